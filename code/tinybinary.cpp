@@ -0,0 +1,590 @@
+/*
+ * @Author       : mark
+ * @Date         : 2020-05-26
+ * @copyleft Apache 2.0
+ */
+
+#include "tinybinary.h"
+#include "tinycontext.h"
+#include <assert.h>  /* assert() */
+#include <float.h>   /* FLT_MAX */
+#include <math.h>    /* signbit(), ldexp() */
+#include <stdlib.h>  /* malloc(), free() */
+#include <string.h>  /* memcpy() */
+
+struct TinyBinContext {
+    const unsigned char* p;
+    const unsigned char* end;
+    TinyContext context;    /* CBOR 不定长字符串/数组的暂存区 */
+};
+
+//大端写入
+static void TinyPutBE(TinyContext* context, unsigned char head, uint64_t u, int bytes) {
+    unsigned char* p = (unsigned char*)TinyContextPush(context, bytes + 1);
+    *p++ = head;
+    for(int i = bytes - 1; i >= 0; i--) {
+        *p++ = (unsigned char)(u >> (8 * i));
+    }
+}
+
+static bool TinyBinRead(TinyBinContext* c, int bytes, uint64_t* u) {
+    if(c->end - c->p < bytes) return false;
+    *u = 0;
+    for(int i = 0; i < bytes; i++) {
+        *u = (*u << 8) | *c->p++;
+    }
+    return true;
+}
+
+//整数值的 number: 非负时 u 为其值, 负数时 u 为其补码
+static bool TinyNumberIsInt(double d, bool* negative, uint64_t* u) {
+    if(d >= 0 && d < 18446744073709551616.0 && d == (double)(uint64_t)d) {
+        if(d == 0 && signbit(d)) return false;  /* -0 只能用浮点数表示 */
+        *negative = false;
+        *u = (uint64_t)d;
+        return true;
+    }
+    if(d < 0 && d >= -9223372036854775808.0 && d == (double)(int64_t)d) {
+        *negative = true;
+        *u = (uint64_t)(int64_t)d;
+        return true;
+    }
+    return false;
+}
+
+static bool TinyNumberIsFloat(double d) {
+    return d >= -FLT_MAX && d <= FLT_MAX && (double)(float)d == d;
+}
+
+static double TinyFloatFromBits(uint32_t bits) {
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+static double TinyDoubleFromBits(uint64_t bits) {
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    return d;
+}
+
+static int TinyBinSetNumber(TinyValue* value, double d) {
+    //NaN 与无穷大不能用 JSON 表示
+    if(d - d != 0) return TINY_PARSE_NUMBER_TOO_BIG;
+    TinySetNumber(value, d);
+    return TINY_PARSE_OK;
+}
+
+static int TinyBinFinish(TinyBinContext* c, TinyValue* value, int ret) {
+    if(ret == TINY_PARSE_OK && c->p != c->end) {
+        ret = TINY_PARSE_ROOT_NOT_SINGULAR;
+    }
+    if(ret != TINY_PARSE_OK) {
+        TinyFree(value);
+    }
+    assert(c->context.top == 0);
+    free(c->context.stack);
+    return ret;
+}
+
+static void TinyBinInit(TinyBinContext* c, const char* data, size_t len) {
+    c->p = (const unsigned char*)data;
+    c->end = c->p + len;
+    c->context.stack = NULL;
+    c->context.size = c->context.top = 0;
+}
+
+/* ------------------------------------------------------------------ */
+/* MessagePack                                                        */
+/* ------------------------------------------------------------------ */
+
+static void TinyMsgPackLength(TinyContext* context, size_t n, unsigned char fix, size_t fixMax, unsigned char head8, unsigned char head16) {
+    if(n <= fixMax) {
+        TinyPutC(context, (char)(fix | n));
+    } else if(head8 != 0 && n <= 0xFF) {
+        TinyPutBE(context, head8, n, 1);
+    } else if(n <= 0xFFFF) {
+        TinyPutBE(context, head16, n, 2);
+    } else {
+        TinyPutBE(context, head16 + 1, n, 4);
+    }
+}
+
+static void TinyEncodeMsgPackValue(TinyContext* context, const TinyValue* value) {
+    switch(TinyGetType(value)) {
+        case TINY_NULL: TinyPutC(context, (char)0xC0); break;
+        case TINY_FALSE: TinyPutC(context, (char)0xC2); break;
+        case TINY_TRUE: TinyPutC(context, (char)0xC3); break;
+        case TINY_NUMBER:
+        {
+            double d = TinyGetNumber(value);
+            bool negative;
+            uint64_t u;
+            if(TinyNumberIsInt(d, &negative, &u)) {
+                int64_t i = (int64_t)u;
+                if(!negative) {
+                    if(u <= 0x7F) TinyPutC(context, (char)u);
+                    else if(u <= 0xFF) TinyPutBE(context, 0xCC, u, 1);
+                    else if(u <= 0xFFFF) TinyPutBE(context, 0xCD, u, 2);
+                    else if(u <= 0xFFFFFFFFULL) TinyPutBE(context, 0xCE, u, 4);
+                    else TinyPutBE(context, 0xCF, u, 8);
+                } else {
+                    if(i >= -32) TinyPutC(context, (char)i);
+                    else if(i >= -128) TinyPutBE(context, 0xD0, u, 1);
+                    else if(i >= -32768) TinyPutBE(context, 0xD1, u, 2);
+                    else if(i >= -2147483648LL) TinyPutBE(context, 0xD2, u, 4);
+                    else TinyPutBE(context, 0xD3, u, 8);
+                }
+            } else if(TinyNumberIsFloat(d)) {
+                float f = (float)d;
+                uint32_t bits;
+                memcpy(&bits, &f, sizeof(bits));
+                TinyPutBE(context, 0xCA, bits, 4);
+            } else {
+                memcpy(&u, &d, sizeof(u));
+                TinyPutBE(context, 0xCB, u, 8);
+            }
+            break;
+        }
+        case TINY_STRING:
+        {
+            size_t len = TinyGetStringLength(value);
+            TinyMsgPackLength(context, len, 0xA0, 31, 0xD9, 0xDA);
+            if(len > 0) TinyPutS(context, TinyGetString(value), len);
+            break;
+        }
+        case TINY_ARRAY:
+        {
+            size_t n = TinyGetArraySize(value);
+            TinyMsgPackLength(context, n, 0x90, 15, 0, 0xDC);
+            for(size_t i = 0; i < n; i++) {
+                TinyEncodeMsgPackValue(context, TinyGetArrayElement(value, i));
+            }
+            break;
+        }
+        case TINY_OBJECT:
+        {
+            size_t n = TinyGetObjectSize(value);
+            TinyMsgPackLength(context, n, 0x80, 15, 0, 0xDE);
+            for(size_t i = 0; i < n; i++) {
+                size_t klen = TinyGetObjectKeyLength(value, i);
+                TinyMsgPackLength(context, klen, 0xA0, 31, 0xD9, 0xDA);
+                if(klen > 0) TinyPutS(context, TinyGetObjectKey(value, i), klen);
+                TinyEncodeMsgPackValue(context, TinyGetObjectValue(value, i));
+            }
+            break;
+        }
+    }
+}
+
+char* TinyEncodeMsgPack(const TinyValue* value, size_t* len) {
+    TinyContext context;
+    assert(value != NULL);
+    context.size = TINY_STACK_SIZE;
+    context.stack = (char*)malloc(context.size);
+    context.top = 0;
+    TinyEncodeMsgPackValue(&context, value);
+    if(len != NULL) *len = context.top;
+    return context.stack;
+}
+
+//读取字符串类型的长度, 不是字符串时返回 false
+static int TinyMsgPackStringHead(TinyBinContext* c, unsigned char b, size_t* len) {
+    uint64_t u;
+    if(b >= 0xA0 && b <= 0xBF) {
+        *len = b & 0x1F;
+    } else if(b == 0xD9 || b == 0xC4) {
+        if(!TinyBinRead(c, 1, &u)) return TINY_PARSE_EXPECT_VALUE;
+        *len = (size_t)u;
+    } else if(b == 0xDA || b == 0xC5) {
+        if(!TinyBinRead(c, 2, &u)) return TINY_PARSE_EXPECT_VALUE;
+        *len = (size_t)u;
+    } else if(b == 0xDB || b == 0xC6) {
+        if(!TinyBinRead(c, 4, &u)) return TINY_PARSE_EXPECT_VALUE;
+        *len = (size_t)u;
+    } else {
+        return TINY_PARSE_MISS_KEY;
+    }
+    if((size_t)(c->end - c->p) < *len) return TINY_PARSE_EXPECT_VALUE;
+    return TINY_PARSE_OK;
+}
+
+static int TinyDecodeMsgPackValue(TinyBinContext* c, TinyValue* value) {
+    uint64_t u;
+    size_t n;
+    int ret;
+    if(c->p == c->end) return TINY_PARSE_EXPECT_VALUE;
+    unsigned char b = *c->p++;
+
+    if(b <= 0x7F) return TinyBinSetNumber(value, b);
+    if(b >= 0xE0) return TinyBinSetNumber(value, (signed char)b);
+    if((b >= 0xA0 && b <= 0xBF) || b == 0xD9 || b == 0xDA || b == 0xDB || b == 0xC4 || b == 0xC5 || b == 0xC6) {
+        ret = TinyMsgPackStringHead(c, b, &n);
+        if(ret != TINY_PARSE_OK) return ret;
+        TinySetString(value, (const char*)c->p, n);
+        c->p += n;
+        return TINY_PARSE_OK;
+    }
+    switch(b) {
+        case 0xC0: TinySetNull(value); return TINY_PARSE_OK;
+        case 0xC2: TinySetBoolen(value, false); return TINY_PARSE_OK;
+        case 0xC3: TinySetBoolen(value, true); return TINY_PARSE_OK;
+        case 0xCA:
+            if(!TinyBinRead(c, 4, &u)) return TINY_PARSE_EXPECT_VALUE;
+            return TinyBinSetNumber(value, TinyFloatFromBits((uint32_t)u));
+        case 0xCB:
+            if(!TinyBinRead(c, 8, &u)) return TINY_PARSE_EXPECT_VALUE;
+            return TinyBinSetNumber(value, TinyDoubleFromBits(u));
+        case 0xCC: case 0xCD: case 0xCE: case 0xCF:
+            if(!TinyBinRead(c, 1 << (b - 0xCC), &u)) return TINY_PARSE_EXPECT_VALUE;
+            return TinyBinSetNumber(value, (double)u);
+        case 0xD0:
+            if(!TinyBinRead(c, 1, &u)) return TINY_PARSE_EXPECT_VALUE;
+            return TinyBinSetNumber(value, (int8_t)u);
+        case 0xD1:
+            if(!TinyBinRead(c, 2, &u)) return TINY_PARSE_EXPECT_VALUE;
+            return TinyBinSetNumber(value, (int16_t)u);
+        case 0xD2:
+            if(!TinyBinRead(c, 4, &u)) return TINY_PARSE_EXPECT_VALUE;
+            return TinyBinSetNumber(value, (int32_t)u);
+        case 0xD3:
+            if(!TinyBinRead(c, 8, &u)) return TINY_PARSE_EXPECT_VALUE;
+            return TinyBinSetNumber(value, (double)(int64_t)u);
+        default:
+            break;
+    }
+
+    bool isMap;
+    if(b >= 0x80 && b <= 0x8F) { n = b & 0x0F; isMap = true; }
+    else if(b >= 0x90 && b <= 0x9F) { n = b & 0x0F; isMap = false; }
+    else if(b == 0xDC || b == 0xDE) {
+        if(!TinyBinRead(c, 2, &u)) return TINY_PARSE_EXPECT_VALUE;
+        n = (size_t)u;
+        isMap = b == 0xDE;
+    } else if(b == 0xDD || b == 0xDF) {
+        if(!TinyBinRead(c, 4, &u)) return TINY_PARSE_EXPECT_VALUE;
+        n = (size_t)u;
+        isMap = b == 0xDF;
+    } else {
+        return TINY_PARSE_INVALID_VALUE;    /* 0xC1 及 ext 类型 */
+    }
+    //每个元素至少一个字节, 避免按伪造的长度申请内存
+    if(n > (size_t)(c->end - c->p)) return TINY_PARSE_EXPECT_VALUE;
+
+    if(!isMap) {
+        TinySetArray(value, n);
+        for(size_t i = 0; i < n; i++) {
+            ret = TinyDecodeMsgPackValue(c, TinyPushBackArrayElement(value));
+            if(ret != TINY_PARSE_OK) {
+                TinyFree(value);
+                return ret;
+            }
+        }
+        return TINY_PARSE_OK;
+    }
+    TinySetObject(value, n);
+    for(size_t i = 0; i < n; i++) {
+        size_t klen;
+        ret = c->p == c->end ? TINY_PARSE_EXPECT_VALUE : TinyMsgPackStringHead(c, *c->p++, &klen);
+        if(ret == TINY_PARSE_OK) {
+            TinyValue* m = TinyPushBackObjectValue(value, (const char*)c->p, klen);
+            c->p += klen;
+            ret = TinyDecodeMsgPackValue(c, m);
+        }
+        if(ret != TINY_PARSE_OK) {
+            TinyFree(value);
+            return ret;
+        }
+    }
+    return TINY_PARSE_OK;
+}
+
+int TinyDecodeMsgPack(TinyValue* value, const char* data, size_t len) {
+    TinyBinContext c;
+    assert(value != NULL && (data != NULL || len == 0));
+    TinyInitValue(value);
+    TinyBinInit(&c, data, len);
+    return TinyBinFinish(&c, value, TinyDecodeMsgPackValue(&c, value));
+}
+
+/* ------------------------------------------------------------------ */
+/* CBOR (RFC 8949)                                                    */
+/* ------------------------------------------------------------------ */
+
+static void TinyCborHead(TinyContext* context, unsigned major, uint64_t u) {
+    unsigned char head = (unsigned char)(major << 5);
+    if(u < 24) TinyPutC(context, (char)(head | u));
+    else if(u <= 0xFF) TinyPutBE(context, head | 24, u, 1);
+    else if(u <= 0xFFFF) TinyPutBE(context, head | 25, u, 2);
+    else if(u <= 0xFFFFFFFFULL) TinyPutBE(context, head | 26, u, 4);
+    else TinyPutBE(context, head | 27, u, 8);
+}
+
+static void TinyEncodeCborValue(TinyContext* context, const TinyValue* value) {
+    switch(TinyGetType(value)) {
+        case TINY_NULL: TinyPutC(context, (char)0xF6); break;
+        case TINY_FALSE: TinyPutC(context, (char)0xF4); break;
+        case TINY_TRUE: TinyPutC(context, (char)0xF5); break;
+        case TINY_NUMBER:
+        {
+            double d = TinyGetNumber(value);
+            bool negative;
+            uint64_t u;
+            if(TinyNumberIsInt(d, &negative, &u)) {
+                //负数 n 编码为 -1 - n
+                if(negative) TinyCborHead(context, 1, ~u);
+                else TinyCborHead(context, 0, u);
+            } else if(TinyNumberIsFloat(d)) {
+                float f = (float)d;
+                uint32_t bits;
+                memcpy(&bits, &f, sizeof(bits));
+                TinyPutBE(context, 0xFA, bits, 4);
+            } else {
+                memcpy(&u, &d, sizeof(u));
+                TinyPutBE(context, 0xFB, u, 8);
+            }
+            break;
+        }
+        case TINY_STRING:
+        {
+            size_t len = TinyGetStringLength(value);
+            TinyCborHead(context, 3, len);
+            if(len > 0) TinyPutS(context, TinyGetString(value), len);
+            break;
+        }
+        case TINY_ARRAY:
+        {
+            size_t n = TinyGetArraySize(value);
+            TinyCborHead(context, 4, n);
+            for(size_t i = 0; i < n; i++) {
+                TinyEncodeCborValue(context, TinyGetArrayElement(value, i));
+            }
+            break;
+        }
+        case TINY_OBJECT:
+        {
+            size_t n = TinyGetObjectSize(value);
+            TinyCborHead(context, 5, n);
+            for(size_t i = 0; i < n; i++) {
+                size_t klen = TinyGetObjectKeyLength(value, i);
+                TinyCborHead(context, 3, klen);
+                if(klen > 0) TinyPutS(context, TinyGetObjectKey(value, i), klen);
+                TinyEncodeCborValue(context, TinyGetObjectValue(value, i));
+            }
+            break;
+        }
+    }
+}
+
+char* TinyEncodeCbor(const TinyValue* value, size_t* len) {
+    TinyContext context;
+    assert(value != NULL);
+    context.size = TINY_STACK_SIZE;
+    context.stack = (char*)malloc(context.size);
+    context.top = 0;
+    TinyEncodeCborValue(&context, value);
+    if(len != NULL) *len = context.top;
+    return context.stack;
+}
+
+//读取头部的参数; 不定长(info 为 31)单独用 indefinite 表示, 2^64-1 是合法的定长
+static int TinyCborArgument(TinyBinContext* c, unsigned info, uint64_t* u, bool* indefinite) {
+    *indefinite = false;
+    if(info < 24) {
+        *u = info;
+    } else if(info <= 27) {
+        if(!TinyBinRead(c, 1 << (info - 24), u)) return TINY_PARSE_EXPECT_VALUE;
+    } else if(info == 31) {
+        *u = 0;
+        *indefinite = true;
+    } else {
+        return TINY_PARSE_INVALID_VALUE;
+    }
+    return TINY_PARSE_OK;
+}
+
+static double TinyHalfToDouble(unsigned half) {
+    unsigned exp = (half >> 10) & 0x1F, mant = half & 0x3FF;
+    double d;
+    if(exp == 0) d = ldexp(mant, -24);
+    else if(exp != 31) d = ldexp(mant + 1024, exp - 25);
+    else d = mant == 0 ? HUGE_VAL : NAN;
+    return (half & 0x8000) ? -d : d;
+}
+
+//读取字符串(major 2/3), 不定长字符串的各段拼接到暂存区
+//成功时字符串位于 *str, 若 *pushed 非零则位于暂存区顶部, 用完需弹出
+static int TinyCborString(TinyBinContext* c, unsigned major, uint64_t u, bool indefinite, const char** str, size_t* len, size_t* pushed) {
+    *pushed = 0;
+    if(!indefinite) {
+        if(u > (uint64_t)(c->end - c->p)) return TINY_PARSE_EXPECT_VALUE;
+        *str = (const char*)c->p;
+        *len = (size_t)u;
+        c->p += u;
+        return TINY_PARSE_OK;
+    }
+    size_t head = c->context.top;
+    int ret = TINY_PARSE_OK;
+    while(true) {
+        if(c->p == c->end) { ret = TINY_PARSE_EXPECT_VALUE; break; }
+        unsigned char b = *c->p++;
+        if(b == 0xFF) break;
+        //每一段必须是同类型的定长字符串
+        if((b >> 5) != major || (b & 0x1F) == 31) { ret = TINY_PARSE_INVALID_VALUE; break; }
+        ret = TinyCborArgument(c, b & 0x1F, &u, &indefinite);
+        if(ret != TINY_PARSE_OK) break;
+        if(u > (uint64_t)(c->end - c->p)) { ret = TINY_PARSE_EXPECT_VALUE; break; }
+        if(u > 0) TinyPutS(&c->context, (const char*)c->p, (size_t)u);
+        c->p += u;
+    }
+    *pushed = c->context.top - head;
+    if(ret != TINY_PARSE_OK) {
+        c->context.top = head;
+        *pushed = 0;
+        return ret;
+    }
+    *len = *pushed;
+    *str = c->context.stack + head;
+    return TINY_PARSE_OK;
+}
+
+static int TinyDecodeCborValue(TinyBinContext* c, TinyValue* value);
+
+static bool TinyCborBreak(TinyBinContext* c) {
+    if(c->p != c->end && *c->p == 0xFF) {
+        c->p++;
+        return true;
+    }
+    return false;
+}
+
+static int TinyDecodeCborArray(TinyBinContext* c, TinyValue* value, uint64_t n, bool indefinite) {
+    int ret = TINY_PARSE_OK;
+    if(!indefinite) {
+        if(n > (uint64_t)(c->end - c->p)) return TINY_PARSE_EXPECT_VALUE;
+        TinySetArray(value, (size_t)n);
+        for(size_t i = 0; i < n; i++) {
+            ret = TinyDecodeCborValue(c, TinyPushBackArrayElement(value));
+            if(ret != TINY_PARSE_OK) {
+                TinyFree(value);
+                return ret;
+            }
+        }
+        return TINY_PARSE_OK;
+    }
+    //不定长: 和 TinyParseArray 一样先把元素压入暂存区
+    size_t size = 0;
+    while(!TinyCborBreak(c)) {
+        TinyValue e;
+        TinyInitValue(&e);
+        ret = TinyDecodeCborValue(c, &e);
+        if(ret != TINY_PARSE_OK) break;
+        memcpy(TinyContextPush(&c->context, sizeof(TinyValue)), &e, sizeof(TinyValue));
+        size++;
+    }
+    if(ret == TINY_PARSE_OK) {
+        TinyValue* e = (TinyValue*)TinyContextPop(&c->context, size * sizeof(TinyValue));
+        TinySetArray(value, size);
+        for(size_t i = 0; i < size; i++) {
+            TinyMove(TinyPushBackArrayElement(value), &e[i]);
+        }
+        return TINY_PARSE_OK;
+    }
+    for(size_t i = 0; i < size; i++) {
+        TinyFree((TinyValue*)TinyContextPop(&c->context, sizeof(TinyValue)));
+    }
+    return ret;
+}
+
+static int TinyDecodeCborMap(TinyBinContext* c, TinyValue* value, uint64_t n, bool indefinite) {
+    int ret = TINY_PARSE_OK;
+    if(!indefinite && n > (uint64_t)(c->end - c->p)) return TINY_PARSE_EXPECT_VALUE;
+    TinySetObject(value, indefinite ? 0 : (size_t)n);
+    for(uint64_t i = 0; indefinite ? !TinyCborBreak(c) : i < n; i++) {
+        const char* key;
+        size_t klen, pushed;
+        uint64_t u;
+        bool keyIndefinite;
+        if(c->p == c->end) {
+            ret = TINY_PARSE_EXPECT_VALUE;
+            break;
+        }
+        unsigned char b = *c->p++;
+        if((b >> 5) != 2 && (b >> 5) != 3) {
+            ret = TINY_PARSE_MISS_KEY;
+            break;
+        }
+        ret = TinyCborArgument(c, b & 0x1F, &u, &keyIndefinite);
+        if(ret == TINY_PARSE_OK) ret = TinyCborString(c, b >> 5, u, keyIndefinite, &key, &klen, &pushed);
+        if(ret != TINY_PARSE_OK) break;
+        TinyValue* m = TinyPushBackObjectValue(value, key, klen);
+        c->context.top -= pushed;
+        ret = TinyDecodeCborValue(c, m);
+        if(ret != TINY_PARSE_OK) break;
+    }
+    if(ret != TINY_PARSE_OK) TinyFree(value);
+    return ret;
+}
+
+static int TinyDecodeCborValue(TinyBinContext* c, TinyValue* value) {
+    uint64_t u;
+    bool indefinite;
+    int ret;
+    if(c->p == c->end) return TINY_PARSE_EXPECT_VALUE;
+    unsigned char b = *c->p++;
+    unsigned major = b >> 5, info = b & 0x1F;
+
+    if(major == 7) {
+        switch(info) {
+            case 20: TinySetBoolen(value, false); return TINY_PARSE_OK;
+            case 21: TinySetBoolen(value, true); return TINY_PARSE_OK;
+            case 22: case 23: TinySetNull(value); return TINY_PARSE_OK;   /* null, undefined */
+            case 25:
+                if(!TinyBinRead(c, 2, &u)) return TINY_PARSE_EXPECT_VALUE;
+                return TinyBinSetNumber(value, TinyHalfToDouble((unsigned)u));
+            case 26:
+                if(!TinyBinRead(c, 4, &u)) return TINY_PARSE_EXPECT_VALUE;
+                return TinyBinSetNumber(value, TinyFloatFromBits((uint32_t)u));
+            case 27:
+                if(!TinyBinRead(c, 8, &u)) return TINY_PARSE_EXPECT_VALUE;
+                return TinyBinSetNumber(value, TinyDoubleFromBits(u));
+            default:
+                return TINY_PARSE_INVALID_VALUE;
+        }
+    }
+    ret = TinyCborArgument(c, info, &u, &indefinite);
+    if(ret != TINY_PARSE_OK) return ret;
+    switch(major) {
+        case 0:
+        case 1:
+            if(indefinite) return TINY_PARSE_INVALID_VALUE;
+            return TinyBinSetNumber(value, major == 0 ? (double)u : -1.0 - (double)u);
+        case 2:
+        case 3:
+        {
+            const char* str;
+            size_t len, pushed;
+            ret = TinyCborString(c, major, u, indefinite, &str, &len, &pushed);
+            if(ret != TINY_PARSE_OK) return ret;
+            TinySetString(value, str, len);
+            c->context.top -= pushed;
+            return TINY_PARSE_OK;
+        }
+        case 4:
+            return TinyDecodeCborArray(c, value, u, indefinite);
+        case 5:
+            return TinyDecodeCborMap(c, value, u, indefinite);
+        default:
+            //tag: 忽略标签, 解码其后的值
+            if(info == 31) return TINY_PARSE_INVALID_VALUE;
+            return TinyDecodeCborValue(c, value);
+    }
+}
+
+int TinyDecodeCbor(TinyValue* value, const char* data, size_t len) {
+    TinyBinContext c;
+    assert(value != NULL && (data != NULL || len == 0));
+    TinyInitValue(value);
+    TinyBinInit(&c, data, len);
+    return TinyBinFinish(&c, value, TinyDecodeCborValue(&c, value));
+}
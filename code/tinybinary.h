@@ -0,0 +1,26 @@
+/*
+ * @Author       : mark
+ * @Date         : 2020-05-26
+ * @copyleft Apache 2.0
+ */
+
+#ifndef TINYBINARY_H
+#define TINYBINARY_H
+
+#include "tinyjson.h"
+
+// MessagePack / CBOR 与 TinyValue 互转
+// 整数值的 number 编码为整数类型, 其余编码为 float32(无损时)或 float64
+// 返回的缓冲区由调用者 free(); 解码失败时 value 为 TINY_NULL, 返回值同 TinyParse:
+//   TINY_PARSE_EXPECT_VALUE       数据不完整
+//   TINY_PARSE_INVALID_VALUE      不支持或不合法的类型字节
+//   TINY_PARSE_NUMBER_TOO_BIG     NaN 或无穷大
+//   TINY_PARSE_MISS_KEY           map 的键不是字符串
+//   TINY_PARSE_ROOT_NOT_SINGULAR  根值之后还有数据
+char* TinyEncodeMsgPack(const TinyValue* value, size_t* len);
+int TinyDecodeMsgPack(TinyValue* value, const char* data, size_t len);
+
+char* TinyEncodeCbor(const TinyValue* value, size_t* len);
+int TinyDecodeCbor(TinyValue* value, const char* data, size_t len);
+
+#endif // TINYBINARY_H
@@ -0,0 +1,480 @@
+/*
+ * @Author       : mark
+ * @Date         : 2020-05-26
+ * @copyleft Apache 2.0
+ */
+
+#include "tinybind.h"
+#include "tinycontext.h"
+#include <assert.h>  /* assert() */
+#include <math.h>    /* HUGE_VAL */
+#include <stdlib.h>  /* strtod(), free() */
+#include <string.h>  /* memcmp(), strchr() */
+
+void TinyBindReaderInit(TinyBindReader* r, const char* json) {
+    assert(r != NULL && json != NULL);
+    r->json = json;
+    r->context.stack = NULL;
+    r->context.size = r->context.top = 0;
+}
+
+void TinyBindReaderFree(TinyBindReader* r) {
+    free(r->context.stack);
+    r->context.stack = NULL;
+    r->context.size = r->context.top = 0;
+}
+
+void TinyBindSkipWhiteSpace(TinyBindReader* r) {
+    const char *p = r->json;
+    while(*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r') p++;
+    r->json = p;
+}
+
+//读到的不是期望的类型: 是其它合法值的开头时为类型不符
+static int TinyBindMismatch(const TinyBindReader* r) {
+    const char* p = r->json;
+    switch(*p) {
+        case '\0': return TINY_PARSE_EXPECT_VALUE;
+        case 't': return memcmp(p, "true", 4) == 0 ? TINY_BIND_TYPE_MISMATCH : TINY_PARSE_INVALID_VALUE;
+        case 'f': return memcmp(p, "false", 5) == 0 ? TINY_BIND_TYPE_MISMATCH : TINY_PARSE_INVALID_VALUE;
+        case 'n': return memcmp(p, "null", 4) == 0 ? TINY_BIND_TYPE_MISMATCH : TINY_PARSE_INVALID_VALUE;
+        default: return strchr("{[\"-0123456789", *p) != NULL ? TINY_BIND_TYPE_MISMATCH : TINY_PARSE_INVALID_VALUE;
+    }
+}
+
+static int TinyBindLiteral(TinyBindReader* r, const char* literal, size_t len) {
+    if(memcmp(r->json, literal, len) != 0) return TINY_PARSE_INVALID_VALUE;
+    r->json += len;
+    return TINY_PARSE_OK;
+}
+
+int TinyBindReadBool(TinyBindReader* r, bool* out) {
+    switch(*r->json) {
+        case 't': *out = true; return TinyBindLiteral(r, "true", 4);
+        case 'f': *out = false; return TinyBindLiteral(r, "false", 5);
+        default: return TinyBindMismatch(r);
+    }
+}
+
+bool TinyBindReadNull(TinyBindReader* r) {
+    return *r->json == 'n' && TinyBindLiteral(r, "null", 4) == TINY_PARSE_OK;
+}
+
+static bool TinyBindIsDigit(char ch) {
+    return ch >= '0' && ch <= '9';
+}
+
+//按 JSON 语法检查数字, 返回其后的位置, 不合法时返回 NULL
+static const char* TinyBindScanNumber(const char* p) {
+    if(*p == '-') p++;
+    if(*p == '0') p++;
+    else {
+        if(*p < '1' || *p > '9') return NULL;
+        for(p++; TinyBindIsDigit(*p); p++);
+    }
+    if(*p == '.') {
+        p++;
+        if(!TinyBindIsDigit(*p)) return NULL;
+        for(p++; TinyBindIsDigit(*p); p++);
+    }
+    if(*p == 'e' || *p == 'E') {
+        p++;
+        if(*p == '-' || *p == '+') p++;
+        if(!TinyBindIsDigit(*p)) return NULL;
+        for(p++; TinyBindIsDigit(*p); p++);
+    }
+    return p;
+}
+
+int TinyBindReadDouble(TinyBindReader* r, double* out) {
+    if(*r->json != '-' && !TinyBindIsDigit(*r->json)) return TinyBindMismatch(r);
+    const char* end = TinyBindScanNumber(r->json);
+    if(end == NULL) return TINY_PARSE_INVALID_VALUE;
+    *out = strtod(r->json, NULL);
+    //同 TinyParse: 只有溢出才报错, 下溢(如 1e-320)得到非规格化数或 0, errno 也会是 ERANGE
+    if(*out == HUGE_VAL || *out == -HUGE_VAL) return TINY_PARSE_NUMBER_TOO_BIG;
+    r->json = end;
+    return TINY_PARSE_OK;
+}
+
+int TinyBindReadInt64(TinyBindReader* r, int64_t* out) {
+    const char* p = r->json;
+    bool negative = *p == '-';
+    if(negative) p++;
+    if(!TinyBindIsDigit(*p)) return negative ? TINY_PARSE_INVALID_VALUE : TinyBindMismatch(r);
+    //整数部分全部精确累加, 超出 int64_t 的范围时报错; 只有带小数或指数时才交给 strtod
+    const uint64_t limit = negative ? (uint64_t)INT64_MAX + 1 : (uint64_t)INT64_MAX;
+    uint64_t u = 0;
+    bool overflow = false;
+    const char* digits = p;
+    for(; TinyBindIsDigit(*p); p++) {
+        unsigned d = *p - '0';
+        if(u > (limit - d) / 10) overflow = true;
+        else u = u * 10 + d;
+    }
+    if(*p != '.' && *p != 'e' && *p != 'E') {
+        if(*digits == '0' && p - digits > 1) return TINY_PARSE_INVALID_VALUE;
+        if(overflow) return TINY_BIND_TYPE_MISMATCH;
+        *out = negative ? (u == (uint64_t)INT64_MAX + 1 ? INT64_MIN : -(int64_t)u) : (int64_t)u;
+        r->json = p;
+        return TINY_PARSE_OK;
+    }
+    double num;
+    int ret = TinyBindReadDouble(r, &num);
+    if(ret != TINY_PARSE_OK) return ret;
+    //2^63 是 double 能精确表示的边界
+    if(num != (double)(int64_t)num || num >= 9223372036854775808.0 || num < -9223372036854775808.0) {
+        return TINY_BIND_TYPE_MISMATCH;
+    }
+    *out = (int64_t)num;
+    return TINY_PARSE_OK;
+}
+
+static const char* TinyBindHex4(const char* p, unsigned* u) {
+    *u = 0;
+    for(int i = 0; i < 4; i++) {
+        char ch = *p++;
+        *u <<= 4;
+        if     (ch >= '0' && ch <= '9')  *u |= ch - '0';
+        else if(ch >= 'A' && ch <= 'F')  *u |= ch - ('A' - 10);
+        else if(ch >= 'a' && ch <= 'f')  *u |= ch - ('a' - 10);
+        else return NULL;
+    }
+    return p;
+}
+
+static void TinyBindEncodeUtf8(TinyContext* context, unsigned u) {
+    char* p;
+    if(u <= 0x7F) {
+        TinyPutC(context, (char)u);
+    } else if(u <= 0x7FF) {
+        p = (char*)TinyContextPush(context, 2);
+        p[0] = (char)(0xC0 | (u >> 6));
+        p[1] = (char)(0x80 | (u & 0x3F));
+    } else if(u <= 0xFFFF) {
+        p = (char*)TinyContextPush(context, 3);
+        p[0] = (char)(0xE0 | (u >> 12));
+        p[1] = (char)(0x80 | ((u >> 6) & 0x3F));
+        p[2] = (char)(0x80 | (u & 0x3F));
+    } else {
+        p = (char*)TinyContextPush(context, 4);
+        p[0] = (char)(0xF0 | (u >> 18));
+        p[1] = (char)(0x80 | ((u >> 12) & 0x3F));
+        p[2] = (char)(0x80 | ((u >> 6) & 0x3F));
+        p[3] = (char)(0x80 | (u & 0x3F));
+    }
+}
+
+//读取字符串: 没有转义时直接指向 json 中的内容, 否则解码到 context
+//结果在下一次读取之前有效
+static int TinyBindReadRaw(TinyBindReader* r, const char** str, size_t* len) {
+    const char* p = r->json + 1;
+    const char* start = p;
+    assert(*r->json == '"');
+    while(true) {
+        unsigned char ch = (unsigned char)*p;
+        if(ch == '"') {
+            *str = start;
+            *len = p - start;
+            r->json = p + 1;
+            return TINY_PARSE_OK;
+        }
+        if(ch == '\\') break;
+        if(ch < 0x20) return ch == '\0' ? TINY_PARSE_MISS_QUOTATION_MARK : TINY_PARSE_INVALID_STRING_CHAR;
+        p++;
+    }
+    TinyContext* context = &r->context;
+    size_t head = context->top;
+    unsigned u, u2;
+    if(p > start) TinyPutS(context, start, p - start);
+    while(true) {
+        char ch = *p++;
+        switch(ch) {
+            case '"':
+                *len = context->top - head;
+                *str = context->stack + head;
+                context->top = head;
+                r->json = p;
+                return TINY_PARSE_OK;
+            case '\\':
+                switch(*p++) {
+                    case '"': TinyPutC(context, '"'); break;
+                    case '\\': TinyPutC(context, '\\'); break;
+                    case '/': TinyPutC(context, '/'); break;
+                    case 'b': TinyPutC(context, '\b'); break;
+                    case 'f': TinyPutC(context, '\f'); break;
+                    case 'n': TinyPutC(context, '\n'); break;
+                    case 'r': TinyPutC(context, '\r'); break;
+                    case 't': TinyPutC(context, '\t'); break;
+                    case 'u':
+                        p = TinyBindHex4(p, &u);
+                        if(p == NULL) {
+                            context->top = head;
+                            return TINY_PARSE_INVALID_UNICODE_HEX;
+                        }
+                        if(u >= 0xD800 && u <= 0xDBFF) {
+                            if(p[0] != '\\' || p[1] != 'u' || (p = TinyBindHex4(p + 2, &u2)) == NULL
+                               || u2 < 0xDC00 || u2 > 0xDFFF) {
+                                context->top = head;
+                                return TINY_PARSE_INVALID_UNICODE_SURROGATE;
+                            }
+                            u = (((u - 0xD800) << 10) | (u2 - 0xDC00)) + 0x10000;
+                        }
+                        TinyBindEncodeUtf8(context, u);
+                        break;
+                    default:
+                        context->top = head;
+                        return TINY_PARSE_INVALID_STRING_ESCAPE;
+                }
+                break;
+            case '\0':
+                context->top = head;
+                return TINY_PARSE_MISS_QUOTATION_MARK;
+            default:
+                if((unsigned char)ch < 0x20) {
+                    context->top = head;
+                    return TINY_PARSE_INVALID_STRING_CHAR;
+                }
+                TinyPutC(context, ch);
+        }
+    }
+}
+
+int TinyBindReadString(TinyBindReader* r, std::string* out) {
+    const char* str;
+    size_t len;
+    if(*r->json != '"') return TinyBindMismatch(r);
+    int ret = TinyBindReadRaw(r, &str, &len);
+    if(ret == TINY_PARSE_OK) out->assign(str, len);
+    return ret;
+}
+
+int TinyBindReadStringRef(TinyBindReader* r, const char** str, size_t* len) {
+    if(*r->json != '"') return TinyBindMismatch(r);
+    return TinyBindReadRaw(r, str, len);
+}
+
+int TinyBindStartArray(TinyBindReader* r) {
+    if(*r->json != '[') return TinyBindMismatch(r);
+    r->json++;
+    return TINY_PARSE_OK;
+}
+
+int TinyBindNextElement(TinyBindReader* r, size_t index, bool* more) {
+    TinyBindSkipWhiteSpace(r);
+    if(*r->json == ']') {
+        r->json++;
+        *more = false;
+        return TINY_PARSE_OK;
+    }
+    if(index > 0) {
+        if(*r->json != ',') return TINY_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+        r->json++;
+        TinyBindSkipWhiteSpace(r);
+    }
+    *more = true;
+    return TINY_PARSE_OK;
+}
+
+//跳过未登记成员的值: 不递归, 用 context 记下各层的右括号
+//检查括号配对、字符串和各个标量, 不检查逗号和冒号的位置
+//跳过时各层容器的状态: 下一个应当出现的是什么
+enum TinyBindSkipState {
+    TINY_SKIP_OBJECT_START,     /* 键或 '}' */
+    TINY_SKIP_OBJECT_KEY,       /* ',' 之后的键 */
+    TINY_SKIP_OBJECT_COLON,
+    TINY_SKIP_OBJECT_VALUE,
+    TINY_SKIP_OBJECT_NEXT,      /* ',' 或 '}' */
+    TINY_SKIP_ARRAY_START,      /* 值或 ']' */
+    TINY_SKIP_ARRAY_VALUE,      /* ',' 之后的值 */
+    TINY_SKIP_ARRAY_NEXT,       /* ',' 或 ']' */
+};
+
+//不递归: 每层容器在 context 中占一个字节记下状态, 逗号、冒号和括号都按 JSON 语法检查
+int TinyBindSkipValue(TinyBindReader* r) {
+    TinyContext* context = &r->context;
+    const size_t head = context->top;
+    int ret = TINY_PARSE_OK;
+    const char* str;
+    size_t len;
+    double num;
+    do {
+        TinyBindSkipWhiteSpace(r);
+        char* state = context->top > head ? &context->stack[context->top - 1] : NULL;
+        bool value = state == NULL;
+        if(state != NULL) {
+            switch(*state) {
+                case TINY_SKIP_OBJECT_START:
+                case TINY_SKIP_OBJECT_KEY:
+                    if(*r->json == '}' && *state == TINY_SKIP_OBJECT_START) {
+                        r->json++;
+                        context->top--;
+                    } else if(*r->json != '"') {
+                        ret = TINY_PARSE_MISS_KEY;
+                    } else if((ret = TinyBindReadRaw(r, &str, &len)) == TINY_PARSE_OK) {
+                        *state = TINY_SKIP_OBJECT_COLON;
+                    }
+                    break;
+                case TINY_SKIP_OBJECT_COLON:
+                    if(*r->json != ':') {
+                        ret = TINY_PARSE_MISS_COLON;
+                    } else {
+                        r->json++;
+                        *state = TINY_SKIP_OBJECT_VALUE;
+                    }
+                    break;
+                case TINY_SKIP_OBJECT_NEXT:
+                case TINY_SKIP_ARRAY_NEXT:
+                {
+                    bool object = *state == TINY_SKIP_OBJECT_NEXT;
+                    if(*r->json == ',') {
+                        r->json++;
+                        *state = object ? TINY_SKIP_OBJECT_KEY : TINY_SKIP_ARRAY_VALUE;
+                    } else if(*r->json == (object ? '}' : ']')) {
+                        r->json++;
+                        context->top--;
+                    } else {
+                        ret = object ? TINY_PARSE_MISS_COMMA_OR_CURLY_BRACKET : TINY_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+                    }
+                    break;
+                }
+                case TINY_SKIP_ARRAY_START:
+                    if(*r->json == ']') {
+                        r->json++;
+                        context->top--;
+                    } else {
+                        value = true;
+                    }
+                    break;
+                default:
+                    value = true;
+                    break;
+            }
+        }
+        if(!value || ret != TINY_PARSE_OK) continue;
+        //读一个值; 所在容器接下来应当是 ',' 或右括号
+        if(state != NULL) {
+            *state = *state == TINY_SKIP_OBJECT_VALUE ? TINY_SKIP_OBJECT_NEXT : TINY_SKIP_ARRAY_NEXT;
+        }
+        switch(*r->json) {
+            case '{': TinyPutC(context, TINY_SKIP_OBJECT_START); r->json++; break;
+            case '[': TinyPutC(context, TINY_SKIP_ARRAY_START); r->json++; break;
+            case '"':
+                //解码用到的空间在各层状态之上, 读完后即归还
+                ret = TinyBindReadRaw(r, &str, &len);
+                break;
+            case 't': ret = TinyBindLiteral(r, "true", 4); break;
+            case 'f': ret = TinyBindLiteral(r, "false", 5); break;
+            case 'n': ret = TinyBindLiteral(r, "null", 4); break;
+            case '\0': ret = TINY_PARSE_EXPECT_VALUE; break;
+            case '-': case '0': case '1': case '2': case '3': case '4':
+            case '5': case '6': case '7': case '8': case '9':
+                ret = TinyBindReadDouble(r, &num);
+                break;
+            default: ret = TINY_PARSE_INVALID_VALUE; break;
+        }
+    } while(ret == TINY_PARSE_OK && context->top > head);
+    context->top = head;
+    return ret;
+}
+
+//FNV-1a
+static uint64_t TinyBindHash(const char* key, size_t klen) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for(size_t i = 0; i < klen; i++) {
+        h = (h ^ (unsigned char)key[i]) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+TinyBindStruct TinyBindMakeStruct(TinyBindField* fields, size_t count) {
+    assert(count <= 64);
+    for(size_t i = 0; i < count; i++) {
+        fields[i].hash = TinyBindHash(fields[i].key, fields[i].klen);
+    }
+    TinyBindStruct s = { fields, count };
+    return s;
+}
+
+//键通常按声明顺序出现, 先比较下一个成员, 不中再按哈希查找
+static const TinyBindField* TinyBindFindField(const TinyBindStruct* s, const char* key, size_t klen, size_t next) {
+    if(next < s->count) {
+        const TinyBindField* f = &s->fields[next];
+        if(f->klen == klen && memcmp(f->key, key, klen) == 0) return f;
+    }
+    uint64_t h = TinyBindHash(key, klen);
+    for(size_t i = 0; i < s->count; i++) {
+        const TinyBindField* f = &s->fields[i];
+        if(f->hash == h && f->klen == klen && memcmp(f->key, key, klen) == 0) return f;
+    }
+    return NULL;
+}
+
+int TinyBindParseStruct(TinyBindReader* r, const TinyBindStruct* s, void* obj) {
+    uint64_t seen = 0;
+    size_t next = 0;
+    int ret;
+    if(*r->json != '{') return TinyBindMismatch(r);
+    r->json++;
+    TinyBindSkipWhiteSpace(r);
+    if(*r->json == '}') {
+        r->json++;
+    } else {
+        while(true) {
+            const char* key;
+            size_t klen;
+            if(*r->json != '"') return TINY_PARSE_MISS_KEY;
+            ret = TinyBindReadRaw(r, &key, &klen);
+            if(ret != TINY_PARSE_OK) return ret;
+            const TinyBindField* f = TinyBindFindField(s, key, klen, next);
+            TinyBindSkipWhiteSpace(r);
+            if(*r->json != ':') return TINY_PARSE_MISS_COLON;
+            r->json++;
+            TinyBindSkipWhiteSpace(r);
+            if(f != NULL) {
+                next = f - s->fields;
+                seen |= 1ULL << next;
+                next++;
+                ret = f->parse(r, obj);
+            } else {
+                ret = TinyBindSkipValue(r);
+            }
+            if(ret != TINY_PARSE_OK) return ret;
+            TinyBindSkipWhiteSpace(r);
+            if(*r->json == '}') {
+                r->json++;
+                break;
+            }
+            if(*r->json != ',') return TINY_PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+            r->json++;
+            TinyBindSkipWhiteSpace(r);
+        }
+    }
+    for(size_t i = 0; i < s->count; i++) {
+        if(seen & (1ULL << i)) continue;
+        if(s->fields[i].reset == NULL) return TINY_BIND_MISSING_FIELD;
+        s->fields[i].reset(obj);
+    }
+    return TINY_PARSE_OK;
+}
+
+void TinyBindWriteStruct(TinyWriter* w, const TinyBindStruct* s, const void* obj) {
+    TinyWriterStartObject(w);
+    for(size_t i = 0; i < s->count; i++) {
+        const TinyBindField* f = &s->fields[i];
+        if(f->present != NULL && !f->present(obj)) continue;
+        TinyWriterKey(w, f->key, f->klen);
+        f->write(w, obj);
+    }
+    TinyWriterEndObject(w);
+}
+
+char* TinyBindTakeString(TinyWriter* w, size_t* len) {
+    char* json = NULL;
+    if(TinyWriterGetString(w, len) != NULL) {
+        json = w->context.stack;
+        w->context.stack = NULL;
+    }
+    TinyWriterFree(w);
+    return json;
+}
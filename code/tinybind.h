@@ -0,0 +1,254 @@
+/*
+ * @Author       : mark
+ * @Date         : 2020-05-26
+ * @copyleft Apache 2.0
+ */
+
+#ifndef TINYBIND_H
+#define TINYBIND_H
+
+#include "tinyjson.h"
+#include <limits.h>  /* INT_MIN, INT_MAX */
+#include <string>
+#include <utility>
+#include <vector>
+
+// C++ 结构体与 JSON 直接互转, 不经过 TinyValue
+//
+//   struct User { int64_t id; std::string name; std::vector<std::string> tags; TinyOptional<double> score; };
+//   TINY_BIND_BEGIN(User)
+//       TINY_BIND_FIELD(id)
+//       TINY_BIND_FIELD(name)
+//       TINY_BIND_FIELD_AS(tags, "labels")
+//       TINY_BIND_FIELD(score)
+//   TINY_BIND_END()
+//
+//   User u;
+//   int ret = TinyBindParse(&u, json);
+//   char* out = TinyBindStringify(u, &len);
+//
+// 支持 bool、int、int64_t、double、std::string、std::vector<T>、TinyOptional<T> 以及登记过的结构体
+// 未登记的键直接跳过; 缺少非 TinyOptional 的成员时返回 TINY_BIND_MISSING_FIELD
+// 失败时 out 可能已被部分写入
+
+// 可以缺少或为 null 的成员, 输出时没有值则省略
+template <class T>
+struct TinyOptional {
+    bool has;
+    T value;
+    TinyOptional() : has(false), value() {}
+};
+
+struct TinyBindReader {
+    const char* json;
+    TinyContext context;        /* 含转义的字符串解码到这里 */
+};
+
+// 以下供模板展开使用
+void TinyBindSkipWhiteSpace(TinyBindReader* r);
+int TinyBindReadBool(TinyBindReader* r, bool* out);
+int TinyBindReadDouble(TinyBindReader* r, double* out);
+int TinyBindReadInt64(TinyBindReader* r, int64_t* out);
+int TinyBindReadString(TinyBindReader* r, std::string* out);
+// 不复制: 没有转义时指向 json 中的内容, 否则指向 context, 在下一次读取之前有效
+int TinyBindReadStringRef(TinyBindReader* r, const char** str, size_t* len);
+// 读到 null 时返回 true 并跳过
+bool TinyBindReadNull(TinyBindReader* r);
+// 读取 '['
+int TinyBindStartArray(TinyBindReader* r);
+// index 为已读的元素个数; 读取其后的 ',' 或 ']', *more 表示还有元素
+int TinyBindNextElement(TinyBindReader* r, size_t index, bool* more);
+// 跳过一个完整的值, 检查括号、逗号、冒号和各个标量, 错误码同 TinyParse
+int TinyBindSkipValue(TinyBindReader* r);
+
+// 结构体成员的描述, 由 TINY_BIND_FIELD 生成
+struct TinyBindField {
+    const char* key;
+    size_t klen;
+    uint64_t hash;
+    int (*parse)(TinyBindReader* r, void* obj);
+    void (*write)(TinyWriter* w, const void* obj);
+    bool (*present)(const void* obj);       /* 可选成员是否有值, 必需成员为 NULL */
+    void (*reset)(void* obj);               /* 可选成员缺少时清除 */
+};
+
+struct TinyBindStruct {
+    const TinyBindField* fields;
+    size_t count;                           /* 最多 64 个成员, TINY_BIND_END 在编译期检查 */
+};
+
+TinyBindStruct TinyBindMakeStruct(TinyBindField* fields, size_t count);
+int TinyBindParseStruct(TinyBindReader* r, const TinyBindStruct* s, void* obj);
+void TinyBindWriteStruct(TinyWriter* w, const TinyBindStruct* s, const void* obj);
+
+void TinyBindReaderInit(TinyBindReader* r, const char* json);
+void TinyBindReaderFree(TinyBindReader* r);
+// 取走 writer 中完整的输出, 由调用者 free()
+char* TinyBindTakeString(TinyWriter* w, size_t* len);
+
+template <class T>
+struct TinyBindTraits;
+
+template <>
+struct TinyBindTraits<bool> {
+    static int Parse(TinyBindReader* r, bool* out) { return TinyBindReadBool(r, out); }
+    static void Write(TinyWriter* w, bool in) { TinyWriterBool(w, in); }
+};
+
+template <>
+struct TinyBindTraits<double> {
+    static int Parse(TinyBindReader* r, double* out) { return TinyBindReadDouble(r, out); }
+    static void Write(TinyWriter* w, double in) { TinyWriterNumber(w, in); }
+};
+
+template <>
+struct TinyBindTraits<int64_t> {
+    static int Parse(TinyBindReader* r, int64_t* out) { return TinyBindReadInt64(r, out); }
+    static void Write(TinyWriter* w, int64_t in) { TinyWriterInt64(w, in); }
+};
+
+template <>
+struct TinyBindTraits<int> {
+    static int Parse(TinyBindReader* r, int* out) {
+        int64_t n;
+        int ret = TinyBindReadInt64(r, &n);
+        if(ret != TINY_PARSE_OK) return ret;
+        if(n < INT_MIN || n > INT_MAX) return TINY_BIND_TYPE_MISMATCH;
+        *out = (int)n;
+        return TINY_PARSE_OK;
+    }
+    static void Write(TinyWriter* w, int in) { TinyWriterInt64(w, in); }
+};
+
+template <>
+struct TinyBindTraits<std::string> {
+    static int Parse(TinyBindReader* r, std::string* out) { return TinyBindReadString(r, out); }
+    static void Write(TinyWriter* w, const std::string& in) { TinyWriterString(w, in.data(), in.size()); }
+};
+
+template <class T>
+struct TinyBindTraits<std::vector<T> > {
+    static int Parse(TinyBindReader* r, std::vector<T>* out) {
+        int ret = TinyBindStartArray(r);
+        bool more;
+        out->clear();
+        while(ret == TINY_PARSE_OK && (ret = TinyBindNextElement(r, out->size(), &more)) == TINY_PARSE_OK && more) {
+            T item;
+            ret = TinyBindTraits<T>::Parse(r, &item);
+            out->push_back(std::move(item));
+        }
+        return ret;
+    }
+    static void Write(TinyWriter* w, const std::vector<T>& in) {
+        TinyWriterStartArray(w);
+        for(typename std::vector<T>::const_iterator it = in.begin(); it != in.end(); ++it) {
+            TinyBindTraits<T>::Write(w, *it);
+        }
+        TinyWriterEndArray(w);
+    }
+};
+
+template <class T>
+struct TinyBindTraits<TinyOptional<T> > {
+    static int Parse(TinyBindReader* r, TinyOptional<T>* out) {
+        out->has = !TinyBindReadNull(r);
+        return out->has ? TinyBindTraits<T>::Parse(r, &out->value) : TINY_PARSE_OK;
+    }
+    static void Write(TinyWriter* w, const TinyOptional<T>& in) {
+        if(in.has) TinyBindTraits<T>::Write(w, in.value);
+        else TinyWriterNull(w);
+    }
+};
+
+// 每个成员实例化一组函数, 经成员指针访问, 不要求结构体是标准布局
+template <class S, class F, F S::*M>
+struct TinyBindMember {
+    static int Parse(TinyBindReader* r, void* obj) {
+        return TinyBindTraits<F>::Parse(r, &(static_cast<S*>(obj)->*M));
+    }
+    static void Write(TinyWriter* w, const void* obj) {
+        TinyBindTraits<F>::Write(w, static_cast<const S*>(obj)->*M);
+    }
+};
+
+template <class S, class T, TinyOptional<T> S::*M>
+struct TinyBindOptionalMember {
+    static bool Present(const void* obj) {
+        return (static_cast<const S*>(obj)->*M).has;
+    }
+    static void Reset(void* obj) {
+        (static_cast<S*>(obj)->*M).has = false;
+    }
+};
+
+template <class S, class F, F S::*M>
+struct TinyBindFieldOf {
+    static TinyBindField Make(const char* key, size_t klen) {
+        TinyBindField f = { key, klen, 0, TinyBindMember<S, F, M>::Parse, TinyBindMember<S, F, M>::Write, NULL, NULL };
+        return f;
+    }
+};
+
+template <class S, class T, TinyOptional<T> S::*M>
+struct TinyBindFieldOf<S, TinyOptional<T>, M> {
+    static TinyBindField Make(const char* key, size_t klen) {
+        typedef TinyBindMember<S, TinyOptional<T>, M> Member;
+        TinyBindField f = { key, klen, 0, Member::Parse, Member::Write,
+                            TinyBindOptionalMember<S, T, M>::Present, TinyBindOptionalMember<S, T, M>::Reset };
+        return f;
+    }
+};
+
+#define TINY_BIND_BEGIN(Struct) \
+    template <> \
+    struct TinyBindTraits<Struct> { \
+        typedef Struct Type; \
+        static const TinyBindStruct* Fields() { \
+            static TinyBindField fields[] = {
+
+#define TINY_BIND_FIELD_AS(member, key) \
+                TinyBindFieldOf<Type, decltype(Type::member), &Type::member>::Make(key, sizeof(key) - 1),
+
+#define TINY_BIND_FIELD(member) TINY_BIND_FIELD_AS(member, #member)
+
+#define TINY_BIND_END() \
+            }; \
+            static_assert(sizeof(fields) / sizeof(fields[0]) <= 64, "TINY_BIND supports at most 64 fields"); \
+            static const TinyBindStruct s = TinyBindMakeStruct(fields, sizeof(fields) / sizeof(fields[0])); \
+            return &s; \
+        } \
+        static int Parse(TinyBindReader* r, Type* out) { return TinyBindParseStruct(r, Fields(), out); } \
+        static void Write(TinyWriter* w, const Type& in) { TinyBindWriteStruct(w, Fields(), &in); } \
+    };
+
+// json 必须恰好是一个值, 返回值同 TinyParse, 另有 TINY_BIND_TYPE_MISMATCH、TINY_BIND_MISSING_FIELD
+template <class T>
+int TinyBindParse(T* out, const char* json) {
+    TinyBindReader r;
+    TinyBindReaderInit(&r, json);
+    TinyBindSkipWhiteSpace(&r);
+    int ret = TinyBindTraits<T>::Parse(&r, out);
+    if(ret == TINY_PARSE_OK) {
+        TinyBindSkipWhiteSpace(&r);
+        if(*r.json != '\0') ret = TINY_PARSE_ROOT_NOT_SINGULAR;
+    }
+    TinyBindReaderFree(&r);
+    return ret;
+}
+
+// 追加到 writer, 可以与 TinyWriter* 系列函数混用
+template <class T>
+void TinyBindWrite(TinyWriter* w, const T& in) {
+    TinyBindTraits<T>::Write(w, in);
+}
+
+// 返回以 '\0' 结尾的 JSON, 由调用者 free()
+template <class T>
+char* TinyBindStringify(const T& in, size_t* len) {
+    TinyWriter w;
+    TinyWriterInit(&w);
+    TinyBindTraits<T>::Write(&w, in);
+    return TinyBindTakeString(&w, len);
+}
+
+#endif // TINYBIND_H
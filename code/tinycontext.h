@@ -0,0 +1,120 @@
+/*
+ * @Author       : mark
+ * @Date         : 2020-05-26
+ * @copyleft Apache 2.0
+ */ 
+
+#ifndef TINYCONTEXT_H
+#define TINYCONTEXT_H
+
+#include "tinyjson.h"
+#include <assert.h>  /* assert() */
+#include <stdlib.h>  /* realloc() */
+#include <string.h>  /* memcpy() */
+
+#if TINY_ENABLE_STATS
+#include <atomic>
+
+// 每个线程一份计数, 只有本线程写入, 其它线程汇总时读取
+struct TinyStatsLocal {
+    std::atomic<uint64_t> counts[TINY_STAT_COUNT];
+    uint64_t base[TINY_STAT_COUNT];     /* TinyResetStats 时的计数 */
+    uint64_t peaks[TINY_STAT_COUNT];    /* 本线程自 TinyResetStats 以来的峰值 */
+    size_t depth;                       /* 正在解析的嵌套深度 */
+    TinyStatsLocal* next;
+};
+
+extern thread_local TinyStatsLocal* tinyStatsLocal;
+TinyStatsLocal* TinyStatsRegister();
+
+static inline TinyStatsLocal* TinyStatsGet() {
+    TinyStatsLocal* s = tinyStatsLocal;
+    return s != NULL ? s : TinyStatsRegister();
+}
+
+//只有本线程写, 不需要读改写的原子操作
+static inline void TinyStatAdd(TinyStat stat, uint64_t n) {
+    std::atomic<uint64_t>& c = TinyStatsGet()->counts[stat];
+    c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+static inline void TinyStatMax(TinyStat stat, uint64_t n) {
+    TinyStatsLocal* s = TinyStatsGet();
+    if(n > s->peaks[stat]) s->peaks[stat] = n;
+    if(n > s->counts[stat].load(std::memory_order_relaxed)) s->counts[stat].store(n, std::memory_order_relaxed);
+}
+
+static inline void TinyStatEnter() {
+    TinyStatsLocal* s = TinyStatsGet();
+    s->depth++;
+    TinyStatMax(TINY_STAT_MAX_DEPTH, s->depth);
+}
+
+static inline void TinyStatLeave() {
+    TinyStatsGet()->depth--;
+}
+
+#define TINY_STAT_ADD(stat, n) TinyStatAdd(stat, n)
+#define TINY_STAT_MAX(stat, n) TinyStatMax(stat, n)
+#define TINY_STAT_ENTER() TinyStatEnter()
+#define TINY_STAT_LEAVE() TinyStatLeave()
+#else
+#define TINY_STAT_ADD(stat, n) ((void)0)
+#define TINY_STAT_MAX(stat, n) ((void)0)
+#define TINY_STAT_ENTER() ((void)0)
+#define TINY_STAT_LEAVE() ((void)0)
+#endif
+
+// TinyContext 缓冲区的压栈/出栈, 供解析、输出以及各编解码模块共用
+
+//扩容放在快速路径之外, 使 TinyContextPush 保持短小可以内联
+#if defined(__GNUC__)
+__attribute__((noinline))
+#endif
+static void TinyContextGrow(TinyContext* context, size_t size) {
+    //初始化
+    if(context->size == 0) {
+        context->size = TINY_STACK_SIZE;
+    }
+    //如果超过缓冲空间，增大size
+    while(context->top + size  >= context->size) {
+        context->size += context->size >> 1; /* context->size * 1.5 */
+    }
+    //分配空间
+    TINY_STAT_ADD(context->stack ? TINY_STAT_REALLOCS : TINY_STAT_ALLOCS, 1);
+    TINY_STAT_ADD(context->stack ? TINY_STAT_REALLOC_BYTES : TINY_STAT_ALLOC_BYTES, context->size);
+    TINY_STAT_ADD(TINY_STAT_STACK_GROWS, 1);
+    TINY_STAT_MAX(TINY_STAT_STACK_PEAK, context->size);
+    context->stack = (char*)realloc(context->stack, context->size);
+}
+
+static inline void* TinyContextPush(TinyContext* context, size_t size) {
+    void* ret;
+    assert(size > 0);
+    //开辟新空间
+    if(context->top + size  >= context->size) {
+        TinyContextGrow(context, size);
+    }
+    //返回 元素开始的 位置
+    ret = context->stack + context->top;
+    context->top += size;
+    return ret;
+}
+
+static inline void* TinyContextPop(TinyContext* context, size_t size) {
+    assert(context->top >= size);
+    context->top -= size;
+    return context->stack + context->top;
+}
+
+static inline void TinyPutC(TinyContext* context, const char ch) {
+    char* top = (char*)TinyContextPush(context, sizeof(char));
+    // 写入stack
+    *top = ch;
+}
+
+static inline void TinyPutS(TinyContext* context, const char* str, size_t len) {
+    memcpy(TinyContextPush(context, len), str, len);
+}
+
+#endif // TINYCONTEXT_H
@@ -5,14 +5,281 @@
  */ 
 
 #include "tinyjson.h"
+#include "tinycontext.h"
 #include <assert.h>  /* assert() */
-#include <errno.h>   /* errno, ERANGE */
-#include <math.h>    /* HUGE_VAL */
-#include <stdio.h>   /* sprintf() */
+#include <errno.h>   /* errno, ERANGE, EINTR */
+#include <limits.h>  /* UINT_MAX, IOV_MAX */
+#include <math.h>    /* HUGE_VAL, NAN, isnan(), isfinite(), signbit() */
+#include <stdio.h>   /* fwrite() */
 #include <stdlib.h>  /* NULL, malloc(), realloc(), free(), strtod() */
 #include <string.h>  /* memcpy() */
+#include <atomic>    /* std::atomic */
+#include <condition_variable>
+#include <mutex>     /* std::mutex */
+#include <thread>    /* std::thread */
+#include <vector>
+#if defined(__SSE2__) && defined(__GNUC__)
+#define TINY_SSE2 1
+#include <emmintrin.h>
+#else
+#define TINY_SSE2 0
+#endif
+#if TINY_HAS_POSIX
+#include <sys/uio.h> /* writev() */
+#include <unistd.h>  /* write() */
+#endif
+#if TINY_ENABLE_STATS
+#include <chrono>    /* steady_clock */
+#endif
+
+#if TINY_ENABLE_STATS
+static uint64_t TinyStatsNow() {
+    using namespace std::chrono;
+    return (uint64_t)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+#define TINY_STAT_CLOCK(t) uint64_t t = TinyStatsNow()
+#define TINY_STAT_ELAPSED(stat, t) TinyStatAdd(stat, TinyStatsNow() - (t))
+#else
+#define TINY_STAT_CLOCK(t) ((void)0)
+#define TINY_STAT_ELAPSED(stat, t) ((void)0)
+#endif
+
+//引用计数: 容器和字符串在 TinyCopy 时共享, 修改前才复制(写时复制)
+//共享的文档可能被多个线程同时 TinyCopy, 所以计数是原子的
+static void TinyRefRetain(size_t* refs) {
+    __atomic_fetch_add(refs, 1, __ATOMIC_RELAXED);
+}
+
+//返回 true 表示释放的是最后一个引用
+static bool TinyRefRelease(size_t* refs) {
+    //唯一的持有者不需要原子减
+    return __atomic_load_n(refs, __ATOMIC_ACQUIRE) == 1
+        || __atomic_sub_fetch(refs, 1, __ATOMIC_ACQ_REL) == 0;
+}
+
+static bool TinyRefShared(const size_t* refs) {
+    return __atomic_load_n(refs, __ATOMIC_ACQUIRE) > 1;
+}
+
+//字符串和键内容前的隐藏头部
+struct TinyStringBlock {
+    size_t refs;
+    unsigned flags;
+};
+
+#define TINY_STRING_CLEAN 0x1u      /* 内容不含需要转义的字符, 输出时整段拷贝 */
+
+static TinyStringBlock* TinyStringBlockOf(const char* str) {
+    return (TinyStringBlock*)str - 1;
+}
+
+static size_t TinyScanClean(const char* str, size_t len);
+
+//复制 len 个字符并以 '\0' 结尾, 调用者已知是否需要转义时直接给出 flags
+static char* TinyStringNewFlags(const char* str, size_t len, unsigned flags) {
+    TinyStringBlock* block = (TinyStringBlock*)malloc(sizeof(TinyStringBlock) + len + 1);
+    TINY_STAT_ADD(TINY_STAT_ALLOCS, 1);
+    TINY_STAT_ADD(TINY_STAT_ALLOC_BYTES, sizeof(TinyStringBlock) + len + 1);
+    block->refs = 1;
+    block->flags = flags;
+    char* s = (char*)(block + 1);
+    if(len > 0) memcpy(s, str, len);
+    s[len] = '\0';
+    return s;
+}
+
+//创建时扫描一次, 之后每次输出都不必再扫描
+static char* TinyStringNew(const char* str, size_t len) {
+    return TinyStringNewFlags(str, len, TinyScanClean(str, len) == len ? TINY_STRING_CLEAN : 0);
+}
+
+static bool TinyStringIsClean(const char* str) {
+    return (TinyStringBlockOf(str)->flags & TINY_STRING_CLEAN) != 0;
+}
+
+static char* TinyStringRetain(char* str) {
+    TinyRefRetain(&TinyStringBlockOf(str)->refs);
+    return str;
+}
+
+static void TinyStringRelease(char* str) {
+    if(str && TinyRefRelease(&TinyStringBlockOf(str)->refs)) {
+        free(TinyStringBlockOf(str));
+    }
+}
+
+//TinyStringifyCached() 记下的容器输出, 内容紧跟其后
+struct TinyCache {
+    size_t len;
+    uint64_t time;      /* 开始生成时的 TinyBlockClock, 之后修改过的子孙容器使它过期 */
+    uint64_t checked;   /* 最近一次确认未过期时的 TinyBlockClock, 时钟没有前进时不必再检查 */
+};
+
+//数组/对象存储前的隐藏头部, value->array / value->object 指向头部之后
+struct TinyBlock {
+    uint64_t hash;      /* TinyHashMemo() 记下的结构哈希 */
+    size_t refs;        /* 共享该存储的值的个数 */
+    unsigned flags;     /* 建立后只在未共享时修改 */
+    unsigned hashed;    /* hash 有效; 共享的存储可能被多个线程同时记下, 先写 hash 再以 release 发布 */
+    TinyCache* cache;   /* 记下的输出, 共享该存储的值都可以使用 */
+    TinyValue* view;    /* packed 数组按元素读取时建立的 TinyValue 副本, 随存储一起释放 */
+    uint64_t modified;  /* 建立或最近一次修改时的 TinyBlockClock */
+};
+
+//全局修改时钟: 容器存储每次建立或修改时前进一步
+static uint64_t TinyBlockClock = 0;
+
+static uint64_t TinyBlockTick() {
+    return __atomic_add_fetch(&TinyBlockClock, 1, __ATOMIC_RELAXED);
+}
+
+#define TINY_BLOCK_PACKED 0x2u      /* 全部是数字的数组, 存储为 double[] */
+
+static TinyBlock* TinyBlockOf(const void* storage) {
+    return (TinyBlock*)storage - 1;
+}
+
+//释放头部和记下的内容, 不处理元素
+static void TinyBlockFree(TinyBlock* block) {
+    free(block->cache);
+    free(block->view);
+    free(block);
+}
+
+//只能用于未共享的存储
+static void* TinyBlockRealloc(void* storage, size_t bytes) {
+    TinyBlock* block = storage ? TinyBlockOf(storage) : NULL;
+    assert(block == NULL || block->refs == 1);
+    if(bytes == 0) {
+        if(block) TinyBlockFree(block);
+        return NULL;
+    }
+    TINY_STAT_ADD(block ? TINY_STAT_REALLOCS : TINY_STAT_ALLOCS, 1);
+    TINY_STAT_ADD(block ? TINY_STAT_REALLOC_BYTES : TINY_STAT_ALLOC_BYTES, sizeof(TinyBlock) + bytes);
+    block = (TinyBlock*)realloc(block, sizeof(TinyBlock) + bytes);
+    if(storage == NULL) {
+        block->refs = 1;
+        block->flags = 0;
+        block->hashed = 0;
+        block->cache = NULL;
+        block->view = NULL;
+        block->modified = TinyBlockTick();
+    }
+    return block + 1;
+}
+
+//内容即将被修改: 丢弃记下的哈希和输出, 只用于未共享的存储
+static void TinyBlockTouch(void* storage) {
+    TinyBlock* block = TinyBlockOf(storage);
+    block->modified = TinyBlockTick();
+    __atomic_store_n(&block->hashed, 0u, __ATOMIC_RELAXED);
+    if(block->cache) {
+        free(block->cache);
+        block->cache = NULL;
+    }
+    if(block->view) {
+        free(block->view);
+        block->view = NULL;
+    }
+}
+
+static bool TinyIsPacked(const TinyValue* value) {
+    return value->type == TINY_ARRAY && value->array && (TinyBlockOf(value->array)->flags & TINY_BLOCK_PACKED);
+}
+
+static double* TinyPackedOf(const TinyValue* value) {
+    return (double*)value->array;
+}
+
+static size_t TinyArrayElementSize(const TinyValue* value) {
+    return TinyIsPacked(value) ? sizeof(double) : sizeof(TinyValue);
+}
+
+//分配能放 capacity 个数字的 packed 存储
+static TinyValue* TinyPackedAlloc(size_t capacity) {
+    void* storage = TinyBlockRealloc(NULL, capacity * sizeof(double));
+    if(storage) TinyBlockOf(storage)->flags |= TINY_BLOCK_PACKED;
+    return (TinyValue*)storage;
+}
+
+static void TinyReleaseArray(TinyValue* array, size_t size) {
+    if(array && TinyRefRelease(&TinyBlockOf(array)->refs)) {
+        if(TinyBlockOf(array)->flags & TINY_BLOCK_PACKED) size = 0;
+        for(size_t i = 0; i < size; i++) {
+            TinyFree(&array[i]);
+        }
+        TinyBlockFree(TinyBlockOf(array));
+    }
+}
+
+static void TinyReleaseObject(TinyMember* object, size_t size) {
+    if(object && TinyRefRelease(&TinyBlockOf(object)->refs)) {
+        for(size_t i = 0; i < size; i++) {
+            TinyStringRelease(object[i].key);
+            TinyFree(&object[i].value);
+        }
+        TinyBlockFree(TinyBlockOf(object));
+    }
+}
+
+//packed 数组之外的修改: 先展开成普通数组
+static void TinyUnpackArray(TinyValue* value) {
+    const double* nums = TinyPackedOf(value);
+    TinyValue* array = (TinyValue*)TinyBlockRealloc(NULL, value->capacity * sizeof(TinyValue));
+    for(size_t i = 0; i < value->size; i++) {
+        array[i].num = nums[i];
+        array[i].type = TINY_NUMBER;
+        array[i].numLen = 0;
+    }
+    TinyReleaseArray(value->array, value->size);
+    value->array = array;
+}
+
+//保持 packed 的修改(追加数字、调整容量)
+static void TinyPackedWrite(TinyValue* value) {
+    assert(TinyIsPacked(value));
+    if(TinyRefShared(&TinyBlockOf(value->array)->refs)) {
+        TinyValue* array = TinyPackedAlloc(value->capacity);
+        memcpy(array, value->array, value->size * sizeof(double));
+        TinyReleaseArray(value->array, value->size);
+        value->array = array;
+    }
+    TinyBlockTouch(value->array);
+}
+
+//修改容器内容之前调用: 存储被共享时复制一份(元素仍与原容器共享), 并丢弃记下的哈希和输出
+static void TinyBlockWrite(TinyValue* value) {
+    if(value->type == TINY_ARRAY && value->array) {
+        if(TinyIsPacked(value)) {
+            TinyUnpackArray(value);
+        } else if(TinyRefShared(&TinyBlockOf(value->array)->refs)) {
+            TinyValue* array = (TinyValue*)TinyBlockRealloc(NULL, value->capacity * sizeof(TinyValue));
+            for(size_t i = 0; i < value->size; i++) {
+                TinyCopy(&array[i], &value->array[i]);
+            }
+            TinyReleaseArray(value->array, value->size);
+            value->array = array;
+        }
+        TinyBlockTouch(value->array);
+    } else if(value->type == TINY_OBJECT && value->object) {
+        if(TinyRefShared(&TinyBlockOf(value->object)->refs)) {
+            TinyMember* object = (TinyMember*)TinyBlockRealloc(NULL, value->ocapacity * sizeof(TinyMember));
+            for(size_t i = 0; i < value->osize; i++) {
+                object[i].key = TinyStringRetain(value->object[i].key);
+                object[i].kLen = value->object[i].kLen;
+                TinyCopy(&object[i].value, &value->object[i].value);
+            }
+            TinyReleaseObject(value->object, value->osize);
+            value->object = object;
+        }
+        TinyBlockTouch(value->object);
+    }
+}
 
-static int TinyParseValue(TinyContext* context, TinyValue* value);
+//解析器按 TinyParseFlag 组合实例化, 未打开的功能在编译期去掉, 不留下运行时分支
+//depth 为正在解析的值所在的嵌套层数, 只在 TINY_PARSE_FLAG_DEPTH_LIMIT 时使用
+template <unsigned Flags>
+static int TinyParseValue(TinyContext* context, TinyValue* value, size_t depth);
 
 //解析空白
 static void TinyParseWhiteSpace(TinyContext* context) {
@@ -40,6 +307,57 @@ static bool isDigit(const char t) {
     return t >= '0' && t <= '9'; 
 }
 
+//保留原文: 较短的放在 numText 中, 不必分配
+static void TinyNumberSetText(TinyValue* value, const char* text, size_t len) {
+    if(len <= sizeof(value->numText)) {
+        memcpy(value->numText, text, len);
+    } else {
+        value->str = TinyStringNewFlags(text, len, TINY_STRING_CLEAN);
+        value->len = len;
+    }
+    value->numLen = (unsigned)len;
+    value->type = TINY_NUMBER;
+}
+
+static bool TinyNumberIsHeap(const TinyValue* value) {
+    return value->numLen > sizeof(value->numText);
+}
+
+//不转换也能给出与 strtod 相同的范围检查: 由第一个非零数字的位置和指数得到数量级,
+//大于 308 时必然溢出, 等于 308 时才需要转换比较
+static bool TinyNumberTextTooBig(const char* text) {
+    const char* p = text;
+    if(*p == '-') p++;
+    long long magnitude = -1;       /* 第一个非零数字的十进制数量级 */
+    bool nonzero = false;
+    for(; isDigit(*p); p++) {
+        if(nonzero) magnitude++;
+        else if(*p != '0') nonzero = true, magnitude = 0;
+    }
+    if(*p == '.') {
+        long long place = 0;
+        for(p++; isDigit(*p); p++) {
+            place--;
+            if(!nonzero && *p != '0') nonzero = true, magnitude = place;
+        }
+    }
+    if(!nonzero) return false;
+    if(*p == 'e' || *p == 'E') {
+        p++;
+        bool negative = *p == '-';
+        if(*p == '-' || *p == '+') p++;
+        long long exp = 0;
+        //指数很长时保持在不会溢出的范围内, 结果不受影响
+        for(; isDigit(*p); p++) if(exp < 100000000) exp = exp * 10 + (*p - '0');
+        magnitude += negative ? -exp : exp;
+    }
+    if(magnitude < 308) return false;
+    if(magnitude > 308) return true;
+    double d = strtod(text, NULL);
+    return d == HUGE_VAL || d == -HUGE_VAL;
+}
+
+template <unsigned Flags>
 static int TinyParseNumber(TinyContext* context, TinyValue* value) {
     const char* p = context->json;
     
@@ -61,6 +379,12 @@ static int TinyParseNumber(TinyContext* context, TinyValue* value) {
         for(p++; isDigit(*p); p++);
     }
     if (*p == 'e' || *p == 'E' || *p == '.' || isDigit1To9(*p)) return TINY_PARSE_INVALID_VALUE;
+    if((Flags & TINY_PARSE_FLAG_LAZY_NUMBER) && (size_t)(p - context->json) <= UINT_MAX) {
+        if(TinyNumberTextTooBig(context->json)) return TINY_PARSE_NUMBER_TOO_BIG;
+        TinyNumberSetText(value, context->json, p - context->json);
+        context->json = p;
+        return TINY_PARSE_OK;
+    }
     value->num = strtod(context->json, NULL);
     //溢出的时候 errno = ERANGE  
     errno = 0;
@@ -69,48 +393,11 @@ static int TinyParseNumber(TinyContext* context, TinyValue* value) {
         return TINY_PARSE_NUMBER_TOO_BIG;
     }
     value->type = TINY_NUMBER;
+    value->numLen = 0;
     context->json = p;
     return TINY_PARSE_OK;
 }
 
-static void* TinyContextPush(TinyContext* context, size_t size) {
-    void* ret;
-    assert(size > 0);
-    //开辟新空间
-    if(context->top + size  >= context->size) {
-        //初始化
-        if(context->size == 0) {
-            context->size = TINY_STACK_SIZE;
-        }
-        //如果超过缓冲空间，增大size
-        while(context->top + size  >= context->size) {
-            context->size += context->size >> 1; /* context->size * 1.5 */
-        }
-        //分配空间
-        context->stack = (char*)realloc(context->stack, context->size);
-    }
-    //返回 元素开始的 位置
-    ret = context->stack + context->top;
-    context->top += size;
-    return ret;
-}
-
-static void* TinyContextPop(TinyContext* context, size_t size) {
-    assert(context->top >= size);
-    context->top -= size;
-    return context->stack + context->top;
-}
-
-static void TinyPutC(TinyContext* context, const char ch) {
-    char* top = (char*)TinyContextPush(context, sizeof(char));
-    // 写入stack
-    *top = ch;
-}
-
-static void TinyPutS(TinyContext* context, const char* str, size_t len) {
-    memcpy(TinyContextPush(context, len), str, len);
-}
-
 //读取4位六进制
 static const char* TinyParseHex4(const char* str, unsigned* u) {
     int i;
@@ -168,12 +455,84 @@ static void TinyEncodeUtf8(TinyContext* context, unsigned u) {
     }
 }
 
+//返回从 p 开始第一个 '"'、'\\' 或 < 0x20 的字节(包括结尾的 '\0'), 经过的字节按位或到 *high
+#if TINY_SSE2
+//对齐后每次读16个字节: 读取可能越过 '\0' 但不会跨页
+#if defined(__GNUC__)
+__attribute__((no_sanitize_address))
+#endif
+static const char* TinyScanStringRun(const char* p, unsigned* high) {
+    for(; ((uintptr_t)p & 15) != 0; p++) {
+        unsigned char ch = (unsigned char)*p;
+        if(ch == '"' || ch == '\\' || ch < 0x20) return p;
+        *high |= ch;
+    }
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i slash = _mm_set1_epi8('\\');
+    const __m128i ctrl = _mm_set1_epi8(0x1F);
+    for(;; p += 16) {
+        __m128i v = _mm_load_si128((const __m128i*)p);
+        __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, slash)),
+                                 _mm_cmpeq_epi8(_mm_min_epu8(v, ctrl), v));
+        unsigned mask = (unsigned)_mm_movemask_epi8(m);
+        //最高位为1的字节
+        unsigned bits = (unsigned)_mm_movemask_epi8(v);
+        if(mask != 0) {
+            unsigned n = __builtin_ctz(mask);
+            if(bits & ((1u << n) - 1)) *high |= 0x80;
+            return p + n;
+        }
+        if(bits) *high |= 0x80;
+    }
+}
+#else
+static const char* TinyScanStringRun(const char* p, unsigned* high) {
+    for(;; p++) {
+        unsigned char ch = (unsigned char)*p;
+        if(ch == '"' || ch == '\\' || ch < 0x20) return p;
+        *high |= ch;
+    }
+}
+#endif
+
+//严格的 UTF-8: 拒绝超长编码、编码后的代理项、超过 U+10FFFF 的码点以及不完整的序列
+static bool TinyValidateUtf8(const unsigned char* s, const unsigned char* end) {
+    while(s < end) {
+        unsigned ch = *s;
+        if(ch < 0x80) {
+            s++;
+            continue;
+        }
+        //后续字节数以及第二个字节的范围
+        size_t n;
+        unsigned lo = 0x80, hi = 0xBF;
+        if(ch >= 0xC2 && ch <= 0xDF) n = 1;
+        else if(ch == 0xE0) { n = 2; lo = 0xA0; }
+        else if(ch == 0xED) { n = 2; hi = 0x9F; }
+        else if(ch >= 0xE1 && ch <= 0xEF) n = 2;
+        else if(ch == 0xF0) { n = 3; lo = 0x90; }
+        else if(ch >= 0xF1 && ch <= 0xF3) n = 3;
+        else if(ch == 0xF4) { n = 3; hi = 0x8F; }
+        else return false;
+        if((size_t)(end - s) <= n) return false;
+        if(s[1] < lo || s[1] > hi) return false;
+        for(size_t i = 2; i <= n; i++) {
+            if((s[i] & 0xC0) != 0x80) return false;
+        }
+        s += n + 1;
+    }
+    return true;
+}
+
 #define STRING_ERROR(ret) do { context->top = head; return ret; } while(0)
 
-static int TinyParseStringRaw(TinyContext* context, char** str, size_t* len) {
+template <unsigned Flags>
+static int TinyParseStringRaw(TinyContext* context, char** str, size_t* len, unsigned* flags) {
     size_t head = context->top;
     const char* p;
     unsigned u, u2;
+    //原文中未转义的部分一定不需要转义, 只有转义序列可能解出需要转义的字符
+    unsigned clean = TINY_STRING_CLEAN;
     
     assert(*context->json == '\"');
     context->json++;
@@ -187,25 +546,30 @@ static int TinyParseStringRaw(TinyContext* context, char** str, size_t* len) {
                 //字符串结束
                 *len = context->top - head;
                 *str = (char*)TinyContextPop(context, *len);
+                *flags = clean;
                 context->json = p;
                 return TINY_PARSE_OK;
             }
             case '\\':
                 //解析转义符和utf8字符
                 switch(*p++) {
-                    case '\"': TinyPutC(context, '\"'); break;
-                    case '\\': TinyPutC(context, '\\'); break;
+                    case '\"': TinyPutC(context, '\"'); clean = 0; break;
+                    case '\\': TinyPutC(context, '\\'); clean = 0; break;
                     case '/': TinyPutC(context, '/'); break;
-                    case 'b': TinyPutC(context, '\b'); break;
-                    case 'f': TinyPutC(context, '\f'); break;
-                    case 'n': TinyPutC(context, '\n'); break;
-                    case 'r': TinyPutC(context, '\r'); break;
-                    case 't': TinyPutC(context, '\t'); break;
+                    case 'b': TinyPutC(context, '\b'); clean = 0; break;
+                    case 'f': TinyPutC(context, '\f'); clean = 0; break;
+                    case 'n': TinyPutC(context, '\n'); clean = 0; break;
+                    case 'r': TinyPutC(context, '\r'); clean = 0; break;
+                    case 't': TinyPutC(context, '\t'); clean = 0; break;
                     case 'u': {
                         p = TinyParseHex4(p, &u);
                         if(p == NULL) {
                             STRING_ERROR(TINY_PARSE_INVALID_UNICODE_HEX);
                         }
+                        //单独的低代理项编码后不是合法的 UTF-8
+                        if((Flags & TINY_PARSE_FLAG_VALIDATE_UTF8) && u >= 0xDC00 && u <= 0xDFFF) {
+                            STRING_ERROR(TINY_PARSE_INVALID_UNICODE_SURROGATE);
+                        }
                         // surrogate pair \uXXXX\uYYYY 
                         // 扩展字符而使用的编码方式 (两个UTF-16编码)来表示一个字符
                         if(u >= 0xD800 && u <= 0xDBFF) {
@@ -231,6 +595,7 @@ static int TinyParseStringRaw(TinyContext* context, char** str, size_t* len) {
                             //codepoint = 0x10000 + (H − 0xD800) × 0x400 + (L − 0xDC00)
                             u = (((u - 0xD800) << 10) | (u2 - 0xDC00)) + 0x10000;
                         }
+                        if(u < 0x20) clean = 0;
                         TinyEncodeUtf8(context, u);
                         break;
                     }
@@ -251,24 +616,38 @@ static int TinyParseStringRaw(TinyContext* context, char** str, size_t* len) {
                 if((unsigned char)ch < 0x20) {
                     STRING_ERROR(TINY_PARSE_INVALID_STRING_CHAR);
                 }
-                TinyPutC(context, ch);
+                //无需处理的一段整段拷贝, 校验只发生在含有非 ASCII 字节的段上
+                const char* start = p - 1;
+                unsigned high = (unsigned char)ch;
+                p = TinyScanStringRun(p, &high);
+                if((Flags & TINY_PARSE_FLAG_VALIDATE_UTF8) && (high & 0x80)
+                   && !TinyValidateUtf8((const unsigned char*)start, (const unsigned char*)p)) {
+                    STRING_ERROR(TINY_PARSE_INVALID_UTF8);
+                }
+                TinyPutS(context, start, p - start);
             }
         }
     }
 }
 
+template <unsigned Flags>
 static int TinyParseString(TinyContext* context, TinyValue* value) {
     int ret;
     char* str;
     size_t len;
-    ret = TinyParseStringRaw(context, &str, &len);
+    unsigned flags;
+    ret = TinyParseStringRaw<Flags>(context, &str, &len, &flags);
     if(ret == TINY_PARSE_OK) {
-        TinySetString(value, str, len);
+        TinyFree(value);
+        value->str = TinyStringNewFlags(str, len, flags);
+        value->len = len;
+        value->type = TINY_STRING;
     }
     return ret;
 }
 
-static int TinyParseArray(TinyContext* context, TinyValue* value) {
+template <unsigned Flags>
+static int TinyParseArray(TinyContext* context, TinyValue* value, size_t depth) {
     size_t size = 0;
     int ret;
 
@@ -282,15 +661,18 @@ static int TinyParseArray(TinyContext* context, TinyValue* value) {
         return TINY_PARSE_OK;
     }
 
+    bool numbers = (Flags & TINY_PARSE_FLAG_PACK_NUMBERS) != 0;
     while(true) {
         TinyValue element;
         TinyInitValue(&element);
-        ret = TinyParseValue(context, &element);
+        ret = TinyParseValue<Flags>(context, &element, depth + 1);
         if(ret != TINY_PARSE_OK) {
             break;
         }
         memcpy(TinyContextPush(context, sizeof(TinyValue)), &element, sizeof(TinyValue));
         size++;
+        //保留原文的数字不能存为 double
+        numbers = numbers && element.type == TINY_NUMBER && element.numLen == 0;
         TinyParseWhiteSpace(context);
         if(*context->json == ',') {
             context->json++;
@@ -298,9 +680,20 @@ static int TinyParseArray(TinyContext* context, TinyValue* value) {
         }
         else if(*context->json == ']') {
             context->json++;
+            const TinyValue* e = (const TinyValue*)TinyContextPop(context,  size * sizeof(TinyValue));
+            if(numbers) {
+                //全是数字: 直接存 double, 每个元素 8 字节
+                TinyFree(value);
+                value->type = TINY_ARRAY;
+                value->size = value->capacity = size;
+                value->array = TinyPackedAlloc(size);
+                double* nums = TinyPackedOf(value);
+                for(size_t i = 0; i < size; i++) nums[i] = e[i].num;
+                return TINY_PARSE_OK;
+            }
             TinySetArray(value, size);
             value->size = size;
-            memcpy(value->array, TinyContextPop(context,  size * sizeof(TinyValue)),  size * sizeof(TinyValue));
+            memcpy(value->array, e,  size * sizeof(TinyValue));
             return TINY_PARSE_OK;
         } else {
             ret = TINY_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
@@ -314,7 +707,8 @@ static int TinyParseArray(TinyContext* context, TinyValue* value) {
     return ret;
 }
 
-static int TinyParseObject(TinyContext* context, TinyValue* value) {
+template <unsigned Flags>
+static int TinyParseObject(TinyContext* context, TinyValue* value, size_t depth) {
     size_t size;
     TinyMember m;
     int ret;
@@ -333,6 +727,7 @@ static int TinyParseObject(TinyContext* context, TinyValue* value) {
     size = 0;
     while(true) {
         char * str;
+        unsigned flags;
         TinyInitValue(&m.value);
 
         // 1. parse key
@@ -340,13 +735,11 @@ static int TinyParseObject(TinyContext* context, TinyValue* value) {
             ret = TINY_PARSE_MISS_KEY;
             break;
         }
-        ret = TinyParseStringRaw(context, &str, &m.kLen);
+        ret = TinyParseStringRaw<Flags>(context, &str, &m.kLen, &flags);
         if(ret != TINY_PARSE_OK) {
             break;
         }
-        m.key = (char*)malloc(m.kLen + 1);
-        memcpy(m.key, str, m.kLen);
-        m.key[m.kLen] = '\0';
+        m.key = TinyStringNewFlags(str, m.kLen, flags);
 
         // 2. parse colon
         TinyParseWhiteSpace(context);
@@ -358,7 +751,7 @@ static int TinyParseObject(TinyContext* context, TinyValue* value) {
 
         // 3. parse value
         TinyParseWhiteSpace(context);
-        ret = TinyParseValue(context, &m.value);
+        ret = TinyParseValue<Flags>(context, &m.value, depth + 1);
         if(ret != TINY_PARSE_OK) {
             break;
         }
@@ -385,68 +778,453 @@ static int TinyParseObject(TinyContext* context, TinyValue* value) {
         }
     }
     
-    free(m.key);
+    TinyStringRelease(m.key);
     for(size_t i = 0; i < size; i++) {
         TinyMember* m = (TinyMember*) TinyContextPop(context, sizeof(TinyMember));
-        free(m->key);
+        TinyStringRelease(m->key);
         TinyFree(&m->value);
     }
     value->type = TINY_NULL;
     return ret;
 }
 
-static int TinyParseValue(TinyContext* context, TinyValue* value) {
+//NaN、Infinity、-Infinity
+static int TinyParseNanInf(TinyContext* context, TinyValue* value) {
+    const char* p = context->json;
+    bool negative = *p == '-';
+    if(negative) p++;
+    if(!negative && strncmp(p, "NaN", 3) == 0) {
+        value->num = NAN;
+        p += 3;
+    } else if(strncmp(p, "Infinity", 8) == 0) {
+        value->num = negative ? -HUGE_VAL : HUGE_VAL;
+        p += 8;
+    } else {
+        return TINY_PARSE_INVALID_VALUE;
+    }
+    value->type = TINY_NUMBER;
+    value->numLen = 0;
+    context->json = p;
+    return TINY_PARSE_OK;
+}
+
+template <unsigned Flags>
+static int TinyParseValue(TinyContext* context, TinyValue* value, size_t depth) {
+    int ret;
+    if((Flags & TINY_PARSE_FLAG_DEPTH_LIMIT) && depth >= TINY_PARSE_MAX_DEPTH
+       && (*context->json == '[' || *context->json == '{')) {
+        return TINY_PARSE_DEPTH_EXCEEDED;
+    }
     switch(*context->json) {
-        case 'n': return TinyParseLiteral(context, value, "null", TINY_NULL);
-        case 't': return TinyParseLiteral(context, value, "true", TINY_TRUE);
-        case 'f': return TinyParseLiteral(context, value, "false", TINY_FALSE);
-        default: return TinyParseNumber(context, value);
-        case '"': return TinyParseString(context, value);
-        case '[': return TinyParseArray(context, value);
-        case '{': return TinyParseObject(context, value);
+        case 'n': ret = TinyParseLiteral(context, value, "null", TINY_NULL); break;
+        case 't': ret = TinyParseLiteral(context, value, "true", TINY_TRUE); break;
+        case 'f': ret = TinyParseLiteral(context, value, "false", TINY_FALSE); break;
+        case 'N':
+        case 'I':
+            ret = (Flags & TINY_PARSE_FLAG_NAN_INF) ? TinyParseNanInf(context, value) : TINY_PARSE_INVALID_VALUE;
+            break;
+        case '-':
+            if((Flags & TINY_PARSE_FLAG_NAN_INF) && context->json[1] == 'I') {
+                ret = TinyParseNanInf(context, value);
+                break;
+            }
+            ret = TinyParseNumber<Flags>(context, value);
+            break;
+        default: ret = TinyParseNumber<Flags>(context, value); break;
+        case '"': ret = TinyParseString<Flags>(context, value); break;
+        case '[':
+            TINY_STAT_ENTER();
+            ret = TinyParseArray<Flags>(context, value, depth);
+            TINY_STAT_LEAVE();
+            break;
+        case '{':
+            TINY_STAT_ENTER();
+            ret = TinyParseObject<Flags>(context, value, depth);
+            TINY_STAT_LEAVE();
+            break;
         case '\0': return TINY_PARSE_EXPECT_VALUE;
     }
+    if(ret == TINY_PARSE_OK) TINY_STAT_ADD((TinyStat)(TINY_STAT_NULLS + value->type), 1);
+    return ret;
 }
 
-static void TinyStringifyString(TinyContext* context, const char *str, size_t len) {
+//需要转义的字符: 0 表示原样输出, 'u' 表示 \u00XX, 其余为 \ 之后的字符
+static const char TINY_ESCAPE[256] = {
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'b', 't', 'n', 'u', 'f', 'r', 'u', 'u',
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',
+    0, 0, '"', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, '\\', 0, 0, 0,
+};
+
+//返回 str 中第一个需要转义的字符的位置, 没有则返回 len
+static size_t TinyScanClean(const char* str, size_t len) {
+    size_t i = 0;
+#if TINY_SSE2
+    //每次检查16个字节: '"', '\\' 以及 < 0x20 的控制字符
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i slash = _mm_set1_epi8('\\');
+    const __m128i ctrl = _mm_set1_epi8(0x1F);
+    for(; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(str + i));
+        __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, slash)),
+                                 _mm_cmpeq_epi8(_mm_min_epu8(v, ctrl), v));
+        int mask = _mm_movemask_epi8(m);
+        if(mask != 0) return i + __builtin_ctz(mask);
+    }
+#endif
+    while(i < len && TINY_ESCAPE[(unsigned char)str[i]] == 0) i++;
+    return i;
+}
+
+//转义字符串内容, 不含两端的引号; 无需转义的片段整段拷贝, 按实际长度申请空间
+static void TinyStringifyChars(TinyContext* context, const char *str, size_t len) {
     static const char hexDigits[] = { '0', '1', '2', '3', '4', '5', '6', '7', '8', '9',
                                       'A', 'B', 'C', 'D', 'E', 'F'};
-    size_t size = len * 6 + 2; //  "\u00xx"
-    char* head, *p;
-
-    assert(str != NULL);
-    p = head = (char*)TinyContextPush(context, size);
-    *p++ = '"';
-    for(size_t i = 0; i < len; i++) {
-        unsigned char ch = (unsigned char)str[i];
-        switch (ch)
-        {
-        case '\"': *p++ = '\\'; *p++ = '\"'; break;
-        case '\\': *p++ = '\\'; *p++ = '\\'; break;
-        case '\b': *p++ = '\\'; *p++ = 'b'; break;
-        case '\f': *p++ = '\\'; *p++ = 'f'; break;
-        case '\n': *p++ = '\\'; *p++ = 'n'; break;
-        case '\r': *p++ = '\\'; *p++ = 'r'; break;
-        case '\t': *p++ = '\\'; *p++ = 't'; break;
-        default:
+    size_t i = 0;
+    assert(str != NULL || len == 0);
+    while(i < len) {
+        size_t n = TinyScanClean(str + i, len - i);
+        if(n > 0) {
+            TinyPutS(context, str + i, n);
+            i += n;
+            if(i == len) break;
+        }
+        unsigned char ch = (unsigned char)str[i++];
+        char esc = TINY_ESCAPE[ch];
+        if(esc == 'u') {
             // 小于0x20的字符需要转义为\u00xx的形式
-            if(ch < 0x20) {
-                char buff[7];
-                sprintf(buff, "\\u%04X", ch); // 按16进制输出(大写)，最小输出宽度为4个字符
-                *p++ = '\\'; 
-                *p++ = 'u'; 
-                *p++ = '0'; 
-                *p++ = '0';
-                *p++ = hexDigits[ch >> 4];
-                *p++ = hexDigits[ch & 15];
-            } else {
-                *p++ = str[i];
-            }
-            break;
+            char* p = (char*)TinyContextPush(context, 6);
+            p[0] = '\\';
+            p[1] = 'u';
+            p[2] = '0';
+            p[3] = '0';
+            p[4] = hexDigits[ch >> 4];
+            p[5] = hexDigits[ch & 15];
+        } else {
+            char* p = (char*)TinyContextPush(context, 2);
+            p[0] = '\\';
+            p[1] = esc;
+        }
+    }
+}
+
+static void TinyStringifyString(TinyContext* context, const char *str, size_t len) {
+    size_t n = TinyScanClean(str, len);
+    if(n == len) {
+        //整个字符串都不需要转义
+        char* p = (char*)TinyContextPush(context, len + 2);
+        p[0] = '"';
+        memcpy(p + 1, str, len);
+        p[len + 1] = '"';
+        return;
+    }
+    char* p = (char*)TinyContextPush(context, n + 1);
+    p[0] = '"';
+    memcpy(p + 1, str, n);
+    TinyStringifyChars(context, str + n, len - n);
+    TinyPutC(context, '"');
+}
+
+//值中的字符串: 创建时已记下是否需要转义, 不需要的整段拷贝
+static void TinyStringifyStored(TinyContext* context, const char* str, size_t len) {
+    if(!TinyStringIsClean(str)) {
+        TinyStringifyString(context, str, len);
+        return;
+    }
+    char* p = (char*)TinyContextPush(context, len + 2);
+    p[0] = '"';
+    memcpy(p + 1, str, len);
+    p[len + 1] = '"';
+}
+
+//对象成员的键连同冒号: "key":
+static void TinyStringifyKey(TinyContext* context, const TinyMember* m) {
+    if(!TinyStringIsClean(m->key)) {
+        TinyStringifyString(context, m->key, m->kLen);
+        TinyPutC(context, ':');
+        return;
+    }
+    char* p = (char*)TinyContextPush(context, m->kLen + 3);
+    p[0] = '"';
+    memcpy(p + 1, m->key, m->kLen);
+    p[m->kLen + 1] = '"';
+    p[m->kLen + 2] = ':';
+}
+
+//double 转字符串: Grisu2 (Florian Loitsch, "Printing Floating-Point Numbers Quickly and Accurately with Integers")
+//输出能精确还原的最短(或接近最短)十进制表示, 与 locale 无关
+struct TinyDiyFp {
+    uint64_t f;
+    int e;
+};
+
+static const uint64_t TINY_DP_SIGNIFICAND_MASK = 0x000FFFFFFFFFFFFFULL;
+static const uint64_t TINY_DP_HIDDEN_BIT       = 0x0010000000000000ULL;
+static const int TINY_DP_EXPONENT_BIAS = 0x3FF + 52;
+
+static TinyDiyFp TinyDiyFpMake(uint64_t f, int e) {
+    TinyDiyFp r;
+    r.f = f;
+    r.e = e;
+    return r;
+}
+
+static TinyDiyFp TinyDiyFpMul(TinyDiyFp lhs, TinyDiyFp rhs) {
+    const uint64_t M32 = 0xFFFFFFFFu;
+    const uint64_t a = lhs.f >> 32, b = lhs.f & M32;
+    const uint64_t c = rhs.f >> 32, d = rhs.f & M32;
+    const uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+    uint64_t tmp = (bd >> 32) + (ad & M32) + (bc & M32);
+    tmp += 1u << 31;    /* 四舍五入 */
+    return TinyDiyFpMake(ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), lhs.e + rhs.e + 64);
+}
+
+static TinyDiyFp TinyDiyFpNormalize(TinyDiyFp x) {
+    while(!(x.f & (1ULL << 63))) {
+        x.f <<= 1;
+        x.e--;
+    }
+    return x;
+}
+
+//10^k 的64位规格化近似值, k = -348, -340, ..., 340
+static TinyDiyFp TinyCachedPower(int e, int* K) {
+    static const uint64_t f[] = {
+    0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL, 0xcf42894a5dce35eaULL,
+    0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL, 0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL,
+    0xbe5691ef416bd60cULL, 0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+    0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL, 0xc21094364dfb5637ULL,
+    0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL, 0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL,
+    0xb23867fb2a35b28eULL, 0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+    0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL, 0xb5b5ada8aaff80b8ULL,
+    0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL, 0x964e858c91ba2655ULL, 0xdff9772470297ebdULL,
+    0xa6dfbd9fb8e5b88fULL, 0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+    0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL, 0xaa242499697392d3ULL,
+    0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL, 0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL,
+    0x9c40000000000000ULL, 0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+    0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL, 0x9f4f2726179a2245ULL,
+    0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL, 0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL,
+    0x924d692ca61be758ULL, 0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+    0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL, 0x952ab45cfa97a0b3ULL,
+    0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL, 0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL,
+    0x88fcf317f22241e2ULL, 0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+    0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL, 0x8bab8eefb6409c1aULL,
+    0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL, 0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL,
+    0x80444b5e7aa7cf85ULL, 0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+    0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL,
+    };
+    static const short be[] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980,
+    -954, -927, -901, -874, -847, -821, -794, -768, -741, -715,
+    -688, -661, -635, -608, -582, -555, -529, -502, -475, -449,
+    -422, -396, -369, -343, -316, -289, -263, -236, -210, -183,
+    -157, -130, -103, -77, -50, -24, 3, 30, 56, 83,
+    109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+    375, 402, 428, 455, 481, 508, 534, 561, 588, 614,
+    641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+    907, 933, 960, 986, 1013, 1039, 1066,
+    };
+    double dk = (-61 - e) * 0.30102999566398114 + 347;  /* dk must be positive */
+    int k = (int)dk;
+    if(dk - k > 0.0) k++;
+    unsigned index = (unsigned)((k >> 3) + 1);
+    *K = -(-348 + (int)index * 8);
+    return TinyDiyFpMake(f[index], be[index]);
+}
+
+static const uint64_t TINY_POW10[] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+    100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL,
+    10000000000000ULL, 100000000000000ULL, 1000000000000000ULL,
+    10000000000000000ULL, 100000000000000000ULL, 1000000000000000000ULL,
+    10000000000000000000ULL
+};
+
+static void TinyGrisuRound(char* buffer, int len, uint64_t delta, uint64_t rest, uint64_t tenKappa, uint64_t wpw) {
+    while(rest < wpw && delta - rest >= tenKappa &&
+          (rest + tenKappa < wpw || wpw - rest > rest + tenKappa - wpw)) {
+        buffer[len - 1]--;
+        rest += tenKappa;
+    }
+}
+
+static int TinyCountDecimalDigit32(uint32_t n) {
+    if(n < 10) return 1;
+    if(n < 100) return 2;
+    if(n < 1000) return 3;
+    if(n < 10000) return 4;
+    if(n < 100000) return 5;
+    if(n < 1000000) return 6;
+    if(n < 10000000) return 7;
+    if(n < 100000000) return 8;
+    if(n < 1000000000) return 9;
+    return 10;
+}
+
+static void TinyDigitGen(TinyDiyFp W, TinyDiyFp Mp, uint64_t delta, char* buffer, int* len, int* K) {
+    const TinyDiyFp one = TinyDiyFpMake(1ULL << -Mp.e, Mp.e);
+    const uint64_t wpw = Mp.f - W.f;
+    uint32_t p1 = (uint32_t)(Mp.f >> -one.e);
+    uint64_t p2 = Mp.f & (one.f - 1);
+    int kappa = TinyCountDecimalDigit32(p1);
+    *len = 0;
+
+    //整数部分
+    while(kappa > 0) {
+        uint32_t d = (uint32_t)(p1 / TINY_POW10[kappa - 1]);
+        p1 %= (uint32_t)TINY_POW10[kappa - 1];
+        if(d || *len) buffer[(*len)++] = (char)('0' + d);
+        kappa--;
+        uint64_t tmp = ((uint64_t)p1 << -one.e) + p2;
+        if(tmp <= delta) {
+            *K += kappa;
+            TinyGrisuRound(buffer, *len, delta, tmp, TINY_POW10[kappa] << -one.e, wpw);
+            return;
+        }
+    }
+
+    //小数部分
+    while(true) {
+        p2 *= 10;
+        delta *= 10;
+        char d = (char)(p2 >> -one.e);
+        if(d || *len) buffer[(*len)++] = (char)('0' + d);
+        p2 &= one.f - 1;
+        kappa--;
+        if(p2 < delta) {
+            *K += kappa;
+            int index = -kappa;
+            TinyGrisuRound(buffer, *len, delta, p2, one.f, wpw * (index < 20 ? TINY_POW10[index] : 0));
+            return;
+        }
+    }
+}
+
+//value > 0, 得到 digits * 10^K
+static void TinyGrisu2(double value, char* buffer, int* len, int* K) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    int biased = (int)((bits >> 52) & 0x7FF);
+    uint64_t significand = bits & TINY_DP_SIGNIFICAND_MASK;
+    TinyDiyFp v = biased != 0 ?
+        TinyDiyFpMake(significand + TINY_DP_HIDDEN_BIT, biased - TINY_DP_EXPONENT_BIAS) :
+        TinyDiyFpMake(significand, 1 - TINY_DP_EXPONENT_BIAS);
+
+    //边界 m+ m-
+    TinyDiyFp plus = TinyDiyFpMake((v.f << 1) + 1, v.e - 1);
+    while(!(plus.f & (TINY_DP_HIDDEN_BIT << 1))) {
+        plus.f <<= 1;
+        plus.e--;
+    }
+    plus.f <<= 64 - 52 - 2;
+    plus.e -= 64 - 52 - 2;
+    TinyDiyFp minus = (v.f == TINY_DP_HIDDEN_BIT) ?
+        TinyDiyFpMake((v.f << 2) - 1, v.e - 2) :
+        TinyDiyFpMake((v.f << 1) - 1, v.e - 1);
+    minus.f <<= minus.e - plus.e;
+    minus.e = plus.e;
+
+    const TinyDiyFp cmk = TinyCachedPower(plus.e, K);
+    const TinyDiyFp W = TinyDiyFpMul(TinyDiyFpNormalize(v), cmk);
+    TinyDiyFp Wp = TinyDiyFpMul(plus, cmk);
+    TinyDiyFp Wm = TinyDiyFpMul(minus, cmk);
+    Wm.f++;
+    Wp.f--;
+    TinyDigitGen(W, Wp, Wp.f - Wm.f, buffer, len, K);
+}
+
+static char* TinyWriteUint64(char* p, uint64_t u) {
+    char tmp[20];
+    int n = 0;
+    do {
+        tmp[n++] = (char)('0' + u % 10);
+        u /= 10;
+    } while(u != 0);
+    while(n > 0) *p++ = tmp[--n];
+    return p;
+}
+
+//与 "%.17g" 相同的排版规则: 十进制指数在 [-4, 17) 内用定点, 否则用科学计数法
+static int TinyDtoa(double value, char* buffer) {
+    char* p = buffer;
+    //NaN 和无穷大按 TINY_PARSE_FLAG_NAN_INF 接受的写法输出, 不能交给 Grisu2
+    if(!isfinite(value)) {
+        const char* text = isnan(value) ? "NaN" : value < 0 ? "-Infinity" : "Infinity";
+        size_t len = strlen(text);
+        memcpy(p, text, len);
+        return (int)len;
+    }
+    if(value == 0) {
+        if(signbit(value)) *p++ = '-';
+        *p++ = '0';
+        return (int)(p - buffer);
+    }
+    if(value < 0) {
+        *p++ = '-';
+        value = -value;
+    }
+    //整数快速路径
+    if(value < 9007199254740992.0 && value == (double)(uint64_t)value) {
+        return (int)(TinyWriteUint64(p, (uint64_t)value) - buffer);
+    }
+
+    char digits[20];
+    int len, K;
+    TinyGrisu2(value, digits, &len, &K);
+    int exp10 = len + K - 1;
+    if(exp10 >= -4 && exp10 < 17) {
+        int kk = len + K;   /* 整数部分的位数 */
+        if(kk >= len) {
+            memcpy(p, digits, len);
+            p += len;
+            memset(p, '0', kk - len);
+            p += kk - len;
+        } else if(kk > 0) {
+            memcpy(p, digits, kk);
+            p += kk;
+            *p++ = '.';
+            memcpy(p, digits + kk, len - kk);
+            p += len - kk;
+        } else {
+            *p++ = '0';
+            *p++ = '.';
+            memset(p, '0', -kk);
+            p += -kk;
+            memcpy(p, digits, len);
+            p += len;
+        }
+    } else {
+        *p++ = digits[0];
+        if(len > 1) {
+            *p++ = '.';
+            memcpy(p, digits + 1, len - 1);
+            p += len - 1;
+        }
+        *p++ = 'e';
+        if(exp10 < 0) {
+            *p++ = '-';
+            exp10 = -exp10;
+        } else {
+            *p++ = '+';
         }
+        if(exp10 < 10) *p++ = '0';
+        p = TinyWriteUint64(p, (uint64_t)exp10);
+    }
+    return (int)(p - buffer);
+}
+
+//逗号分隔的一串数字, 一次预留全部空间
+static void TinyStringifyNumbers(TinyContext* context, const double* nums, size_t n) {
+    if(n == 0) return;
+    char* begin = (char*)TinyContextPush(context, n * 33);
+    char* p = begin;
+    for(size_t i = 0; i < n; i++) {
+        p += TinyDtoa(nums[i], p);
+        *p++ = ',';
     }
-    *p++ = '"';
-    context->top -= size - (p - head);     //对齐
+    context->top -= n * 33 - (p - begin - 1);
 }
 
 static void TinyStringifyValue(TinyContext* context, const TinyValue* value) {
@@ -455,16 +1233,22 @@ static void TinyStringifyValue(TinyContext* context, const TinyValue* value) {
     case TINY_NULL: TinyPutS(context, "null", 4); break;
     case TINY_FALSE: TinyPutS(context, "false", 5); break;
     case TINY_TRUE: TinyPutS(context, "true", 4); break;
-    case TINY_STRING: TinyStringifyString(context, value->str, value->len); break;
+    case TINY_STRING: TinyStringifyStored(context, value->str, value->len); break;
     case TINY_NUMBER:
-        {
+        if(value->numLen != 0) {
+            TinyPutS(context, TinyNumberIsHeap(value) ? value->str : value->numText, value->numLen);
+        } else {
              char* buff = (char*)TinyContextPush(context, 32);
-             int len = sprintf(buff, "%.17g", value->num);
+             int len = TinyDtoa(value->num, buff);
              context->top -= 32 - len;
         }
         break;
     case TINY_ARRAY:
-        {
+        if(TinyIsPacked(value)) {
+            TinyPutC(context, '[');
+            TinyStringifyNumbers(context, TinyPackedOf(value), value->size);
+            TinyPutC(context, ']');
+        } else {
             TinyPutC(context, '[');
             for(size_t i = 0; i < value->size; i++) {
                 if(i > 0) TinyPutC(context, ',');
@@ -478,8 +1262,7 @@ static void TinyStringifyValue(TinyContext* context, const TinyValue* value) {
             TinyPutC(context, '{');
             for(size_t i = 0; i < value->osize; i++) {
                 if(i > 0) TinyPutC(context, ',');
-                TinyStringifyString(context, value->object[i].key, value->object[i].kLen);
-                TinyPutC(context, ':');
+                TinyStringifyKey(context, &value->object[i]);
                 TinyStringifyValue(context, &value->object[i].value);
             }
             TinyPutC(context, '}');
@@ -491,10 +1274,12 @@ static void TinyStringifyValue(TinyContext* context, const TinyValue* value) {
     }
 }
 
-int TinyParse(TinyValue *value, const char* json) {
-    assert(value != NULL);
+template <unsigned Flags>
+static int TinyParseWith(TinyValue *value, const char* json) {
+    assert(value != NULL && json != NULL);
     TinyContext context;
     int ret;
+    TINY_STAT_CLOCK(start);
 
     TinyInitValue(value);
     //初始化context
@@ -503,7 +1288,7 @@ int TinyParse(TinyValue *value, const char* json) {
     context.size = context.top = 0;
 
     TinyParseWhiteSpace(&context);
-    ret = TinyParseValue(&context, value);
+    ret = TinyParseValue<Flags>(&context, value, 0);
 
     if(ret == TINY_PARSE_OK) {
         TinyParseWhiteSpace(&context);
@@ -514,9 +1299,57 @@ int TinyParse(TinyValue *value, const char* json) {
     }
     assert(context.top == 0);
     free(context.stack);
+    TINY_STAT_ADD(TINY_STAT_PARSES, 1);
+    TINY_STAT_ADD(TINY_STAT_PARSE_ERRORS, ret != TINY_PARSE_OK);
+    TINY_STAT_ADD(TINY_STAT_PARSE_BYTES, context.json - json);
+    TINY_STAT_ELAPSED(TINY_STAT_PARSE_NS, start);
     return ret;
 }
 
+int TinyParse(TinyValue *value, const char* json) {
+    return TinyParseWith<TINY_PARSE_FLAG_DEFAULT>(value, json);
+}
+
+int TinyParseWithFlags(TinyValue *value, const char* json, unsigned flags) {
+    //每种组合一个实例
+    static int (*const parsers[])(TinyValue*, const char*) = {
+        TinyParseWith<0>,
+        TinyParseWith<1>,
+        TinyParseWith<2>,
+        TinyParseWith<3>,
+        TinyParseWith<4>,
+        TinyParseWith<5>,
+        TinyParseWith<6>,
+        TinyParseWith<7>,
+        TinyParseWith<8>,
+        TinyParseWith<9>,
+        TinyParseWith<10>,
+        TinyParseWith<11>,
+        TinyParseWith<12>,
+        TinyParseWith<13>,
+        TinyParseWith<14>,
+        TinyParseWith<15>,
+        TinyParseWith<16>,
+        TinyParseWith<17>,
+        TinyParseWith<18>,
+        TinyParseWith<19>,
+        TinyParseWith<20>,
+        TinyParseWith<21>,
+        TinyParseWith<22>,
+        TinyParseWith<23>,
+        TinyParseWith<24>,
+        TinyParseWith<25>,
+        TinyParseWith<26>,
+        TinyParseWith<27>,
+        TinyParseWith<28>,
+        TinyParseWith<29>,
+        TinyParseWith<30>,
+        TinyParseWith<31>,
+    };
+    assert(flags < sizeof(parsers) / sizeof(parsers[0]));
+    return parsers[flags](value, json);
+}
+
 void TinyInitValue(TinyValue *value) {
     value->type = TINY_NULL;
 }
@@ -525,25 +1358,20 @@ void TinyFree(TinyValue *value) {
     assert(value != NULL);
     switch (value->type)
     {
+    case TINY_NUMBER:
+        if(TinyNumberIsHeap(value)) TinyStringRelease(value->str);
+        break;
     case TINY_STRING:
-        free(value->str);
+        TinyStringRelease(value->str);
         value->len = 0;
         break;
     case TINY_ARRAY:
-        //释放元素
-        for(size_t i = 0; i < value->size; i++) {
-            TinyFree(&value->array[i]);
-        }
-        //释放数组
-        free(value->array);
+        //最后一个引用时释放元素和数组
+        TinyReleaseArray(value->array, value->size);
         value->size = 0;
         break;
     case TINY_OBJECT:
-        for(size_t i = 0; i < value->osize; i++){
-            free(value->object[i].key);
-            TinyFree(&value->object[i].value);
-        }
-        free(value->object);
+        TinyReleaseObject(value->object, value->osize);
         value->osize = 0;
         break;
     default:
@@ -552,41 +1380,1007 @@ void TinyFree(TinyValue *value) {
     value->type = TINY_NULL;
 }
 
-char* TinyStringify(const TinyValue* value, size_t* len) {
-    TinyContext context;
-    assert(value != NULL);
-
-    context.size = TINY_STACK_SIZE;
-    context.stack = (char*)malloc(context.size);
-    context.top = 0;
+void TinyReclaimerInit(TinyReclaimer* r) {
+    assert(r != NULL);
+    r->values = NULL;
+    r->count = r->vcapacity = 0;
+    r->frames = NULL;
+    r->depth = r->fcapacity = 0;
+    r->nodes = r->bytes = 0;
+}
 
-    TinyStringifyValue(&context, value);
-    if(len > 0) *len = context.top;
-    TinyPutC(&context, '\0');
+void TinyReclaimerPush(TinyReclaimer* r, TinyValue* value) {
+    assert(r != NULL && value != NULL);
+    if(r->count == r->vcapacity) {
+        r->vcapacity = r->vcapacity == 0 ? 8 : r->vcapacity + (r->vcapacity >> 1);
+        r->values = (TinyValue*)realloc(r->values, r->vcapacity * sizeof(TinyValue));
+    }
+    memcpy(&r->values[r->count++], value, sizeof(TinyValue));
+    TinyInitValue(value);
+}
 
-    return context.stack;
+static void TinyReclaimString(TinyReclaimer* r, char* str, size_t len) {
+    if(str && TinyRefRelease(&TinyStringBlockOf(str)->refs)) {
+        free(TinyStringBlockOf(str));
+        r->nodes++;
+        r->bytes += sizeof(TinyStringBlock) + len + 1;
+    }
 }
 
-void TinySetNull(TinyValue* value) {
-    assert(value != NULL);
-    TinyFree(value);
+//释放最后一个引用的容器时压入一层, 其元素留到之后的步骤
+static void TinyReclaimValue(TinyReclaimer* r, TinyValue* value) {
+    void* storage;
+    size_t size, bytes;
+    switch(value->type) {
+        case TINY_NUMBER:
+            if(TinyNumberIsHeap(value)) TinyReclaimString(r, value->str, value->len);
+            return;
+        case TINY_STRING: TinyReclaimString(r, value->str, value->len); return;
+        case TINY_ARRAY:
+            storage = value->array;
+            size = TinyIsPacked(value) ? 0 : value->size;
+            bytes = value->capacity * (storage ? TinyArrayElementSize(value) : 0);
+            break;
+        case TINY_OBJECT:
+            storage = value->object;
+            size = value->osize;
+            bytes = value->ocapacity * sizeof(TinyMember);
+            break;
+        default: return;
+    }
+    if(storage == NULL || !TinyRefRelease(&TinyBlockOf(storage)->refs)) return;
+    if(r->depth == r->fcapacity) {
+        r->fcapacity = r->fcapacity == 0 ? 16 : r->fcapacity + (r->fcapacity >> 1);
+        r->frames = (TinyReclaimFrame*)realloc(r->frames, r->fcapacity * sizeof(TinyReclaimFrame));
+    }
+    TinyReclaimFrame* f = &r->frames[r->depth++];
+    f->storage = storage;
+    f->index = 0;
+    f->size = size;
+    f->bytes = sizeof(TinyBlock) + bytes;
+    f->object = value->type == TINY_OBJECT;
 }
 
-TinyType TinyGetType(const TinyValue* value) {
-    assert(value != NULL);
-    return value->type;
+bool TinyReclaimerStep(TinyReclaimer* r, size_t budget) {
+    assert(r != NULL);
+    for(; budget > 0; budget--) {
+        if(r->depth > 0) {
+            TinyReclaimFrame* f = &r->frames[r->depth - 1];
+            if(f->index == f->size) {
+                TinyBlockFree(TinyBlockOf(f->storage));
+                r->nodes++;
+                r->bytes += f->bytes;
+                r->depth--;
+            } else if(f->object) {
+                TinyMember* m = (TinyMember*)f->storage + f->index++;
+                TinyReclaimString(r, m->key, m->kLen);
+                TinyReclaimValue(r, &m->value);
+            } else {
+                TinyReclaimValue(r, (TinyValue*)f->storage + f->index++);
+            }
+        } else if(r->count > 0) {
+            TinyReclaimValue(r, &r->values[--r->count]);
+        } else {
+            break;
+        }
+    }
+    return TinyReclaimerIsEmpty(r);
 }
 
-double TinyGetNumber(const TinyValue* value) {
-    assert(value != NULL && value->type == TINY_NUMBER);
-    return value->num;
+bool TinyReclaimerIsEmpty(const TinyReclaimer* r) {
+    assert(r != NULL);
+    return r->depth == 0 && r->count == 0;
 }
 
-void TinySetNumber(TinyValue* value, double num) {
-    assert(value != NULL);
-    TinyFree(value);
-    value->num = num;
-    value->type = TINY_NUMBER;
+void TinyReclaimerFree(TinyReclaimer* r) {
+    assert(r != NULL);
+    TinyReclaimerStep(r, SIZE_MAX);
+    free(r->values);
+    free(r->frames);
+    r->values = NULL;
+    r->frames = NULL;
+    r->vcapacity = r->fcapacity = 0;
+}
+
+//输出较短的容器重新生成也很快, 不值得记下
+#define TINY_CACHE_MIN 16
+
+//记下输出之后有子孙容器被修改过: 修改只丢弃被修改容器自己的输出, 祖先的输出在使用前逐层检查
+static bool TinyCacheStale(const TinyValue* value, uint64_t time) {
+    if(TinyIsPacked(value)) return false;
+    size_t size = value->type == TINY_ARRAY ? value->size : value->osize;
+    for(size_t i = 0; i < size; i++) {
+        const TinyValue* e = value->type == TINY_ARRAY ? &value->array[i] : &value->object[i].value;
+        const void* storage;
+        if(e->type == TINY_ARRAY && e->array) storage = e->array;
+        else if(e->type == TINY_OBJECT && e->object) storage = e->object;
+        else continue;
+        if(TinyBlockOf(storage)->modified > time || TinyCacheStale(e, time)) return true;
+    }
+    return false;
+}
+
+//同 TinyStringifyValue, 容器优先使用记下的输出, 没有时生成并记下
+static void TinyStringifyCachedValue(TinyContext* context, const TinyValue* value) {
+    void* storage;
+    if(value->type == TINY_ARRAY && value->array) storage = value->array;
+    else if(value->type == TINY_OBJECT && value->object) storage = value->object;
+    else {
+        TinyStringifyValue(context, value);
+        return;
+    }
+    TinyBlock* block = TinyBlockOf(storage);
+    uint64_t time = __atomic_load_n(&TinyBlockClock, __ATOMIC_RELAXED);
+    TinyCache* cache = __atomic_load_n(&block->cache, __ATOMIC_ACQUIRE);
+    if(cache) {
+        uint64_t checked = __atomic_load_n(&cache->checked, __ATOMIC_RELAXED);
+        if(checked == time || !TinyCacheStale(value, cache->time)) {
+            if(checked != time) __atomic_store_n(&cache->checked, time, __ATOMIC_RELAXED);
+            TinyPutS(context, (const char*)(cache + 1), cache->len);
+            return;
+        }
+    }
+    size_t head = context->top;
+    if(TinyIsPacked(value)) {
+        TinyStringifyValue(context, value);
+    } else if(value->type == TINY_ARRAY) {
+        TinyPutC(context, '[');
+        for(size_t i = 0; i < value->size; i++) {
+            if(i > 0) TinyPutC(context, ',');
+            TinyStringifyCachedValue(context, &value->array[i]);
+        }
+        TinyPutC(context, ']');
+    } else {
+        TinyPutC(context, '{');
+        for(size_t i = 0; i < value->osize; i++) {
+            if(i > 0) TinyPutC(context, ',');
+            TinyStringifyKey(context, &value->object[i]);
+            TinyStringifyCachedValue(context, &value->object[i].value);
+        }
+        TinyPutC(context, '}');
+    }
+    size_t len = context->top - head;
+    //过期的输出可能正被其它线程检查, 不能在这里替换, 留到该容器下次修改或释放时丢弃
+    if(len < TINY_CACHE_MIN || cache != NULL) return;
+    cache = (TinyCache*)malloc(sizeof(TinyCache) + len);
+    TINY_STAT_ADD(TINY_STAT_ALLOCS, 1);
+    TINY_STAT_ADD(TINY_STAT_ALLOC_BYTES, sizeof(TinyCache) + len);
+    cache->len = len;
+    cache->time = cache->checked = time;
+    memcpy(cache + 1, context->stack + head, len);
+    //共享的存储可能被其它线程同时输出, 先记下的为准
+    TinyCache* expected = NULL;
+    if(!__atomic_compare_exchange_n(&block->cache, &expected, cache, false, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE)) {
+        free(cache);
+    }
+}
+
+static char* TinyStringifyWith(const TinyValue* value, size_t* len, void (*stringify)(TinyContext*, const TinyValue*)) {
+    TinyContext context;
+    assert(value != NULL);
+    TINY_STAT_CLOCK(start);
+
+    context.size = TINY_STACK_SIZE;
+    context.stack = (char*)malloc(context.size);
+    context.top = 0;
+    TINY_STAT_ADD(TINY_STAT_ALLOCS, 1);
+    TINY_STAT_ADD(TINY_STAT_ALLOC_BYTES, context.size);
+
+    stringify(&context, value);
+    if(len != NULL) *len = context.top;
+    TINY_STAT_ADD(TINY_STAT_STRINGIFIES, 1);
+    TINY_STAT_ADD(TINY_STAT_STRINGIFY_BYTES, context.top);
+    TinyPutC(&context, '\0');
+    TINY_STAT_ELAPSED(TINY_STAT_STRINGIFY_NS, start);
+
+    return context.stack;
+}
+
+char* TinyStringify(const TinyValue* value, size_t* len) {
+    return TinyStringifyWith(value, len, TinyStringifyValue);
+}
+
+char* TinyStringifyCached(const TinyValue* value, size_t* len) {
+    return TinyStringifyWith(value, len, TinyStringifyCachedValue);
+}
+
+#define TINY_LEVEL_OBJECT    0x1u    /* 当前层是对象 */
+#define TINY_LEVEL_ELEMENT   0x2u    /* 已经有元素, 下一个需要逗号 */
+#define TINY_LEVEL_KEY       0x4u    /* 已写出键, 等待值 */
+
+void TinyWriterInit(TinyWriter* w) {
+    assert(w != NULL);
+    w->context.stack = NULL;
+    w->context.size = w->context.top = 0;
+    w->levels = NULL;
+    w->depth = w->lcapacity = 0;
+    w->root = false;
+}
+
+void TinyWriterReset(TinyWriter* w) {
+    assert(w != NULL);
+    w->context.top = 0;
+    w->depth = 0;
+    w->root = false;
+}
+
+void TinyWriterFree(TinyWriter* w) {
+    assert(w != NULL);
+    free(w->context.stack);
+    free(w->levels);
+    TinyWriterInit(w);
+}
+
+//写值之前: 检查位置是否允许一个值, 并写出需要的逗号
+static bool TinyWriterPrefix(TinyWriter* w) {
+    if(w->depth == 0) {
+        if(w->root) return false;
+        w->root = true;
+        return true;
+    }
+    unsigned char& level = w->levels[w->depth - 1];
+    if(level & TINY_LEVEL_OBJECT) {
+        if(!(level & TINY_LEVEL_KEY)) return false;
+        level &= ~TINY_LEVEL_KEY;
+        return true;
+    }
+    if(level & TINY_LEVEL_ELEMENT) TinyPutC(&w->context, ',');
+    level |= TINY_LEVEL_ELEMENT;
+    return true;
+}
+
+static bool TinyWriterStart(TinyWriter* w, char ch, unsigned char level) {
+    if(!TinyWriterPrefix(w)) return false;
+    if(w->depth == w->lcapacity) {
+        w->lcapacity = w->lcapacity == 0 ? 32 : w->lcapacity * 2;
+        w->levels = (unsigned char*)realloc(w->levels, w->lcapacity);
+    }
+    w->levels[w->depth++] = level;
+    TinyPutC(&w->context, ch);
+    return true;
+}
+
+static bool TinyWriterEnd(TinyWriter* w, char ch, unsigned char level) {
+    if(w->depth == 0) return false;
+    unsigned char top = w->levels[w->depth - 1];
+    if((top & TINY_LEVEL_OBJECT) != level || (top & TINY_LEVEL_KEY)) return false;
+    w->depth--;
+    TinyPutC(&w->context, ch);
+    return true;
+}
+
+bool TinyWriterStartObject(TinyWriter* w) {
+    assert(w != NULL);
+    return TinyWriterStart(w, '{', TINY_LEVEL_OBJECT);
+}
+
+bool TinyWriterEndObject(TinyWriter* w) {
+    assert(w != NULL);
+    return TinyWriterEnd(w, '}', TINY_LEVEL_OBJECT);
+}
+
+bool TinyWriterStartArray(TinyWriter* w) {
+    assert(w != NULL);
+    return TinyWriterStart(w, '[', 0);
+}
+
+bool TinyWriterEndArray(TinyWriter* w) {
+    assert(w != NULL);
+    return TinyWriterEnd(w, ']', 0);
+}
+
+bool TinyWriterKey(TinyWriter* w, const char* key, size_t klen) {
+    assert(w != NULL && (key != NULL || klen == 0));
+    if(w->depth == 0) return false;
+    unsigned char& level = w->levels[w->depth - 1];
+    if((level & (TINY_LEVEL_OBJECT | TINY_LEVEL_KEY)) != TINY_LEVEL_OBJECT) return false;
+    if(level & TINY_LEVEL_ELEMENT) TinyPutC(&w->context, ',');
+    level |= TINY_LEVEL_ELEMENT | TINY_LEVEL_KEY;
+    TinyStringifyString(&w->context, key, klen);
+    TinyPutC(&w->context, ':');
+    return true;
+}
+
+bool TinyWriterString(TinyWriter* w, const char* str, size_t len) {
+    assert(w != NULL && (str != NULL || len == 0));
+    if(!TinyWriterPrefix(w)) return false;
+    TinyStringifyString(&w->context, str, len);
+    return true;
+}
+
+bool TinyWriterNumber(TinyWriter* w, double num) {
+    assert(w != NULL);
+    if(!TinyWriterPrefix(w)) return false;
+    char* buff = (char*)TinyContextPush(&w->context, 32);
+    w->context.top -= 32 - TinyDtoa(num, buff);
+    return true;
+}
+
+bool TinyWriterInt64(TinyWriter* w, int64_t num) {
+    assert(w != NULL);
+    if(!TinyWriterPrefix(w)) return false;
+    char* head = (char*)TinyContextPush(&w->context, 21);
+    char* p = head;
+    uint64_t u = (uint64_t)num;
+    if(num < 0) {
+        *p++ = '-';
+        u = ~u + 1;
+    }
+    p = TinyWriteUint64(p, u);
+    w->context.top -= 21 - (p - head);
+    return true;
+}
+
+bool TinyWriterBool(TinyWriter* w, bool flag) {
+    assert(w != NULL);
+    if(!TinyWriterPrefix(w)) return false;
+    if(flag) TinyPutS(&w->context, "true", 4);
+    else TinyPutS(&w->context, "false", 5);
+    return true;
+}
+
+bool TinyWriterNull(TinyWriter* w) {
+    assert(w != NULL);
+    if(!TinyWriterPrefix(w)) return false;
+    TinyPutS(&w->context, "null", 4);
+    return true;
+}
+
+bool TinyWriterValue(TinyWriter* w, const TinyValue* value) {
+    assert(w != NULL && value != NULL);
+    if(!TinyWriterPrefix(w)) return false;
+    TinyStringifyValue(&w->context, value);
+    return true;
+}
+
+bool TinyWriterIsComplete(const TinyWriter* w) {
+    assert(w != NULL);
+    return w->root && w->depth == 0;
+}
+
+const char* TinyWriterGetString(TinyWriter* w, size_t* len) {
+    assert(w != NULL);
+    if(!TinyWriterIsComplete(w)) return NULL;
+    if(len != NULL) *len = w->context.top;
+    TinyPutC(&w->context, '\0');
+    w->context.top--;
+    return w->context.stack;
+}
+
+//长字符串分段转义, 每段最多这么多字节
+#define TINY_STRINGIFY_CHUNK 4096
+
+static void TinyStringifierString(TinyStringifier* s, const char* str, size_t len) {
+    if(len <= TINY_STRINGIFY_CHUNK) {
+        TinyStringifyStored(&s->context, str, len);
+    } else {
+        TinyPutC(&s->context, '"');
+        s->str = str;
+        s->slen = len;
+        s->soff = 0;
+    }
+}
+
+//开始输出一个值: 标量直接写入, 容器写入左括号并压入新的一帧
+static void TinyStringifierBegin(TinyStringifier* s, const TinyValue* value) {
+    switch(value->type) {
+        case TINY_STRING:
+            TinyStringifierString(s, value->str, value->len);
+            return;
+        case TINY_ARRAY:
+            TinyPutC(&s->context, '[');
+            break;
+        case TINY_OBJECT:
+            TinyPutC(&s->context, '{');
+            break;
+        default:
+            TinyStringifyValue(&s->context, value);
+            return;
+    }
+    if(s->depth == s->fcapacity) {
+        s->fcapacity = s->fcapacity == 0 ? 16 : s->fcapacity * 2;
+        s->frames = (TinyStringifyFrame*)realloc(s->frames, s->fcapacity * sizeof(TinyStringifyFrame));
+    }
+    TinyStringifyFrame& f = s->frames[s->depth++];
+    f.value = value;
+    f.index = 0;
+    f.key = false;
+}
+
+//向缓冲区写入下一段输出
+static void TinyStringifierStep(TinyStringifier* s) {
+    TinyContext* context = &s->context;
+    if(s->str != NULL) {
+        size_t n = s->slen - s->soff;
+        if(n > TINY_STRINGIFY_CHUNK) n = TINY_STRINGIFY_CHUNK;
+        TinyStringifyChars(context, s->str + s->soff, n);
+        s->soff += n;
+        if(s->soff == s->slen) {
+            TinyPutC(context, '"');
+            s->str = NULL;
+        }
+        return;
+    }
+    TinyStringifyFrame& f = s->frames[s->depth - 1];
+    const TinyValue* value = f.value;
+    if(value->type == TINY_ARRAY) {
+        if(f.index == value->size) {
+            TinyPutC(context, ']');
+            s->depth--;
+            return;
+        }
+        if(f.index > 0) TinyPutC(context, ',');
+        if(TinyIsPacked(value)) {
+            //每次最多 128 个数字, 不超过 TINY_STRINGIFY_CHUNK
+            size_t n = value->size - f.index < 128 ? value->size - f.index : 128;
+            TinyStringifyNumbers(context, TinyPackedOf(value) + f.index, n);
+            f.index += n;
+            return;
+        }
+        TinyStringifierBegin(s, &value->array[f.index++]);
+    } else {
+        if(f.index == value->osize) {
+            TinyPutC(context, '}');
+            s->depth--;
+            return;
+        }
+        const TinyMember& m = value->object[f.index];
+        if(!f.key) {
+            if(f.index > 0) TinyPutC(context, ',');
+            f.key = true;
+            TinyStringifierString(s, m.key, m.kLen);
+            return;
+        }
+        TinyPutC(context, ':');
+        f.key = false;
+        f.index++;
+        TinyStringifierBegin(s, &m.value);
+    }
+}
+
+void TinyStringifierInit(TinyStringifier* s, const TinyValue* value) {
+    assert(s != NULL && value != NULL);
+    s->context.stack = NULL;
+    s->context.size = s->context.top = 0;
+    s->head = 0;
+    s->frames = NULL;
+    s->depth = s->fcapacity = 0;
+    s->str = NULL;
+    s->slen = s->soff = 0;
+    TinyStringifierBegin(s, value);
+    TINY_STAT_ADD(TINY_STAT_STRINGIFIES, 1);
+}
+
+size_t TinyStringifierWrite(TinyStringifier* s, char* buff, size_t size) {
+    assert(s != NULL && (buff != NULL || size == 0));
+    size_t n = 0;
+    TINY_STAT_CLOCK(start);
+    while(n < size) {
+        if(s->head == s->context.top) {
+            s->head = s->context.top = 0;
+            if(s->depth == 0 && s->str == NULL) break;
+            TinyStringifierStep(s);
+            continue;
+        }
+        size_t k = s->context.top - s->head;
+        if(k > size - n) k = size - n;
+        memcpy(buff + n, s->context.stack + s->head, k);
+        s->head += k;
+        n += k;
+    }
+    TINY_STAT_ADD(TINY_STAT_STRINGIFY_BYTES, n);
+    TINY_STAT_ELAPSED(TINY_STAT_STRINGIFY_NS, start);
+    return n;
+}
+
+bool TinyStringifierDone(const TinyStringifier* s) {
+    assert(s != NULL);
+    return s->head == s->context.top && s->depth == 0 && s->str == NULL;
+}
+
+void TinyStringifierFree(TinyStringifier* s) {
+    assert(s != NULL);
+    free(s->context.stack);
+    free(s->frames);
+    s->context.stack = NULL;
+    s->frames = NULL;
+}
+
+int TinyStringifyFile(const TinyValue* value, FILE* fp) {
+    assert(value != NULL && fp != NULL);
+    TinyStringifier s;
+    char* buff = (char*)malloc(TINY_WRITE_BUFFER_SIZE);
+    int ret = TINY_STRINGIFY_OK;
+    size_t n;
+
+    TinyStringifierInit(&s, value);
+    while((n = TinyStringifierWrite(&s, buff, TINY_WRITE_BUFFER_SIZE)) > 0) {
+        if(fwrite(buff, 1, n, fp) != n) {
+            ret = TINY_STRINGIFY_IO_ERROR;
+            break;
+        }
+    }
+    TinyStringifierFree(&s);
+    free(buff);
+    return ret;
+}
+
+#if TINY_HAS_POSIX
+static bool TinyWriteAll(int fd, const char* buff, size_t len) {
+    while(len > 0) {
+        ssize_t n = write(fd, buff, len);
+        if(n < 0) {
+            if(errno == EINTR) continue;
+            return false;
+        }
+        buff += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+int TinyStringifyFd(const TinyValue* value, int fd) {
+    assert(value != NULL);
+    TinyStringifier s;
+    char* buff = (char*)malloc(TINY_WRITE_BUFFER_SIZE);
+    int ret = TINY_STRINGIFY_OK;
+    size_t n;
+
+    TinyStringifierInit(&s, value);
+    while((n = TinyStringifierWrite(&s, buff, TINY_WRITE_BUFFER_SIZE)) > 0) {
+        if(!TinyWriteAll(fd, buff, n)) {
+            ret = TINY_STRINGIFY_IO_ERROR;
+            break;
+        }
+    }
+    TinyStringifierFree(&s);
+    free(buff);
+    return ret;
+}
+#endif
+
+static void TinyIovecPush(TinyIovecList* list, const void* base, size_t len) {
+    if(len == 0) return;
+    if(list->count == list->capacity) {
+        list->capacity = list->capacity == 0 ? 16 : list->capacity * 2;
+        list->iov = (TinyIovec*)realloc(list->iov, list->capacity * sizeof(TinyIovec));
+    }
+    list->iov[list->count].base = base;
+    list->iov[list->count].len = len;
+    list->count++;
+}
+
+//把暂存区中尚未引用的部分作为一段, 暂存区还会扩容, 先记 NULL 最后统一换成地址
+static void TinyIovecFlush(TinyIovecList* list, TinyContext* context, size_t* mark) {
+    TinyIovecPush(list, NULL, context->top - *mark);
+    *mark = context->top;
+}
+
+static void TinyStringifyIovecValue(TinyIovecList* list, TinyContext* context, size_t* mark, const TinyValue* value) {
+    switch(value->type) {
+        case TINY_STRING:
+            if(value->len >= TINY_IOVEC_MIN_REFERENCE && TinyStringIsClean(value->str)) {
+                //直接引用字符串本身, 不拷贝
+                TinyPutC(context, '"');
+                TinyIovecFlush(list, context, mark);
+                TinyIovecPush(list, value->str, value->len);
+                list->direct++;
+                TinyPutC(context, '"');
+            } else {
+                TinyStringifyStored(context, value->str, value->len);
+            }
+            break;
+        case TINY_ARRAY:
+            TinyPutC(context, '[');
+            if(TinyIsPacked(value)) {
+                TinyStringifyNumbers(context, TinyPackedOf(value), value->size);
+            } else {
+                for(size_t i = 0; i < value->size; i++) {
+                    if(i > 0) TinyPutC(context, ',');
+                    TinyStringifyIovecValue(list, context, mark, &value->array[i]);
+                }
+            }
+            TinyPutC(context, ']');
+            break;
+        case TINY_OBJECT:
+            TinyPutC(context, '{');
+            for(size_t i = 0; i < value->osize; i++) {
+                if(i > 0) TinyPutC(context, ',');
+                TinyStringifyKey(context, &value->object[i]);
+                TinyStringifyIovecValue(list, context, mark, &value->object[i].value);
+            }
+            TinyPutC(context, '}');
+            break;
+        default:
+            TinyStringifyValue(context, value);
+            break;
+    }
+}
+
+void TinyStringifyIovec(const TinyValue* value, TinyIovecList* list) {
+    assert(value != NULL && list != NULL);
+    TinyContext context;
+    size_t mark = 0, offset = 0;
+    TINY_STAT_CLOCK(start);
+
+    context.size = TINY_STACK_SIZE;
+    context.stack = (char*)malloc(context.size);
+    context.top = 0;
+    TINY_STAT_ADD(TINY_STAT_ALLOCS, 1);
+    TINY_STAT_ADD(TINY_STAT_ALLOC_BYTES, context.size);
+    list->iov = NULL;
+    list->count = list->capacity = list->direct = 0;
+    list->buffers = NULL;
+    list->nbuffers = 0;
+
+    TinyStringifyIovecValue(list, &context, &mark, value);
+    TinyIovecFlush(list, &context, &mark);
+
+    //暂存区的各段首尾相接
+    for(size_t i = 0; i < list->count; i++) {
+        if(list->iov[i].base == NULL) {
+            list->iov[i].base = context.stack + offset;
+            offset += list->iov[i].len;
+        }
+        TINY_STAT_ADD(TINY_STAT_STRINGIFY_BYTES, list->iov[i].len);
+    }
+    list->buffer = context.stack;
+    TINY_STAT_ADD(TINY_STAT_STRINGIFIES, 1);
+    TINY_STAT_ELAPSED(TINY_STAT_STRINGIFY_NS, start);
+}
+
+void TinyFreeIovecList(TinyIovecList* list) {
+    assert(list != NULL);
+    for(size_t i = 0; i < list->nbuffers; i++) free(list->buffers[i]);
+    free(list->buffers);
+    free(list->iov);
+    free(list->buffer);
+    list->iov = NULL;
+    list->buffer = NULL;
+    list->buffers = NULL;
+    list->nbuffers = 0;
+    list->count = list->capacity = list->direct = 0;
+}
+
+#if TINY_HAS_POSIX
+int TinyStringifyWritev(const TinyValue* value, int fd) {
+    assert(value != NULL);
+    TinyIovecList list;
+    int ret = TINY_STRINGIFY_OK;
+    size_t i = 0;
+
+    TinyStringifyIovec(value, &list);
+    //TinyIovec 与 struct iovec 布局相同
+    struct iovec* iov = (struct iovec*)list.iov;
+    while(i < list.count) {
+        int cnt = (int)(list.count - i < IOV_MAX ? list.count - i : IOV_MAX);
+        ssize_t n = writev(fd, iov + i, cnt);
+        if(n < 0) {
+            if(errno == EINTR) continue;
+            ret = TINY_STRINGIFY_IO_ERROR;
+            break;
+        }
+        //跳过已经写完的段, 部分写入的段调整起点
+        while(i < list.count && (size_t)n >= iov[i].iov_len) {
+            n -= iov[i].iov_len;
+            i++;
+        }
+        if(n > 0) {
+            iov[i].iov_base = (char*)iov[i].iov_base + n;
+            iov[i].iov_len -= n;
+        }
+    }
+    TinyFreeIovecList(&list);
+    return ret;
+}
+#endif
+//并行输出时每个线程约分到的段数, 段数多一些各线程的工作量更均衡
+#define TINY_PARALLEL_CHUNKS 4
+
+//并行输出的一段: 容器中 [begin, end) 的元素, 或计划中的一段固定文本(括号、逗号和键)
+struct TinyParallelChunk {
+    const TinyValue* value;     /* NULL 表示固定文本 */
+    size_t begin, end;          /* end 为 0 时是整个 value */
+    size_t offset, len;         /* 固定文本在 text 中的位置; 输出后为结果中的位置和长度 */
+    char* out;
+};
+
+struct TinyParallelPlan {
+    std::vector<TinyParallelChunk> chunks;
+    TinyContext text;
+};
+
+static void TinyParallelText(TinyParallelPlan* plan, size_t head) {
+    size_t len = plan->text.top - head;
+    if(len == 0) return;
+    //相邻的固定文本在 text 中也相邻, 合并为一段
+    if(!plan->chunks.empty() && plan->chunks.back().value == NULL) {
+        plan->chunks.back().len += len;
+        return;
+    }
+    TinyParallelChunk c = { NULL, 0, 0, head, len, NULL };
+    plan->chunks.push_back(c);
+}
+
+static void TinyParallelRange(TinyParallelPlan* plan, const TinyValue* value, size_t begin, size_t end) {
+    TinyParallelChunk c = { value, begin, end, 0, 0, NULL };
+    plan->chunks.push_back(c);
+}
+
+//把 value 切成大约 want 段; 元素不够分时把份额平分给各元素, 继续切较深的容器
+static void TinyParallelSplit(TinyParallelPlan* plan, const TinyValue* value, size_t want) {
+    size_t n = value->type == TINY_ARRAY ? value->size : value->type == TINY_OBJECT ? value->osize : 0;
+    if(want <= 1 || n == 0) {
+        TinyParallelRange(plan, value, 0, 0);
+        return;
+    }
+    size_t head = plan->text.top;
+    TinyPutC(&plan->text, value->type == TINY_ARRAY ? '[' : '{');
+    //紧凑数组的元素没有 TinyValue, 只能按区间切
+    if(n >= want || TinyIsPacked(value)) {
+        if(want > n) want = n;
+        for(size_t k = 0; k < want; k++) {
+            if(k > 0) TinyPutC(&plan->text, ',');
+            TinyParallelText(plan, head);
+            TinyParallelRange(plan, value, n * k / want, n * (k + 1) / want);
+            head = plan->text.top;
+        }
+    } else {
+        for(size_t i = 0; i < n; i++) {
+            if(i > 0) TinyPutC(&plan->text, ',');
+            if(value->type == TINY_OBJECT) TinyStringifyKey(&plan->text, &value->object[i]);
+            TinyParallelText(plan, head);
+            TinyParallelSplit(plan, value->type == TINY_ARRAY ? &value->array[i] : &value->object[i].value, (want + n - 1) / n);
+            head = plan->text.top;
+        }
+    }
+    TinyPutC(&plan->text, value->type == TINY_ARRAY ? ']' : '}');
+    TinyParallelText(plan, head);
+}
+
+static void TinyParallelOutput(TinyParallelChunk* c) {
+    TinyContext context;
+    context.stack = NULL;
+    context.size = context.top = 0;
+    const TinyValue* v = c->value;
+    if(c->end == 0) {
+        TinyStringifyValue(&context, v);
+    } else if(TinyIsPacked(v)) {
+        TinyStringifyNumbers(&context, TinyPackedOf(v) + c->begin, c->end - c->begin);
+    } else {
+        for(size_t i = c->begin; i < c->end; i++) {
+            if(i > c->begin) TinyPutC(&context, ',');
+            if(v->type == TINY_ARRAY) {
+                TinyStringifyValue(&context, &v->array[i]);
+            } else {
+                TinyStringifyKey(&context, &v->object[i]);
+                TinyStringifyValue(&context, &v->object[i].value);
+            }
+        }
+    }
+    c->out = context.stack;
+    c->len = context.top;
+}
+
+//常驻的工作线程, 按需增加, 进程退出时结束; 每次只执行一个任务
+struct TinyParallelPool {
+    std::mutex run;                     /* 持有者独占线程池 */
+    std::mutex mutex;                   /* 保护以下成员 */
+    std::condition_variable wake, done;
+    std::vector<std::thread> workers;
+    uint64_t generation;                /* 每发布一个任务加一 */
+    unsigned wanted;                    /* 还可以加入当前任务的线程数 */
+    unsigned active;                    /* 正在执行当前任务的线程数 */
+    bool stop;
+    void (*fn)(void* ctx, size_t i);
+    void* ctx;
+    size_t count;
+    std::atomic<size_t> next;
+
+    TinyParallelPool() : generation(0), wanted(0), active(0), stop(false), fn(NULL), ctx(NULL), count(0), next(0) {}
+    ~TinyParallelPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+            wake.notify_all();
+        }
+        for(size_t t = 0; t < workers.size(); t++) workers[t].join();
+    }
+};
+
+static void TinyParallelDrain(TinyParallelPool* pool, void (*fn)(void*, size_t), void* ctx, size_t count) {
+    for(size_t i; (i = pool->next.fetch_add(1, std::memory_order_relaxed)) < count; ) fn(ctx, i);
+}
+
+//seen 为创建时的任务序号, 新线程可以加入随后发布的任务
+static void TinyParallelWorker(TinyParallelPool* pool, uint64_t seen) {
+    std::unique_lock<std::mutex> lock(pool->mutex);
+    while(true) {
+        pool->wake.wait(lock, [&] { return pool->stop || pool->generation != seen; });
+        if(pool->stop) return;
+        seen = pool->generation;
+        //醒得太晚, 任务已经结束或人数已满
+        if(pool->wanted == 0) continue;
+        pool->wanted--;
+        pool->active++;
+        void (*fn)(void*, size_t) = pool->fn;
+        void* ctx = pool->ctx;
+        size_t count = pool->count;
+        lock.unlock();
+        TinyParallelDrain(pool, fn, ctx, count);
+        lock.lock();
+        if(--pool->active == 0) pool->done.notify_all();
+    }
+}
+
+static TinyParallelPool* TinyParallelGetPool() {
+    static TinyParallelPool pool;
+    return &pool;
+}
+
+template <class Work>
+static void TinyParallelCall(void* ctx, size_t i) {
+    (*(const Work*)ctx)(i);
+}
+
+//调用者也是其中一个线程, 各线程从同一个计数器领取下一段
+//线程池正被其它调用者使用时不等待, 由调用者独自完成
+template <class Work>
+static void TinyParallelRun(size_t count, unsigned threads, const Work& work) {
+    TinyParallelPool* pool = TinyParallelGetPool();
+    if(threads > count) threads = (unsigned)count;
+    if(threads <= 1 || !pool->run.try_lock()) {
+        for(size_t i = 0; i < count; i++) work(i);
+        return;
+    }
+    void (*fn)(void*, size_t) = TinyParallelCall<Work>;
+    {
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        while(pool->workers.size() < threads - 1) {
+            pool->workers.push_back(std::thread(TinyParallelWorker, pool, pool->generation));
+        }
+        pool->fn = fn;
+        pool->ctx = (void*)&work;
+        pool->count = count;
+        pool->next.store(0, std::memory_order_relaxed);
+        pool->wanted = threads - 1;
+        pool->generation++;
+        pool->wake.notify_all();
+    }
+    TinyParallelDrain(pool, fn, (void*)&work, count);
+    {
+        //不再接纳新的线程, 等已加入的线程做完手上的一段
+        std::unique_lock<std::mutex> lock(pool->mutex);
+        pool->wanted = 0;
+        pool->done.wait(lock, [&] { return pool->active == 0; });
+    }
+    pool->run.unlock();
+}
+
+static unsigned TinyParallelThreads(unsigned threads) {
+    if(threads == 0) threads = std::thread::hardware_concurrency();
+    return threads == 0 ? 1 : threads;
+}
+
+//切分并输出各段, 固定文本仍在 plan->text 中
+static void TinyParallelStringify(TinyParallelPlan* plan, const TinyValue* value, unsigned threads) {
+    plan->text.stack = NULL;
+    plan->text.size = plan->text.top = 0;
+    TinyParallelSplit(plan, value, (size_t)threads * TINY_PARALLEL_CHUNKS);
+    std::vector<size_t> ranges;
+    for(size_t i = 0; i < plan->chunks.size(); i++) {
+        if(plan->chunks[i].value != NULL) ranges.push_back(i);
+    }
+    TinyParallelChunk* chunks = &plan->chunks[0];
+    TinyParallelRun(ranges.size(), threads, [&](size_t i) { TinyParallelOutput(&chunks[ranges[i]]); });
+}
+
+char* TinyStringifyParallel(const TinyValue* value, size_t* len, unsigned threads) {
+    assert(value != NULL);
+    threads = TinyParallelThreads(threads);
+    if(threads == 1) return TinyStringify(value, len);
+    TINY_STAT_CLOCK(start);
+    TinyParallelPlan plan;
+    TinyParallelStringify(&plan, value, threads);
+
+    size_t total = 0;
+    for(size_t i = 0; i < plan.chunks.size(); i++) {
+        TinyParallelChunk* c = &plan.chunks[i];
+        if(c->value == NULL) {
+            //固定文本很短, 直接拷贝
+            c->out = plan.text.stack + c->offset;
+        }
+        c->offset = total;
+        total += c->len;
+    }
+    char* json = (char*)malloc(total + 1);
+    TINY_STAT_ADD(TINY_STAT_ALLOCS, 1);
+    TINY_STAT_ADD(TINY_STAT_ALLOC_BYTES, total + 1);
+    //拼接也分给各线程
+    TinyParallelChunk* chunks = &plan.chunks[0];
+    TinyParallelRun(plan.chunks.size(), threads, [&](size_t i) {
+        memcpy(json + chunks[i].offset, chunks[i].out, chunks[i].len);
+        if(chunks[i].value != NULL) free(chunks[i].out);
+    });
+    json[total] = '\0';
+    free(plan.text.stack);
+    if(len != NULL) *len = total;
+    TINY_STAT_ADD(TINY_STAT_STRINGIFIES, 1);
+    TINY_STAT_ADD(TINY_STAT_STRINGIFY_BYTES, total);
+    TINY_STAT_ELAPSED(TINY_STAT_STRINGIFY_NS, start);
+    return json;
+}
+
+void TinyStringifyParallelIovec(const TinyValue* value, TinyIovecList* list, unsigned threads) {
+    assert(value != NULL && list != NULL);
+    TINY_STAT_CLOCK(start);
+    TinyParallelPlan plan;
+    TinyParallelStringify(&plan, value, TinyParallelThreads(threads));
+
+    list->iov = NULL;
+    list->count = list->capacity = list->direct = 0;
+    list->buffers = (char**)malloc(plan.chunks.size() * sizeof(char*));
+    list->nbuffers = 0;
+    for(size_t i = 0; i < plan.chunks.size(); i++) {
+        TinyParallelChunk* c = &plan.chunks[i];
+        if(c->value == NULL) {
+            TinyIovecPush(list, plan.text.stack + c->offset, c->len);
+        } else {
+            TinyIovecPush(list, c->out, c->len);
+            list->buffers[list->nbuffers++] = c->out;
+        }
+        TINY_STAT_ADD(TINY_STAT_STRINGIFY_BYTES, c->len);
+    }
+    list->buffer = plan.text.stack;
+    TINY_STAT_ADD(TINY_STAT_STRINGIFIES, 1);
+    TINY_STAT_ELAPSED(TINY_STAT_STRINGIFY_NS, start);
+}
+void TinySetNull(TinyValue* value) {
+    assert(value != NULL);
+    TinyFree(value);
+}
+
+TinyType TinyGetType(const TinyValue* value) {
+    assert(value != NULL);
+    return value->type;
+}
+
+//不记下转换结果: 解析得到的值可能正被多个线程同时读取(TinyShared)
+static double TinyNumberFromText(const TinyValue* value) {
+    const char* text = TinyNumberIsHeap(value) ? value->str : value->numText;
+    size_t len = value->numLen;
+    //不超过 15 位的整数可以精确地直接计算
+    size_t i = text[0] == '-';
+    if(len - i <= 15) {
+        uint64_t n = 0;
+        for(; i < len && isDigit(text[i]); i++) n = n * 10 + (text[i] - '0');
+        if(i == len) return text[0] == '-' ? -(double)n : (double)n;
+    }
+    if(TinyNumberIsHeap(value)) return strtod(text, NULL);
+    char buff[sizeof(value->numText) + 1];
+    memcpy(buff, text, len);
+    buff[len] = '\0';
+    return strtod(buff, NULL);
+}
+
+double TinyGetNumber(const TinyValue* value) {
+    assert(value != NULL && value->type == TINY_NUMBER);
+    return value->numLen != 0 ? TinyNumberFromText(value) : value->num;
+}
+
+const char* TinyGetNumberText(const TinyValue* value, size_t* len) {
+    assert(value != NULL && value->type == TINY_NUMBER);
+    if(len != NULL) *len = value->numLen;
+    if(value->numLen == 0) return NULL;
+    return TinyNumberIsHeap(value) ? value->str : value->numText;
+}
+
+void TinySetNumber(TinyValue* value, double num) {
+    assert(value != NULL);
+    TinyFree(value);
+    value->num = num;
+    value->type = TINY_NUMBER;
+    value->numLen = 0;
 }
 
 bool TinyGetBoolean(const TinyValue* value) {
@@ -613,9 +2407,7 @@ size_t TinyGetStringLength(const TinyValue* value) {
 void TinySetString(TinyValue *value, const char* str, size_t len) {
     assert(value != NULL && (str != NULL || len == 0));
     TinyFree(value);
-    value->str = (char*)malloc(len + 1);
-    memcpy(value->str, str, len);
-    value->str[len] = '\0';
+    value->str = TinyStringNew(str, len);
     value->len = len;
     value->type = TINY_STRING;
 }
@@ -626,11 +2418,7 @@ void TinySetArray(TinyValue* value, size_t capacity) {
     value->type = TINY_ARRAY;
     value->size = 0;
     value->capacity = capacity;
-    if(capacity > 0) {
-        value->array = (TinyValue*)malloc(capacity * sizeof(TinyValue));
-    } else {
-        value->array = NULL;
-    }
+    value->array = (TinyValue*)TinyBlockRealloc(NULL, capacity * sizeof(TinyValue));
 }
 
 size_t TinyGetArrayCapacity(TinyValue* value) {
@@ -645,22 +2433,28 @@ size_t TinyGetArraySize(const TinyValue* value) {
 
 void TinyReserveArray(TinyValue* value, size_t capacity) {
     assert(value != NULL && value->type == TINY_ARRAY);
+    if(TinyIsPacked(value)) TinyPackedWrite(value);
+    else TinyBlockWrite(value);
     if(value->capacity < capacity) {
         value->capacity = capacity;
-        value->array = (TinyValue*) realloc(value->array, capacity * sizeof(TinyValue));
+        value->array = (TinyValue*)TinyBlockRealloc(value->array, capacity * TinyArrayElementSize(value));
     }
 }
 
 void TinyShrinkArray(TinyValue* value) {
     assert(value != NULL && value->type == TINY_ARRAY);
+    if(TinyIsPacked(value)) TinyPackedWrite(value);
+    else TinyBlockWrite(value);
     if(value->capacity > value->size) {
+        size_t bytes = value->size * TinyArrayElementSize(value);
         value->capacity = value->size;
-        value->array = (TinyValue*) realloc(value->array, value->capacity * sizeof(TinyValue));
+        value->array = (TinyValue*)TinyBlockRealloc(value->array, bytes);
     }
 }
 
 TinyValue* TinyPushBackArrayElement(TinyValue *value) {
     assert(value != NULL && value->type == TINY_ARRAY);
+    TinyBlockWrite(value);
     if(value->size == value->capacity) {
         if(value->capacity == 0) {
              TinyReserveArray(value, 1);
@@ -674,41 +2468,165 @@ TinyValue* TinyPushBackArrayElement(TinyValue *value) {
 
 void TinyPopBackArrayElement(TinyValue* value) {
     assert(value != NULL && value->type == TINY_ARRAY && value->size > 0);
+    TinyBlockWrite(value);
     TinyFree(&value->array[--value->size]);
 }
 
-TinyValue* TinyGetArrayElement(const TinyValue* value, size_t index) {
+//packed 数组的元素没有对应的 TinyValue: 第一次按元素读取时建立一份, 之后一直有效到数组被修改
+//共享的存储可能被多个线程同时读取, 先建立的为准
+static const TinyValue* TinyPackedView(const TinyValue* value) {
+    TinyBlock* block = TinyBlockOf(value->array);
+    TinyValue* view = __atomic_load_n(&block->view, __ATOMIC_ACQUIRE);
+    if(view) return view;
+    view = (TinyValue*)malloc(value->size * sizeof(TinyValue));
+    TINY_STAT_ADD(TINY_STAT_ALLOCS, 1);
+    TINY_STAT_ADD(TINY_STAT_ALLOC_BYTES, value->size * sizeof(TinyValue));
+    const double* nums = TinyPackedOf(value);
+    for(size_t i = 0; i < value->size; i++) {
+        view[i].num = nums[i];
+        view[i].type = TINY_NUMBER;
+        view[i].numLen = 0;
+    }
+    TinyValue* expected = NULL;
+    if(!__atomic_compare_exchange_n(&block->view, &expected, view, false, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE)) {
+        free(view);
+        view = expected;
+    }
+    return view;
+}
+
+const TinyValue* TinyGetArrayElement(const TinyValue* value, size_t index) {
     assert(value != NULL && value->type == TINY_ARRAY && index < value->size);
+    if(TinyIsPacked(value)) return TinyPackedView(value) + index;
     return &value->array[index];
 }
 
-TinyValue* TinyInsertArrayElement(TinyValue* value, size_t index) {
+const double* TinyGetArrayDoubles(const TinyValue* value, size_t* size) {
+    assert(value != NULL && value->type == TINY_ARRAY);
+    if(size != NULL) *size = value->size;
+    if(value->size == 0) return NULL;
+    return TinyIsPacked(value) ? TinyPackedOf(value) : NULL;
+}
+
+bool TinyPackArray(TinyValue* value) {
+    assert(value != NULL && value->type == TINY_ARRAY);
+    if(TinyIsPacked(value)) return true;
+    for(size_t i = 0; i < value->size; i++) {
+        if(value->array[i].type != TINY_NUMBER) return false;
+    }
+    //空数组保留原有容量, 之后追加的数字直接写入
+    size_t capacity = value->size != 0 ? value->size : value->capacity != 0 ? value->capacity : 1;
+    TinyValue* array = TinyPackedAlloc(capacity);
+    double* nums = (double*)array;
+    for(size_t i = 0; i < value->size; i++) nums[i] = TinyGetNumber(&value->array[i]);
+    TinyReleaseArray(value->array, value->size);
+    value->array = array;
+    value->capacity = capacity;
+    return true;
+}
+
+TinyValue* TinySetArrayElement(TinyValue* value, size_t index) {
     assert(value != NULL && value->type == TINY_ARRAY && index < value->size);
-    if(value->size + 1 > value->capacity) {
-        TinyPushBackArrayElement(value);      
-    } else {
-        value->size++;
+    TinyBlockWrite(value);
+    return &value->array[index];
+}
+
+//容量不够时至少翻倍, 避免逐个追加时反复 realloc
+static void TinyGrowArray(TinyValue* value, size_t size) {
+    if(size > value->capacity) {
+        TinyReserveArray(value, size > value->capacity * 2 ? size : value->capacity * 2);
     }
-    for(size_t i = value->size - 1; i > index; i--) {
-        value->array[i] = value->array[i - 1];
+}
+
+TinyValue* TinyInsertArrayElement(TinyValue* value, size_t index) {
+    assert(value != NULL && value->type == TINY_ARRAY && index < value->size);
+    return TinyInsertArrayElements(value, index, 1);
+}
+
+TinyValue* TinyInsertArrayElements(TinyValue* value, size_t index, size_t count) {
+    assert(value != NULL && value->type == TINY_ARRAY && index <= value->size);
+    TinyBlockWrite(value);
+    TinyGrowArray(value, value->size + count);
+    if(count == 0) return value->array + index;
+    memmove(&value->array[index + count], &value->array[index], (value->size - index) * sizeof(TinyValue));
+    for(size_t i = index; i < index + count; i++) {
+        TinyInitValue(&value->array[i]);
     }
+    value->size += count;
     return &value->array[index];
 }
 
 void TinyEraseArrayElement(TinyValue* value, size_t index, size_t count) {
-    size_t i;
     assert(value != NULL && value->type == TINY_ARRAY);
-    assert(count >= 0 && count + index <= value->size );
-
-    for(i = index; i + count < value->size; i++) {
-        value->array[i] = value->array[i + count];
-    }
-    for(; i < value->size; i++) {
+    assert(count + index <= value->size);
+    TinyBlockWrite(value);
+    for(size_t i = index; i < index + count; i++) {
         TinyFree(&value->array[i]);
     }
+    memmove(&value->array[index], &value->array[index + count], (value->size - index - count) * sizeof(TinyValue));
     value->size -= count;
 }
 
+//packed 数组追加数字时保持 packed, 返回写入位置; 否则返回 NULL
+//普通数组(包括空数组)不会因此变成 packed, 与解析时一样需要显式选择
+static double* TinyAppendPacked(TinyValue* value, size_t count) {
+    if(count == 0 || !TinyIsPacked(value)) return NULL;
+    TinyPackedWrite(value);
+    TinyGrowArray(value, value->size + count);
+    double* p = TinyPackedOf(value) + value->size;
+    value->size += count;
+    return p;
+}
+
+void TinyAppendArrayNumbers(TinyValue* value, const double* nums, size_t count) {
+    assert(value != NULL && value->type == TINY_ARRAY && (nums != NULL || count == 0));
+    double* packed = TinyAppendPacked(value, count);
+    if(packed != NULL) {
+        memcpy(packed, nums, count * sizeof(double));
+        return;
+    }
+    TinyBlockWrite(value);
+    TinyGrowArray(value, value->size + count);
+    TinyValue* e = value->array + value->size;
+    for(size_t i = 0; i < count; i++) {
+        e[i].num = nums[i];
+        e[i].type = TINY_NUMBER;
+        e[i].numLen = 0;
+    }
+    value->size += count;
+}
+
+void TinyAppendArrayInt64s(TinyValue* value, const int64_t* nums, size_t count) {
+    assert(value != NULL && value->type == TINY_ARRAY && (nums != NULL || count == 0));
+    double* packed = TinyAppendPacked(value, count);
+    if(packed != NULL) {
+        for(size_t i = 0; i < count; i++) packed[i] = (double)nums[i];
+        return;
+    }
+    TinyBlockWrite(value);
+    TinyGrowArray(value, value->size + count);
+    TinyValue* e = value->array + value->size;
+    for(size_t i = 0; i < count; i++) {
+        e[i].num = (double)nums[i];
+        e[i].type = TINY_NUMBER;
+        e[i].numLen = 0;
+    }
+    value->size += count;
+}
+
+void TinyAppendArrayStrings(TinyValue* value, const char* const* strs, const size_t* lens, size_t count) {
+    assert(value != NULL && value->type == TINY_ARRAY && (strs != NULL || count == 0));
+    TinyBlockWrite(value);
+    TinyGrowArray(value, value->size + count);
+    TinyValue* e = value->array + value->size;
+    for(size_t i = 0; i < count; i++) {
+        e[i].len = lens != NULL ? lens[i] : strlen(strs[i]);
+        e[i].str = TinyStringNew(strs[i], e[i].len);
+        e[i].type = TINY_STRING;
+    }
+    value->size += count;
+}
+
 void TinyClearArray(TinyValue* value) {
     assert(value != NULL && value->type == TINY_ARRAY);
     TinyEraseArrayElement(value, 0, value->size);
@@ -729,11 +2647,17 @@ size_t TinyGetObjectKeyLength(const TinyValue* value, size_t index) {
     return value->object[index].kLen;
 }
 
-TinyValue* TinyGetObjectValue(const TinyValue* value, size_t index) {
+const TinyValue* TinyGetObjectValue(const TinyValue* value, size_t index) {
     assert(value != NULL && value->type == TINY_OBJECT && index < value->osize);
     return &value->object[index].value;
 }
 
+TinyValue* TinySetObjectValueAt(TinyValue* value, size_t index) {
+    assert(value != NULL && value->type == TINY_OBJECT && index < value->osize);
+    TinyBlockWrite(value);
+    return &value->object[index].value;
+}
+
 size_t TinyFindObjectIndex(const TinyValue* value, const char* key, size_t klen) {
     assert(value != NULL && value->type == TINY_OBJECT && key != NULL);
     for(size_t i = 0; i < value->osize; i++) {
@@ -744,7 +2668,7 @@ size_t TinyFindObjectIndex(const TinyValue* value, const char* key, size_t klen)
     return TINY_KEY_NOT_EXIST;
 }
 
-TinyValue* TinyFindObjectValue(const TinyValue* value, const char* key, size_t klen) {
+const TinyValue* TinyFindObjectValue(const TinyValue* value, const char* key, size_t klen) {
     size_t index = TinyFindObjectIndex(value, key, klen);
     if(index == TINY_KEY_NOT_EXIST) return NULL;
     return &value->object[index].value;
@@ -754,6 +2678,7 @@ TinyValue* TinySetObjectValue(TinyValue* value, const char* key, size_t klen) {
     assert(value != NULL && value->type == TINY_OBJECT && key != NULL && klen != 0);
     size_t index = TinyFindObjectIndex(value, key, klen);
 
+    TinyBlockWrite(value);
     if(index != TINY_KEY_NOT_EXIST) {
         return &value->object[index].value;
     }
@@ -768,23 +2693,44 @@ TinyValue* TinySetObjectValue(TinyValue* value, const char* key, size_t klen) {
 
     TinyMember &m = value->object[value->osize++];
     m.kLen = klen;
-    m.key = (char*)malloc(klen + 1);
-    memcpy(m.key, key, klen);
+    m.key = TinyStringNew(key, klen);
     TinyInitValue(&m.value);
     return &m.value;
 }
 
+TinyValue* TinyPushBackObjectValue(TinyValue* value, const char* key, size_t klen) {
+    assert(value != NULL && value->type == TINY_OBJECT && (key != NULL || klen == 0));
+    TinyBlockWrite(value);
+    if(value->osize == value->ocapacity) {
+        TinyReserveObject(value, value->ocapacity == 0 ? 1 : value->ocapacity * 2);
+    }
+    TinyMember &m = value->object[value->osize++];
+    m.kLen = klen;
+    m.key = TinyStringNew(key, klen);
+    TinyInitValue(&m.value);
+    return &m.value;
+}
+
+void TinySetObjectFromArrays(TinyValue* value, const char* const* keys, const size_t* klens, const TinyValue* values, size_t count) {
+    assert(value != NULL && (keys != NULL || count == 0));
+    TinySetObject(value, count);
+    for(size_t i = 0; i < count; i++) {
+        TinyMember& m = value->object[i];
+        m.kLen = klens != NULL ? klens[i] : strlen(keys[i]);
+        m.key = TinyStringNew(keys[i], m.kLen);
+        if(values != NULL) TinyCopy(&m.value, &values[i]);
+        else TinyInitValue(&m.value);
+    }
+    value->osize = count;
+}
+
 void TinySetObject(TinyValue* value, size_t capacity) {
     assert(value != NULL);
     TinyFree(value);
     value->type = TINY_OBJECT;
     value->osize = 0;
     value->ocapacity = capacity;
-    if(capacity > 0) {
-        value->object = (TinyMember*)malloc(capacity * sizeof(TinyMember));
-    } else {
-        value->object = NULL;
-    }
+    value->object = (TinyMember*)TinyBlockRealloc(NULL, capacity * sizeof(TinyMember));
 }
 
 size_t TinyGetObjectCapacity(const TinyValue* value) {
@@ -794,51 +2740,219 @@ size_t TinyGetObjectCapacity(const TinyValue* value) {
 
 void TinyReserveObject(TinyValue* value, size_t capacity) {
     assert(value != NULL && value->type == TINY_OBJECT);
+    TinyBlockWrite(value);
     if(value->ocapacity < capacity) {
         value->ocapacity = capacity;
-        value->object = (TinyMember*) realloc(value->object, capacity * sizeof(TinyMember));
+        value->object = (TinyMember*)TinyBlockRealloc(value->object, capacity * sizeof(TinyMember));
     }
 }
 
 void TinyShrinkObject(TinyValue* value) {
     assert(value != NULL && value->type == TINY_OBJECT);
+    TinyBlockWrite(value);
     if(value->ocapacity > value->osize) {
         value->ocapacity = value->osize;
-        value->object = (TinyMember*) realloc(value->object, value->ocapacity * sizeof(TinyMember));
+        value->object = (TinyMember*)TinyBlockRealloc(value->object, value->ocapacity * sizeof(TinyMember));
     }
 }
 
 void TinyClearObject(TinyValue* value) {
     assert(value != NULL && value->type == TINY_OBJECT);
+    TinyBlockWrite(value);
     for(size_t i = 0; i < value->osize; i++) {
-        free(value->object[i].key);
+        TinyStringRelease(value->object[i].key);
         TinyFree(&value->object[i].value);
     }
-    value->size = 0;
+    value->osize = 0;
 }
 
 void TinyRemoveObjectValue(TinyValue* value, size_t index) {
     assert(value != NULL && value->type == TINY_OBJECT && index < value->osize);
-    for(size_t i = index + 1; i < value->osize; i++) {
-        memcpy(value->object[i - 1].key, value->object[i].key, value->object[i].kLen);
-        value->object[i - 1].value = value->object[i].value;
-        value->object[i - 1].kLen = value->object[i].kLen;
-    }
+    TinyBlockWrite(value);
+    TinyStringRelease(value->object[index].key);
+    TinyFree(&value->object[index].value);
     value->osize--;
-    free(value->object[value->osize].key);
-    TinyFree(&value->object[value->osize].value);
+    memmove(&value->object[index], &value->object[index + 1], (value->osize - index) * sizeof(TinyMember));
+}
+
+#define TINY_HASH_K1 0x9E3779B97F4A7C15ULL
+#define TINY_HASH_K2 0xC2B2AE3D27D4EB4FULL
+
+static uint64_t TinyRotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+// murmur3 fmix64
+static uint64_t TinyMix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+static uint64_t TinyHashBytes(const char* str, size_t len, uint64_t seed) {
+    uint64_t h = seed ^ (len * TINY_HASH_K1);
+    uint64_t w;
+    //一次吃8个字节
+    for(; len >= 8; str += 8, len -= 8) {
+        memcpy(&w, str, 8);
+        h = TinyRotl(h ^ (w * TINY_HASH_K2), 31) * TINY_HASH_K1;
+    }
+    w = 0;
+    memcpy(&w, str, len);
+    h = TinyRotl(h ^ (w * TINY_HASH_K2), 31) * TINY_HASH_K1;
+    return TinyMix(h);
+}
+
+static uint64_t TinyHashNumber(double num) {
+    // 0 == -0, 保证相等的值哈希相同
+    if(num == 0) num = 0.0;
+    uint64_t bits;
+    memcpy(&bits, &num, sizeof(bits));
+    return TinyMix(bits ^ TINY_NUMBER);
+}
+
+static bool TinyBlockHashed(const TinyBlock* block) {
+    return __atomic_load_n(&block->hashed, __ATOMIC_ACQUIRE) != 0;
+}
+
+static uint64_t TinyHashValue(const TinyValue* value, bool memoize) {
+    uint64_t h;
+    const void* storage = NULL;
+    switch(value->type) {
+        case TINY_ARRAY: storage = value->array; break;
+        case TINY_OBJECT: storage = value->object; break;
+        default: break;
+    }
+    if(storage && TinyBlockHashed(TinyBlockOf(storage))) {
+        return __atomic_load_n(&TinyBlockOf(storage)->hash, __ATOMIC_RELAXED);
+    }
+    switch(value->type) {
+        case TINY_NUMBER:
+            h = TinyHashNumber(TinyGetNumber(value));
+            break;
+        case TINY_STRING:
+            h = TinyHashBytes(value->str, value->len, TINY_STRING);
+            break;
+        case TINY_ARRAY:
+            //数组与顺序有关
+            h = TinyMix(value->size ^ TINY_ARRAY);
+            for(size_t i = 0; i < value->size; i++) {
+                uint64_t e = TinyIsPacked(value) ? TinyHashNumber(TinyPackedOf(value)[i]) : TinyHashValue(&value->array[i], memoize);
+                h = TinyRotl(h, 23) * TINY_HASH_K1 + e;
+            }
+            h = TinyMix(h);
+            break;
+        case TINY_OBJECT:
+            //对象与成员顺序无关, 成员哈希直接相加
+            h = TinyMix(value->osize ^ TINY_OBJECT);
+            for(size_t i = 0; i < value->osize; i++) {
+                const TinyMember& m = value->object[i];
+                h += TinyMix(TinyHashBytes(m.key, m.kLen, TINY_OBJECT) ^ 
+                             TinyRotl(TinyHashValue(&m.value, memoize), 17));
+            }
+            h = TinyMix(h);
+            break;
+        default:
+            h = TinyMix(value->type * TINY_HASH_K1);
+            break;
+    }
+    if(memoize && storage) {
+        //与其它线程同时记下时写入的是同一个值
+        TinyBlock* block = TinyBlockOf(storage);
+        __atomic_store_n(&block->hash, h, __ATOMIC_RELAXED);
+        __atomic_store_n(&block->hashed, 1u, __ATOMIC_RELEASE);
+    }
+    return h;
+}
+
+uint64_t TinyHash(const TinyValue* value) {
+    assert(value != NULL);
+    return TinyHashValue(value, false);
+}
+
+uint64_t TinyHashMemo(TinyValue* value) {
+    assert(value != NULL);
+    return TinyHashValue(value, true);
+}
+
+//两边都记下了哈希时可以直接排除
+static bool TinyHashDiffers(const void* lhs, const void* rhs) {
+    const TinyBlock* l = TinyBlockOf(lhs);
+    const TinyBlock* r = TinyBlockOf(rhs);
+    return TinyBlockHashed(l) && TinyBlockHashed(r)
+        && __atomic_load_n(&l->hash, __ATOMIC_RELAXED) != __atomic_load_n(&r->hash, __ATOMIC_RELAXED);
+}
+
+static bool TinyIsEqualObject(const TinyValue* lhs, const TinyValue* rhs) {
+    size_t n = lhs->osize, i;
+    //成员顺序相同是最常见的情况
+    for(i = 0; i < n; i++) {
+        const TinyMember& l = lhs->object[i];
+        const TinyMember& r = rhs->object[i];
+        if(l.kLen != r.kLen || memcmp(l.key, r.key, l.kLen) != 0) break;
+        if(!TinyIsEqual(&l.value, &r.value)) return false;
+    }
+    if(i == n) return true;
+    //顺序不同: 剩余成员较少时直接查找, 否则按键哈希建表做 hash join
+    if(n - i <= 16) {
+        for(; i < n; i++) {
+            const TinyValue* t = TinyFindObjectValue(rhs, lhs->object[i].key, lhs->object[i].kLen);
+            if(t == NULL || !TinyIsEqual(t, &lhs->object[i].value)) return false;
+        }
+        return true;
+    }
+    size_t mask = 32;
+    while(mask < n * 2) mask <<= 1;
+    mask--;
+    size_t* table = (size_t*)malloc((mask + 1) * sizeof(size_t));
+    memset(table, 0xff, (mask + 1) * sizeof(size_t));
+    for(size_t j = i; j < n; j++) {
+        const TinyMember& r = rhs->object[j];
+        size_t slot = TinyHashBytes(r.key, r.kLen, TINY_OBJECT) & mask;
+        while(table[slot] != TINY_KEY_NOT_EXIST) slot = (slot + 1) & mask;
+        table[slot] = j;
+    }
+    bool equal = true;
+    for(; i < n && equal; i++) {
+        const TinyMember& l = lhs->object[i];
+        size_t slot = TinyHashBytes(l.key, l.kLen, TINY_OBJECT) & mask;
+        const TinyMember* r = NULL;
+        for(; table[slot] != TINY_KEY_NOT_EXIST; slot = (slot + 1) & mask) {
+            const TinyMember& t = rhs->object[table[slot]];
+            if(t.kLen == l.kLen && memcmp(t.key, l.key, l.kLen) == 0) {
+                r = &t;
+                break;
+            }
+        }
+        equal = r != NULL && TinyIsEqual(&l.value, &r->value);
+    }
+    free(table);
+    return equal;
 }
 
 bool TinyIsEqual(const TinyValue* lhs, const TinyValue* rhs) {
     assert(lhs != NULL && rhs != NULL);
+    if(lhs == rhs) return true;
     if(lhs->type != rhs->type) return false;
     switch(lhs->type) {
         case TINY_STRING:
             return (lhs->len == rhs->len && memcmp(lhs->str, rhs->str, lhs->len) == 0);
         case TINY_NUMBER:
-            return lhs->num == rhs->num;
+            return TinyGetNumber(lhs) == TinyGetNumber(rhs);
         case TINY_ARRAY:
             if(lhs->size != rhs->size) return false;
+            //共享同一存储(TinyCopy 之后未修改)
+            if(lhs->size == 0 || lhs->array == rhs->array) return true;
+            if(TinyHashDiffers(lhs->array, rhs->array)) return false;
+            if(TinyIsPacked(lhs) || TinyIsPacked(rhs)) {
+                for(size_t i = 0; i < lhs->size; i++) {
+                    if(!TinyIsEqual(TinyGetArrayElement(lhs, i), TinyGetArrayElement(rhs, i))) return false;
+                }
+                return true;
+            }
             for(size_t i = 0; i < lhs->size; i++) {
                 if(TinyIsEqual(&lhs->array[i], &rhs->array[i]) == false) {
                     return false;
@@ -847,47 +2961,33 @@ bool TinyIsEqual(const TinyValue* lhs, const TinyValue* rhs) {
             return true;
         case TINY_OBJECT:
             if(lhs->osize != rhs->osize) return false;
-            for(size_t i = 0; i < lhs->osize; i++) {
-                TinyValue* t = TinyFindObjectValue(rhs, lhs->object[i].key, lhs->object[i].kLen);
-                if(t == NULL || TinyIsEqual(t, &lhs->object[i].value) == false) return false;         
-            }
-            return true;
+            if(lhs->osize == 0 || lhs->object == rhs->object) return true;
+            if(TinyHashDiffers(lhs->object, rhs->object)) return false;
+            return TinyIsEqualObject(lhs, rhs);
         default:
             return true;
     }
 }
 
+//O(1): 字符串和容器的存储与 src 共享, 之后哪一边被修改才复制哪一边
 void TinyCopy(TinyValue* dst, const TinyValue* src) {
     assert(src != NULL && dst != NULL && src != dst);
-    TinyInitValue(dst);
+    memcpy(dst, src, sizeof(TinyValue));
     switch (src->type)
     {
+    case TINY_NUMBER:
+        if(TinyNumberIsHeap(dst)) TinyStringRetain(dst->str);
+        break;
     case TINY_STRING:
-        TinySetString(dst, src->str, src->len);
+        TinyStringRetain(dst->str);
         break;
     case TINY_ARRAY:
-        TinySetArray(dst, src->size);
-        dst->size = src->size;
-        for(size_t i = 0; i < src->size; i++) {
-            TinyCopy(&dst->array[i], &src->array[i]);
-        }
-        dst->type = src->type;
+        if(dst->array) TinyRefRetain(&TinyBlockOf(dst->array)->refs);
         break;
     case TINY_OBJECT:
-        TinySetObject(dst, src->osize);
-        dst->osize = src->osize;
-        for(size_t i = 0; i < src->osize; i++) {
-            TinyMember &m = dst->object[i];
-            m.kLen = src->object[i].kLen;
-            m.key = (char*)malloc(m.kLen + 1);
-            memcpy(dst->object[i].key, src->object[i].key, m.kLen);
-            TinyCopy(&m.value, &src->object[i].value);      
-        }
-        dst->type = src->type;
+        if(dst->object) TinyRefRetain(&TinyBlockOf(dst->object)->refs);
         break;
     default:
-        memcpy(dst, src, sizeof(TinyValue));
-        dst->type = src->type;
         break;
     }
 }
@@ -907,4 +3007,119 @@ void TinySwap(TinyValue* lhs, TinyValue* rhs) {
         memcpy(lhs, rhs, sizeof(TinyValue));
         memcpy(rhs, &tmp, sizeof(TinyValue));
     }
-}
\ No newline at end of file
+}
+static const char* const TINY_STAT_NAMES[TINY_STAT_COUNT] = {
+    "parses", "parse_errors", "parse_bytes", "parse_ns",
+    "stringifies", "stringify_bytes", "stringify_ns",
+    "nulls", "falses", "trues", "numbers", "strings", "arrays", "objects",
+    "allocs", "alloc_bytes", "reallocs", "realloc_bytes",
+    "stack_grows", "stack_peak", "max_depth",
+};
+
+const char* TinyGetStatName(TinyStat stat) {
+    assert(stat >= 0 && stat < TINY_STAT_COUNT);
+    return TINY_STAT_NAMES[stat];
+}
+
+#if TINY_ENABLE_STATS
+//峰值类计数取最大值, 其余求和
+static bool TinyStatIsPeak(int stat) {
+    return stat == TINY_STAT_STACK_PEAK || stat == TINY_STAT_MAX_DEPTH;
+}
+
+static std::mutex tinyStatsLock;
+static TinyStatsLocal* tinyStatsThreads;                /* 仍在运行的线程 */
+static uint64_t tinyStatsRetired[TINY_STAT_COUNT];     /* 已退出线程的计数 */
+static uint64_t tinyStatsBase[TINY_STAT_COUNT];        /* TinyResetGlobalStats 时的总和 */
+
+thread_local TinyStatsLocal* tinyStatsLocal = NULL;
+
+//线程退出时把计数并入 tinyStatsRetired
+struct TinyStatsOwner {
+    TinyStatsLocal* stats;
+    ~TinyStatsOwner() {
+        std::lock_guard<std::mutex> lock(tinyStatsLock);
+        for(int i = 0; i < TINY_STAT_COUNT; i++) {
+            uint64_t n = stats->counts[i].load(std::memory_order_relaxed);
+            if(!TinyStatIsPeak(i)) tinyStatsRetired[i] += n;
+            else if(n > tinyStatsRetired[i]) tinyStatsRetired[i] = n;
+        }
+        TinyStatsLocal** p = &tinyStatsThreads;
+        while(*p != stats) p = &(*p)->next;
+        *p = stats->next;
+        delete stats;
+        tinyStatsLocal = NULL;
+    }
+};
+
+TinyStatsLocal* TinyStatsRegister() {
+    static thread_local TinyStatsOwner owner;
+    TinyStatsLocal* s = new TinyStatsLocal;
+    for(int i = 0; i < TINY_STAT_COUNT; i++) {
+        s->counts[i].store(0, std::memory_order_relaxed);
+        s->base[i] = s->peaks[i] = 0;
+    }
+    s->depth = 0;
+    std::lock_guard<std::mutex> lock(tinyStatsLock);
+    s->next = tinyStatsThreads;
+    tinyStatsThreads = s;
+    owner.stats = s;
+    tinyStatsLocal = s;
+    return s;
+}
+#endif
+
+void TinyGetStats(TinyStats* stats) {
+    assert(stats != NULL);
+    memset(stats, 0, sizeof(*stats));
+#if TINY_ENABLE_STATS
+    TinyStatsLocal* s = TinyStatsGet();
+    for(int i = 0; i < TINY_STAT_COUNT; i++) {
+        stats->counts[i] = TinyStatIsPeak(i) ? s->peaks[i] : s->counts[i].load(std::memory_order_relaxed) - s->base[i];
+    }
+#endif
+}
+
+void TinyResetStats() {
+#if TINY_ENABLE_STATS
+    TinyStatsLocal* s = TinyStatsGet();
+    for(int i = 0; i < TINY_STAT_COUNT; i++) {
+        s->base[i] = s->counts[i].load(std::memory_order_relaxed);
+        s->peaks[i] = 0;
+    }
+#endif
+}
+
+void TinyGetGlobalStats(TinyStats* stats) {
+    assert(stats != NULL);
+    memset(stats, 0, sizeof(*stats));
+#if TINY_ENABLE_STATS
+    std::lock_guard<std::mutex> lock(tinyStatsLock);
+    for(int i = 0; i < TINY_STAT_COUNT; i++) {
+        uint64_t n = tinyStatsRetired[i];
+        for(TinyStatsLocal* s = tinyStatsThreads; s != NULL; s = s->next) {
+            uint64_t c = s->counts[i].load(std::memory_order_relaxed);
+            if(!TinyStatIsPeak(i)) n += c;
+            else if(c > n) n = c;
+        }
+        stats->counts[i] = TinyStatIsPeak(i) ? n : n - tinyStatsBase[i];
+    }
+#endif
+}
+
+void TinyResetGlobalStats() {
+#if TINY_ENABLE_STATS
+    std::lock_guard<std::mutex> lock(tinyStatsLock);
+    for(int i = 0; i < TINY_STAT_COUNT; i++) {
+        if(!TinyStatIsPeak(i)) {
+            uint64_t n = tinyStatsRetired[i];
+            for(TinyStatsLocal* s = tinyStatsThreads; s != NULL; s = s->next) n += s->counts[i].load(std::memory_order_relaxed);
+            tinyStatsBase[i] = n;
+        } else {
+            //其它线程随后写入的峰值只会是新观察到的值
+            tinyStatsRetired[i] = 0;
+            for(TinyStatsLocal* s = tinyStatsThreads; s != NULL; s = s->next) s->counts[i].store(0, std::memory_order_relaxed);
+        }
+    }
+#endif
+}
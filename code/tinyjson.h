@@ -8,9 +8,25 @@
 #define TINYJSON_H
 
 #include <stddef.h> /* size_t */
+#include <stdint.h> /* uint64_t */
+#include <stdio.h>  /* FILE */
+
+#if defined(__unix__) || defined(__APPLE__)
+#define TINY_HAS_POSIX 1
+#else
+#define TINY_HAS_POSIX 0
+#endif
+
+// 编译时 -DTINY_ENABLE_STATS=1 打开运行时统计, 所有源文件须一致
+#ifndef TINY_ENABLE_STATS
+#define TINY_ENABLE_STATS 0
+#endif
 
 const size_t TINY_STACK_SIZE = 256;
+const size_t TINY_WRITE_BUFFER_SIZE = 65536;   /* TinyStringifyFile/Fd 每次写出的大小 */
+const size_t TINY_IOVEC_MIN_REFERENCE = 256;   /* 不小于该长度且无需转义的字符串直接引用 */
 const size_t TINY_KEY_NOT_EXIST = -1;
+const size_t TINY_PARSE_MAX_DEPTH = 512;       /* TINY_PARSE_FLAG_DEPTH_LIMIT 允许的最大嵌套层数 */
 
 typedef struct TinyValue TinyValue; 
 typedef struct TinyMember TinyMember; 
@@ -42,8 +58,10 @@ struct TinyValue {
             size_t capacity;
         };
         double num;
+        char numText[3 * sizeof(size_t)];   /* 较短的数字原文 */
     };
     TinyType type;
+    unsigned numLen;    /* TINY_NUMBER: 0 表示 num 有效, 否则为保留的原文长度; 原文放不下 numText 时存于 str */
 };
 
 struct TinyMember {
@@ -72,6 +90,7 @@ enum TinyParseReact{
 
     TINY_PARSE_INVALID_UNICODE_HEX,       //不符合4位十六进制数字
     TINY_PARSE_INVALID_UNICODE_SURROGATE, //范围不正确 U+0000 ~ U+10FFFF
+    TINY_PARSE_INVALID_UTF8,              //TINY_PARSE_FLAG_VALIDATE_UTF8: 字符串不是合法的 UTF-8
 
     TINY_PARSE_MISS_COMMA_OR_SQUARE_BRACKET,
 
@@ -79,18 +98,207 @@ enum TinyParseReact{
     TINY_PARSE_MISS_COLON,
     TINY_PARSE_MISS_COMMA_OR_CURLY_BRACKET,
 
+    TINY_PARSE_DEPTH_EXCEEDED,            //嵌套超过 TINY_PARSE_MAX_DEPTH
+
     TINY_STRINGIFY_OK,
+    TINY_STRINGIFY_IO_ERROR,
+
+    TINY_SNAPSHOT_OK,
+    TINY_SNAPSHOT_IO_ERROR,
+    TINY_SNAPSHOT_INVALID_FORMAT,         //魔数、版本、字节序或长度不符
+    TINY_SNAPSHOT_CHECKSUM_MISMATCH,
+
+    TINY_PATCH_OK,
+    TINY_PATCH_INVALID_OPERATION,         //操作不是对象、op 未知或缺少成员
+    TINY_PATCH_INVALID_POINTER,           //不是合法的 JSON Pointer
+    TINY_PATCH_PATH_NOT_FOUND,
+    TINY_PATCH_TEST_FAILED,
+
+    TINY_BIND_TYPE_MISMATCH,              //JSON 值的类型与绑定的成员不符, 或整数超出范围
+    TINY_BIND_MISSING_FIELD,              //缺少非 TinyOptional 的成员
+
+    TINY_SCHEMA_OK,
+    TINY_SCHEMA_INVALID,                  //schema 不合法或用到了不支持的关键字
+    TINY_SCHEMA_TYPE_MISMATCH,
+    TINY_SCHEMA_ENUM_MISMATCH,            //不在 enum 中或不等于 const
+    TINY_SCHEMA_OUT_OF_RANGE,             //数值、长度、元素个数或成员个数超出范围
+    TINY_SCHEMA_MISSING_PROPERTY,         //缺少 required 中的成员
+    TINY_SCHEMA_ADDITIONAL_PROPERTY,      //additionalProperties 为 false 时出现未列出的成员
+
+    TINY_PATH_OK,
+    TINY_PATH_INVALID,                    //JSONPath 语法错误或用到了不支持的写法
+};
+
+// TinyParseWithFlags 的选项, 可以按位或
+enum TinyParseFlag {
+    TINY_PARSE_FLAG_DEFAULT = 0,          //与 TinyParse 相同
+    TINY_PARSE_FLAG_DEPTH_LIMIT = 0x1,    //限制嵌套层数, 防止恶意输入耗尽栈
+    TINY_PARSE_FLAG_NAN_INF = 0x2,        //接受 NaN、Infinity、-Infinity
+    TINY_PARSE_FLAG_VALIDATE_UTF8 = 0x4,  //字符串和键必须是合法的 UTF-8, 单独的低代理项 \uDC00 等也被拒绝
+    TINY_PARSE_FLAG_LAZY_NUMBER = 0x8,    //数字只检查语法并保留原文, TinyGetNumber 时才转换, 未修改的数字原样输出
+                                          //(如 1.0、超过 2^53 的整数); 超出 double 范围时同样返回 TINY_PARSE_NUMBER_TOO_BIG
+    TINY_PARSE_FLAG_PACK_NUMBERS = 0x10,  //全部是数字的数组存为紧凑的 double[], 见 TinyGetArrayDoubles
+};
+
+enum TinyStat {
+    TINY_STAT_PARSES,
+    TINY_STAT_PARSE_ERRORS,
+    TINY_STAT_PARSE_BYTES,
+    TINY_STAT_PARSE_NS,
+    TINY_STAT_STRINGIFIES,
+    TINY_STAT_STRINGIFY_BYTES,
+    TINY_STAT_STRINGIFY_NS,
+
+    TINY_STAT_NULLS,                      //解析得到的各类型值的个数, 与 TinyType 顺序相同
+    TINY_STAT_FALSES,
+    TINY_STAT_TRUES,
+    TINY_STAT_NUMBERS,
+    TINY_STAT_STRINGS,
+    TINY_STAT_ARRAYS,
+    TINY_STAT_OBJECTS,
+
+    TINY_STAT_ALLOCS,                     //字符串、数组/对象存储以及 TinyContext 缓冲区
+    TINY_STAT_ALLOC_BYTES,
+    TINY_STAT_REALLOCS,
+    TINY_STAT_REALLOC_BYTES,
+    TINY_STAT_STACK_GROWS,                //TinyContext 缓冲区扩容次数
+    TINY_STAT_STACK_PEAK,                 //峰值: TinyContext 缓冲区的最大字节数
+    TINY_STAT_MAX_DEPTH,                  //峰值: 解析时的最大嵌套深度
+
+    TINY_STAT_COUNT,
+};
+
+struct TinyStats {
+    uint64_t counts[TINY_STAT_COUNT];
+};
+
+// 可续写的输出状态, 每次写满调用者的缓冲区
+struct TinyStringifyFrame {
+    const TinyValue* value;
+    size_t index;
+    bool key;           /* 对象成员的键已经写出 */
+};
+
+struct TinyStringifier {
+    TinyContext context;        /* 尚未交给调用者的输出 */
+    size_t head;
+    TinyStringifyFrame* frames;
+    size_t depth, fcapacity;
+    const char* str;            /* 正在分段转义的长字符串 */
+    size_t slen, soff;
+};
+
+// 不经过 TinyValue 直接生成 JSON
+struct TinyWriter {
+    TinyContext context;        /* 输出缓冲区, TinyWriterReset 后复用 */
+    unsigned char* levels;      /* 每层嵌套的状态 */
+    size_t depth, lcapacity;
+    bool root;                  /* 已经写出根值 */
+};
+
+// 分步释放: 正在逐个释放元素的容器
+struct TinyReclaimFrame {
+    void* storage;
+    size_t index, size;
+    size_t bytes;               /* 存储本身的字节数, 元素释放完后计入 */
+    bool object;
+};
+
+// 把大文档的释放拆成多步, 每步的工作量有上限
+struct TinyReclaimer {
+    TinyValue* values;          /* 交来的、尚未开始释放的值 */
+    size_t count, vcapacity;
+    TinyReclaimFrame* frames;   /* 不递归, 深度只受内存限制 */
+    size_t depth, fcapacity;
+    uint64_t nodes;             /* 已释放的字符串、键和容器存储的个数 */
+    uint64_t bytes;             /* 以及它们的字节数(不含 malloc 自身的开销) */
+};
+
+// 与 struct iovec 布局相同, 可直接交给 writev
+struct TinyIovec {
+    const void* base;
+    size_t len;
+};
+
+struct TinyIovecList {
+    TinyIovec* iov;
+    size_t count, capacity;
+    size_t direct;              /* 直接引用字符串内容的段数 */
+    char* buffer;               /* 其余各段所在的缓冲区 */
+    char** buffers;             /* 并行输出时各段各自的缓冲区 */
+    size_t nbuffers;
 };
 
 void TinyInitValue(TinyValue *value);
 void TinyFree(TinyValue *value);
 
+// TinyFree 一次走完整棵树, 大文档会阻塞较久; 改为交给 TinyReclaimer 分步释放
+void TinyReclaimerInit(TinyReclaimer* r);
+// O(1): 把 value 移入 r, value 变为 null
+void TinyReclaimerPush(TinyReclaimer* r, TinyValue* value);
+// 最多处理 budget 个元素或成员, 全部释放完时返回 true
+// 与其它值共享的存储只减少引用计数, 不再深入
+bool TinyReclaimerStep(TinyReclaimer* r, size_t budget);
+bool TinyReclaimerIsEmpty(const TinyReclaimer* r);
+// 释放剩下的全部内容
+void TinyReclaimerFree(TinyReclaimer* r);
+
 int TinyParse(TinyValue *value, const char* json);
+// flags 为 TinyParseFlag 的组合; 每种组合对应单独编译的解析器, 没有打开的选项不产生任何开销
+int TinyParseWithFlags(TinyValue *value, const char* json, unsigned flags);
+// NaN 和无穷大输出为 NaN、Infinity、-Infinity, 可以用 TINY_PARSE_FLAG_NAN_INF 读回; 各种输出方式相同
 char* TinyStringify(const TinyValue* value, size_t* len);
+// 输出与 TinyStringify 相同, 同时在较大的容器中记下各自的输出, 之后只重新生成修改过的容器
+// 容器经 TinySet*/TinyPushBack* 等修改时丢弃自己记下的输出, 祖先记下的输出在使用前检查子孙容器是否修改过,
+// 所以可以保存子容器的指针继续修改; 经保存的元素指针直接改写数字、字符串等(不经过其容器)不会被发现.
+// 记下的输出随存储共享, 可以在多个线程中同时输出共享的值
+char* TinyStringifyCached(const TinyValue* value, size_t* len);
+// 并行输出, 结果与 TinyStringify 逐字节相同; threads 为 0 时取 CPU 个数, 为 1 时即 TinyStringify
+// 容器按元素切成约 threads * 4 段(元素不够时继续切较深的容器), 各线程(包括调用者)领取后分别输出,
+// 最后按顺序拼接; 输出期间 value 不能修改. 小文档启动线程不划算, 直接用 TinyStringify
+char* TinyStringifyParallel(const TinyValue* value, size_t* len, unsigned threads);
+
+// 流式输出: 反复调用 TinyStringifierWrite 直到返回 0, 输出期间 value 不能修改
+void TinyStringifierInit(TinyStringifier* s, const TinyValue* value);
+size_t TinyStringifierWrite(TinyStringifier* s, char* buff, size_t size);
+bool TinyStringifierDone(const TinyStringifier* s);
+void TinyStringifierFree(TinyStringifier* s);
+
+// 顺序或嵌套不合法时返回 false 且不写入任何内容
+void TinyWriterInit(TinyWriter* w);
+void TinyWriterReset(TinyWriter* w);
+void TinyWriterFree(TinyWriter* w);
+bool TinyWriterStartObject(TinyWriter* w);
+bool TinyWriterEndObject(TinyWriter* w);
+bool TinyWriterStartArray(TinyWriter* w);
+bool TinyWriterEndArray(TinyWriter* w);
+bool TinyWriterKey(TinyWriter* w, const char* key, size_t klen);
+bool TinyWriterString(TinyWriter* w, const char* str, size_t len);
+bool TinyWriterNumber(TinyWriter* w, double num);
+bool TinyWriterInt64(TinyWriter* w, int64_t num);
+bool TinyWriterBool(TinyWriter* w, bool flag);
+bool TinyWriterNull(TinyWriter* w);
+bool TinyWriterValue(TinyWriter* w, const TinyValue* value);
+bool TinyWriterIsComplete(const TinyWriter* w);
+// 根值写完后返回以 '\0' 结尾的输出, 内存属于 writer, 否则返回 NULL
+const char* TinyWriterGetString(TinyWriter* w, size_t* len);
+
+int TinyStringifyFile(const TinyValue* value, FILE* fp);
+// 长字符串直接引用 value 中的内容, list 使用期间 value 不能修改或释放
+void TinyStringifyIovec(const TinyValue* value, TinyIovecList* list);
+// 同 TinyStringifyParallel, 但不拼接: 各段的输出直接作为 list 的各段
+void TinyStringifyParallelIovec(const TinyValue* value, TinyIovecList* list, unsigned threads);
+void TinyFreeIovecList(TinyIovecList* list);
+#if TINY_HAS_POSIX
+int TinyStringifyFd(const TinyValue* value, int fd);
+int TinyStringifyWritev(const TinyValue* value, int fd);
+#endif
 
 TinyType TinyGetType(const TinyValue* value);
 bool TinyGetBoolean(const TinyValue* value);
 double TinyGetNumber(const TinyValue* value);
+// TINY_PARSE_FLAG_LAZY_NUMBER 保留的原文, 没有时返回 NULL; 不以 '\0' 结尾
+const char* TinyGetNumberText(const TinyValue* value, size_t* len);
 
 const char* TinyGetString(const TinyValue* value);
 size_t TinyGetStringLength(const TinyValue* value);
@@ -101,8 +309,19 @@ void TinySetNumber(TinyValue* value, double num);
 void TinySetString(TinyValue* value, const char* str, size_t len);
 
 // array
+// 紧凑数组: 由 TINY_PARSE_FLAG_PACK_NUMBERS 或 TinyPackArray 建立, 以 double[] 存储, 修改元素时展开;
+// TinyParse 得到的数组和普通数组(包括空数组)都不会自动变成紧凑数组
 size_t TinyGetArraySize(const TinyValue* value);
-TinyValue* TinyGetArrayElement(const TinyValue* value, size_t index);
+// 紧凑数组第一次按元素读取时建立一份 TinyValue 副本(每个元素 sizeof(TinyValue) 字节), 与普通数组一样
+// 返回的指针一直有效到数组被修改或释放; 只读数字时用 TinyGetArrayDoubles 不占额外内存
+const TinyValue* TinyGetArrayElement(const TinyValue* value, size_t index);
+// 紧凑数组返回其 double[], 否则返回 NULL
+const double* TinyGetArrayDoubles(const TinyValue* value, size_t* size);
+// 全部是数字(或为空)时转为紧凑存储, 之后 TinyAppendArrayNumbers/TinyAppendArrayInt64s 追加的数字保持紧凑
+bool TinyPackArray(TinyValue* value);
+// 需要修改元素时使用, 会丢弃容器记下的哈希, 容器与其它值共享时先复制一份
+// TinyGetArrayElement/TinyGetObjectValue/TinyFindObjectValue 返回 const, 元素可能与副本共享
+TinyValue* TinySetArrayElement(TinyValue* value, size_t index);
 
 void TinySetArray(TinyValue* value, size_t capacity);
 size_t TinyGetArrayCapacity(TinyValue* value);
@@ -114,6 +333,14 @@ TinyValue* TinyPushBackArrayElement(TinyValue *value);
 void TinyPopBackArrayElement(TinyValue* value);
 TinyValue* TinyInsertArrayElement(TinyValue* value, size_t index);
 void TinyEraseArrayElement(TinyValue* value, size_t index, size_t count);
+// 批量操作: 一次预留空间, 用 memmove 整段移动元素
+// 在 index(可以等于 size)处插入 count 个 null, 返回其中第一个
+TinyValue* TinyInsertArrayElements(TinyValue* value, size_t index, size_t count);
+void TinyAppendArrayNumbers(TinyValue* value, const double* nums, size_t count);
+// 超过 2^53 的整数会舍入
+void TinyAppendArrayInt64s(TinyValue* value, const int64_t* nums, size_t count);
+// lens 为 NULL 时按 '\0' 结尾计算长度
+void TinyAppendArrayStrings(TinyValue* value, const char* const* strs, const size_t* lens, size_t count);
 void TinyClearArray(TinyValue* value);
 
 // object
@@ -121,20 +348,43 @@ size_t TinyGetObjectSize(const TinyValue* value);
 size_t TinyGetObjectCapacity(const TinyValue* value);
 const char* TinyGetObjectKey(const TinyValue* value, size_t index);
 size_t TinyGetObjectKeyLength(const TinyValue* value, size_t index);
-TinyValue* TinyGetObjectValue(const TinyValue* value, size_t index);
+const TinyValue* TinyGetObjectValue(const TinyValue* value, size_t index);
 
 void TinySetObject(TinyValue* value, size_t capacity);
+// 由并列的键/值数组构造对象, 值通过 TinyCopy 复制; klens 为 NULL 时按 '\0' 结尾计算, values 为 NULL 时均为 null
+void TinySetObjectFromArrays(TinyValue* value, const char* const* keys, const size_t* klens, const TinyValue* values, size_t count);
 TinyValue* TinySetObjectValue(TinyValue* value, const char* key, size_t klen);
+// 直接追加成员, 不检查键是否已存在
+TinyValue* TinyPushBackObjectValue(TinyValue* value, const char* key, size_t klen);
+
+// 按下标修改成员, 同 TinySetArrayElement
+TinyValue* TinySetObjectValueAt(TinyValue* value, size_t index);
 
 size_t TinyFindObjectIndex(const TinyValue* value, const char* key, size_t klen);
-TinyValue* TinyFindObjectValue(const TinyValue* value, const char* key, size_t klen);
+const TinyValue* TinyFindObjectValue(const TinyValue* value, const char* key, size_t klen);
 
 void TinyReserveObject(TinyValue* value, size_t capacity);
 void TinyShrinkObject(TinyValue* value);
 void TinyClearObject(TinyValue* value);
 void TinyRemoveObjectValue(TinyValue* value, size_t index);
 
+// 结构哈希: 相等的值哈希相同, 对象与成员顺序无关
+uint64_t TinyHash(const TinyValue* value);
+// 同 TinyHash, 并把结果记在每个容器中; 容器被修改(TinySet*/TinyPushBack*等)后失效
+uint64_t TinyHashMemo(TinyValue* value);
+
 bool TinyIsEqual(const TinyValue* lhs, const TinyValue* rhs);
+// 运行时统计, 未打开 TINY_ENABLE_STATS 时各项均为 0
+// 本线程自上次 TinyResetStats 以来的计数
+void TinyGetStats(TinyStats* stats);
+void TinyResetStats();
+// 所有线程(包括已退出的)自上次 TinyResetGlobalStats 以来的计数, 峰值取各线程中最大的
+void TinyGetGlobalStats(TinyStats* stats);
+void TinyResetGlobalStats();
+// 如 "parse_bytes", 便于导出
+const char* TinyGetStatName(TinyStat stat);
+
+// O(1): 与 src 共享字符串和容器, 之后通过 TinySet*/TinyPushBack* 等修改时才复制被修改的路径
 void TinyCopy(TinyValue* dst, const  TinyValue* src);
 void TinyMove(TinyValue* dst, TinyValue* src);
 void TinySwap(TinyValue* lhs, TinyValue* rhs);
@@ -0,0 +1,458 @@
+/*
+ * @Author       : mark
+ * @Date         : 2020-05-26
+ * @copyleft Apache 2.0
+ */
+
+#include "tinypatch.h"
+#include "tinycontext.h"
+#include <assert.h>  /* assert() */
+#include <stdlib.h>  /* malloc(), free() */
+#include <stdio.h>   /* snprintf() */
+#include <string.h>  /* memcmp() */
+
+void TinyApplyMergePatch(TinyValue* target, TinyValue* patch) {
+    assert(target != NULL && patch != NULL && target != patch);
+    if(TinyGetType(patch) != TINY_OBJECT) {
+        TinyMove(target, patch);
+        return;
+    }
+    if(TinyGetType(target) != TINY_OBJECT) {
+        TinySetObject(target, TinyGetObjectSize(patch));
+    }
+    for(size_t i = 0; i < TinyGetObjectSize(patch); i++) {
+        const char* key = TinyGetObjectKey(patch, i);
+        size_t klen = TinyGetObjectKeyLength(patch, i);
+        size_t index = TinyFindObjectIndex(target, key, klen);
+        TinyValue* v = TinySetObjectValueAt(patch, i);
+        if(TinyGetType(v) == TINY_NULL) {
+            if(index != TINY_KEY_NOT_EXIST) TinyRemoveObjectValue(target, index);
+            continue;
+        }
+        TinyValue* t = index != TINY_KEY_NOT_EXIST ? TinySetObjectValueAt(target, index)
+                                                   : TinyPushBackObjectValue(target, key, klen);
+        TinyApplyMergePatch(t, v);
+    }
+}
+
+/* ------------------------------------------------------------------ */
+/* JSON Pointer (RFC 6901)                                            */
+/* ------------------------------------------------------------------ */
+
+//把 [p, end) 中的一个 token 反转义到 buf, 返回 token 之后的位置
+static const char* TinyPointerToken(const char* p, const char* end, char* buf, size_t* len, int* ret) {
+    size_t n = 0;
+    *ret = TINY_PATCH_OK;
+    for(; p < end && *p != '/'; p++) {
+        if(*p != '~') {
+            buf[n++] = *p;
+        } else if(p + 1 < end && (p[1] == '0' || p[1] == '1')) {
+            buf[n++] = p[1] == '0' ? '~' : '/';
+            p++;
+        } else {
+            *ret = TINY_PATCH_INVALID_POINTER;
+            break;
+        }
+    }
+    *len = n;
+    return p;
+}
+
+//数组下标: "0" 或不以 0 开头的十进制数
+static bool TinyPointerIndex(const char* token, size_t len, size_t* index) {
+    if(len == 0 || (token[0] == '0' && len > 1)) return false;
+    size_t n = 0;
+    for(size_t i = 0; i < len; i++) {
+        if(token[i] < '0' || token[i] > '9') return false;
+        if(n > ((size_t)-1 - 9) / 10) return false;
+        n = n * 10 + (token[i] - '0');
+    }
+    *index = n;
+    return true;
+}
+
+//取路径上的子值: 可写时经 TinySet* 取得, 被共享的容器会先复制
+static TinyValue* TinyPointerMember(TinyValue* v, size_t index) { return TinySetObjectValueAt(v, index); }
+static const TinyValue* TinyPointerMember(const TinyValue* v, size_t index) { return TinyGetObjectValue(v, index); }
+static TinyValue* TinyPointerElement(TinyValue* v, size_t index) { return TinySetArrayElement(v, index); }
+static const TinyValue* TinyPointerElement(const TinyValue* v, size_t index) { return TinyGetArrayElement(v, index); }
+
+//沿 [path, end) 找到值; Value 为 TinyValue 时用于修改, 为 const TinyValue 时只读
+template <typename Value>
+static int TinyResolve(Value* root, const char* path, const char* end, char* buf, Value** out) {
+    Value* v = root;
+    int ret;
+    if(path < end && *path != '/') return TINY_PATCH_INVALID_POINTER;
+    while(path < end) {
+        size_t len, index;
+        path = TinyPointerToken(path + 1, end, buf, &len, &ret);
+        if(ret != TINY_PATCH_OK) return ret;
+        if(TinyGetType(v) == TINY_OBJECT) {
+            index = TinyFindObjectIndex(v, buf, len);
+            if(index == TINY_KEY_NOT_EXIST) return TINY_PATCH_PATH_NOT_FOUND;
+            v = TinyPointerMember(v, index);
+        } else if(TinyGetType(v) == TINY_ARRAY) {
+            if(!TinyPointerIndex(buf, len, &index) || index >= TinyGetArraySize(v)) return TINY_PATCH_PATH_NOT_FOUND;
+            v = TinyPointerElement(v, index);
+        } else {
+            return TINY_PATCH_PATH_NOT_FOUND;
+        }
+    }
+    *out = v;
+    return TINY_PATCH_OK;
+}
+
+//找到最后一个 token 所在的容器, 最后一个 token 反转义到 buf
+static int TinyResolveParent(TinyValue* root, const char* path, size_t plen, char* buf, TinyValue** parent, size_t* len) {
+    const char* end = path + plen;
+    const char* last = end;
+    int ret;
+    while(last > path && *(last - 1) != '/') last--;
+    if(last == path) return TINY_PATCH_INVALID_POINTER;
+    ret = TinyResolve(root, path, last - 1, buf, parent);
+    if(ret != TINY_PATCH_OK) return ret;
+    TinyPointerToken(last, end, buf, len, &ret);
+    return ret;
+}
+
+/* ------------------------------------------------------------------ */
+/* JSON Patch (RFC 6902)                                              */
+/* ------------------------------------------------------------------ */
+
+static int TinyPatchAdd(TinyValue* root, const char* path, size_t plen, TinyValue* value, char* buf) {
+    TinyValue* parent;
+    size_t len, index;
+    if(plen == 0) {
+        TinyMove(root, value);
+        return TINY_PATCH_OK;
+    }
+    int ret = TinyResolveParent(root, path, plen, buf, &parent, &len);
+    if(ret != TINY_PATCH_OK) return ret;
+    if(TinyGetType(parent) == TINY_OBJECT) {
+        index = TinyFindObjectIndex(parent, buf, len);
+        TinyMove(index != TINY_KEY_NOT_EXIST ? TinySetObjectValueAt(parent, index)
+                                             : TinyPushBackObjectValue(parent, buf, len), value);
+        return TINY_PATCH_OK;
+    }
+    if(TinyGetType(parent) == TINY_ARRAY) {
+        if(len == 1 && buf[0] == '-') {
+            index = TinyGetArraySize(parent);
+        } else if(!TinyPointerIndex(buf, len, &index) || index > TinyGetArraySize(parent)) {
+            return TINY_PATCH_PATH_NOT_FOUND;
+        }
+        TinyMove(TinyInsertArrayElements(parent, index, 1), value);
+        return TINY_PATCH_OK;
+    }
+    return TINY_PATCH_PATH_NOT_FOUND;
+}
+
+//removed 不为 NULL 时被删除的值移入其中
+static int TinyPatchRemove(TinyValue* root, const char* path, size_t plen, TinyValue* removed, char* buf) {
+    TinyValue* parent;
+    size_t len, index;
+    if(plen == 0) return TINY_PATCH_INVALID_OPERATION;
+    int ret = TinyResolveParent(root, path, plen, buf, &parent, &len);
+    if(ret != TINY_PATCH_OK) return ret;
+    if(TinyGetType(parent) == TINY_OBJECT) {
+        index = TinyFindObjectIndex(parent, buf, len);
+        if(index == TINY_KEY_NOT_EXIST) return TINY_PATCH_PATH_NOT_FOUND;
+        if(removed != NULL) TinyMove(removed, TinySetObjectValueAt(parent, index));
+        TinyRemoveObjectValue(parent, index);
+        return TINY_PATCH_OK;
+    }
+    if(TinyGetType(parent) == TINY_ARRAY) {
+        if(!TinyPointerIndex(buf, len, &index) || index >= TinyGetArraySize(parent)) return TINY_PATCH_PATH_NOT_FOUND;
+        if(removed != NULL) TinyMove(removed, TinySetArrayElement(parent, index));
+        TinyEraseArrayElement(parent, index, 1);
+        return TINY_PATCH_OK;
+    }
+    return TINY_PATCH_PATH_NOT_FOUND;
+}
+
+static bool TinyPatchString(const TinyValue* op, const char* name, size_t nlen, const char** str, size_t* len) {
+    const TinyValue* v = TinyFindObjectValue(op, name, nlen);
+    if(v == NULL || TinyGetType(v) != TINY_STRING) return false;
+    *str = TinyGetString(v);
+    *len = TinyGetStringLength(v);
+    return true;
+}
+
+static bool TinyPatchOp(const char* op, size_t len, const char* name) {
+    return len == strlen(name) && memcmp(op, name, len) == 0;
+}
+
+static int TinyApplyOperation(TinyValue* target, TinyValue* op, char* buf) {
+    const char *name, *path, *from = NULL;
+    size_t nlen, plen, flen = 0;
+    TinyValue *value = NULL, *replaced;
+    const TinyValue* found;
+    int ret;
+
+    if(!TinyPatchString(op, "op", 2, &name, &nlen) || !TinyPatchString(op, "path", 4, &path, &plen)) {
+        return TINY_PATCH_INVALID_OPERATION;
+    }
+    if(TinyPatchOp(name, nlen, "add") || TinyPatchOp(name, nlen, "replace") || TinyPatchOp(name, nlen, "test")) {
+        size_t index = TinyFindObjectIndex(op, "value", 5);
+        if(index == TINY_KEY_NOT_EXIST) return TINY_PATCH_INVALID_OPERATION;
+        value = TinySetObjectValueAt(op, index);
+    } else if(TinyPatchOp(name, nlen, "move") || TinyPatchOp(name, nlen, "copy")) {
+        if(!TinyPatchString(op, "from", 4, &from, &flen)) return TINY_PATCH_INVALID_OPERATION;
+    } else if(!TinyPatchOp(name, nlen, "remove")) {
+        return TINY_PATCH_INVALID_OPERATION;
+    }
+
+    switch(name[0]) {
+        case 'a':
+            return TinyPatchAdd(target, path, plen, value, buf);
+        case 'r':
+            if(name[2] == 'm') return TinyPatchRemove(target, path, plen, NULL, buf);
+            ret = TinyResolve(target, path, path + plen, buf, &replaced);
+            if(ret == TINY_PATCH_OK) TinyMove(replaced, value);
+            return ret;
+        case 't':
+            ret = TinyResolve<const TinyValue>(target, path, path + plen, buf, &found);
+            if(ret == TINY_PATCH_OK && !TinyIsEqual(found, value)) ret = TINY_PATCH_TEST_FAILED;
+            return ret;
+        case 'm':
+        {
+            if(flen == plen && memcmp(from, path, plen) == 0) return TINY_PATCH_OK;
+            //不能移动到自己的子孙之下
+            if(flen < plen && memcmp(from, path, flen) == 0 && path[flen] == '/') return TINY_PATCH_INVALID_OPERATION;
+            TinyValue moved;
+            TinyInitValue(&moved);
+            ret = TinyPatchRemove(target, from, flen, &moved, buf);
+            if(ret == TINY_PATCH_OK) ret = TinyPatchAdd(target, path, plen, &moved, buf);
+            TinyFree(&moved);
+            return ret;
+        }
+        default:
+        {
+            TinyValue copied;
+            ret = TinyResolve<const TinyValue>(target, from, from + flen, buf, &found);
+            if(ret != TINY_PATCH_OK) return ret;
+            TinyCopy(&copied, found);
+            ret = TinyPatchAdd(target, path, plen, &copied, buf);
+            TinyFree(&copied);
+            return ret;
+        }
+    }
+}
+
+int TinyApplyPatch(TinyValue* target, TinyValue* ops) {
+    assert(target != NULL && ops != NULL && target != ops);
+    if(TinyGetType(ops) != TINY_ARRAY) return TINY_PATCH_INVALID_OPERATION;
+    int ret = TINY_PATCH_OK;
+    char* buf = NULL;
+    size_t bsize = 0;
+    for(size_t i = 0; i < TinyGetArraySize(ops) && ret == TINY_PATCH_OK; i++) {
+        TinyValue* op = TinySetArrayElement(ops, i);
+        if(TinyGetType(op) != TINY_OBJECT) {
+            ret = TINY_PATCH_INVALID_OPERATION;
+            break;
+        }
+        //token 反转义后不会变长, 按最长的 path/from 准备缓冲区
+        const char* str;
+        size_t len, need = 1;
+        if(TinyPatchString(op, "path", 4, &str, &len) && len + 1 > need) need = len + 1;
+        if(TinyPatchString(op, "from", 4, &str, &len) && len + 1 > need) need = len + 1;
+        if(need > bsize) {
+            bsize = need;
+            buf = (char*)realloc(buf, bsize);
+        }
+        ret = TinyApplyOperation(target, op, buf);
+    }
+    free(buf);
+    return ret;
+}
+
+/* ------------------------------------------------------------------ */
+/* Diff                                                               */
+/* ------------------------------------------------------------------ */
+
+struct TinyDiffState {
+    TinyValue* patch;
+    TinyContext path;           /* 当前位置的 JSON Pointer */
+};
+
+static void TinyDiffValue(TinyDiffState* d, const TinyValue* from, const TinyValue* to);
+
+//追加一个操作, value 为 NULL 时没有 value 成员
+static void TinyDiffEmit(TinyDiffState* d, const char* op, const TinyValue* value) {
+    TinyValue* o = TinyPushBackArrayElement(d->patch);
+    TinySetObject(o, 3);
+    TinySetString(TinyPushBackObjectValue(o, "op", 2), op, strlen(op));
+    TinySetString(TinyPushBackObjectValue(o, "path", 4), d->path.stack, d->path.top);
+    if(value != NULL) TinyCopy(TinyPushBackObjectValue(o, "value", 5), value);
+}
+
+//在路径后追加一个 token, 返回追加之前的长度
+static size_t TinyDiffPushKey(TinyDiffState* d, const char* key, size_t klen) {
+    size_t top = d->path.top;
+    TinyPutC(&d->path, '/');
+    for(size_t i = 0; i < klen; i++) {
+        if(key[i] == '~') TinyPutS(&d->path, "~0", 2);
+        else if(key[i] == '/') TinyPutS(&d->path, "~1", 2);
+        else TinyPutC(&d->path, key[i]);
+    }
+    return top;
+}
+
+static size_t TinyDiffPushIndex(TinyDiffState* d, size_t index) {
+    char buf[24];
+    size_t top = d->path.top;
+    TinyPutS(&d->path, buf, snprintf(buf, sizeof(buf), "/%zu", index));
+    return top;
+}
+
+static uint64_t TinyDiffKeyHash(const char* key, size_t klen) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for(size_t i = 0; i < klen; i++) {
+        h = (h ^ (unsigned char)key[i]) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static void TinyDiffObject(TinyDiffState* d, const TinyValue* from, const TinyValue* to) {
+    size_t fn = TinyGetObjectSize(from), tn = TinyGetObjectSize(to), i, top;
+    //to 中每个成员是否已与 from 中的成员配对
+    bool* matched = (bool*)calloc(tn + 1, sizeof(bool));
+    size_t* table = NULL;
+    size_t mask = 0;
+    for(i = 0; i < fn; i++) {
+        const char* key = TinyGetObjectKey(from, i);
+        size_t klen = TinyGetObjectKeyLength(from, i);
+        size_t j = TINY_KEY_NOT_EXIST;
+        //键的顺序相同是最常见的情况, 否则按键哈希建表查找
+        if(i < tn && !matched[i] && TinyGetObjectKeyLength(to, i) == klen && memcmp(TinyGetObjectKey(to, i), key, klen) == 0) {
+            j = i;
+        } else {
+            if(table == NULL) {
+                mask = 32;
+                while(mask < tn * 2) mask <<= 1;
+                mask--;
+                table = (size_t*)malloc((mask + 1) * sizeof(size_t));
+                memset(table, 0xff, (mask + 1) * sizeof(size_t));
+                for(size_t k = 0; k < tn; k++) {
+                    size_t slot = TinyDiffKeyHash(TinyGetObjectKey(to, k), TinyGetObjectKeyLength(to, k)) & mask;
+                    while(table[slot] != TINY_KEY_NOT_EXIST) slot = (slot + 1) & mask;
+                    table[slot] = k;
+                }
+            }
+            for(size_t slot = TinyDiffKeyHash(key, klen) & mask; table[slot] != TINY_KEY_NOT_EXIST; slot = (slot + 1) & mask) {
+                size_t k = table[slot];
+                if(!matched[k] && TinyGetObjectKeyLength(to, k) == klen && memcmp(TinyGetObjectKey(to, k), key, klen) == 0) {
+                    j = k;
+                    break;
+                }
+            }
+        }
+        top = TinyDiffPushKey(d, key, klen);
+        if(j == TINY_KEY_NOT_EXIST) {
+            TinyDiffEmit(d, "remove", NULL);
+        } else {
+            matched[j] = true;
+            TinyDiffValue(d, TinyGetObjectValue(from, i), TinyGetObjectValue(to, j));
+        }
+        d->path.top = top;
+    }
+    for(i = 0; i < tn; i++) {
+        if(matched[i]) continue;
+        top = TinyDiffPushKey(d, TinyGetObjectKey(to, i), TinyGetObjectKeyLength(to, i));
+        TinyDiffEmit(d, "add", TinyGetObjectValue(to, i));
+        d->path.top = top;
+    }
+    free(table);
+    free(matched);
+}
+
+//from[fb, fe) 与 to[tb, te) 按位置配对: 配对的元素递归比较, 多出的删除或追加; 返回处理后的下标
+static size_t TinyDiffRun(TinyDiffState* d, const TinyValue* from, size_t fb, size_t fe,
+                          const TinyValue* to, size_t tb, size_t te, size_t at) {
+    size_t top;
+    for(; fb < fe && tb < te; fb++, tb++, at++) {
+        top = TinyDiffPushIndex(d, at);
+        TinyDiffValue(d, TinyGetArrayElement(from, fb), TinyGetArrayElement(to, tb));
+        d->path.top = top;
+    }
+    for(; fb < fe; fb++) {
+        top = TinyDiffPushIndex(d, at);
+        TinyDiffEmit(d, "remove", NULL);
+        d->path.top = top;
+    }
+    for(; tb < te; tb++, at++) {
+        top = TinyDiffPushIndex(d, at);
+        TinyDiffEmit(d, "add", TinyGetArrayElement(to, tb));
+        d->path.top = top;
+    }
+    return at;
+}
+
+static void TinyDiffArray(TinyDiffState* d, const TinyValue* from, const TinyValue* to) {
+    size_t fn = TinyGetArraySize(from), tn = TinyGetArraySize(to), b = 0, i, j;
+    //去掉相同的首尾, 共享存储的元素比较是 O(1)
+    while(b < fn && b < tn && TinyIsEqual(TinyGetArrayElement(from, b), TinyGetArrayElement(to, b))) b++;
+    while(fn > b && tn > b && TinyIsEqual(TinyGetArrayElement(from, fn - 1), TinyGetArrayElement(to, tn - 1))) fn--, tn--;
+    size_t m = fn - b, n = tn - b;
+    //规模过大时不求 LCS
+    if(m == 0 || n == 0 || m > TINY_DIFF_LCS_LIMIT / n) {
+        TinyDiffRun(d, from, b, fn, to, b, tn, b);
+        return;
+    }
+    uint64_t* fh = (uint64_t*)malloc((m + n) * sizeof(uint64_t));
+    uint64_t* th = fh + m;
+    for(i = 0; i < m; i++) fh[i] = TinyHash(TinyGetArrayElement(from, b + i));
+    for(j = 0; j < n; j++) th[j] = TinyHash(TinyGetArrayElement(to, b + j));
+    //lcs[i][j]: from[b+i..) 与 to[b+j..) 的 LCS 长度
+    uint32_t* lcs = (uint32_t*)calloc((m + 1) * (n + 1), sizeof(uint32_t));
+    for(i = m; i-- > 0; ) {
+        for(j = n; j-- > 0; ) {
+            uint32_t* c = lcs + i * (n + 1) + j;
+            if(fh[i] == th[j]) *c = c[n + 2] + 1;
+            else *c = c[n + 1] > c[1] ? c[n + 1] : c[1];
+        }
+    }
+    //沿 LCS 前进, 两个公共元素之间的部分按位置配对
+    size_t at = b, fi = 0, ti = 0;
+    i = j = 0;
+    while(i < m && j < n) {
+        const uint32_t* c = lcs + i * (n + 1) + j;
+        if(fh[i] == th[j]) {
+            at = TinyDiffRun(d, from, b + fi, b + i, to, b + ti, b + j, at);
+            //哈希相同仍按值比较一次
+            at = TinyDiffRun(d, from, b + i, b + i + 1, to, b + j, b + j + 1, at);
+            fi = ++i;
+            ti = ++j;
+        } else if(c[n + 1] >= c[1]) {
+            i++;
+        } else {
+            j++;
+        }
+    }
+    TinyDiffRun(d, from, b + fi, fn, to, b + ti, tn, at);
+    free(lcs);
+    free(fh);
+}
+
+static void TinyDiffValue(TinyDiffState* d, const TinyValue* from, const TinyValue* to) {
+    TinyType type = TinyGetType(from);
+    if(type != TinyGetType(to)) {
+        TinyDiffEmit(d, "replace", to);
+    } else if(type == TINY_OBJECT) {
+        if(from->object != to->object) TinyDiffObject(d, from, to);
+    } else if(type == TINY_ARRAY) {
+        if(from->array != to->array) TinyDiffArray(d, from, to);
+    } else if(!TinyIsEqual(from, to)) {
+        TinyDiffEmit(d, "replace", to);
+    }
+}
+
+void TinyDiff(TinyValue* patch, const TinyValue* from, const TinyValue* to) {
+    assert(patch != NULL && from != NULL && to != NULL && patch != from && patch != to);
+    TinyDiffState d;
+    TinySetArray(patch, 0);
+    d.patch = patch;
+    d.path.stack = NULL;
+    d.path.size = d.path.top = 0;
+    TinyDiffValue(&d, from, to);
+    free(d.path.stack);
+}
@@ -0,0 +1,29 @@
+/*
+ * @Author       : mark
+ * @Date         : 2020-05-26
+ * @copyleft Apache 2.0
+ */
+
+#ifndef TINYPATCH_H
+#define TINYPATCH_H
+
+#include "tinyjson.h"
+
+const size_t TINY_DIFF_LCS_LIMIT = 1 << 20;   /* 数组 LCS 表的最大格数 */
+
+// 就地修改 target, patch 中的子树用 TinyMove 移入 target, 之后 patch 只能 TinyFree
+// 代价只与补丁大小及路径上容器的宽度有关, 与文档大小无关
+
+// JSON Merge Patch (RFC 7386)
+void TinyApplyMergePatch(TinyValue* target, TinyValue* patch);
+
+// JSON Patch (RFC 6902), ops 为操作数组, 成功返回 TINY_PATCH_OK
+// 操作依次执行, 失败时已执行的操作不会撤销; 需要原子性时先 TinyCopy 一份 target(O(1))
+int TinyApplyPatch(TinyValue* target, TinyValue* ops);
+
+// 生成把 from 变为 to 的 JSON Patch, 结果写入 patch(一个操作数组)
+// 共享存储的子树直接跳过; 对象按键匹配, 数组去掉相同的首尾后对剩余部分求 LCS,
+// 规模超过 TINY_DIFF_LCS_LIMIT 时退化为按位置比较. 操作中的值与 to 共享存储
+void TinyDiff(TinyValue* patch, const TinyValue* from, const TinyValue* to);
+
+#endif // TINYPATCH_H
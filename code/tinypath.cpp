@@ -0,0 +1,266 @@
+/*
+ * @Author       : mark
+ * @Date         : 2020-05-26
+ * @copyleft Apache 2.0
+ */
+
+#include "tinypath.h"
+#include "tinybind.h"
+#include "tinycontext.h"
+#include <assert.h>  /* assert() */
+#include <stdint.h>  /* SIZE_MAX */
+#include <stdlib.h>  /* realloc(), malloc(), free() */
+#include <string.h>  /* memcmp(), memcpy(), memset() */
+
+static bool TinyPathIsDigit(char ch) {
+    return ch >= '0' && ch <= '9';
+}
+
+//读取非负整数, 没有数字或溢出时返回 NULL
+static const char* TinyPathNumber(const char* p, size_t* out) {
+    if(!TinyPathIsDigit(*p)) return NULL;
+    size_t n = 0;
+    for(; TinyPathIsDigit(*p); p++) {
+        size_t d = *p - '0';
+        if(n > (SIZE_MAX - d) / 10) return NULL;
+        n = n * 10 + d;
+    }
+    *out = n;
+    return p;
+}
+
+static bool TinyPathAddStep(TinyPath* path, const TinyPathStep* step) {
+    if(path->count == TINY_PATH_MAX_STEPS) return false;
+    path->steps = (TinyPathStep*)realloc(path->steps, (path->count + 1) * sizeof(TinyPathStep));
+    path->steps[path->count++] = *step;
+    return true;
+}
+
+//.name 形式的键: 到下一个 '.'、'[' 或结尾为止
+static const char* TinyPathDotName(const char* p, TinyPathStep* step) {
+    const char* start = p;
+    while(*p != '\0' && *p != '.' && *p != '[') p++;
+    if(p == start) return NULL;
+    if(p - start == 1 && *start == '*') {
+        step->kind = TINY_PATH_WILDCARD;
+        return p;
+    }
+    step->kind = TINY_PATH_NAME;
+    step->nlen = p - start;
+    step->name = (char*)malloc(step->nlen + 1);
+    memcpy(step->name, start, step->nlen);
+    step->name[step->nlen] = '\0';
+    return p;
+}
+
+//['name'] 或 ["name"] 形式的键, 只处理 \\ 和引号的转义
+static const char* TinyPathQuotedName(const char* p, TinyPathStep* step) {
+    char quote = *p++;
+    size_t len = 0;
+    step->kind = TINY_PATH_NAME;
+    step->name = (char*)malloc(strlen(p) + 1);
+    while(*p != quote) {
+        if(*p == '\0') return NULL;
+        if(*p == '\\') {
+            p++;
+            if(*p != '\\' && *p != '\'' && *p != '"') return NULL;
+        }
+        step->name[len++] = *p++;
+    }
+    step->name[len] = '\0';
+    step->nlen = len;
+    return p + 1;
+}
+
+//[n]、[start:end:step] 中的各项都可以省略, 但不能为负
+static const char* TinyPathSlice(const char* p, TinyPathStep* step) {
+    step->kind = TINY_PATH_SLICE;
+    step->start = 0;
+    step->end = SIZE_MAX;
+    step->step = 1;
+    if(*p != ':') {
+        if((p = TinyPathNumber(p, &step->start)) == NULL) return NULL;
+        if(*p != ':') {
+            if(step->start == SIZE_MAX) return NULL;
+            step->end = step->start + 1;
+            return p;
+        }
+    }
+    p++;
+    if(TinyPathIsDigit(*p) && (p = TinyPathNumber(p, &step->end)) == NULL) return NULL;
+    if(*p == ':') {
+        p++;
+        if(TinyPathIsDigit(*p) && ((p = TinyPathNumber(p, &step->step)) == NULL || step->step == 0)) return NULL;
+    }
+    return p;
+}
+
+static const char* TinyPathBracket(const char* p, TinyPathStep* step) {
+    assert(*p == '[');
+    p++;
+    if(*p == '*') {
+        step->kind = TINY_PATH_WILDCARD;
+        p++;
+    } else if(*p == '\'' || *p == '"') {
+        p = TinyPathQuotedName(p, step);
+    } else if(TinyPathIsDigit(*p) || *p == ':') {
+        p = TinyPathSlice(p, step);
+    } else {
+        return NULL;
+    }
+    return p != NULL && *p == ']' ? p + 1 : NULL;
+}
+
+int TinyPathCompile(TinyPath* path, const char* expr) {
+    assert(path != NULL && expr != NULL);
+    path->steps = NULL;
+    path->count = 0;
+    const char* p = expr;
+    if(*p++ != '$') return TINY_PATH_INVALID;
+    while(*p != '\0') {
+        TinyPathStep step;
+        memset(&step, 0, sizeof(step));
+        if(p[0] == '.' && p[1] == '.') {
+            step.descendant = true;
+            p += 2;
+            p = *p == '[' ? TinyPathBracket(p, &step) : TinyPathDotName(p, &step);
+        } else if(*p == '.') {
+            p = TinyPathDotName(p + 1, &step);
+        } else if(*p == '[') {
+            p = TinyPathBracket(p, &step);
+        } else {
+            p = NULL;
+        }
+        if(p == NULL || !TinyPathAddStep(path, &step)) {
+            free(step.name);
+            return TINY_PATH_INVALID;
+        }
+    }
+    return TINY_PATH_OK;
+}
+
+void TinyPathFree(TinyPath* path) {
+    assert(path != NULL);
+    for(size_t i = 0; i < path->count; i++) free(path->steps[i].name);
+    free(path->steps);
+    path->steps = NULL;
+    path->count = 0;
+}
+
+//第 i 位表示已经匹配了前 i 步; 递归下降的步骤在更深处仍然有效
+//key 为 NULL 时是数组的第 index 个元素
+static uint64_t TinyPathNext(const TinyPath* path, uint64_t states, const char* key, size_t klen, size_t index) {
+    uint64_t next = 0;
+    while(states != 0) {
+        unsigned i = __builtin_ctzll(states);
+        const TinyPathStep* s = &path->steps[i];
+        bool hit;
+        states &= states - 1;
+        switch(s->kind) {
+            case TINY_PATH_NAME: hit = key != NULL && s->nlen == klen && memcmp(s->name, key, klen) == 0; break;
+            case TINY_PATH_WILDCARD: hit = true; break;
+            default: hit = key == NULL && index >= s->start && index < s->end && (index - s->start) % s->step == 0; break;
+        }
+        if(s->descendant) next |= 1ULL << i;
+        if(hit) next |= 1ULL << (i + 1);
+    }
+    return next;
+}
+
+//尚未读完的容器
+struct TinyPathFrame {
+    uint64_t states;            /* 其成员可能匹配的状态 */
+    const char* start;          /* 容器本身匹配时的起点, 否则为 NULL */
+    size_t index;
+    char close;
+};
+
+//不递归: 用 frames 记下各层容器, 深度只受内存限制
+static int TinyPathRun(const TinyPath* path, TinyBindReader* r, TinyContext* frames, TinyPathCallback callback, void* user, bool* stopped) {
+    const uint64_t accept = 1ULL << path->count;
+    uint64_t states = 1;
+    int ret;
+    while(true) {
+        const char* start = r->json;
+        uint64_t live = states & (accept - 1);
+        if(live == 0 || (*r->json != '{' && *r->json != '[')) {
+            //没有状态能在更深处匹配, 整个值直接跳过
+            if((ret = TinyBindSkipValue(r)) != TINY_PARSE_OK) return ret;
+            if((states & accept) && !callback(user, start, r->json - start)) {
+                *stopped = true;
+                return TINY_PARSE_OK;
+            }
+        } else {
+            TinyPathFrame* f = (TinyPathFrame*)TinyContextPush(frames, sizeof(TinyPathFrame));
+            f->states = live;
+            f->start = (states & accept) ? start : NULL;
+            f->index = 0;
+            f->close = *r->json == '{' ? '}' : ']';
+            r->json++;
+        }
+        //找到下一个值, 途中结束的容器依次出栈
+        while(true) {
+            if(frames->top == 0) return TINY_PARSE_OK;
+            TinyPathFrame* f = (TinyPathFrame*)(frames->stack + frames->top) - 1;
+            TinyBindSkipWhiteSpace(r);
+            if(*r->json == f->close) {
+                r->json++;
+                frames->top -= sizeof(TinyPathFrame);
+                if(f->start != NULL && !callback(user, f->start, r->json - f->start)) {
+                    *stopped = true;
+                    return TINY_PARSE_OK;
+                }
+                continue;
+            }
+            if(f->index > 0) {
+                if(*r->json != ',') {
+                    return f->close == '}' ? TINY_PARSE_MISS_COMMA_OR_CURLY_BRACKET : TINY_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+                }
+                r->json++;
+                TinyBindSkipWhiteSpace(r);
+            }
+            if(f->close == '}') {
+                const char* key;
+                size_t klen;
+                if(*r->json != '"') return TINY_PARSE_MISS_KEY;
+                if((ret = TinyBindReadStringRef(r, &key, &klen)) != TINY_PARSE_OK) return ret;
+                states = TinyPathNext(path, f->states, key, klen, 0);
+                TinyBindSkipWhiteSpace(r);
+                if(*r->json != ':') return TINY_PARSE_MISS_COLON;
+                r->json++;
+                TinyBindSkipWhiteSpace(r);
+            } else {
+                states = TinyPathNext(path, f->states, NULL, 0, f->index);
+            }
+            f->index++;
+            break;
+        }
+    }
+}
+
+int TinyPathQuery(const TinyPath* path, const char* json, TinyPathCallback callback, void* user) {
+    assert(path != NULL && json != NULL && callback != NULL);
+    TinyBindReader r;
+    TinyContext frames = { NULL, NULL, 0, 0 };
+    TinyBindReaderInit(&r, json);
+    TinyBindSkipWhiteSpace(&r);
+    bool stopped = false;
+    int ret = TinyPathRun(path, &r, &frames, callback, user, &stopped);
+    if(ret == TINY_PARSE_OK && !stopped) {
+        TinyBindSkipWhiteSpace(&r);
+        if(*r.json != '\0') ret = TINY_PARSE_ROOT_NOT_SINGULAR;
+    }
+    TinyBindReaderFree(&r);
+    free(frames.stack);
+    return ret == TINY_PARSE_OK ? TINY_PATH_OK : ret;
+}
+
+int TinyPathParseMatch(TinyValue* value, const char* json, size_t len) {
+    assert(value != NULL && json != NULL);
+    char* buf = (char*)malloc(len + 1);
+    memcpy(buf, json, len);
+    buf[len] = '\0';
+    int ret = TinyParse(value, buf);
+    free(buf);
+    return ret;
+}
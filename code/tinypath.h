@@ -0,0 +1,56 @@
+/*
+ * @Author       : mark
+ * @Date         : 2020-05-26
+ * @copyleft Apache 2.0
+ */
+
+#ifndef TINYPATH_H
+#define TINYPATH_H
+
+#include "tinyjson.h"
+
+// JSONPath 的一个子集, 直接在 JSON 文本上查找, 不建立 TinyValue
+//
+//   $.events[*].user.id    $['a b'][0]    $..id    $.list[2:10:2]    $..*
+//
+// 支持成员(.name 或 ['name'])、通配符(.* 或 [*])、非负下标、切片 [start:end:step](均不能为负)
+// 以及递归下降(..); 不支持负下标、并集和过滤表达式, 编译时返回 TINY_PATH_INVALID
+//
+// 路径编译成一组步骤, 查找时每层只记一组"已经匹配到第几步"的状态, 状态为空的子树直接跳过
+// 匹配的值在其结束处交给回调, 所以嵌套的匹配(如 $..a 中 a 里的 a)先于外层输出
+
+const size_t TINY_PATH_MAX_STEPS = 63;
+
+enum TinyPathKind {
+    TINY_PATH_NAME,
+    TINY_PATH_WILDCARD,
+    TINY_PATH_SLICE,            /* 下标 n 即 [n:n+1:1] */
+};
+
+struct TinyPathStep {
+    TinyPathKind kind;
+    bool descendant;            /* 前面是 .. */
+    char* name;                 /* 已去掉转义 */
+    size_t nlen;
+    size_t start, end, step;
+};
+
+struct TinyPath {
+    TinyPathStep* steps;
+    size_t count;
+};
+
+// 匹配到的值在原 JSON 中的范围, 只在回调期间有效; 返回 false 停止查找
+typedef bool (*TinyPathCallback)(void* user, const char* json, size_t len);
+
+// 成功返回 TINY_PATH_OK; 无论成败之后都要 TinyPathFree
+int TinyPathCompile(TinyPath* path, const char* expr);
+void TinyPathFree(TinyPath* path);
+
+// 语法错误返回 TINY_PARSE_* 错误码, 出错前的匹配已经交给回调; 回调停止时不再检查后面的内容
+// 跳过的子树不建立任何匹配, 但同样按 JSON 语法检查(TinyBindSkipValue)
+int TinyPathQuery(const TinyPath* path, const char* json, TinyPathCallback callback, void* user);
+// 把匹配到的一段解析为 TinyValue, 返回值同 TinyParse
+int TinyPathParseMatch(TinyValue* value, const char* json, size_t len);
+
+#endif // TINYPATH_H
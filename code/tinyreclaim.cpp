@@ -0,0 +1,104 @@
+/*
+ * @Author       : mark
+ * @Date         : 2020-05-26
+ * @copyleft Apache 2.0
+ */
+
+#include "tinyreclaim.h"
+#include <assert.h>  /* assert() */
+#include <stdlib.h>  /* realloc(), free() */
+#include <string.h>  /* memcpy() */
+
+const size_t TINY_RECLAIM_BUDGET = 4096;
+
+static void TinyReclaimThreadRun(TinyReclaimThread* t) {
+    TinyReclaimer r;
+    TinyReclaimerInit(&r);
+    std::unique_lock<std::mutex> lock(t->mutex);
+    while(true) {
+        t->wake.wait(lock, [t] { return t->count > 0 || t->stop; });
+        if(t->count == 0) break;
+        //一次取走全部, 释放期间不持有锁
+        size_t taken = t->count;
+        for(size_t i = 0; i < taken; i++) TinyReclaimerPush(&r, &t->queue[i]);
+        t->count = 0;
+        lock.unlock();
+        uint64_t nodes = r.nodes, bytes = r.bytes;
+        bool done;
+        do {
+            done = TinyReclaimerStep(&r, t->budget);
+            t->nodes.fetch_add(r.nodes - nodes, std::memory_order_relaxed);
+            t->bytes.fetch_add(r.bytes - bytes, std::memory_order_relaxed);
+            nodes = r.nodes;
+            bytes = r.bytes;
+        } while(!done);
+        t->pending.fetch_sub(taken, std::memory_order_relaxed);
+        lock.lock();
+        if(t->count == 0) {
+            t->busy = false;
+            t->idle.notify_all();
+        }
+    }
+    lock.unlock();
+    TinyReclaimerFree(&r);
+}
+
+TinyReclaimThread* TinyReclaimThreadStart(size_t budget) {
+    TinyReclaimThread* t = new TinyReclaimThread;
+    t->queue = NULL;
+    t->count = t->capacity = 0;
+    t->busy = t->stop = false;
+    t->budget = budget == 0 ? TINY_RECLAIM_BUDGET : budget;
+    t->pending.store(0, std::memory_order_relaxed);
+    t->nodes.store(0, std::memory_order_relaxed);
+    t->bytes.store(0, std::memory_order_relaxed);
+    t->worker = std::thread(TinyReclaimThreadRun, t);
+    return t;
+}
+
+void TinyReclaimThreadPush(TinyReclaimThread* t, TinyValue* value) {
+    assert(t != NULL && value != NULL);
+    //标量没有可释放的内容, 不必交给后台线程
+    if(value->type != TINY_STRING && value->type != TINY_ARRAY && value->type != TINY_OBJECT) {
+        TinyFree(value);
+        return;
+    }
+    std::lock_guard<std::mutex> lock(t->mutex);
+    assert(!t->stop);
+    if(t->count == t->capacity) {
+        t->capacity = t->capacity == 0 ? 8 : t->capacity + (t->capacity >> 1);
+        t->queue = (TinyValue*)realloc(t->queue, t->capacity * sizeof(TinyValue));
+    }
+    memcpy(&t->queue[t->count++], value, sizeof(TinyValue));
+    TinyInitValue(value);
+    t->pending.fetch_add(1, std::memory_order_relaxed);
+    t->busy = true;
+    t->wake.notify_one();
+}
+
+void TinyReclaimThreadDrain(TinyReclaimThread* t) {
+    assert(t != NULL);
+    std::unique_lock<std::mutex> lock(t->mutex);
+    t->idle.wait(lock, [t] { return !t->busy; });
+}
+
+void TinyReclaimThreadGetStats(TinyReclaimThread* t, TinyReclaimStats* stats) {
+    assert(t != NULL && stats != NULL);
+    stats->pending = t->pending.load(std::memory_order_relaxed);
+    stats->nodes = t->nodes.load(std::memory_order_relaxed);
+    stats->bytes = t->bytes.load(std::memory_order_relaxed);
+}
+
+void TinyReclaimThreadStop(TinyReclaimThread* t) {
+    if(t == NULL) return;
+    {
+        std::lock_guard<std::mutex> lock(t->mutex);
+        t->stop = true;
+        t->wake.notify_one();
+    }
+    //线程先取走剩下的值, 队列为空时才退出
+    t->worker.join();
+    assert(t->count == 0);
+    free(t->queue);
+    delete t;
+}
@@ -0,0 +1,46 @@
+/*
+ * @Author       : mark
+ * @Date         : 2020-05-26
+ * @copyleft Apache 2.0
+ */
+
+#ifndef TINYRECLAIM_H
+#define TINYRECLAIM_H
+
+#include "tinyjson.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// 后台释放: 调用线程只把值移交过去(O(1)), 由后台线程用 TinyReclaimer 分步释放
+struct TinyReclaimThread {
+    std::mutex mutex;
+    std::condition_variable wake;           /* 有新的值或要求停止 */
+    std::condition_variable idle;           /* 交来的值都已释放 */
+    TinyValue* queue;                       /* 尚未被后台线程取走的值 */
+    size_t count, capacity;
+    bool busy, stop;
+    size_t budget;                          /* 每步处理的元素个数, 两步之间更新统计 */
+    std::atomic<uint64_t> pending;          /* 已交来但尚未释放完的值的个数 */
+    std::atomic<uint64_t> nodes, bytes;     /* 累计释放的节点数和字节数, 同 TinyReclaimer */
+    std::thread worker;
+};
+
+struct TinyReclaimStats {
+    uint64_t pending;
+    uint64_t nodes;
+    uint64_t bytes;
+};
+
+// budget 为 0 时取默认值
+TinyReclaimThread* TinyReclaimThreadStart(size_t budget);
+// 把 value 移交给后台线程, value 变为 null; 与 value 共享存储的值仍可在调用线程使用
+void TinyReclaimThreadPush(TinyReclaimThread* t, TinyValue* value);
+// 等待已交来的值全部释放
+void TinyReclaimThreadDrain(TinyReclaimThread* t);
+void TinyReclaimThreadGetStats(TinyReclaimThread* t, TinyReclaimStats* stats);
+// 释放完剩下的值后结束线程并释放 t
+void TinyReclaimThreadStop(TinyReclaimThread* t);
+
+#endif // TINYRECLAIM_H
@@ -0,0 +1,620 @@
+/*
+ * @Author       : mark
+ * @Date         : 2020-05-26
+ * @copyleft Apache 2.0
+ */
+
+#include "tinyschema.h"
+#include "tinybind.h"
+#include "tinycontext.h"
+#include <assert.h>  /* assert() */
+#include <math.h>    /* floor() */
+#include <stdint.h>  /* SIZE_MAX */
+#include <stdlib.h>  /* realloc(), free() */
+#include <string.h>  /* memcmp(), memset(), strlen() */
+
+enum {
+    TINY_SCHEMA_TYPE_NULL = 0x1,
+    TINY_SCHEMA_TYPE_BOOLEAN = 0x2,
+    TINY_SCHEMA_TYPE_INTEGER = 0x4,
+    TINY_SCHEMA_TYPE_NUMBER = 0x8,
+    TINY_SCHEMA_TYPE_STRING = 0x10,
+    TINY_SCHEMA_TYPE_ARRAY = 0x20,
+    TINY_SCHEMA_TYPE_OBJECT = 0x40,
+};
+
+enum {
+    TINY_SCHEMA_CHECK_TYPE = 0x1,
+    TINY_SCHEMA_CHECK_ENUM = 0x2,
+    TINY_SCHEMA_CHECK_MINIMUM = 0x4,
+    TINY_SCHEMA_CHECK_MAXIMUM = 0x8,
+    TINY_SCHEMA_CHECK_EXCLUSIVE_MINIMUM = 0x10,
+    TINY_SCHEMA_CHECK_EXCLUSIVE_MAXIMUM = 0x20,
+    TINY_SCHEMA_CHECK_LENGTH = 0x40,
+    TINY_SCHEMA_CHECK_ARRAY = 0x80,     /* minItems、maxItems 或 items */
+    TINY_SCHEMA_CHECK_OBJECT = 0x100,   /* properties、required、additionalProperties 或成员个数 */
+};
+
+//内部以 TINY_PARSE_OK 表示通过, 对外换成 TINY_SCHEMA_OK
+
+//FNV-1a
+static uint64_t TinySchemaHash(const char* key, size_t klen) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for(size_t i = 0; i < klen; i++) {
+        h = (h ^ (unsigned char)key[i]) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static bool TinySchemaKeyIs(const char* key, size_t klen, const char* name) {
+    return strlen(name) == klen && memcmp(key, name, klen) == 0;
+}
+
+static int TinySchemaAddNode(TinySchema* s) {
+    if(s->nodeCount == s->nodeCapacity) {
+        s->nodeCapacity = s->nodeCapacity == 0 ? 8 : s->nodeCapacity * 2;
+        s->nodes = (TinySchemaNode*)realloc(s->nodes, s->nodeCapacity * sizeof(TinySchemaNode));
+    }
+    TinySchemaNode* n = &s->nodes[s->nodeCount];
+    memset(n, 0, sizeof(*n));
+    n->maxLength = n->maxItems = n->maxProperties = SIZE_MAX;
+    n->items = n->additional = -1;
+    return (int)s->nodeCount++;
+}
+
+//在节点的哈希表中查找键, 没有时返回 NULL
+static const TinySchemaProperty* TinySchemaFindProperty(const TinySchema* s, const TinySchemaNode* n, const char* key, size_t klen) {
+    if(n->propCount == 0) return NULL;
+    uint64_t h = TinySchemaHash(key, klen);
+    const size_t* slots = s->slots + n->slots;
+    for(size_t i = (size_t)h & n->slotMask; slots[i] != 0; i = (i + 1) & n->slotMask) {
+        const TinySchemaProperty* p = &s->props[slots[i] - 1];
+        if(p->hash == h && p->klen == klen && memcmp(p->key, key, klen) == 0) return p;
+    }
+    return NULL;
+}
+
+//编译时加入节点的成员, 已存在时返回原有的下标
+static size_t TinySchemaAddProperty(TinySchema* s, size_t index, const char* key, size_t klen) {
+    TinySchemaNode* n = &s->nodes[index];
+    uint64_t h = TinySchemaHash(key, klen);
+    size_t* slots = s->slots + n->slots;
+    size_t i;
+    for(i = (size_t)h & n->slotMask; slots[i] != 0; i = (i + 1) & n->slotMask) {
+        const TinySchemaProperty* p = &s->props[slots[i] - 1];
+        if(p->hash == h && p->klen == klen && memcmp(p->key, key, klen) == 0) return slots[i] - 1;
+    }
+    //各节点的成员连续存放, 容量在编译子 schema 之前已经留好
+    TinySchemaProperty* p = &s->props[n->props + n->propCount];
+    p->key = key;
+    p->klen = klen;
+    p->hash = h;
+    p->node = -1;
+    p->bit = (size_t)-1;
+    slots[i] = n->props + n->propCount + 1;
+    return n->props + n->propCount++;
+}
+
+static bool TinySchemaGetSize(const TinyValue* json, size_t* out) {
+    if(TinyGetType(json) != TINY_NUMBER) return false;
+    double num = TinyGetNumber(json);
+    if(num < 0 || num != floor(num)) return false;
+    *out = num >= 18446744073709551615.0 ? SIZE_MAX : (size_t)num;
+    return true;
+}
+
+static bool TinySchemaGetType(const TinyValue* json, unsigned* types) {
+    static const char* names[] = { "null", "boolean", "integer", "number", "string", "array", "object" };
+    if(TinyGetType(json) != TINY_STRING) return false;
+    for(size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if(TinySchemaKeyIs(TinyGetString(json), TinyGetStringLength(json), names[i])) {
+            *types |= 1u << i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void TinySchemaAddEnum(TinySchema* s, const TinyValue* value) {
+    if(s->enumCount == s->enumCapacity) {
+        s->enumCapacity = s->enumCapacity == 0 ? 8 : s->enumCapacity * 2;
+        s->enums = (TinyValue*)realloc(s->enums, s->enumCapacity * sizeof(TinyValue));
+        s->enumHashes = (uint64_t*)realloc(s->enumHashes, s->enumCapacity * sizeof(uint64_t));
+    }
+    TinyInitValue(&s->enums[s->enumCount]);
+    TinyCopy(&s->enums[s->enumCount], value);
+    s->enumHashes[s->enumCount++] = TinyHash(value);
+}
+
+//收紧下界: 取较大者, 相等时排它的更严
+static void TinySchemaLowerBound(TinySchemaNode* n, double num, bool exclusive) {
+    bool has = (n->checks & (TINY_SCHEMA_CHECK_MINIMUM | TINY_SCHEMA_CHECK_EXCLUSIVE_MINIMUM)) != 0;
+    if(has && (num < n->minimum || (num == n->minimum && !exclusive))) return;
+    n->minimum = num;
+    n->checks &= ~(TINY_SCHEMA_CHECK_MINIMUM | TINY_SCHEMA_CHECK_EXCLUSIVE_MINIMUM);
+    n->checks |= exclusive ? TINY_SCHEMA_CHECK_EXCLUSIVE_MINIMUM : TINY_SCHEMA_CHECK_MINIMUM;
+}
+
+static void TinySchemaUpperBound(TinySchemaNode* n, double num, bool exclusive) {
+    bool has = (n->checks & (TINY_SCHEMA_CHECK_MAXIMUM | TINY_SCHEMA_CHECK_EXCLUSIVE_MAXIMUM)) != 0;
+    if(has && (num > n->maximum || (num == n->maximum && !exclusive))) return;
+    n->maximum = num;
+    n->checks &= ~(TINY_SCHEMA_CHECK_MAXIMUM | TINY_SCHEMA_CHECK_EXCLUSIVE_MAXIMUM);
+    n->checks |= exclusive ? TINY_SCHEMA_CHECK_EXCLUSIVE_MAXIMUM : TINY_SCHEMA_CHECK_MAXIMUM;
+}
+
+//编译一个 schema, 子 schema 递归编译; nodes 可能被 realloc, 所以只保存下标
+static int TinySchemaCompileNode(TinySchema* s, const TinyValue* json, int* out) {
+    int index = TinySchemaAddNode(s);
+    *out = index;
+    TinyType type = TinyGetType(json);
+    if(type == TINY_TRUE) return TINY_SCHEMA_OK;
+    if(type == TINY_FALSE) {
+        s->nodes[index].checks = TINY_SCHEMA_CHECK_TYPE;
+        return TINY_SCHEMA_OK;
+    }
+    if(type != TINY_OBJECT) return TINY_SCHEMA_INVALID;
+
+    static const char* unsupported[] = {
+        "pattern", "patternProperties", "$ref", "allOf", "anyOf", "oneOf", "not", "if", "then", "else",
+        "dependencies", "dependentRequired", "dependentSchemas", "propertyNames", "additionalItems",
+        "prefixItems", "contains", "minContains", "maxContains", "uniqueItems", "multipleOf",
+        "unevaluatedProperties", "unevaluatedItems",
+    };
+    const TinyValue *properties = NULL, *required = NULL, *items = NULL, *additional = NULL;
+    const TinyValue *minimum = NULL, *maximum = NULL;
+    bool exclusiveMin = false, exclusiveMax = false;
+    size_t n = TinyGetObjectSize(json);
+    for(size_t i = 0; i < n; i++) {
+        const char* key = TinyGetObjectKey(json, i);
+        size_t klen = TinyGetObjectKeyLength(json, i);
+        const TinyValue* v = TinyGetObjectValue(json, i);
+        TinySchemaNode* node = &s->nodes[index];
+        TinyType vt = TinyGetType(v);
+        if(TinySchemaKeyIs(key, klen, "type")) {
+            if(vt == TINY_ARRAY) {
+                for(size_t j = 0; j < TinyGetArraySize(v); j++) {
+                    if(!TinySchemaGetType(TinyGetArrayElement(v, j), &node->types)) return TINY_SCHEMA_INVALID;
+                }
+            } else if(!TinySchemaGetType(v, &node->types)) {
+                return TINY_SCHEMA_INVALID;
+            }
+            node->checks |= TINY_SCHEMA_CHECK_TYPE;
+        } else if(TinySchemaKeyIs(key, klen, "enum") || TinySchemaKeyIs(key, klen, "const")) {
+            //两者同时出现时不支持
+            if(node->checks & TINY_SCHEMA_CHECK_ENUM) return TINY_SCHEMA_INVALID;
+            node->enums = s->enumCount;
+            if(klen == 5) {
+                TinySchemaAddEnum(s, v);
+            } else {
+                if(vt != TINY_ARRAY) return TINY_SCHEMA_INVALID;
+                for(size_t j = 0; j < TinyGetArraySize(v); j++) TinySchemaAddEnum(s, TinyGetArrayElement(v, j));
+            }
+            node->enumCount = s->enumCount - node->enums;
+            node->checks |= TINY_SCHEMA_CHECK_ENUM;
+        } else if(TinySchemaKeyIs(key, klen, "minimum") || TinySchemaKeyIs(key, klen, "maximum")) {
+            if(vt != TINY_NUMBER) return TINY_SCHEMA_INVALID;
+            (key[1] == 'i' ? minimum : maximum) = v;
+        } else if(TinySchemaKeyIs(key, klen, "exclusiveMinimum") || TinySchemaKeyIs(key, klen, "exclusiveMaximum")) {
+            bool lower = key[10] == 'i';
+            //draft 4 中为布尔, 修饰 minimum/maximum
+            if(vt == TINY_TRUE || vt == TINY_FALSE) (lower ? exclusiveMin : exclusiveMax) = vt == TINY_TRUE;
+            else if(vt != TINY_NUMBER) return TINY_SCHEMA_INVALID;
+            else if(lower) TinySchemaLowerBound(node, TinyGetNumber(v), true);
+            else TinySchemaUpperBound(node, TinyGetNumber(v), true);
+        } else if(TinySchemaKeyIs(key, klen, "minLength") || TinySchemaKeyIs(key, klen, "maxLength")) {
+            if(!TinySchemaGetSize(v, key[1] == 'i' ? &node->minLength : &node->maxLength)) return TINY_SCHEMA_INVALID;
+            node->checks |= TINY_SCHEMA_CHECK_LENGTH;
+        } else if(TinySchemaKeyIs(key, klen, "minItems") || TinySchemaKeyIs(key, klen, "maxItems")) {
+            if(!TinySchemaGetSize(v, key[1] == 'i' ? &node->minItems : &node->maxItems)) return TINY_SCHEMA_INVALID;
+            node->checks |= TINY_SCHEMA_CHECK_ARRAY;
+        } else if(TinySchemaKeyIs(key, klen, "minProperties") || TinySchemaKeyIs(key, klen, "maxProperties")) {
+            if(!TinySchemaGetSize(v, key[1] == 'i' ? &node->minProperties : &node->maxProperties)) return TINY_SCHEMA_INVALID;
+            node->checks |= TINY_SCHEMA_CHECK_OBJECT;
+        } else if(TinySchemaKeyIs(key, klen, "properties")) {
+            if(vt != TINY_OBJECT) return TINY_SCHEMA_INVALID;
+            properties = v;
+        } else if(TinySchemaKeyIs(key, klen, "required")) {
+            if(vt != TINY_ARRAY) return TINY_SCHEMA_INVALID;
+            for(size_t j = 0; j < TinyGetArraySize(v); j++) {
+                if(TinyGetType(TinyGetArrayElement(v, j)) != TINY_STRING) return TINY_SCHEMA_INVALID;
+            }
+            required = v;
+        } else if(TinySchemaKeyIs(key, klen, "items")) {
+            //元组形式的 items 不支持
+            if(vt != TINY_OBJECT && vt != TINY_TRUE && vt != TINY_FALSE) return TINY_SCHEMA_INVALID;
+            items = v;
+        } else if(TinySchemaKeyIs(key, klen, "additionalProperties")) {
+            if(vt != TINY_OBJECT && vt != TINY_TRUE && vt != TINY_FALSE) return TINY_SCHEMA_INVALID;
+            additional = v;
+        } else {
+            for(size_t j = 0; j < sizeof(unsupported) / sizeof(unsupported[0]); j++) {
+                if(TinySchemaKeyIs(key, klen, unsupported[j])) return TINY_SCHEMA_INVALID;
+            }
+        }
+    }
+    if(minimum != NULL) TinySchemaLowerBound(&s->nodes[index], TinyGetNumber(minimum), exclusiveMin);
+    if(maximum != NULL) TinySchemaUpperBound(&s->nodes[index], TinyGetNumber(maximum), exclusiveMax);
+
+    int child, ret;
+    if(items != NULL) {
+        if((ret = TinySchemaCompileNode(s, items, &child)) != TINY_SCHEMA_OK) return ret;
+        s->nodes[index].items = child;
+        s->nodes[index].checks |= TINY_SCHEMA_CHECK_ARRAY;
+    }
+    if(additional != NULL) {
+        if(TinyGetType(additional) == TINY_FALSE) child = -2;
+        else if((ret = TinySchemaCompileNode(s, additional, &child)) != TINY_SCHEMA_OK) return ret;
+        s->nodes[index].additional = child;
+        s->nodes[index].checks |= TINY_SCHEMA_CHECK_OBJECT;
+    }
+
+    size_t pn = properties != NULL ? TinyGetObjectSize(properties) : 0;
+    size_t rn = required != NULL ? TinyGetArraySize(required) : 0;
+    if(pn + rn == 0) return TINY_SCHEMA_OK;
+    //先留出本节点全部成员和哈希表的位置, 再编译各成员的 schema
+    size_t mask = 1;
+    while(mask + 1 < (pn + rn) * 2) mask = mask * 2 + 1;
+    TinySchemaNode* node = &s->nodes[index];
+    node->checks |= TINY_SCHEMA_CHECK_OBJECT;
+    node->props = s->propCount;
+    node->slots = s->slotCount;
+    node->slotMask = mask;
+    if(s->propCount + pn + rn > s->propCapacity) {
+        while(s->propCount + pn + rn > s->propCapacity) s->propCapacity = s->propCapacity == 0 ? 8 : s->propCapacity * 2;
+        s->props = (TinySchemaProperty*)realloc(s->props, s->propCapacity * sizeof(TinySchemaProperty));
+    }
+    if(s->slotCount + mask + 1 > s->slotCapacity) {
+        while(s->slotCount + mask + 1 > s->slotCapacity) s->slotCapacity = s->slotCapacity == 0 ? 16 : s->slotCapacity * 2;
+        s->slots = (size_t*)realloc(s->slots, s->slotCapacity * sizeof(size_t));
+    }
+    memset(s->slots + s->slotCount, 0, (mask + 1) * sizeof(size_t));
+    s->propCount += pn + rn;
+    s->slotCount += mask + 1;
+
+    for(size_t i = 0; i < pn; i++) {
+        size_t p = TinySchemaAddProperty(s, index, TinyGetObjectKey(properties, i), TinyGetObjectKeyLength(properties, i));
+        //重复的键取第一个
+        if(s->props[p].node != -1) continue;
+        if((ret = TinySchemaCompileNode(s, TinyGetObjectValue(properties, i), &child)) != TINY_SCHEMA_OK) return ret;
+        s->props[p].node = child;
+    }
+    for(size_t i = 0; i < rn; i++) {
+        const TinyValue* name = TinyGetArrayElement(required, i);
+        size_t p = TinySchemaAddProperty(s, index, TinyGetString(name), TinyGetStringLength(name));
+        if(s->props[p].bit == (size_t)-1) s->props[p].bit = s->nodes[index].required++;
+    }
+    return TINY_SCHEMA_OK;
+}
+
+int TinySchemaCompile(TinySchema* schema, const TinyValue* json) {
+    assert(schema != NULL && json != NULL);
+    memset(schema, 0, sizeof(*schema));
+    TinyInitValue(&schema->source);
+    TinyCopy(&schema->source, json);
+    int root;
+    return TinySchemaCompileNode(schema, &schema->source, &root);
+}
+
+void TinySchemaFree(TinySchema* schema) {
+    assert(schema != NULL);
+    for(size_t i = 0; i < schema->enumCount; i++) TinyFree(&schema->enums[i]);
+    free(schema->nodes);
+    free(schema->props);
+    free(schema->slots);
+    free(schema->enums);
+    free(schema->enumHashes);
+    TinyFree(&schema->source);
+    memset(schema, 0, sizeof(*schema));
+    TinyInitValue(&schema->source);
+}
+
+static bool TinySchemaTypeMatch(const TinySchemaNode* n, unsigned type, double num) {
+    if(n->types & type) return true;
+    //integer 只是 number 的子集
+    return type == TINY_SCHEMA_TYPE_NUMBER && (n->types & TINY_SCHEMA_TYPE_INTEGER) && num == floor(num);
+}
+
+static int TinySchemaCheckNumber(const TinySchemaNode* n, double num) {
+    if(!(n->checks & TINY_SCHEMA_CHECK_TYPE) || TinySchemaTypeMatch(n, TINY_SCHEMA_TYPE_NUMBER, num)) {
+        unsigned c = n->checks;
+        if(((c & TINY_SCHEMA_CHECK_MINIMUM) && num < n->minimum) ||
+           ((c & TINY_SCHEMA_CHECK_EXCLUSIVE_MINIMUM) && num <= n->minimum) ||
+           ((c & TINY_SCHEMA_CHECK_MAXIMUM) && num > n->maximum) ||
+           ((c & TINY_SCHEMA_CHECK_EXCLUSIVE_MAXIMUM) && num >= n->maximum)) {
+            return TINY_SCHEMA_OUT_OF_RANGE;
+        }
+        return TINY_PARSE_OK;
+    }
+    return TINY_SCHEMA_TYPE_MISMATCH;
+}
+
+//长度按码点计: 不数 UTF-8 的后续字节
+static int TinySchemaCheckString(const TinySchemaNode* n, const char* str, size_t len) {
+    if((n->checks & TINY_SCHEMA_CHECK_TYPE) && !(n->types & TINY_SCHEMA_TYPE_STRING)) return TINY_SCHEMA_TYPE_MISMATCH;
+    if(n->checks & TINY_SCHEMA_CHECK_LENGTH) {
+        //码点数在 len / 4 与 len 之间, 先按字节数排除
+        if(len < n->minLength || len / 4 > n->maxLength) return TINY_SCHEMA_OUT_OF_RANGE;
+        size_t count = 0;
+        for(size_t i = 0; i < len; i++) count += ((unsigned char)str[i] & 0xC0) != 0x80;
+        if(count < n->minLength || count > n->maxLength) return TINY_SCHEMA_OUT_OF_RANGE;
+    }
+    return TINY_PARSE_OK;
+}
+
+static int TinySchemaCheckKind(const TinySchemaNode* n, unsigned type) {
+    if((n->checks & TINY_SCHEMA_CHECK_TYPE) && !(n->types & type)) return TINY_SCHEMA_TYPE_MISMATCH;
+    return TINY_PARSE_OK;
+}
+
+//标量直接比较, 不需要计算哈希
+static int TinySchemaCheckEnumScalar(const TinySchema* s, const TinySchemaNode* n, TinyType type, const char* str, size_t len, double num) {
+    for(size_t i = n->enums; i < n->enums + n->enumCount; i++) {
+        const TinyValue* e = &s->enums[i];
+        if(TinyGetType(e) != type) continue;
+        if(type == TINY_STRING) {
+            if(TinyGetStringLength(e) == len && memcmp(TinyGetString(e), str, len) == 0) return TINY_PARSE_OK;
+        } else if(type != TINY_NUMBER || TinyGetNumber(e) == num) {
+            return TINY_PARSE_OK;
+        }
+    }
+    return TINY_SCHEMA_ENUM_MISMATCH;
+}
+
+static int TinySchemaCheckEnum(const TinySchema* s, const TinySchemaNode* n, const TinyValue* value) {
+    TinyType type = TinyGetType(value);
+    if(type == TINY_STRING) return TinySchemaCheckEnumScalar(s, n, type, TinyGetString(value), TinyGetStringLength(value), 0);
+    if(type != TINY_ARRAY && type != TINY_OBJECT) {
+        return TinySchemaCheckEnumScalar(s, n, type, NULL, 0, type == TINY_NUMBER ? TinyGetNumber(value) : 0);
+    }
+    uint64_t h = TinyHash(value);
+    for(size_t i = n->enums; i < n->enums + n->enumCount; i++) {
+        if(s->enumHashes[i] == h && TinyIsEqual(&s->enums[i], value)) return TINY_PARSE_OK;
+    }
+    return TINY_SCHEMA_ENUM_MISMATCH;
+}
+
+//required 成员的位图, 嵌套的对象在 context 中各占一段
+struct TinySchemaSeen {
+    size_t head, count;
+};
+
+static void TinySchemaSeenStart(TinyContext* c, const TinySchemaNode* n, TinySchemaSeen* seen) {
+    size_t words = (n->required + 63) / 64;
+    seen->head = c->top;
+    seen->count = 0;
+    if(words > 0) memset(TinyContextPush(c, words * sizeof(uint64_t)), 0, words * sizeof(uint64_t));
+}
+
+static void TinySchemaSeenMark(TinyContext* c, TinySchemaSeen* seen, const TinySchemaProperty* p) {
+    if(p == NULL || p->bit == (size_t)-1) return;
+    uint64_t* bits = (uint64_t*)(c->stack + seen->head) + p->bit / 64;
+    uint64_t mask = 1ULL << (p->bit % 64);
+    if(!(*bits & mask)) {
+        *bits |= mask;
+        seen->count++;
+    }
+}
+
+//成员的 schema: 列在 properties 中的用其 schema, 否则按 additionalProperties
+static int TinySchemaMemberNode(const TinySchemaNode* n, const TinySchemaProperty* p) {
+    return p != NULL && p->node >= 0 ? p->node : n->additional;
+}
+
+static int TinySchemaCheckValue(const TinySchema* s, int index, const TinyValue* value, TinyContext* c);
+
+//enum/const 以外的约束
+static int TinySchemaCheckShape(const TinySchema* s, const TinySchemaNode* n, const TinyValue* value, TinyContext* c) {
+    switch(TinyGetType(value)) {
+        case TINY_NULL: return TinySchemaCheckKind(n, TINY_SCHEMA_TYPE_NULL);
+        case TINY_FALSE:
+        case TINY_TRUE: return TinySchemaCheckKind(n, TINY_SCHEMA_TYPE_BOOLEAN);
+        case TINY_NUMBER: return TinySchemaCheckNumber(n, TinyGetNumber(value));
+        case TINY_STRING: return TinySchemaCheckString(n, TinyGetString(value), TinyGetStringLength(value));
+        case TINY_ARRAY: {
+            int ret = TinySchemaCheckKind(n, TINY_SCHEMA_TYPE_ARRAY);
+            if(ret != TINY_PARSE_OK || !(n->checks & TINY_SCHEMA_CHECK_ARRAY)) return ret;
+            size_t size = TinyGetArraySize(value);
+            if(size < n->minItems || size > n->maxItems) return TINY_SCHEMA_OUT_OF_RANGE;
+            if(n->items < 0) return TINY_PARSE_OK;
+            for(size_t i = 0; i < size && ret == TINY_PARSE_OK; i++) {
+                ret = TinySchemaCheckValue(s, n->items, TinyGetArrayElement(value, i), c);
+            }
+            return ret;
+        }
+        case TINY_OBJECT: {
+            int ret = TinySchemaCheckKind(n, TINY_SCHEMA_TYPE_OBJECT);
+            if(ret != TINY_PARSE_OK || !(n->checks & TINY_SCHEMA_CHECK_OBJECT)) return ret;
+            size_t size = TinyGetObjectSize(value);
+            if(size < n->minProperties || size > n->maxProperties) return TINY_SCHEMA_OUT_OF_RANGE;
+            TinySchemaSeen seen;
+            TinySchemaSeenStart(c, n, &seen);
+            for(size_t i = 0; i < size && ret == TINY_PARSE_OK; i++) {
+                const TinySchemaProperty* p = TinySchemaFindProperty(s, n, TinyGetObjectKey(value, i), TinyGetObjectKeyLength(value, i));
+                TinySchemaSeenMark(c, &seen, p);
+                int child = TinySchemaMemberNode(n, p);
+                if(child == -2) ret = TINY_SCHEMA_ADDITIONAL_PROPERTY;
+                else if(child >= 0) ret = TinySchemaCheckValue(s, child, TinyGetObjectValue(value, i), c);
+            }
+            c->top = seen.head;
+            if(ret == TINY_PARSE_OK && seen.count < n->required) ret = TINY_SCHEMA_MISSING_PROPERTY;
+            return ret;
+        }
+        default: assert(0 && "invalid type");
+    }
+    return TINY_PARSE_OK;
+}
+
+static int TinySchemaCheckValue(const TinySchema* s, int index, const TinyValue* value, TinyContext* c) {
+    const TinySchemaNode* n = &s->nodes[index];
+    if(n->checks == 0) return TINY_PARSE_OK;
+    int ret = TinySchemaCheckShape(s, n, value, c);
+    if(ret == TINY_PARSE_OK && (n->checks & TINY_SCHEMA_CHECK_ENUM)) ret = TinySchemaCheckEnum(s, n, value);
+    return ret;
+}
+
+int TinySchemaValidate(const TinySchema* schema, const TinyValue* value) {
+    assert(schema != NULL && schema->nodeCount > 0 && value != NULL);
+    TinyContext c = { NULL, NULL, 0, 0 };
+    int ret = TinySchemaCheckValue(schema, 0, value, &c);
+    free(c.stack);
+    return ret == TINY_PARSE_OK ? TINY_SCHEMA_OK : ret;
+}
+
+static int TinySchemaCheckJson(const TinySchema* s, int index, TinyBindReader* r, TinyContext* c);
+
+//enum/const 约束下的容器先找出范围, 只把这一段复制并解析成 TinyValue 再比较
+//这一段因此扫描两遍并建立临时值, 容器形式的 enum 不宜用于很大的值
+static int TinySchemaCheckSpan(const TinySchema* s, int index, TinyBindReader* r, TinyContext* c) {
+    const char* start = r->json;
+    int ret = TinyBindSkipValue(r);
+    if(ret != TINY_PARSE_OK) return ret;
+    size_t len = r->json - start;
+    size_t head = r->context.top;
+    char* buf = (char*)TinyContextPush(&r->context, len + 1);
+    memcpy(buf, start, len);
+    buf[len] = '\0';
+    TinyValue value;
+    TinyInitValue(&value);
+    ret = TinyParse(&value, buf);
+    if(ret == TINY_PARSE_OK) ret = TinySchemaCheckValue(s, index, &value, c);
+    TinyFree(&value);
+    r->context.top = head;
+    return ret;
+}
+
+static int TinySchemaCheckArrayJson(const TinySchema* s, const TinySchemaNode* n, TinyBindReader* r, TinyContext* c) {
+    int ret = TinySchemaCheckKind(n, TINY_SCHEMA_TYPE_ARRAY);
+    if(ret != TINY_PARSE_OK) return ret;
+    if(!(n->checks & TINY_SCHEMA_CHECK_ARRAY)) return TinyBindSkipValue(r);
+    bool more;
+    size_t size = 0;
+    r->json++;
+    while((ret = TinyBindNextElement(r, size, &more)) == TINY_PARSE_OK && more) {
+        //超过上限立即停止, 不读后面的元素
+        if(++size > n->maxItems) return TINY_SCHEMA_OUT_OF_RANGE;
+        ret = n->items >= 0 ? TinySchemaCheckJson(s, n->items, r, c) : TinyBindSkipValue(r);
+        if(ret != TINY_PARSE_OK) return ret;
+    }
+    if(ret == TINY_PARSE_OK && size < n->minItems) ret = TINY_SCHEMA_OUT_OF_RANGE;
+    return ret;
+}
+
+static int TinySchemaCheckObjectJson(const TinySchema* s, const TinySchemaNode* n, TinyBindReader* r, TinyContext* c) {
+    int ret = TinySchemaCheckKind(n, TINY_SCHEMA_TYPE_OBJECT);
+    if(ret != TINY_PARSE_OK) return ret;
+    if(!(n->checks & TINY_SCHEMA_CHECK_OBJECT)) return TinyBindSkipValue(r);
+    TinySchemaSeen seen;
+    size_t size = 0;
+    TinySchemaSeenStart(c, n, &seen);
+    r->json++;
+    TinyBindSkipWhiteSpace(r);
+    if(*r->json == '}') {
+        r->json++;
+    } else {
+        while(true) {
+            const char* key;
+            size_t klen;
+            if(*r->json != '"') {
+                ret = TINY_PARSE_MISS_KEY;
+                break;
+            }
+            if((ret = TinyBindReadStringRef(r, &key, &klen)) != TINY_PARSE_OK) break;
+            const TinySchemaProperty* p = TinySchemaFindProperty(s, n, key, klen);
+            TinySchemaSeenMark(c, &seen, p);
+            int child = TinySchemaMemberNode(n, p);
+            if(child == -2) ret = TINY_SCHEMA_ADDITIONAL_PROPERTY;
+            else if(++size > n->maxProperties) ret = TINY_SCHEMA_OUT_OF_RANGE;
+            if(ret != TINY_PARSE_OK) break;
+            TinyBindSkipWhiteSpace(r);
+            if(*r->json != ':') {
+                ret = TINY_PARSE_MISS_COLON;
+                break;
+            }
+            r->json++;
+            TinyBindSkipWhiteSpace(r);
+            ret = child >= 0 ? TinySchemaCheckJson(s, child, r, c) : TinyBindSkipValue(r);
+            if(ret != TINY_PARSE_OK) break;
+            TinyBindSkipWhiteSpace(r);
+            if(*r->json == '}') {
+                r->json++;
+                break;
+            }
+            if(*r->json != ',') {
+                ret = TINY_PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+                break;
+            }
+            r->json++;
+            TinyBindSkipWhiteSpace(r);
+        }
+    }
+    c->top = seen.head;
+    if(ret != TINY_PARSE_OK) return ret;
+    if(size < n->minProperties) return TINY_SCHEMA_OUT_OF_RANGE;
+    return seen.count < n->required ? TINY_SCHEMA_MISSING_PROPERTY : TINY_PARSE_OK;
+}
+
+//边读边校验: 容器类型不符时不再读入其内容
+static int TinySchemaCheckJson(const TinySchema* s, int index, TinyBindReader* r, TinyContext* c) {
+    const TinySchemaNode* n = &s->nodes[index];
+    if(n->checks == 0) return TinyBindSkipValue(r);
+    bool isEnum = (n->checks & TINY_SCHEMA_CHECK_ENUM) != 0;
+    int ret;
+    switch(*r->json) {
+        case '{': return isEnum ? TinySchemaCheckSpan(s, index, r, c) : TinySchemaCheckObjectJson(s, n, r, c);
+        case '[': return isEnum ? TinySchemaCheckSpan(s, index, r, c) : TinySchemaCheckArrayJson(s, n, r, c);
+        case '"': {
+            const char* str;
+            size_t len;
+            if((ret = TinyBindReadStringRef(r, &str, &len)) != TINY_PARSE_OK) return ret;
+            ret = TinySchemaCheckString(n, str, len);
+            if(ret == TINY_PARSE_OK && isEnum) ret = TinySchemaCheckEnumScalar(s, n, TINY_STRING, str, len, 0);
+            return ret;
+        }
+        case 't':
+        case 'f': {
+            bool flag;
+            if((ret = TinyBindReadBool(r, &flag)) != TINY_PARSE_OK) return ret;
+            ret = TinySchemaCheckKind(n, TINY_SCHEMA_TYPE_BOOLEAN);
+            if(ret == TINY_PARSE_OK && isEnum) ret = TinySchemaCheckEnumScalar(s, n, flag ? TINY_TRUE : TINY_FALSE, NULL, 0, 0);
+            return ret;
+        }
+        case 'n':
+            if(!TinyBindReadNull(r)) return TINY_PARSE_INVALID_VALUE;
+            ret = TinySchemaCheckKind(n, TINY_SCHEMA_TYPE_NULL);
+            if(ret == TINY_PARSE_OK && isEnum) ret = TinySchemaCheckEnumScalar(s, n, TINY_NULL, NULL, 0, 0);
+            return ret;
+        default: {
+            double num;
+            if((ret = TinyBindReadDouble(r, &num)) != TINY_PARSE_OK) return ret;
+            ret = TinySchemaCheckNumber(n, num);
+            if(ret == TINY_PARSE_OK && isEnum) ret = TinySchemaCheckEnumScalar(s, n, TINY_NUMBER, NULL, 0, num);
+            return ret;
+        }
+    }
+}
+
+int TinySchemaValidateJson(const TinySchema* schema, const char* json) {
+    assert(schema != NULL && schema->nodeCount > 0 && json != NULL);
+    TinyBindReader r;
+    TinyContext c = { NULL, NULL, 0, 0 };
+    TinyBindReaderInit(&r, json);
+    TinyBindSkipWhiteSpace(&r);
+    int ret = *r.json == '\0' ? TINY_PARSE_EXPECT_VALUE : TinySchemaCheckJson(schema, 0, &r, &c);
+    if(ret == TINY_PARSE_OK) {
+        TinyBindSkipWhiteSpace(&r);
+        if(*r.json != '\0') ret = TINY_PARSE_ROOT_NOT_SINGULAR;
+    }
+    TinyBindReaderFree(&r);
+    free(c.stack);
+    return ret == TINY_PARSE_OK ? TINY_SCHEMA_OK : ret;
+}
+
+//两遍: 先校验, 通过后再解析
+int TinySchemaParse(const TinySchema* schema, TinyValue* value, const char* json) {
+    assert(value != NULL);
+    int ret = TinySchemaValidateJson(schema, json);
+    if(ret != TINY_SCHEMA_OK) return ret;
+    ret = TinyParse(value, json);
+    return ret == TINY_PARSE_OK ? TINY_SCHEMA_OK : ret;
+}
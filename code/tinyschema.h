@@ -0,0 +1,74 @@
+/*
+ * @Author       : mark
+ * @Date         : 2020-05-26
+ * @copyleft Apache 2.0
+ */
+
+#ifndef TINYSCHEMA_H
+#define TINYSCHEMA_H
+
+#include "tinyjson.h"
+
+// JSON Schema 的一个子集, 编译一次后反复校验
+//
+// 支持: type(含 integer 及类型数组)、properties、required、additionalProperties(布尔或 schema)、
+//       items(单个 schema)、enum、const、minimum、maximum、exclusiveMinimum、exclusiveMaximum
+//       (数值或 draft 4 的布尔)、minLength、maxLength(按码点计)、minItems、maxItems、
+//       minProperties、maxProperties, 以及 true/false 形式的 schema
+// 不支持 pattern、$ref、allOf/anyOf/oneOf/not 等以及同时使用 enum 和 const, 遇到时编译返回 TINY_SCHEMA_INVALID;
+// title、description、default、format 等注解以及未知的关键字忽略
+//
+// 校验在第一个不满足的约束处停止, 返回对应的 TINY_SCHEMA_* 错误码
+
+// 编译后的一个 schema(子 schema 各占一个), 子 schema 以下标引用
+struct TinySchemaNode {
+    unsigned types;             /* 允许的类型 TINY_SCHEMA_TYPE_* 的组合 */
+    unsigned checks;            /* 需要检查的约束 TINY_SCHEMA_CHECK_*, 为 0 时接受任何值 */
+    double minimum, maximum;
+    size_t minLength, maxLength;
+    size_t minItems, maxItems;
+    size_t minProperties, maxProperties;
+    size_t props, propCount;    /* TinySchema::props 中的一段 */
+    size_t slots, slotMask;     /* 键哈希表在 TinySchema::slots 中的位置 */
+    size_t required;            /* required 成员的个数 */
+    size_t enums, enumCount;    /* TinySchema::enums 中的一段 */
+    int items;                  /* 数组元素的 schema, -1 表示不限 */
+    int additional;             /* 未列出成员的 schema, -1 表示不限, -2 表示禁止 */
+};
+
+struct TinySchemaProperty {
+    const char* key;            /* 指向 TinySchema::source 中的键 */
+    size_t klen;
+    uint64_t hash;
+    int node;                   /* -1 表示只出现在 required 中 */
+    size_t bit;                 /* required 成员的序号, 其余为 (size_t)-1 */
+};
+
+struct TinySchema {
+    TinySchemaNode* nodes;
+    size_t nodeCount, nodeCapacity;
+    TinySchemaProperty* props;
+    size_t propCount, propCapacity;
+    size_t* slots;              /* 各节点的开放寻址表, 存 props 下标 + 1, 0 为空 */
+    size_t slotCount, slotCapacity;
+    TinyValue* enums;           /* enum/const 的值及其哈希 */
+    uint64_t* enumHashes;
+    size_t enumCount, enumCapacity;
+    TinyValue source;           /* 与编译时的 schema 共享存储, 保证键有效 */
+};
+
+// 成功返回 TINY_SCHEMA_OK; 无论成败之后都要 TinySchemaFree
+int TinySchemaCompile(TinySchema* schema, const TinyValue* json);
+void TinySchemaFree(TinySchema* schema);
+
+// 校验已解析的值
+int TinySchemaValidate(const TinySchema* schema, const TinyValue* value);
+// 直接校验 JSON 文本, 不建立 TinyValue; 语法错误返回 TINY_PARSE_* 错误码
+// 对象、数组中 schema 不限的部分只检查语法, 不逐个校验
+// 带 enum/const 约束的对象或数组例外: 先找出其范围, 复制这一段并解析成 TinyValue 后再比较
+int TinySchemaValidateJson(const TinySchema* schema, const char* json);
+// 先校验后解析: TinySchemaValidateJson 通过后再 TinyParse, 文本扫描两遍, 校验并不在解析过程中进行
+// 合法文档的开销约为 TinyParse 加上一次 TinySchemaValidateJson; 好处是不通过时不分配任何 TinyValue, value 不变
+int TinySchemaParse(const TinySchema* schema, TinyValue* value, const char* json);
+
+#endif // TINYSCHEMA_H
@@ -0,0 +1,122 @@
+/*
+ * @Author       : mark
+ * @Date         : 2020-05-26
+ * @copyleft Apache 2.0
+ */
+
+#include "tinyshared.h"
+#include <assert.h>  /* assert() */
+#include <stdint.h>  /* uint64_t, uintptr_t */
+
+TinySharedDoc* TinySharedCreate(TinyValue* value) {
+    assert(value != NULL);
+    TinySharedDoc* doc = new TinySharedDoc;
+    doc->refs.store(1, std::memory_order_relaxed);
+    TinyInitValue(&doc->value);
+    TinyMove(&doc->value, value);
+    return doc;
+}
+
+TinySharedDoc* TinySharedRetain(TinySharedDoc* doc) {
+    assert(doc != NULL);
+    doc->refs.fetch_add(1, std::memory_order_relaxed);
+    return doc;
+}
+
+void TinySharedRelease(TinySharedDoc* doc) {
+    if(doc == NULL) return;
+    //最后一个引用: 之前各线程对文档的访问都已完成
+    if(doc->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        TinyFree(&doc->value);
+        delete doc;
+    }
+}
+
+const TinyValue* TinySharedGetValue(const TinySharedDoc* doc) {
+    assert(doc != NULL);
+    return &doc->value;
+}
+
+#define TINY_SHARED_PTR_BITS 48
+#define TINY_SHARED_PTR_MASK ((UINT64_C(1) << TINY_SHARED_PTR_BITS) - 1)
+#define TINY_SHARED_ONE_READER (UINT64_C(1) << TINY_SHARED_PTR_BITS)
+
+static inline uint64_t TinySharedPack(TinySharedDoc* doc) {
+    uint64_t bits = (uint64_t)(uintptr_t)doc;
+    //用户态指针只用低 48 位
+    assert((bits & ~TINY_SHARED_PTR_MASK) == 0);
+    return bits;
+}
+
+static inline TinySharedDoc* TinySharedUnpack(uint64_t word) {
+    return (TinySharedDoc*)(uintptr_t)(word & TINY_SHARED_PTR_MASK);
+}
+
+void TinySharedSlotInit(TinySharedSlot* slot, TinySharedDoc* doc) {
+    assert(slot != NULL);
+    slot->current.store(TinySharedPack(doc));
+    slot->version.store(0);
+}
+
+void TinySharedSlotFree(TinySharedSlot* slot) {
+    assert(slot != NULL);
+    uint64_t word = slot->current.exchange(0);
+    assert((word >> TINY_SHARED_PTR_BITS) == 0);
+    TinySharedRelease(TinySharedUnpack(word));
+}
+
+void TinySharedPublish(TinySharedSlot* slot, TinySharedDoc* doc) {
+    assert(slot != NULL);
+    uint64_t word = slot->current.exchange(TinySharedPack(doc), std::memory_order_acq_rel);
+    slot->version.fetch_add(1, std::memory_order_release);
+    TinySharedDoc* old = TinySharedUnpack(word);
+    if(old == NULL) return;
+    //替换时还没归还的读者: 转成 refs 上的引用, 由读者自己释放
+    size_t pending = (size_t)(word >> TINY_SHARED_PTR_BITS);
+    if(pending != 0) old->refs.fetch_add(pending, std::memory_order_relaxed);
+    TinySharedRelease(old);
+}
+
+TinySharedDoc* TinySharedAcquire(TinySharedSlot* slot) {
+    assert(slot != NULL);
+    //先在发布点上登记, 写者替换前旧文档不会被释放
+    uint64_t word = slot->current.fetch_add(TINY_SHARED_ONE_READER, std::memory_order_acquire);
+    assert((word >> TINY_SHARED_PTR_BITS) < 0xFFFF);
+    TinySharedDoc* doc = TinySharedUnpack(word);
+    if(doc != NULL) TinySharedRetain(doc);
+    //归还登记; 指针已被替换说明登记已转入 refs, 改为释放一个引用
+    word += TINY_SHARED_ONE_READER;
+    while(TinySharedUnpack(word) == doc && (word >> TINY_SHARED_PTR_BITS) != 0) {
+        if(slot->current.compare_exchange_weak(word, word - TINY_SHARED_ONE_READER,
+                                               std::memory_order_release, std::memory_order_relaxed)) {
+            return doc;
+        }
+    }
+    if(doc != NULL) doc->refs.fetch_sub(1, std::memory_order_relaxed);
+    return doc;
+}
+
+void TinySharedReaderInit(TinySharedReader* reader, TinySharedSlot* slot) {
+    assert(reader != NULL && slot != NULL);
+    reader->slot = slot;
+    reader->version = slot->version.load(std::memory_order_acquire);
+    reader->doc = TinySharedAcquire(slot);
+}
+
+void TinySharedReaderFree(TinySharedReader* reader) {
+    assert(reader != NULL);
+    TinySharedRelease(reader->doc);
+    reader->doc = NULL;
+}
+
+const TinyValue* TinySharedRead(TinySharedReader* reader) {
+    assert(reader != NULL);
+    uint64_t version = reader->slot->version.load(std::memory_order_acquire);
+    if(version != reader->version) {
+        //先记版本再取文档, 取到的文档不会比该版本旧
+        TinySharedRelease(reader->doc);
+        reader->doc = TinySharedAcquire(reader->slot);
+        reader->version = version;
+    }
+    return reader->doc == NULL ? NULL : &reader->doc->value;
+}
@@ -0,0 +1,53 @@
+/*
+ * @Author       : mark
+ * @Date         : 2020-05-26
+ * @copyleft Apache 2.0
+ */
+
+#ifndef TINYSHARED_H
+#define TINYSHARED_H
+
+#include "tinyjson.h"
+#include <atomic>
+
+// 只读共享文档: 引用计数, 可被多个线程同时读取
+// 文档创建后不能再修改, 最后一个引用释放时回收
+struct TinySharedDoc {
+    std::atomic<size_t> refs;
+    TinyValue value;
+};
+
+// 发布点: 写者原子地替换当前文档(RCU 风格), 读者无需加锁, 写者无需等待
+// 分离引用计数: 低 48 位是文档指针, 高 16 位是正在取引用的读者数,
+// 替换时写者把旧文档上的读者数转入 refs, 读者再各自归还
+struct TinySharedSlot {
+    std::atomic<uint64_t> current;         /* 发布点持有一个引用 */
+    std::atomic<uint64_t> version;         /* 每次发布加一 */
+};
+
+// 读者在本线程缓存的引用, 版本未变时读取不做任何原子读改写
+struct TinySharedReader {
+    TinySharedSlot* slot;
+    TinySharedDoc* doc;
+    uint64_t version;
+};
+
+// 接管 value 的内容, value 变为 TINY_NULL, 返回的文档引用数为 1
+TinySharedDoc* TinySharedCreate(TinyValue* value);
+TinySharedDoc* TinySharedRetain(TinySharedDoc* doc);
+void TinySharedRelease(TinySharedDoc* doc);
+const TinyValue* TinySharedGetValue(const TinySharedDoc* doc);
+
+// Init/Publish 接管调用者对 doc 的引用, doc 可以为 NULL
+void TinySharedSlotInit(TinySharedSlot* slot, TinySharedDoc* doc);
+void TinySharedSlotFree(TinySharedSlot* slot);
+void TinySharedPublish(TinySharedSlot* slot, TinySharedDoc* doc);
+// 返回当前文档的一个新引用, 用完后 TinySharedRelease
+TinySharedDoc* TinySharedAcquire(TinySharedSlot* slot);
+
+void TinySharedReaderInit(TinySharedReader* reader, TinySharedSlot* slot);
+void TinySharedReaderFree(TinySharedReader* reader);
+// 返回最新发布的文档, 在下一次 TinySharedRead 或 TinySharedReaderFree 之前有效
+const TinyValue* TinySharedRead(TinySharedReader* reader);
+
+#endif // TINYSHARED_H
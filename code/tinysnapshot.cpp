@@ -0,0 +1,397 @@
+/*
+ * @Author       : mark
+ * @Date         : 2020-05-26
+ * @copyleft Apache 2.0
+ */
+
+#include "tinysnapshot.h"
+#include "tinycontext.h"
+#include <assert.h>     /* assert() */
+#include <stdio.h>      /* fopen(), fwrite() */
+#include <stdlib.h>     /* malloc(), free() */
+#include <string.h>     /* memcpy(), memcmp() */
+#include <algorithm>    /* std::sort() */
+
+#if TINY_HAS_POSIX
+#include <fcntl.h>      /* open() */
+#include <sys/mman.h>   /* mmap() */
+#include <sys/stat.h>   /* fstat() */
+#include <unistd.h>     /* close() */
+#endif
+
+static const char TINY_SNAPSHOT_MAGIC[8] = { 'T', 'I', 'N', 'Y', 'S', 'N', 'A', 'P' };
+static const uint32_t TINY_SNAPSHOT_BYTE_ORDER = 0x01020304;
+
+static uint64_t TinySnapMix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+//按 8 字节处理的校验和, 映像总是 8 字节对齐
+static uint64_t TinySnapChecksum(const char* data, size_t len) {
+    uint64_t h = len * 0x9e3779b97f4a7c15ULL;
+    uint64_t w;
+    size_t i = 0;
+    for(; i + 8 <= len; i += 8) {
+        memcpy(&w, data + i, 8);
+        h ^= w * 0x87c37b91114253d5ULL;
+        h = ((h << 31) | (h >> 33)) * 0x4cf5ad432745937fULL;
+    }
+    if(i < len) {
+        w = 0;
+        memcpy(&w, data + i, len - i);
+        h ^= w * 0x87c37b91114253d5ULL;
+    }
+    return TinySnapMix(h);
+}
+
+/* ------------------------------------------------------------------ */
+/* 保存                                                               */
+/* ------------------------------------------------------------------ */
+
+//在映像末尾分配 8 字节对齐且清零的空间, 返回其位置
+//映像可能被 realloc, 所以构建期间只记位置不记指针
+static size_t TinySnapAlloc(TinyContext* c, size_t bytes) {
+    size_t pad = (8 - (c->top & 7)) & 7;
+    size_t pos = c->top + pad;
+    if(pad + bytes == 0) return pos;
+    memset(TinyContextPush(c, pad + bytes), 0, pad + bytes);
+    return pos;
+}
+
+static size_t TinySnapPutBytes(TinyContext* c, const char* str, size_t len) {
+    size_t pos = TinySnapAlloc(c, len + 1);
+    if(len > 0) memcpy(c->stack + pos, str, len);
+    return pos;
+}
+
+static void TinySnapSetNode(TinyContext* c, size_t pos, uint64_t tag, uint64_t payload) {
+    TinySnapValue node;
+    node.tag = tag;
+    node.payload = payload;
+    memcpy(c->stack + pos, &node, sizeof(node));
+}
+
+//写入 pos 处的节点及其内容, 内容总在节点之后, 偏移均为正数
+static void TinySnapWriteValue(TinyContext* c, size_t pos, const TinyValue* value) {
+    TinyType type = TinyGetType(value);
+    switch(type) {
+        case TINY_NUMBER:
+        {
+            double d = TinyGetNumber(value);
+            uint64_t bits;
+            memcpy(&bits, &d, sizeof(bits));
+            TinySnapSetNode(c, pos, type, bits);
+            break;
+        }
+        case TINY_STRING:
+        {
+            size_t len = TinyGetStringLength(value);
+            size_t str = TinySnapPutBytes(c, TinyGetString(value), len);
+            TinySnapSetNode(c, pos, type | ((uint64_t)len << 8), str - pos);
+            break;
+        }
+        case TINY_ARRAY:
+        {
+            size_t n = TinyGetArraySize(value);
+            size_t elements = TinySnapAlloc(c, n * sizeof(TinySnapValue));
+            TinySnapSetNode(c, pos, type | ((uint64_t)n << 8), elements - pos);
+            for(size_t i = 0; i < n; i++) {
+                TinySnapWriteValue(c, elements + i * sizeof(TinySnapValue), TinyGetArrayElement(value, i));
+            }
+            break;
+        }
+        case TINY_OBJECT:
+        {
+            size_t n = TinyGetObjectSize(value);
+            size_t members = TinySnapAlloc(c, n * sizeof(TinySnapMember));
+            size_t index = TinySnapAlloc(c, n * sizeof(uint64_t));
+            TinySnapSetNode(c, pos, type | ((uint64_t)n << 8), members - pos);
+
+            //成员之后是按 (键, 下标) 排序的下标数组
+            uint64_t* order = (uint64_t*)malloc(n * sizeof(uint64_t) + 1);
+            for(size_t i = 0; i < n; i++) order[i] = i;
+            std::sort(order, order + n, [value](uint64_t a, uint64_t b) {
+                size_t alen = TinyGetObjectKeyLength(value, a), blen = TinyGetObjectKeyLength(value, b);
+                int cmp = memcmp(TinyGetObjectKey(value, a), TinyGetObjectKey(value, b), alen < blen ? alen : blen);
+                if(cmp != 0) return cmp < 0;
+                if(alen != blen) return alen < blen;
+                return a < b;
+            });
+            memcpy(c->stack + index, order, n * sizeof(uint64_t));
+            free(order);
+
+            for(size_t i = 0; i < n; i++) {
+                size_t m = members + i * sizeof(TinySnapMember);
+                size_t klen = TinyGetObjectKeyLength(value, i);
+                uint64_t key = TinySnapPutBytes(c, TinyGetObjectKey(value, i), klen) - m;
+                uint64_t kLen = klen;
+                memcpy(c->stack + m + offsetof(TinySnapMember, key), &key, sizeof(key));
+                memcpy(c->stack + m + offsetof(TinySnapMember, kLen), &kLen, sizeof(kLen));
+                TinySnapWriteValue(c, m + offsetof(TinySnapMember, value), TinyGetObjectValue(value, i));
+            }
+            break;
+        }
+        default:
+            TinySnapSetNode(c, pos, type, 0);
+            break;
+    }
+}
+
+int TinySaveSnapshot(const TinyValue* value, const char* path) {
+    TinyContext c;
+    TinySnapshotHeader header;
+    assert(value != NULL && path != NULL);
+    c.stack = NULL;
+    c.size = c.top = 0;
+    TinySnapAlloc(&c, sizeof(header));
+    size_t root = TinySnapAlloc(&c, sizeof(TinySnapValue));
+    TinySnapWriteValue(&c, root, value);
+    TinySnapAlloc(&c, 0);
+
+    memcpy(header.magic, TINY_SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = TINY_SNAPSHOT_VERSION;
+    header.byteOrder = TINY_SNAPSHOT_BYTE_ORDER;
+    header.size = c.top;
+    header.checksum = TinySnapChecksum(c.stack + sizeof(header), c.top - sizeof(header));
+    memcpy(c.stack, &header, sizeof(header));
+
+    int ret = TINY_SNAPSHOT_OK;
+    FILE* fp = fopen(path, "wb");
+    if(fp == NULL) {
+        ret = TINY_SNAPSHOT_IO_ERROR;
+    } else {
+        if(fwrite(c.stack, 1, c.top, fp) != c.top) ret = TINY_SNAPSHOT_IO_ERROR;
+        if(fclose(fp) != 0) ret = TINY_SNAPSHOT_IO_ERROR;
+    }
+    free(c.stack);
+    return ret;
+}
+
+/* ------------------------------------------------------------------ */
+/* 加载                                                               */
+/* ------------------------------------------------------------------ */
+
+static int TinySnapVerify(const char* base, size_t size) {
+    TinySnapshotHeader header;
+    if(size < sizeof(header) + sizeof(TinySnapValue)) return TINY_SNAPSHOT_INVALID_FORMAT;
+    memcpy(&header, base, sizeof(header));
+    if(memcmp(header.magic, TINY_SNAPSHOT_MAGIC, sizeof(header.magic)) != 0
+        || header.version != TINY_SNAPSHOT_VERSION
+        || header.byteOrder != TINY_SNAPSHOT_BYTE_ORDER
+        || header.size != size) {
+        return TINY_SNAPSHOT_INVALID_FORMAT;
+    }
+    if(header.checksum != TinySnapChecksum(base + sizeof(header), size - sizeof(header))) {
+        return TINY_SNAPSHOT_CHECKSUM_MISMATCH;
+    }
+    return TINY_SNAPSHOT_OK;
+}
+
+int TinyLoadSnapshot(TinySnapshot* snapshot, const char* path) {
+    assert(snapshot != NULL && path != NULL);
+    snapshot->base = NULL;
+    snapshot->size = 0;
+    snapshot->mapped = false;
+#if TINY_HAS_POSIX
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) return TINY_SNAPSHOT_IO_ERROR;
+    struct stat st;
+    if(fstat(fd, &st) != 0) {
+        close(fd);
+        return TINY_SNAPSHOT_IO_ERROR;
+    }
+    if((size_t)st.st_size < sizeof(TinySnapshotHeader)) {
+        close(fd);
+        return TINY_SNAPSHOT_INVALID_FORMAT;
+    }
+    void* base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(base == MAP_FAILED) return TINY_SNAPSHOT_IO_ERROR;
+    snapshot->base = (const char*)base;
+    snapshot->size = st.st_size;
+    snapshot->mapped = true;
+#else
+    FILE* fp = fopen(path, "rb");
+    if(fp == NULL) return TINY_SNAPSHOT_IO_ERROR;
+    long size = -1;
+    if(fseek(fp, 0, SEEK_END) == 0) size = ftell(fp);
+    if(size < 0 || fseek(fp, 0, SEEK_SET) != 0) {
+        fclose(fp);
+        return TINY_SNAPSHOT_IO_ERROR;
+    }
+    char* base = (char*)malloc(size + 1);
+    if(fread(base, 1, size, fp) != (size_t)size) {
+        free(base);
+        fclose(fp);
+        return TINY_SNAPSHOT_IO_ERROR;
+    }
+    fclose(fp);
+    snapshot->base = base;
+    snapshot->size = size;
+#endif
+    int ret = TinySnapVerify(snapshot->base, snapshot->size);
+    if(ret != TINY_SNAPSHOT_OK) TinyFreeSnapshot(snapshot);
+    return ret;
+}
+
+void TinyFreeSnapshot(TinySnapshot* snapshot) {
+    assert(snapshot != NULL);
+    if(snapshot->base != NULL) {
+#if TINY_HAS_POSIX
+        if(snapshot->mapped) munmap((void*)snapshot->base, snapshot->size);
+        else
+#endif
+        free((void*)snapshot->base);
+    }
+    snapshot->base = NULL;
+    snapshot->size = 0;
+    snapshot->mapped = false;
+}
+
+const TinySnapValue* TinySnapshotRoot(const TinySnapshot* snapshot) {
+    assert(snapshot != NULL && snapshot->base != NULL);
+    return (const TinySnapValue*)(snapshot->base + sizeof(TinySnapshotHeader));
+}
+
+/* ------------------------------------------------------------------ */
+/* 访问                                                               */
+/* ------------------------------------------------------------------ */
+
+static inline const char* TinySnapTarget(const void* from, uint64_t offset) {
+    return (const char*)from + offset;
+}
+
+static inline size_t TinySnapCount(const TinySnapValue* value) {
+    return (size_t)(value->tag >> 8);
+}
+
+static inline const TinySnapMember* TinySnapMembers(const TinySnapValue* value) {
+    return (const TinySnapMember*)TinySnapTarget(value, value->payload);
+}
+
+TinyType TinySnapGetType(const TinySnapValue* value) {
+    assert(value != NULL);
+    return (TinyType)(value->tag & 0xFF);
+}
+
+bool TinySnapGetBoolean(const TinySnapValue* value) {
+    assert(value != NULL && (TinySnapGetType(value) == TINY_TRUE || TinySnapGetType(value) == TINY_FALSE));
+    return TinySnapGetType(value) == TINY_TRUE;
+}
+
+double TinySnapGetNumber(const TinySnapValue* value) {
+    assert(value != NULL && TinySnapGetType(value) == TINY_NUMBER);
+    double d;
+    memcpy(&d, &value->payload, sizeof(d));
+    return d;
+}
+
+const char* TinySnapGetString(const TinySnapValue* value) {
+    assert(value != NULL && TinySnapGetType(value) == TINY_STRING);
+    return TinySnapTarget(value, value->payload);
+}
+
+size_t TinySnapGetStringLength(const TinySnapValue* value) {
+    assert(value != NULL && TinySnapGetType(value) == TINY_STRING);
+    return TinySnapCount(value);
+}
+
+size_t TinySnapGetArraySize(const TinySnapValue* value) {
+    assert(value != NULL && TinySnapGetType(value) == TINY_ARRAY);
+    return TinySnapCount(value);
+}
+
+const TinySnapValue* TinySnapGetArrayElement(const TinySnapValue* value, size_t index) {
+    assert(value != NULL && TinySnapGetType(value) == TINY_ARRAY);
+    assert(index < TinySnapCount(value));
+    return (const TinySnapValue*)TinySnapTarget(value, value->payload) + index;
+}
+
+size_t TinySnapGetObjectSize(const TinySnapValue* value) {
+    assert(value != NULL && TinySnapGetType(value) == TINY_OBJECT);
+    return TinySnapCount(value);
+}
+
+const char* TinySnapGetObjectKey(const TinySnapValue* value, size_t index) {
+    assert(value != NULL && TinySnapGetType(value) == TINY_OBJECT);
+    assert(index < TinySnapCount(value));
+    const TinySnapMember* m = TinySnapMembers(value) + index;
+    return TinySnapTarget(m, m->key);
+}
+
+size_t TinySnapGetObjectKeyLength(const TinySnapValue* value, size_t index) {
+    assert(value != NULL && TinySnapGetType(value) == TINY_OBJECT);
+    assert(index < TinySnapCount(value));
+    return (size_t)TinySnapMembers(value)[index].kLen;
+}
+
+const TinySnapValue* TinySnapGetObjectValue(const TinySnapValue* value, size_t index) {
+    assert(value != NULL && TinySnapGetType(value) == TINY_OBJECT);
+    assert(index < TinySnapCount(value));
+    return &TinySnapMembers(value)[index].value;
+}
+
+size_t TinySnapFindObjectIndex(const TinySnapValue* value, const char* key, size_t klen) {
+    assert(value != NULL && TinySnapGetType(value) == TINY_OBJECT && key != NULL);
+    size_t n = TinySnapCount(value);
+    const TinySnapMember* members = TinySnapMembers(value);
+    const uint64_t* order = (const uint64_t*)(members + n);
+    //lower_bound: 第一个不小于 key 的成员
+    size_t lo = 0, hi = n;
+    while(lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        const TinySnapMember* m = members + order[mid];
+        size_t mlen = (size_t)m->kLen;
+        int cmp = memcmp(TinySnapTarget(m, m->key), key, mlen < klen ? mlen : klen);
+        if(cmp < 0 || (cmp == 0 && mlen < klen)) lo = mid + 1;
+        else hi = mid;
+    }
+    if(lo < n) {
+        const TinySnapMember* m = members + order[lo];
+        if(m->kLen == klen && memcmp(TinySnapTarget(m, m->key), key, klen) == 0) {
+            return (size_t)order[lo];
+        }
+    }
+    return TINY_KEY_NOT_EXIST;
+}
+
+const TinySnapValue* TinySnapFindObjectValue(const TinySnapValue* value, const char* key, size_t klen) {
+    size_t index = TinySnapFindObjectIndex(value, key, klen);
+    if(index == TINY_KEY_NOT_EXIST) return NULL;
+    return TinySnapGetObjectValue(value, index);
+}
+
+void TinySnapCopy(TinyValue* dst, const TinySnapValue* src) {
+    assert(dst != NULL && src != NULL);
+    switch(TinySnapGetType(src)) {
+        case TINY_NULL: TinySetNull(dst); break;
+        case TINY_FALSE: TinySetBoolen(dst, false); break;
+        case TINY_TRUE: TinySetBoolen(dst, true); break;
+        case TINY_NUMBER: TinySetNumber(dst, TinySnapGetNumber(src)); break;
+        case TINY_STRING: TinySetString(dst, TinySnapGetString(src), TinySnapGetStringLength(src)); break;
+        case TINY_ARRAY:
+        {
+            size_t n = TinySnapGetArraySize(src);
+            TinySetArray(dst, n);
+            for(size_t i = 0; i < n; i++) {
+                TinySnapCopy(TinyPushBackArrayElement(dst), TinySnapGetArrayElement(src, i));
+            }
+            break;
+        }
+        case TINY_OBJECT:
+        {
+            size_t n = TinySnapGetObjectSize(src);
+            TinySetObject(dst, n);
+            for(size_t i = 0; i < n; i++) {
+                TinyValue* m = TinyPushBackObjectValue(dst, TinySnapGetObjectKey(src, i), TinySnapGetObjectKeyLength(src, i));
+                TinySnapCopy(m, TinySnapGetObjectValue(src, i));
+            }
+            break;
+        }
+    }
+}
@@ -0,0 +1,74 @@
+/*
+ * @Author       : mark
+ * @Date         : 2020-05-26
+ * @copyleft Apache 2.0
+ */
+
+#ifndef TINYSNAPSHOT_H
+#define TINYSNAPSHOT_H
+
+#include "tinyjson.h"
+
+// 快照: TinyValue 的二进制映像, 以相对偏移代替指针, 加载时 mmap 后直接访问, 不需要解析
+//
+// 文件布局(主机字节序, 8 字节对齐):
+//   TinySnapshotHeader
+//   TinySnapValue            根值
+//   ...                      字符串内容、数组元素、对象成员及其按键排序的索引
+//
+// 每个偏移都相对于保存它的结构本身的地址, 所以映像可以映射到任意地址
+const uint32_t TINY_SNAPSHOT_VERSION = 1;
+
+struct TinySnapshotHeader {
+    char magic[8];          /* "TINYSNAP" */
+    uint32_t version;
+    uint32_t byteOrder;     /* 0x01020304, 用于识别字节序不同的机器生成的文件 */
+    uint64_t size;          /* 整个文件的字节数 */
+    uint64_t checksum;      /* 头部之后全部内容的校验和 */
+};
+
+struct TinySnapValue {
+    uint64_t tag;           /* 低 8 位为 TinyType, 其余为字符串长度或元素个数 */
+    uint64_t payload;       /* number 的位模式, 或内容相对本结构的偏移 */
+};
+
+struct TinySnapMember {
+    uint64_t key;           /* 键(以 '\0' 结尾)相对本结构的偏移 */
+    uint64_t kLen;
+    TinySnapValue value;
+};
+
+struct TinySnapshot {
+    const char* base;
+    size_t size;
+    bool mapped;            /* base 来自 mmap, 否则来自 malloc */
+};
+
+int TinySaveSnapshot(const TinyValue* value, const char* path);
+// 成功返回 TINY_SNAPSHOT_OK, 校验和覆盖整个映像, 通过后不再检查其中的偏移
+int TinyLoadSnapshot(TinySnapshot* snapshot, const char* path);
+void TinyFreeSnapshot(TinySnapshot* snapshot);
+const TinySnapValue* TinySnapshotRoot(const TinySnapshot* snapshot);
+
+// 只读访问, 与 TinyGet* / TinyFind* 一一对应
+TinyType TinySnapGetType(const TinySnapValue* value);
+bool TinySnapGetBoolean(const TinySnapValue* value);
+double TinySnapGetNumber(const TinySnapValue* value);
+const char* TinySnapGetString(const TinySnapValue* value);
+size_t TinySnapGetStringLength(const TinySnapValue* value);
+
+size_t TinySnapGetArraySize(const TinySnapValue* value);
+const TinySnapValue* TinySnapGetArrayElement(const TinySnapValue* value, size_t index);
+
+size_t TinySnapGetObjectSize(const TinySnapValue* value);
+const char* TinySnapGetObjectKey(const TinySnapValue* value, size_t index);
+size_t TinySnapGetObjectKeyLength(const TinySnapValue* value, size_t index);
+const TinySnapValue* TinySnapGetObjectValue(const TinySnapValue* value, size_t index);
+// 二分查找按键排序的索引, 键重复时返回下标最小的成员
+size_t TinySnapFindObjectIndex(const TinySnapValue* value, const char* key, size_t klen);
+const TinySnapValue* TinySnapFindObjectValue(const TinySnapValue* value, const char* key, size_t klen);
+
+// 把快照中的值复制成普通的 TinyValue
+void TinySnapCopy(TinyValue* dst, const TinySnapValue* src);
+
+#endif // TINYSNAPSHOT_H
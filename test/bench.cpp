@@ -0,0 +1,1479 @@
+/*
+ * @Author       : mark
+ * @Date         : 2020-05-26
+ * @copyleft Apache 2.0
+ */ 
+
+/*
+ * ./bench [--json FILE] [NAME...]
+ *   NAME      只运行名字中含有 NAME 的分组, 如 ./bench Corpus Diff
+ *   --json    另外把每个结果作为一行 JSON 写入 FILE, 便于比较不同构建
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "../code/tinyjson.h"
+#include "../code/tinybinary.h"
+#include "../code/tinysnapshot.h"
+#include "../code/tinyshared.h"
+#include "../code/tinypatch.h"
+#include "../code/tinybind.h"
+#include "../code/tinyschema.h"
+#include "../code/tinypath.h"
+#include "../code/tinyreclaim.h"
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+/* count heap allocations by interposing malloc/calloc/realloc (glibc only) */
+static std::atomic<size_t> allocations(0);
+#if defined(__GLIBC__)
+#define BENCH_COUNT_ALLOCS 1
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t n, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* malloc(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+void* calloc(size_t n, size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(n, size);
+}
+void* realloc(void* ptr, size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+}
+}
+#else
+#define BENCH_COUNT_ALLOCS 0
+#endif
+
+static double NowNs() {
+    using namespace std::chrono;
+    return (double)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+static FILE* report = NULL;
+
+/* bytes/allocs < 0: not measured */
+static void BenchReport(const char* name, double ns, double bytes, double allocs) {
+    printf("%-40s %12.0f ns/op", name, ns);
+    if(bytes >= 0) printf(" %8.1f MB/s", bytes / ns * 1e3);
+    if(allocs >= 0 && BENCH_COUNT_ALLOCS) printf(" %10.1f allocs/op", allocs);
+    printf("\n");
+    if(report == NULL) return;
+    TinyWriter w;
+    size_t len;
+    TinyWriterInit(&w);
+    TinyWriterStartObject(&w);
+    TinyWriterKey(&w, "name", 4);
+    TinyWriterString(&w, name, strlen(name));
+    TinyWriterKey(&w, "ns_per_op", 9);
+    TinyWriterNumber(&w, ns);
+    if(bytes >= 0) {
+        TinyWriterKey(&w, "bytes_per_op", 12);
+        TinyWriterNumber(&w, bytes);
+        TinyWriterKey(&w, "mb_per_s", 8);
+        TinyWriterNumber(&w, bytes / ns * 1e3);
+    }
+    if(allocs >= 0 && BENCH_COUNT_ALLOCS) {
+        TinyWriterKey(&w, "allocs_per_op", 13);
+        TinyWriterNumber(&w, allocs);
+    }
+    TinyWriterEndObject(&w);
+    fprintf(report, "%s\n", TinyWriterGetString(&w, &len));
+    TinyWriterFree(&w);
+}
+
+#define BENCH(name, reps, stmt) \
+    do {\
+        stmt;\
+        size_t allocs = allocations.load();\
+        double start = NowNs();\
+        for(int r = 0; r < (reps); r++) { stmt; }\
+        double ns = NowNs() - start;\
+        BenchReport(name, ns / (reps), -1, (double)(allocations.load() - allocs) / (reps));\
+    } while(0)
+
+static volatile uint64_t sink;
+
+/* {"key-0":{"id":0,"tags":["a","b"]}, ...} in the given member order */
+static void MakeLargeObject(TinyValue* o, size_t n, bool reversed) {
+    char* json = (char*)malloc(n * 64 + 2);
+    char* p = json;
+    *p++ = '{';
+    for(size_t i = 0; i < n; i++) {
+        size_t k = reversed ? n - 1 - i : i;
+        p += sprintf(p, "%s\"key-%zu\":{\"id\":%zu,\"tags\":[\"a\",\"b\"]}", i ? "," : "", k, k);
+    }
+    *p++ = '}';
+    *p = '\0';
+    TinyParse(o, json);
+    free(json);
+}
+
+static void BenchEqual() {
+    const size_t sizes[] = { 1000, 10000, 100000 };
+    for(size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        TinyValue a, b, c;
+        char name[64];
+        MakeLargeObject(&a, sizes[s], false);
+        MakeLargeObject(&b, sizes[s], false);
+        MakeLargeObject(&c, sizes[s], true);
+        int reps = (int)(1000000 / sizes[s]);
+
+        snprintf(name, sizeof(name), "hash/%zu", sizes[s]);
+        BENCH(name, reps, sink = TinyHash(&a));
+        snprintf(name, sizeof(name), "equal-same-order/%zu", sizes[s]);
+        BENCH(name, reps, sink = TinyIsEqual(&a, &b));
+        snprintf(name, sizeof(name), "equal-reversed/%zu", sizes[s]);
+        BENCH(name, reps, sink = TinyIsEqual(&a, &c));
+        TinyHashMemo(&a);
+        TinyHashMemo(&c);
+        TinySetNumber(TinySetObjectValue(TinySetObjectValue(&c, "key-0", 5), "id", 2), -1);
+        TinyHashMemo(&c);
+        snprintf(name, sizeof(name), "not-equal-memoized/%zu", sizes[s]);
+        BENCH(name, reps, sink = TinyIsEqual(&a, &c));
+
+        TinyFree(&a);
+        TinyFree(&b);
+        TinyFree(&c);
+    }
+}
+
+static void MakeNumberArray(TinyValue* a, size_t n) {
+    unsigned long long seed = 88172645463325252ULL;
+    TinySetArray(a, n);
+    for(size_t i = 0; i < n; i++) {
+        double d;
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        switch(i % 3) {
+            case 0: d = (double)(seed % 1000000); break;                /* integers */
+            case 1: d = (double)(seed % 100000) / 100.0; break;         /* prices */
+            default: d = (double)(seed >> 11) / 9007199254740992.0 * 360.0 - 180.0; break; /* coordinates */
+        }
+        TinySetNumber(TinyPushBackArrayElement(a), d);
+    }
+}
+
+static void BenchStringifyNumbers() {
+    TinyValue a;
+    size_t len = 0;
+    char buff[32];
+    TinyInitValue(&a);
+    MakeNumberArray(&a, 100000);
+    double start = NowNs();
+    for(int r = 0; r < 20; r++) {
+        free(TinyStringify(&a, &len));
+    }
+    double ns = (NowNs() - start) / 20;
+    BenchReport("stringify-numbers/100000", ns, len, -1);
+
+    size_t total = 0;
+    start = NowNs();
+    for(int r = 0; r < 20; r++) {
+        total = 0;
+        for(size_t i = 0; i < 100000; i++) {
+            total += sprintf(buff, "%.17g", TinyGetNumber(TinyGetArrayElement(&a, i))) + 1;
+        }
+    }
+    ns = (NowNs() - start) / 20;
+    BenchReport("sprintf-%.17g-numbers/100000", ns, total, -1);
+    TinyFree(&a);
+}
+
+/* parse -> change one field -> stringify on number-heavy records, default vs lazy numbers */
+static void BenchLazyNumber() {
+    const int n = 50000, reps = 10;
+    std::string json = "[";
+    char buf[256];
+    for(int i = 0; i < n; i++) {
+        snprintf(buf, sizeof(buf), "%s{\"id\":%d,\"price\":%d.%02d,\"lat\":%.15f,\"lon\":%.15f,\"qty\":[%d,%d,%d]}",
+                 i ? "," : "", 1000000 + i, i % 1000, i % 100, 37.0 + i * 1e-6, -122.0 - i * 1e-6, i % 7, i % 11, i % 13);
+        json += buf;
+    }
+    json += "]";
+    const unsigned flags[] = { TINY_PARSE_FLAG_DEFAULT, TINY_PARSE_FLAG_LAZY_NUMBER };
+    const char* names[] = { "default", "lazy" };
+    for(int f = 0; f < 2; f++) {
+        TinyValue doc;
+        size_t len = 0;
+        char name[64];
+        TinyInitValue(&doc);
+        double parse = 0, total = 0;
+        for(int r = 0; r < reps; r++) {
+            double start = NowNs();
+            TinyParseWithFlags(&doc, json.c_str(), flags[f]);
+            parse += NowNs() - start;
+            TinySetNumber(TinySetObjectValue(TinySetArrayElement(&doc, 0), "qty", 3), r);
+            free(TinyStringify(&doc, &len));
+            total += NowNs() - start;
+            TinyFree(&doc);
+        }
+        snprintf(name, sizeof(name), "parse/%s", names[f]);
+        BenchReport(name, parse / reps, json.size(), -1);
+        snprintf(name, sizeof(name), "parse-tweak-stringify/%s", names[f]);
+        BenchReport(name, total / reps, json.size(), -1);
+    }
+    TinyValue doc;
+    size_t len;
+    TinyInitValue(&doc);
+    TinyParseWithFlags(&doc, json.c_str(), TINY_PARSE_FLAG_LAZY_NUMBER);
+    char* out = TinyStringify(&doc, &len);
+    printf("  lazy round trip identical to input: %s\n", len == json.size() && memcmp(out, json.c_str(), len) == 0 ? "yes" : "no");
+    free(out);
+    TinyFree(&doc);
+}
+
+static void BenchStringifyStrings() {
+    const size_t n = 50000;
+    TinyValue doc;
+    size_t len = 0;
+    char* big = (char*)malloc(1 << 20);
+    TinyInitValue(&doc);
+    TinySetArray(&doc, n + 1);
+    for(size_t i = 0; i < n; i++) {
+        TinyValue* o = TinyPushBackArrayElement(&doc);
+        char text[64];
+        int tlen = snprintf(text, sizeof(text), "user %zu wrote a \"short\" status update", i);
+        TinySetObject(o, 4);
+        TinySetString(TinySetObjectValue(o, "screen_name", 11), text, 8);
+        TinySetString(TinySetObjectValue(o, "text", 4), text, tlen);
+        TinySetString(TinySetObjectValue(o, "lang", 4), "en", 2);
+        TinySetString(TinySetObjectValue(o, "source", 6), "web client for desktop browsers", 31);
+    }
+    /* 1 MB of text with an escape every ~100 bytes */
+    for(size_t i = 0; i < (1 << 20); i++) big[i] = (i % 97 == 0) ? '\n' : (char)('a' + i % 26);
+    TinySetString(TinyPushBackArrayElement(&doc), big, 1 << 20);
+
+    double start = NowNs();
+    for(int r = 0; r < 20; r++) {
+        free(TinyStringify(&doc, &len));
+    }
+    double ns = (NowNs() - start) / 20;
+    BenchReport("stringify-strings", ns, len, -1);
+
+    TinyValue str;
+    TinyInitValue(&str);
+    TinyMove(&str, TinySetArrayElement(&doc, n));
+    start = NowNs();
+    for(int r = 0; r < 20; r++) {
+        free(TinyStringify(&str, &len));
+    }
+    ns = (NowNs() - start) / 20;
+    BenchReport("stringify-1mb-string", ns, len, -1);
+    TinyFree(&str);
+    free(big);
+    TinyFree(&doc);
+}
+
+/* the same 10k-record response built through the DOM and through TinyWriter */
+static void BenchWriter() {
+    const int n = 10000;
+    size_t len = 0;
+    double start = NowNs();
+    for(int r = 0; r < 20; r++) {
+        TinyValue doc;
+        TinyInitValue(&doc);
+        TinySetArray(&doc, 0);
+        for(int i = 0; i < n; i++) {
+            TinyValue* o = TinyPushBackArrayElement(&doc);
+            TinySetObject(o, 0);
+            TinySetNumber(TinySetObjectValue(o, "id", 2), i);
+            TinySetString(TinySetObjectValue(o, "name", 4), "tiny json writer", 16);
+            TinySetBoolen(TinySetObjectValue(o, "active", 6), i % 2 == 0);
+            TinySetNumber(TinySetObjectValue(o, "score", 5), i * 0.25);
+            TinyValue* tags = TinySetObjectValue(o, "tags", 4);
+            TinySetArray(tags, 0);
+            TinySetString(TinyPushBackArrayElement(tags), "a", 1);
+            TinySetNull(TinyPushBackArrayElement(tags));
+        }
+        free(TinyStringify(&doc, &len));
+        TinyFree(&doc);
+    }
+    double ns = (NowNs() - start) / 20;
+    BenchReport("dom+stringify/10000", ns, len, -1);
+
+    TinyWriter w;
+    TinyWriterInit(&w);
+    start = NowNs();
+    for(int r = 0; r < 20; r++) {
+        TinyWriterReset(&w);
+        TinyWriterStartArray(&w);
+        for(int i = 0; i < n; i++) {
+            TinyWriterStartObject(&w);
+            TinyWriterKey(&w, "id", 2);
+            TinyWriterInt64(&w, i);
+            TinyWriterKey(&w, "name", 4);
+            TinyWriterString(&w, "tiny json writer", 16);
+            TinyWriterKey(&w, "active", 6);
+            TinyWriterBool(&w, i % 2 == 0);
+            TinyWriterKey(&w, "score", 5);
+            TinyWriterNumber(&w, i * 0.25);
+            TinyWriterKey(&w, "tags", 4);
+            TinyWriterStartArray(&w);
+            TinyWriterString(&w, "a", 1);
+            TinyWriterNull(&w);
+            TinyWriterEndArray(&w);
+            TinyWriterEndObject(&w);
+        }
+        TinyWriterEndArray(&w);
+        TinyWriterGetString(&w, &len);
+    }
+    ns = (NowNs() - start) / 20;
+    BenchReport("writer/10000", ns, len, -1);
+    TinyWriterFree(&w);
+}
+
+struct BenchAddress {
+    std::string city;
+    int zip;
+};
+
+struct BenchRecord {
+    int64_t id;
+    std::string name;
+    bool active;
+    double score;
+    std::vector<std::string> tags;
+    BenchAddress address;
+    TinyOptional<std::string> note;
+};
+
+TINY_BIND_BEGIN(BenchAddress)
+    TINY_BIND_FIELD(city)
+    TINY_BIND_FIELD(zip)
+TINY_BIND_END()
+
+TINY_BIND_BEGIN(BenchRecord)
+    TINY_BIND_FIELD(id)
+    TINY_BIND_FIELD(name)
+    TINY_BIND_FIELD(active)
+    TINY_BIND_FIELD(score)
+    TINY_BIND_FIELD(tags)
+    TINY_BIND_FIELD(address)
+    TINY_BIND_FIELD(note)
+TINY_BIND_END()
+
+static void BenchCopyString(std::string* out, const TinyValue* v) {
+    out->assign(TinyGetString(v), TinyGetStringLength(v));
+}
+
+/* what a handler does today: parse to a DOM, then copy the fields it knows */
+static void BenchCopyRecords(std::vector<BenchRecord>* out, const TinyValue* doc) {
+    out->clear();
+    for(size_t i = 0; i < TinyGetArraySize(doc); i++) {
+        const TinyValue* o = TinyGetArrayElement(doc, i);
+        BenchRecord r;
+        r.id = (int64_t)TinyGetNumber(TinyFindObjectValue(o, "id", 2));
+        BenchCopyString(&r.name, TinyFindObjectValue(o, "name", 4));
+        r.active = TinyGetType(TinyFindObjectValue(o, "active", 6)) == TINY_TRUE;
+        r.score = TinyGetNumber(TinyFindObjectValue(o, "score", 5));
+        const TinyValue* tags = TinyFindObjectValue(o, "tags", 4);
+        for(size_t k = 0; k < TinyGetArraySize(tags); k++) {
+            r.tags.push_back(std::string());
+            BenchCopyString(&r.tags.back(), TinyGetArrayElement(tags, k));
+        }
+        const TinyValue* address = TinyFindObjectValue(o, "address", 7);
+        BenchCopyString(&r.address.city, TinyFindObjectValue(address, "city", 4));
+        r.address.zip = (int)TinyGetNumber(TinyFindObjectValue(address, "zip", 3));
+        const TinyValue* note = TinyFindObjectValue(o, "note", 4);
+        r.note.has = note != NULL && TinyGetType(note) == TINY_STRING;
+        if(r.note.has) BenchCopyString(&r.note.value, note);
+        out->push_back(std::move(r));
+    }
+}
+
+static void BenchBuildRecords(TinyValue* doc, const std::vector<BenchRecord>& records) {
+    TinySetArray(doc, records.size());
+    for(size_t i = 0; i < records.size(); i++) {
+        const BenchRecord& r = records[i];
+        TinyValue* o = TinyPushBackArrayElement(doc);
+        TinySetObject(o, 7);
+        TinySetNumber(TinyPushBackObjectValue(o, "id", 2), (double)r.id);
+        TinySetString(TinyPushBackObjectValue(o, "name", 4), r.name.data(), r.name.size());
+        TinySetBoolen(TinyPushBackObjectValue(o, "active", 6), r.active);
+        TinySetNumber(TinyPushBackObjectValue(o, "score", 5), r.score);
+        TinyValue* tags = TinyPushBackObjectValue(o, "tags", 4);
+        TinySetArray(tags, r.tags.size());
+        for(size_t k = 0; k < r.tags.size(); k++) {
+            TinySetString(TinyPushBackArrayElement(tags), r.tags[k].data(), r.tags[k].size());
+        }
+        TinyValue* address = TinyPushBackObjectValue(o, "address", 7);
+        TinySetObject(address, 2);
+        TinySetString(TinyPushBackObjectValue(address, "city", 4), r.address.city.data(), r.address.city.size());
+        TinySetNumber(TinyPushBackObjectValue(address, "zip", 3), r.address.zip);
+        if(r.note.has) TinySetString(TinyPushBackObjectValue(o, "note", 4), r.note.value.data(), r.note.value.size());
+    }
+}
+
+static std::string BenchRecordsJson(int n) {
+    std::string json = "[";
+    char buf[512];
+    for(int i = 0; i < n; i++) {
+        snprintf(buf, sizeof(buf), "%s{\"id\":%d,\"name\":\"user %d\",\"active\":%s,\"score\":%d.25,"
+                 "\"tags\":[\"alpha\",\"beta\",\"gamma\"],\"meta\":{\"source\":\"import\",\"ids\":[1,2,3]},"
+                 "\"address\":{\"city\":\"Springfield\",\"zip\":%d}%s}",
+                 i ? "," : "", i, i, i % 2 ? "true" : "false", i, 10000 + i, i % 3 ? "" : ",\"note\":\"vip\"");
+        json += buf;
+    }
+    json += "]";
+    return json;
+}
+
+/* 10k records with an unknown member each: binding vs DOM + copy, both directions */
+static void BenchBind() {
+    std::string json = BenchRecordsJson(10000);
+    std::vector<BenchRecord> records;
+    TinyValue doc;
+    size_t len = 0;
+    TinyInitValue(&doc);
+
+    double start = NowNs();
+    for(int r = 0; r < 20; r++) {
+        TinyParse(&doc, json.c_str());
+        BenchCopyRecords(&records, &doc);
+        TinyFree(&doc);
+    }
+    BenchReport("dom-parse+copy/10000", (NowNs() - start) / 20, json.size(), -1);
+
+    start = NowNs();
+    for(int r = 0; r < 20; r++) {
+        sink += TinyBindParse(&records, json.c_str());
+    }
+    BenchReport("bind-parse/10000", (NowNs() - start) / 20, json.size(), -1);
+
+    start = NowNs();
+    for(int r = 0; r < 20; r++) {
+        TinyInitValue(&doc);
+        BenchBuildRecords(&doc, records);
+        free(TinyStringify(&doc, &len));
+        TinyFree(&doc);
+    }
+    BenchReport("dom-build+stringify/10000", (NowNs() - start) / 20, len, -1);
+
+    start = NowNs();
+    for(int r = 0; r < 20; r++) {
+        free(TinyBindStringify(records, &len));
+    }
+    BenchReport("bind-stringify/10000", (NowNs() - start) / 20, len, -1);
+}
+
+/* the same records against a schema: validating the DOM vs scanning the text, accepted and rejected */
+static void BenchSchema() {
+    std::string json = BenchRecordsJson(10000);
+    /* the first record breaks the schema, the rest of the text is never read */
+    std::string bad = json;
+    bad.replace(bad.find("\"score\":0.25"), 12, "\"score\":-1.0");
+    const char* schemaJson =
+        "{\"type\":\"array\",\"items\":{\"type\":\"object\",\"required\":[\"id\",\"name\",\"active\",\"address\"],"
+        "\"properties\":{\"id\":{\"type\":\"integer\",\"minimum\":0},\"name\":{\"type\":\"string\",\"maxLength\":64},"
+        "\"active\":{\"type\":\"boolean\"},\"score\":{\"type\":\"number\",\"minimum\":0},"
+        "\"tags\":{\"type\":\"array\",\"items\":{\"enum\":[\"alpha\",\"beta\",\"gamma\"]}},"
+        "\"address\":{\"type\":\"object\",\"required\":[\"city\",\"zip\"],\"additionalProperties\":false,"
+        "\"properties\":{\"city\":{\"type\":\"string\"},\"zip\":{\"type\":\"integer\"}}},"
+        "\"note\":{\"type\":\"string\"}}}}";
+    TinyValue sv, doc;
+    TinySchema schema;
+    TinyInitValue(&sv);
+    TinyInitValue(&doc);
+
+    BENCH("compile/schema", 10000, TinyParse(&sv, schemaJson); TinySchemaCompile(&schema, &sv);
+          TinySchemaFree(&schema); TinyFree(&sv));
+    TinyParse(&sv, schemaJson);
+    TinySchemaCompile(&schema, &sv);
+    TinyFree(&sv);
+    BENCH("parse/10000", 20, TinyParse(&doc, json.c_str()); TinyFree(&doc));
+    BENCH("parse+validate/10000", 20, TinyParse(&doc, json.c_str()); sink += TinySchemaValidate(&schema, &doc);
+          TinyFree(&doc));
+    BENCH("validate-json/10000", 20, sink += TinySchemaValidateJson(&schema, json.c_str()));
+    /* TinySchemaParse validates then parses: roughly validate-json + parse on accepted input */
+    BENCH("schema-parse/10000", 20, sink += TinySchemaParse(&schema, &doc, json.c_str()); TinyFree(&doc));
+    BENCH("parse+validate/reject", 20, TinyParse(&doc, bad.c_str()); sink += TinySchemaValidate(&schema, &doc);
+          TinyFree(&doc));
+    BENCH("schema-parse/reject", 20, sink += TinySchemaParse(&schema, &doc, bad.c_str()); TinyFree(&doc));
+    TinySchemaFree(&schema);
+
+    /* container-valued enum: each element span is copied and parsed before comparing */
+    std::string pairs = "[";
+    for(int i = 0; i < 10000; i++) pairs += i ? ",[3,4]" : "[3,4]";
+    pairs += "]";
+    TinyParse(&sv, "{\"items\":{\"enum\":[[1,2],[3,4]]}}");
+    TinySchemaCompile(&schema, &sv);
+    TinyFree(&sv);
+    BENCH("validate-json/enum-pairs-10000", 20, sink += TinySchemaValidateJson(&schema, pairs.c_str()));
+    TinyParse(&sv, "{\"items\":{\"type\":\"array\",\"items\":{\"type\":\"integer\"}}}");
+    TinySchemaFree(&schema);
+    TinySchemaCompile(&schema, &sv);
+    TinyFree(&sv);
+    BENCH("validate-json/int-pairs-10000", 20, sink += TinySchemaValidateJson(&schema, pairs.c_str()));
+    TinySchemaFree(&schema);
+}
+
+static bool BenchPathCount(void* user, const char* json, size_t len) {
+    *(size_t*)user += len;
+    return true;
+}
+
+/* pulling fields out of the records: parse + walk the DOM vs querying the text */
+static void BenchPath() {
+    std::string json = BenchRecordsJson(10000);
+    const char* exprs[] = { "$[*].address.zip", "$..city", "$[5].id", "$[*].tags[1:]" };
+    TinyValue doc;
+    TinyPath path;
+    size_t bytes = 0;
+    TinyInitValue(&doc);
+    BENCH("dom-parse+walk/address.zip", 20, TinyParse(&doc, json.c_str());
+          for(size_t i = 0; i < TinyGetArraySize(&doc); i++) {
+              const TinyValue* address = TinyFindObjectValue(TinyGetArrayElement(&doc, i), "address", 7);
+              sink += (uint64_t)TinyGetNumber(TinyFindObjectValue(address, "zip", 3));
+          }
+          TinyFree(&doc));
+    for(size_t i = 0; i < sizeof(exprs) / sizeof(exprs[0]); i++) {
+        char name[64];
+        snprintf(name, sizeof(name), "query/%s", exprs[i]);
+        TinyPathCompile(&path, exprs[i]);
+        BENCH(name, 20, sink += TinyPathQuery(&path, json.c_str(), BenchPathCount, &bytes));
+        TinyPathFree(&path);
+    }
+}
+
+/* encode/decode time and size of JSON text vs MessagePack vs CBOR */
+static void BenchBinary() {
+    TinyValue doc, out;
+    size_t jlen, mlen, clen;
+    TinyInitValue(&doc);
+    TinyInitValue(&out);
+    MakeLargeObject(&doc, 20000, false);
+    char* json = TinyStringify(&doc, &jlen);
+    char* mp = TinyEncodeMsgPack(&doc, &mlen);
+    char* cb = TinyEncodeCbor(&doc, &clen);
+    printf("%-40s %12zu %12zu %12zu\n", "size json/msgpack/cbor", jlen, mlen, clen);
+
+    BENCH("encode-json/20000", 20, free(TinyStringify(&doc, NULL)));
+    BENCH("encode-msgpack/20000", 20, free(TinyEncodeMsgPack(&doc, NULL)));
+    BENCH("encode-cbor/20000", 20, free(TinyEncodeCbor(&doc, NULL)));
+    BENCH("decode-json/20000", 20, TinyParse(&out, json); TinyFree(&out));
+    BENCH("decode-msgpack/20000", 20, TinyDecodeMsgPack(&out, mp, mlen); TinyFree(&out));
+    BENCH("decode-cbor/20000", 20, TinyDecodeCbor(&out, cb, clen); TinyFree(&out));
+    free(json);
+    free(mp);
+    free(cb);
+    TinyFree(&doc);
+}
+
+/* restart cost: TinyParse of the text vs TinyLoadSnapshot of the saved image */
+static void BenchSnapshot() {
+    const char* path = "bench-snapshot.tmp";
+    TinyValue doc, out;
+    TinySnapshot snap;
+    TinyInitValue(&doc);
+    TinyInitValue(&out);
+    MakeLargeObject(&doc, 100000, false);
+    char* json = TinyStringify(&doc, NULL);
+    TinySaveSnapshot(&doc, path);
+
+    BENCH("parse/100000", 5, TinyParse(&out, json); TinyFree(&out));
+    BENCH("load-snapshot/100000", 5, TinyLoadSnapshot(&snap, path); TinyFreeSnapshot(&snap));
+
+    char key[32];
+    TinyLoadSnapshot(&snap, path);
+    const TinySnapValue* root = TinySnapshotRoot(&snap);
+    BENCH("snapshot-find/100000", 100000, {
+        static size_t i = 0;
+        snprintf(key, sizeof(key), "key-%zu", (i++ * 7919) % 100000);
+        sink += TinySnapFindObjectIndex(root, key, strlen(key));
+    });
+    BENCH("dom-find/100000", 1000, {
+        static size_t i = 0;
+        snprintf(key, sizeof(key), "key-%zu", (i++ * 7919) % 100000);
+        sink += TinyFindObjectIndex(&doc, key, strlen(key));
+    });
+    TinyFreeSnapshot(&snap);
+    remove(path);
+    free(json);
+    TinyFree(&doc);
+}
+
+/* lookups per second with N reader threads while a writer republishes every millisecond */
+template <typename Read>
+static void BenchSharedRead(const char* name, int threads, Read read) {
+    const int reads = 2000000;
+    std::thread workers[16];
+    double start = NowNs();
+    for(int t = 0; t < threads; t++) {
+        workers[t] = std::thread([&read]() {
+            uint64_t sum = 0;
+            for(int i = 0; i < reads; i++) sum += read();
+            sink += sum;
+        });
+    }
+    for(int t = 0; t < threads; t++) workers[t].join();
+    double ns = NowNs() - start;
+    char label[64];
+    snprintf(label, sizeof(label), "%s/%d-threads", name, threads);
+    BenchReport(label, ns / reads, -1, -1);
+}
+
+/* a reader owned by one thread, released when that thread exits */
+struct SharedReaderScope {
+    TinySharedReader reader;
+    explicit SharedReaderScope(TinySharedSlot* slot) { TinySharedReaderInit(&reader, slot); }
+    ~SharedReaderScope() { TinySharedReaderFree(&reader); }
+};
+
+static TinySharedDoc* MakeSharedConfig(int version) {
+    TinyValue v;
+    TinyInitValue(&v);
+    MakeLargeObject(&v, 100, false);
+    TinySetNumber(TinySetObjectValue(&v, "version", 7), version);
+    return TinySharedCreate(&v);
+}
+
+static void BenchShared() {
+    TinySharedSlot slot;
+    TinySharedSlotInit(&slot, MakeSharedConfig(0));
+    std::atomic<bool> stop(false);
+    std::thread writer([&]() {
+        for(int i = 1; !stop; i++) {
+            TinySharedPublish(&slot, MakeSharedConfig(i));
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+
+    TinyValue locked;
+    std::mutex mutex;
+    TinyInitValue(&locked);
+    MakeLargeObject(&locked, 100, false);
+    for(int threads = 1; threads <= 8; threads *= 2) {
+        BenchSharedRead("shared-reader", threads, [&slot]() {
+            thread_local SharedReaderScope scope(&slot);
+            return TinyFindObjectIndex(TinySharedRead(&scope.reader), "key-42", 6);
+        });
+        BenchSharedRead("shared-acquire", threads, [&slot]() {
+            TinySharedDoc* doc = TinySharedAcquire(&slot);
+            size_t index = TinyFindObjectIndex(TinySharedGetValue(doc), "key-42", 6);
+            TinySharedRelease(doc);
+            return index;
+        });
+        BenchSharedRead("mutex", threads, [&]() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return TinyFindObjectIndex(&locked, "key-42", 6);
+        });
+    }
+    stop = true;
+    writer.join();
+    TinyFree(&locked);
+    TinySharedSlotFree(&slot);
+}
+
+/* copying a large template and changing two fields */
+static void BenchCopy() {
+    TinyValue doc, copy;
+    TinyInitValue(&doc);
+    MakeLargeObject(&doc, 100000, false);
+    BENCH("copy/100000", 1000, TinyCopy(&copy, &doc); TinyFree(&copy));
+    BENCH("copy+2-edits/100000", 100, {
+        TinyCopy(&copy, &doc);
+        TinySetNumber(TinySetObjectValue(TinySetObjectValue(&copy, "key-7", 5), "id", 2), -1);
+        TinySetString(TinySetArrayElement(TinySetObjectValue(TinySetObjectValue(&copy, "key-99999", 9), "tags", 4), 0), "z", 1);
+        TinyFree(&copy);
+    });
+    TinyFree(&doc);
+}
+
+/* building a 1M-element numeric array element by element vs in bulk */
+static void BenchBulk() {
+    const size_t n = 1000000;
+    double* nums = (double*)malloc(n * sizeof(double));
+    for(size_t i = 0; i < n; i++) nums[i] = i * 0.5;
+    TinyValue a;
+    TinyInitValue(&a);
+    BENCH("push-back-numbers/1000000", 10, {
+        TinySetArray(&a, 0);
+        for(size_t i = 0; i < n; i++) TinySetNumber(TinyPushBackArrayElement(&a), nums[i]);
+        TinyFree(&a);
+    });
+    BENCH("append-numbers/1000000", 10, {
+        TinySetArray(&a, 0);
+        TinyAppendArrayNumbers(&a, nums, n);
+        TinyFree(&a);
+    });
+    BENCH("append-numbers-packed/1000000", 10, {
+        TinySetArray(&a, 0);
+        TinyPackArray(&a);
+        TinyAppendArrayNumbers(&a, nums, n);
+        TinyFree(&a);
+    });
+    TinySetArray(&a, 0);
+    TinyAppendArrayNumbers(&a, nums, 100000);
+    BENCH("insert+erase-front/100000", 100, {
+        TinyInsertArrayElements(&a, 0, 16);
+        TinyEraseArrayElement(&a, 0, 16);
+    });
+    TinyFree(&a);
+    free(nums);
+}
+
+/* time series: 1M numbers parsed into a packed array (opt-in via TINY_PARSE_FLAG_PACK_NUMBERS) */
+static void BenchPacked() {
+    const size_t n = 1000000;
+    char* json = (char*)malloc(n * 24 + 2);
+    char* p = json;
+    *p++ = '[';
+    for(size_t i = 0; i < n; i++) p += sprintf(p, "%s%.3f", i ? "," : "", i * 0.001 - 17.5);
+    *p++ = ']';
+    *p = '\0';
+    TinyValue a;
+    TinyInitValue(&a);
+    BENCH("parse-unpacked/1000000", 5, TinyParse(&a, json); TinyFree(&a));
+    BENCH("parse-packed/1000000", 5, TinyParseWithFlags(&a, json, TINY_PARSE_FLAG_PACK_NUMBERS); TinyFree(&a));
+    TinyParseWithFlags(&a, json, TINY_PARSE_FLAG_PACK_NUMBERS);
+    BENCH("stringify-packed/1000000", 5, free(TinyStringify(&a, NULL)));
+    BENCH("sum-get-element/1000000", 20, {
+        double sum = 0;
+        for(size_t i = 0; i < n; i++) sum += TinyGetNumber(TinyGetArrayElement(&a, i));
+        sink += (uint64_t)sum;
+    });
+    BENCH("sum-get-doubles/1000000", 20, {
+        size_t size;
+        const double* nums = TinyGetArrayDoubles(&a, &size);
+        double sum = 0;
+        for(size_t i = 0; i < size; i++) sum += nums[i];
+        sink += (uint64_t)sum;
+    });
+    printf("%-40s %12zu %12zu\n", "bytes packed/unpacked", n * sizeof(double), n * sizeof(TinyValue));
+    TinyFree(&a);
+    free(json);
+}
+
+/* 补丁会被移入文档, 每次先 O(1) 复制一份文档和补丁 */
+static void BenchPatch() {
+    TinyValue doc, copy, patch, ops, p;
+    TinyInitValue(&doc);
+    TinyInitValue(&patch);
+    TinyInitValue(&ops);
+    MakeLargeObject(&doc, 100000, false);
+    TinyParse(&patch, "{\"key-7\":{\"id\":-1,\"tags\":null},\"key-99999\":{\"extra\":[1,2]}}");
+    TinyParse(&ops, "[{\"op\":\"replace\",\"path\":\"/key-7/id\",\"value\":-1},"
+                    "{\"op\":\"remove\",\"path\":\"/key-7/tags\"},"
+                    "{\"op\":\"add\",\"path\":\"/key-99999/tags/-\",\"value\":\"c\"},"
+                    "{\"op\":\"test\",\"path\":\"/key-99999/id\",\"value\":99999}]");
+    BENCH("copy-only/100000", 100, TinyCopy(&copy, &doc); TinyFree(&copy));
+    BENCH("merge-patch/100000", 100, {
+        TinyCopy(&copy, &doc);
+        TinyCopy(&p, &patch);
+        TinyApplyMergePatch(&copy, &p);
+        TinyFree(&p);
+        TinyFree(&copy);
+    });
+    BENCH("json-patch-4-ops/100000", 100, {
+        TinyCopy(&copy, &doc);
+        TinyCopy(&p, &ops);
+        sink += TinyApplyPatch(&copy, &p);
+        TinyFree(&p);
+        TinyFree(&copy);
+    });
+    TinyFree(&doc);
+    TinyFree(&patch);
+    TinyFree(&ops);
+}
+
+static void BenchDiff() {
+    TinyValue doc, copy, parsed, reversed, patch, arr, arr2;
+    TinyInitValue(&doc);
+    TinyInitValue(&parsed);
+    TinyInitValue(&reversed);
+    TinyInitValue(&patch);
+    TinyInitValue(&arr);
+    MakeLargeObject(&doc, 100000, false);
+    MakeLargeObject(&parsed, 100000, false);
+    MakeLargeObject(&reversed, 100000, true);
+    /* 两处修改: 未修改的子树与 doc 共享存储 */
+    TinyCopy(&copy, &doc);
+    TinySetNumber(TinySetObjectValue(TinySetObjectValue(&copy, "key-7", 5), "id", 2), -1);
+    TinySetString(TinySetArrayElement(TinySetObjectValue(TinySetObjectValue(&copy, "key-99999", 9), "tags", 4), 0), "z", 1);
+    TinySetNumber(TinySetObjectValue(TinySetObjectValue(&parsed, "key-7", 5), "id", 2), -1);
+    BENCH("diff-cow-2-edits/100000", 100, TinyDiff(&patch, &doc, &copy));
+    BENCH("diff-parsed-1-edit/100000", 10, TinyDiff(&patch, &doc, &parsed));
+    BENCH("diff-reordered-keys/100000", 10, TinyDiff(&patch, &doc, &reversed));
+    /* 数组中间插入和删除若干元素 */
+    MakeNumberArray(&arr, 100000);
+    TinyCopy(&arr2, &arr);
+    TinyEraseArrayElement(&arr2, 50000, 10);
+    TinySetNumber(TinyInsertArrayElements(&arr2, 50100, 1), -1);
+    BENCH("diff-array-edits/100000", 10, TinyDiff(&patch, &arr, &arr2));
+    sink += TinyGetArraySize(&patch);
+    TinyFree(&doc);
+    TinyFree(&copy);
+    TinyFree(&parsed);
+    TinyFree(&reversed);
+    TinyFree(&patch);
+    TinyFree(&arr);
+    TinyFree(&arr2);
+}
+
+/* one small change between stringifies: cached output is spliced for untouched containers */
+static void BenchCached() {
+    TinyValue flat, nested;
+    size_t k = 0;
+    char key[32];
+    TinyInitValue(&flat);
+    TinyInitValue(&nested);
+    MakeLargeObject(&flat, 100000, false);
+    TinySetObject(&nested, 1000);
+    for(size_t i = 0; i < 1000; i++) {
+        TinyValue group;
+        TinyInitValue(&group);
+        MakeLargeObject(&group, 100, false);
+        TinyMove(TinyPushBackObjectValue(&nested, key, sprintf(key, "group-%zu", i)), &group);
+    }
+    free(TinyStringifyCached(&flat, NULL));
+    free(TinyStringifyCached(&nested, NULL));
+    BENCH("stringify/flat-100000", 20, free(TinyStringify(&flat, NULL)));
+    BENCH("stringify-cached/flat-100000", 20, {
+        TinySetNumber(TinySetObjectValue(TinySetObjectValueAt(&flat, 7), "id", 2), (double)k++);
+        free(TinyStringifyCached(&flat, NULL));
+    });
+    BENCH("stringify/nested-1000x100", 20, free(TinyStringify(&nested, NULL)));
+    BENCH("stringify-cached/nested-1000x100", 20, {
+        TinyValue* group = TinySetObjectValueAt(&nested, k % 1000);
+        TinySetNumber(TinySetObjectValue(TinySetObjectValueAt(group, 7), "id", 2), (double)k++);
+        free(TinyStringifyCached(&nested, NULL));
+    });
+    BENCH("stringify-cached-unchanged/nested-1000x100", 20, free(TinyStringifyCached(&nested, NULL)));
+    /* the group pointer is kept, so the root only learns about the change by checking its descendants */
+    TinyValue* held = TinySetObjectValueAt(&nested, 500);
+    BENCH("stringify-cached-held-child/nested-1000x100", 20, {
+        TinySetNumber(TinySetObjectValue(TinySetObjectValueAt(held, 7), "id", 2), (double)k++);
+        free(TinyStringifyCached(&nested, NULL));
+    });
+    TinyFree(&flat);
+    TinyFree(&nested);
+}
+
+
+/* thread scaling of the parallel stringify, flat and nested, against the sequential path */
+static void BenchParallel() {
+    TinyValue flat, nested;
+    size_t len;
+    char key[32], name[64];
+    TinyInitValue(&flat);
+    TinyInitValue(&nested);
+    MakeLargeObject(&flat, 400000, false);
+    TinySetObject(&nested, 2);
+    TinySetNumber(TinyPushBackObjectValue(&nested, "version", 7), 1);
+    TinyValue* groups = TinyPushBackObjectValue(&nested, "groups", 6);
+    TinySetObject(groups, 4000);
+    for(size_t i = 0; i < 4000; i++) {
+        TinyValue group;
+        TinyInitValue(&group);
+        MakeLargeObject(&group, 100, false);
+        TinyMove(TinyPushBackObjectValue(groups, key, sprintf(key, "group-%zu", i)), &group);
+    }
+    const unsigned threads[] = { 1, 2, 4, 8 };
+    const TinyValue* docs[] = { &flat, &nested };
+    const char* names[] = { "flat-400000", "nested-4000x100" };
+    for(size_t d = 0; d < 2; d++) {
+        free(TinyStringify(docs[d], &len));
+        double start = NowNs();
+        for(int r = 0; r < 5; r++) free(TinyStringify(docs[d], NULL));
+        snprintf(name, sizeof(name), "stringify/%s", names[d]);
+        BenchReport(name, (NowNs() - start) / 5, len, -1);
+        for(size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++) {
+            start = NowNs();
+            for(int r = 0; r < 5; r++) free(TinyStringifyParallel(docs[d], NULL, threads[t]));
+            snprintf(name, sizeof(name), "parallel-%u/%s", threads[t], names[d]);
+            BenchReport(name, (NowNs() - start) / 5, len, -1);
+        }
+        start = NowNs();
+        for(int r = 0; r < 5; r++) {
+            TinyIovecList list;
+            TinyStringifyParallelIovec(docs[d], &list, 0);
+            sink += list.count;
+            TinyFreeIovecList(&list);
+        }
+        snprintf(name, sizeof(name), "parallel-iovec-%u/%s", std::thread::hardware_concurrency(), names[d]);
+        BenchReport(name, (NowNs() - start) / 5, len, -1);
+    }
+    /* per-call overhead on a small document: workers are reused, not created per call */
+    TinyValue small;
+    TinyInitValue(&small);
+    MakeLargeObject(&small, 1000, false);
+    BENCH("stringify/small-1000", 200, free(TinyStringify(&small, NULL)));
+    BENCH("parallel-4/small-1000", 200, free(TinyStringifyParallel(&small, NULL, 4)));
+    TinyFree(&small);
+    TinyFree(&flat);
+    TinyFree(&nested);
+}
+
+/* ------------------------------------------------------------------ */
+/* generated corpora                                                  */
+/* ------------------------------------------------------------------ */
+
+/* one or more '\0'-separated documents (NDJSON has one per line) */
+struct Corpus {
+    const char* name;
+    char* text;
+    size_t bytes, count;
+    const char** docs;
+    TinyValue* values;          /* parsed once, read by stringify/copy/equal/lookup */
+    TinyValue* others;          /* parsed separately, so equal cannot rely on shared storage */
+    TinyValue* scratch;
+    const TinyValue** parents;  /* every object member in values, for lookup */
+    const char** keys;
+    size_t* klens;
+    size_t lookups, lcapacity;
+    size_t outBytes;            /* stringified size */
+};
+
+static unsigned long long corpusSeed;
+
+static unsigned long long CorpusRand() {
+    corpusSeed ^= corpusSeed << 13;
+    corpusSeed ^= corpusSeed >> 7;
+    corpusSeed ^= corpusSeed << 17;
+    return corpusSeed;
+}
+
+static void CorpusText(TinyWriter* w, int words) {
+    static const char* vocabulary[] = {
+        "tiny", "json", "parser", "the", "quick", "brown", "fox", "status", "update", "#cpp",
+        "@mark", "http://t.co/abc", "\xe6\x97\xa5\xe6\x9c\xac\xe8\xaa\x9e", "caf\xc3\xa9", "\xf0\x9f\x98\x80",
+        "\"quoted\"", "line\nbreak", "tab\tstop", "back\\slash", "ok"
+    };
+    char text[512];
+    size_t len = 0;
+    for(int i = 0; i < words; i++) {
+        const char* word = vocabulary[CorpusRand() % (sizeof(vocabulary) / sizeof(vocabulary[0]))];
+        size_t wlen = strlen(word);
+        if(len + wlen + 1 >= sizeof(text)) break;
+        if(i) text[len++] = ' ';
+        memcpy(text + len, word, wlen);
+        len += wlen;
+    }
+    TinyWriterString(w, text, len);
+}
+
+#define CORPUS_KEY(w, key) TinyWriterKey(w, key, sizeof(key) - 1)
+
+static char* CorpusFinish(TinyWriter* w, size_t* len) {
+    const char* json = TinyWriterGetString(w, len);
+    char* text = (char*)malloc(*len + 1);
+    memcpy(text, json, *len + 1);
+    TinyWriterFree(w);
+    return text;
+}
+
+/* twitter.json-like: string- and key-heavy statuses with nested users and entities */
+static char* CorpusTwitter(size_t n, size_t* len) {
+    TinyWriter w;
+    char buf[64];
+    TinyWriterInit(&w);
+    TinyWriterStartObject(&w);
+    CORPUS_KEY(&w, "statuses");
+    TinyWriterStartArray(&w);
+    for(size_t i = 0; i < n; i++) {
+        unsigned long long id = 250000000000000000ULL + CorpusRand() % 1000000000000ULL;
+        TinyWriterStartObject(&w);
+        CORPUS_KEY(&w, "created_at");
+        TinyWriterString(&w, "Sun Aug 31 00:29:15 +0000 2014", 30);
+        CORPUS_KEY(&w, "id");
+        TinyWriterInt64(&w, (int64_t)id);
+        CORPUS_KEY(&w, "id_str");
+        TinyWriterString(&w, buf, snprintf(buf, sizeof(buf), "%llu", id));
+        CORPUS_KEY(&w, "text");
+        CorpusText(&w, 8 + CorpusRand() % 16);
+        CORPUS_KEY(&w, "source");
+        TinyWriterString(&w, "<a href=\"http://twitter.com/download/iphone\" rel=\"nofollow\">Twitter for iPhone</a>", 82);
+        CORPUS_KEY(&w, "truncated");
+        TinyWriterBool(&w, false);
+        CORPUS_KEY(&w, "in_reply_to_status_id");
+        TinyWriterNull(&w);
+        CORPUS_KEY(&w, "user");
+        TinyWriterStartObject(&w);
+        CORPUS_KEY(&w, "id");
+        TinyWriterInt64(&w, (int64_t)(CorpusRand() % 3000000000ULL));
+        CORPUS_KEY(&w, "name");
+        CorpusText(&w, 2);
+        CORPUS_KEY(&w, "screen_name");
+        TinyWriterString(&w, buf, snprintf(buf, sizeof(buf), "user_%llu", CorpusRand() % 100000));
+        CORPUS_KEY(&w, "location");
+        CorpusText(&w, 1);
+        CORPUS_KEY(&w, "description");
+        CorpusText(&w, 12);
+        CORPUS_KEY(&w, "url");
+        TinyWriterNull(&w);
+        CORPUS_KEY(&w, "followers_count");
+        TinyWriterInt64(&w, (int64_t)(CorpusRand() % 100000));
+        CORPUS_KEY(&w, "friends_count");
+        TinyWriterInt64(&w, (int64_t)(CorpusRand() % 5000));
+        CORPUS_KEY(&w, "verified");
+        TinyWriterBool(&w, CorpusRand() % 10 == 0);
+        CORPUS_KEY(&w, "profile_image_url");
+        TinyWriterString(&w, "http://pbs.twimg.com/profile_images/49880/normal.jpeg", 53);
+        TinyWriterEndObject(&w);
+        CORPUS_KEY(&w, "entities");
+        TinyWriterStartObject(&w);
+        CORPUS_KEY(&w, "hashtags");
+        TinyWriterStartArray(&w);
+        for(unsigned long long h = CorpusRand() % 3; h > 0; h--) {
+            TinyWriterStartObject(&w);
+            CORPUS_KEY(&w, "text");
+            CorpusText(&w, 1);
+            CORPUS_KEY(&w, "indices");
+            TinyWriterStartArray(&w);
+            TinyWriterInt64(&w, (int64_t)(h * 10));
+            TinyWriterInt64(&w, (int64_t)(h * 10 + 7));
+            TinyWriterEndArray(&w);
+            TinyWriterEndObject(&w);
+        }
+        TinyWriterEndArray(&w);
+        CORPUS_KEY(&w, "urls");
+        TinyWriterStartArray(&w);
+        TinyWriterEndArray(&w);
+        TinyWriterEndObject(&w);
+        CORPUS_KEY(&w, "retweet_count");
+        TinyWriterInt64(&w, (int64_t)(CorpusRand() % 1000));
+        CORPUS_KEY(&w, "favorited");
+        TinyWriterBool(&w, false);
+        CORPUS_KEY(&w, "lang");
+        TinyWriterString(&w, "ja", 2);
+        TinyWriterEndObject(&w);
+    }
+    TinyWriterEndArray(&w);
+    CORPUS_KEY(&w, "search_metadata");
+    TinyWriterStartObject(&w);
+    CORPUS_KEY(&w, "count");
+    TinyWriterInt64(&w, (int64_t)n);
+    CORPUS_KEY(&w, "query");
+    TinyWriterString(&w, "%E4%B8%80", 9);
+    TinyWriterEndObject(&w);
+    TinyWriterEndObject(&w);
+    return CorpusFinish(&w, len);
+}
+
+/* canada.json-like: one GeoJSON polygon, almost all of it [lon, lat] pairs */
+static char* CorpusCanada(size_t rings, size_t points, size_t* len) {
+    TinyWriter w;
+    TinyWriterInit(&w);
+    TinyWriterStartObject(&w);
+    CORPUS_KEY(&w, "type");
+    TinyWriterString(&w, "FeatureCollection", 17);
+    CORPUS_KEY(&w, "features");
+    TinyWriterStartArray(&w);
+    TinyWriterStartObject(&w);
+    CORPUS_KEY(&w, "type");
+    TinyWriterString(&w, "Feature", 7);
+    CORPUS_KEY(&w, "properties");
+    TinyWriterStartObject(&w);
+    CORPUS_KEY(&w, "name");
+    TinyWriterString(&w, "Canada", 6);
+    TinyWriterEndObject(&w);
+    CORPUS_KEY(&w, "geometry");
+    TinyWriterStartObject(&w);
+    CORPUS_KEY(&w, "type");
+    TinyWriterString(&w, "Polygon", 7);
+    CORPUS_KEY(&w, "coordinates");
+    TinyWriterStartArray(&w);
+    for(size_t r = 0; r < rings; r++) {
+        double lon = -141.0 + (double)(CorpusRand() % 8000) / 100.0;
+        double lat = 42.0 + (double)(CorpusRand() % 4000) / 100.0;
+        TinyWriterStartArray(&w);
+        for(size_t i = 0; i < points; i++) {
+            lon += ((double)(CorpusRand() % 2001) - 1000.0) / 123456.789;
+            lat += ((double)(CorpusRand() % 2001) - 1000.0) / 98765.4321;
+            TinyWriterStartArray(&w);
+            TinyWriterNumber(&w, lon);
+            TinyWriterNumber(&w, lat);
+            TinyWriterEndArray(&w);
+        }
+        TinyWriterEndArray(&w);
+    }
+    TinyWriterEndArray(&w);
+    TinyWriterEndObject(&w);
+    TinyWriterEndObject(&w);
+    TinyWriterEndArray(&w);
+    TinyWriterEndObject(&w);
+    return CorpusFinish(&w, len);
+}
+
+/* n chains of alternating objects and arrays, depth levels each */
+static char* CorpusDeep(size_t n, size_t depth, size_t* len) {
+    TinyWriter w;
+    TinyWriterInit(&w);
+    TinyWriterStartArray(&w);
+    for(size_t i = 0; i < n; i++) {
+        for(size_t d = 0; d < depth; d++) {
+            if(d % 2 == 0) {
+                TinyWriterStartObject(&w);
+                TinyWriterKey(&w, "child", 5);
+            } else {
+                TinyWriterStartArray(&w);
+                TinyWriterInt64(&w, (int64_t)d);
+            }
+        }
+        TinyWriterNull(&w);
+        for(size_t d = depth; d-- > 0; ) {
+            if(d % 2 == 0) TinyWriterEndObject(&w);
+            else TinyWriterEndArray(&w);
+        }
+    }
+    TinyWriterEndArray(&w);
+    return CorpusFinish(&w, len);
+}
+
+/* a few huge strings, written by hand so they contain \uXXXX escapes and surrogate pairs */
+static char* CorpusStrings(size_t n, size_t size, size_t* len) {
+    static const char* pieces[] = {
+        "plain ascii text ", "more words here ", "\\n", "\\t", "\\\"quoted\\\" ", "C:\\\\path\\\\to ",
+        "\\u00e9t\\u00e9 ", "caf\xc3\xa9 ", "\\ud83d\\ude00 ", "\xe6\x97\xa5\xe6\x9c\xac ", "\\/slash "
+    };
+    char* json = (char*)malloc(n * (size + 32) + 2);
+    char* p = json;
+    *p++ = '[';
+    for(size_t i = 0; i < n; i++) {
+        if(i) *p++ = ',';
+        *p++ = '"';
+        for(char* start = p; (size_t)(p - start) < size; ) {
+            const char* piece = pieces[CorpusRand() % (sizeof(pieces) / sizeof(pieces[0]))];
+            size_t plen = strlen(piece);
+            memcpy(p, piece, plen);
+            p += plen;
+        }
+        *p++ = '"';
+    }
+    *p++ = ']';
+    *p = '\0';
+    *len = p - json;
+    return json;
+}
+
+/* NDJSON: n small log events, one per line */
+static char* CorpusNdjson(size_t n, size_t* len) {
+    static const char* levels[] = { "debug", "info", "warn", "error" };
+    TinyWriter w;
+    TinyWriterInit(&w);
+    char* text = NULL;
+    size_t size = 0;
+    for(size_t i = 0; i < n; i++) {
+        const char* level = levels[CorpusRand() % 4];
+        size_t llen;
+        TinyWriterReset(&w);
+        TinyWriterStartObject(&w);
+        CORPUS_KEY(&w, "ts");
+        TinyWriterInt64(&w, (int64_t)(1600000000000ULL + i * 37));
+        CORPUS_KEY(&w, "level");
+        TinyWriterString(&w, level, strlen(level));
+        CORPUS_KEY(&w, "msg");
+        CorpusText(&w, 6);
+        CORPUS_KEY(&w, "latency");
+        TinyWriterNumber(&w, (double)(CorpusRand() % 100000) / 1000.0);
+        CORPUS_KEY(&w, "user");
+        TinyWriterStartObject(&w);
+        CORPUS_KEY(&w, "id");
+        TinyWriterInt64(&w, (int64_t)(CorpusRand() % 1000000));
+        CORPUS_KEY(&w, "admin");
+        TinyWriterBool(&w, CorpusRand() % 50 == 0);
+        TinyWriterEndObject(&w);
+        CORPUS_KEY(&w, "tags");
+        TinyWriterStartArray(&w);
+        TinyWriterString(&w, "api", 3);
+        TinyWriterString(&w, "v2", 2);
+        TinyWriterEndArray(&w);
+        TinyWriterEndObject(&w);
+        const char* line = TinyWriterGetString(&w, &llen);
+        text = (char*)realloc(text, size + llen + 2);
+        memcpy(text + size, line, llen);
+        size += llen;
+        text[size++] = '\n';
+    }
+    text[size] = '\0';
+    TinyWriterFree(&w);
+    *len = size;
+    return text;
+}
+
+static void CorpusCollectKeys(Corpus* c, const TinyValue* v) {
+    if(TinyGetType(v) == TINY_ARRAY) {
+        size_t n;
+        if(TinyGetArrayDoubles(v, &n) != NULL) return;
+        for(size_t i = 0; i < TinyGetArraySize(v); i++) CorpusCollectKeys(c, TinyGetArrayElement(v, i));
+    } else if(TinyGetType(v) == TINY_OBJECT) {
+        for(size_t i = 0; i < TinyGetObjectSize(v); i++) {
+            if(c->lookups == c->lcapacity) {
+                c->lcapacity = c->lcapacity ? c->lcapacity * 2 : 1024;
+                c->parents = (const TinyValue**)realloc(c->parents, c->lcapacity * sizeof(TinyValue*));
+                c->keys = (const char**)realloc(c->keys, c->lcapacity * sizeof(char*));
+                c->klens = (size_t*)realloc(c->klens, c->lcapacity * sizeof(size_t));
+            }
+            c->parents[c->lookups] = v;
+            c->keys[c->lookups] = TinyGetObjectKey(v, i);
+            c->klens[c->lookups] = TinyGetObjectKeyLength(v, i);
+            c->lookups++;
+            CorpusCollectKeys(c, TinyGetObjectValue(v, i));
+        }
+    }
+}
+
+/* lines: the text holds one document per line */
+static void CorpusInit(Corpus* c, const char* name, char* text, size_t bytes, bool lines) {
+    memset(c, 0, sizeof(*c));
+    c->name = name;
+    c->text = text;
+    c->bytes = bytes;
+    c->count = 1;
+    if(lines) {
+        c->count = 0;
+        for(size_t i = 0; i < bytes; i++) c->count += text[i] == '\n';
+    }
+    c->docs = (const char**)malloc(c->count * sizeof(char*));
+    c->values = (TinyValue*)malloc(c->count * 3 * sizeof(TinyValue));
+    c->others = c->values + c->count;
+    c->scratch = c->others + c->count;
+    c->docs[0] = text;
+    for(size_t i = 0, d = 1; lines && i < bytes; i++) {
+        if(text[i] != '\n') continue;
+        text[i] = '\0';
+        if(d < c->count) c->docs[d++] = text + i + 1;
+    }
+    for(size_t i = 0; i < c->count; i++) {
+        size_t len;
+        TinyInitValue(&c->values[i]);
+        TinyInitValue(&c->others[i]);
+        TinyInitValue(&c->scratch[i]);
+        if(TinyParse(&c->values[i], c->docs[i]) != TINY_PARSE_OK) {
+            fprintf(stderr, "corpus %s: document %zu does not parse\n", name, i);
+            exit(1);
+        }
+        TinyParse(&c->others[i], c->docs[i]);
+        free(TinyStringify(&c->values[i], &len));
+        c->outBytes += len;
+        CorpusCollectKeys(c, &c->values[i]);
+    }
+}
+
+static void CorpusFree(Corpus* c) {
+    for(size_t i = 0; i < c->count * 3; i++) TinyFree(&c->values[i]);
+    free(c->values);
+    free(c->docs);
+    free(c->parents);
+    free(c->keys);
+    free(c->klens);
+    free(c->text);
+}
+
+static void CorpusParse(Corpus* c) {
+    for(size_t i = 0; i < c->count; i++) TinyParse(&c->scratch[i], c->docs[i]);
+}
+
+static void CorpusParseFlags(Corpus* c) {
+    for(size_t i = 0; i < c->count; i++) {
+        TinyParseWithFlags(&c->scratch[i], c->docs[i], TINY_PARSE_FLAG_DEPTH_LIMIT | TINY_PARSE_FLAG_NAN_INF);
+    }
+}
+
+static void CorpusParseUtf8(Corpus* c) {
+    for(size_t i = 0; i < c->count; i++) {
+        TinyParseWithFlags(&c->scratch[i], c->docs[i], TINY_PARSE_FLAG_VALIDATE_UTF8);
+    }
+}
+
+static void CorpusStringify(Corpus* c) {
+    for(size_t i = 0; i < c->count; i++) free(TinyStringify(&c->values[i], NULL));
+}
+
+static void CorpusCopy(Corpus* c) {
+    for(size_t i = 0; i < c->count; i++) TinyCopy(&c->scratch[i], &c->values[i]);
+}
+
+static void CorpusFreeScratch(Corpus* c) {
+    for(size_t i = 0; i < c->count; i++) TinyFree(&c->scratch[i]);
+}
+
+static void CorpusEqual(Corpus* c) {
+    for(size_t i = 0; i < c->count; i++) sink += TinyIsEqual(&c->values[i], &c->others[i]);
+}
+
+static void CorpusLookup(Corpus* c) {
+    for(size_t i = 0; i < c->lookups; i++) sink += (uintptr_t)TinyFindObjectValue(c->parents[i], c->keys[i], c->klens[i]);
+}
+
+/*
+ * warm up once, size each round to ~50 ms including setup/teardown, run 5 rounds
+ * and report the median; setup/teardown run around every repetition outside the timed region
+ */
+static void CorpusMeasure(Corpus* c, const char* op, double bytes, size_t items,
+                          void (*setup)(Corpus*), void (*run)(Corpus*), void (*teardown)(Corpus*)) {
+    const int rounds = 5;
+    double samples[rounds];
+    double allocs = 0;
+    char name[64];
+    if(items == 0) return;
+    double start = NowNs();
+    if(setup) setup(c);
+    run(c);
+    if(teardown) teardown(c);
+    double once = NowNs() - start;
+    int reps = once > 50e6 ? 1 : (int)(50e6 / (once + 1)) + 1;
+    for(int k = 0; k < rounds; k++) {
+        double ns = 0;
+        size_t before = 0, after = 0;
+        for(int r = 0; r < reps; r++) {
+            if(setup) setup(c);
+            before = allocations.load();
+            start = NowNs();
+            run(c);
+            ns += NowNs() - start;
+            after = allocations.load();
+            if(teardown) teardown(c);
+        }
+        samples[k] = ns / reps / items;
+        allocs = (double)(after - before) / items;
+    }
+    for(int i = 1; i < rounds; i++) {
+        for(int j = i; j > 0 && samples[j] < samples[j - 1]; j--) {
+            double t = samples[j];
+            samples[j] = samples[j - 1];
+            samples[j - 1] = t;
+        }
+    }
+    snprintf(name, sizeof(name), "corpus/%s/%s", c->name, op);
+    BenchReport(name, samples[rounds / 2], bytes, allocs);
+}
+
+static void BenchCorpus() {
+    Corpus corpora[5];
+    size_t len;
+    char* text;
+    corpusSeed = 88172645463325252ULL;
+    text = CorpusTwitter(2000, &len);
+    CorpusInit(&corpora[0], "twitter", text, len, false);
+    text = CorpusCanada(40, 2800, &len);
+    CorpusInit(&corpora[1], "canada", text, len, false);
+    text = CorpusDeep(2000, 128, &len);
+    CorpusInit(&corpora[2], "deep", text, len, false);
+    text = CorpusStrings(8, 256 << 10, &len);
+    CorpusInit(&corpora[3], "strings", text, len, false);
+    text = CorpusNdjson(20000, &len);
+    CorpusInit(&corpora[4], "ndjson", text, len, true);
+    for(int i = 0; i < 5; i++) {
+        Corpus* c = &corpora[i];
+        printf("%-40s %12zu bytes %8zu docs %8zu keys\n", c->name, c->bytes, c->count, c->lookups);
+        CorpusMeasure(c, "parse", c->bytes, 1, NULL, CorpusParse, CorpusFreeScratch);
+        CorpusMeasure(c, "parse-depth-nan", c->bytes, 1, NULL, CorpusParseFlags, CorpusFreeScratch);
+        CorpusMeasure(c, "parse-utf8", c->bytes, 1, NULL, CorpusParseUtf8, CorpusFreeScratch);
+        CorpusMeasure(c, "stringify", c->outBytes, 1, NULL, CorpusStringify, NULL);
+        CorpusMeasure(c, "copy", -1, c->count, NULL, CorpusCopy, CorpusFreeScratch);
+        CorpusMeasure(c, "free", -1, 1, CorpusParse, CorpusFreeScratch, NULL);
+        CorpusMeasure(c, "equal", c->bytes, 1, NULL, CorpusEqual, NULL);
+        CorpusMeasure(c, "lookup", -1, c->lookups, NULL, CorpusLookup, NULL);
+        CorpusFree(c);
+    }
+}
+
+/* 释放大文档: 调用线程上的停顿, 分别为 TinyFree、交给后台线程、按预算分步释放中最长的一步 */
+static void BenchReclaim() {
+    const int reps = 5;
+    const size_t budgets[] = { 1000, 10000, 100000 };
+    char name[64];
+    TinyValue doc;
+    TinyInitValue(&doc);
+    double total = 0, start;
+    for(int r = 0; r < reps; r++) {
+        MakeLargeObject(&doc, 400000, false);
+        start = NowNs();
+        TinyFree(&doc);
+        total += NowNs() - start;
+    }
+    BenchReport("free/400000", total / reps, 0, -1);
+
+    TinyReclaimThread* t = TinyReclaimThreadStart(0);
+    total = 0;
+    for(int r = 0; r < reps; r++) {
+        MakeLargeObject(&doc, 400000, false);
+        start = NowNs();
+        TinyReclaimThreadPush(t, &doc);
+        total += NowNs() - start;
+        TinyReclaimThreadDrain(t);
+    }
+    TinyReclaimStats stats;
+    TinyReclaimThreadGetStats(t, &stats);
+    BenchReport("thread-push/400000", total / reps, 0, -1);
+    printf("  reclaimed %llu nodes, %llu bytes\n", (unsigned long long)stats.nodes, (unsigned long long)stats.bytes);
+    TinyReclaimThreadStop(t);
+
+    for(size_t b = 0; b < sizeof(budgets) / sizeof(budgets[0]); b++) {
+        TinyReclaimer r;
+        TinyReclaimerInit(&r);
+        MakeLargeObject(&doc, 400000, false);
+        TinyReclaimerPush(&r, &doc);
+        double longest = 0;
+        bool done = false;
+        while(!done) {
+            start = NowNs();
+            done = TinyReclaimerStep(&r, budgets[b]);
+            double ns = NowNs() - start;
+            if(ns > longest) longest = ns;
+        }
+        snprintf(name, sizeof(name), "step-%zu-max/400000", budgets[b]);
+        BenchReport(name, longest, 0, -1);
+        TinyReclaimerFree(&r);
+    }
+}
+
+static int groups;
+static char** selected;
+
+static bool BenchSelected(const char* group) {
+    if(groups == 0) return true;
+    for(int i = 0; i < groups; i++) {
+        if(strstr(group, selected[i]) != NULL) return true;
+    }
+    return false;
+}
+
+#define BENCH_GROUP(fn) do { if(BenchSelected(#fn)) fn(); } while(0)
+
+int main(int argc, char* argv[]) {
+    selected = (char**)malloc(argc * sizeof(char*));
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            report = fopen(argv[++i], "w");
+            if(report == NULL) {
+                perror(argv[i]);
+                return 1;
+            }
+        } else {
+            selected[groups++] = argv[i];
+        }
+    }
+    BENCH_GROUP(BenchCorpus);
+    BENCH_GROUP(BenchEqual);
+    BENCH_GROUP(BenchStringifyNumbers);
+    BENCH_GROUP(BenchLazyNumber);
+    BENCH_GROUP(BenchStringifyStrings);
+    BENCH_GROUP(BenchWriter);
+    BENCH_GROUP(BenchBind);
+    BENCH_GROUP(BenchSchema);
+    BENCH_GROUP(BenchPath);
+    BENCH_GROUP(BenchBinary);
+    BENCH_GROUP(BenchSnapshot);
+    BENCH_GROUP(BenchShared);
+    BENCH_GROUP(BenchCopy);
+    BENCH_GROUP(BenchBulk);
+    BENCH_GROUP(BenchPacked);
+    BENCH_GROUP(BenchPatch);
+    BENCH_GROUP(BenchDiff);
+    BENCH_GROUP(BenchCached);
+    BENCH_GROUP(BenchParallel);
+    BENCH_GROUP(BenchReclaim);
+    if(report != NULL) fclose(report);
+    free(selected);
+    return 0;
+}
@@ -6,7 +6,17 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 #include "../code/tinyjson.h"
+#include "../code/tinybinary.h"
+#include "../code/tinysnapshot.h"
+#include "../code/tinyshared.h"
+#include "../code/tinypatch.h"
+#include "../code/tinybind.h"
+#include "../code/tinyschema.h"
+#include "../code/tinypath.h"
+#include "../code/tinyreclaim.h"
+#include <thread>
 
 static int testCount = 0;
 static int testPass = 0;
@@ -254,11 +264,11 @@ static void TestParseArray() {
     EXPECT_EQ_INT(TINY_ARRAY, TinyGetType(&value));
     EXPECT_EQ_SIZE_T(4,  TinyGetArraySize(&value));
     for(size_t i = 0; i < 4; i++) {
-        TinyValue* arr = TinyGetArrayElement(&value, i);
+        const TinyValue* arr = TinyGetArrayElement(&value, i);
         EXPECT_EQ_INT(TINY_ARRAY, TinyGetType(arr));
         EXPECT_EQ_SIZE_T(i,  TinyGetArraySize(arr));
         for(size_t j = 0; j < i; j++) {
-            TinyValue* e = TinyGetArrayElement(arr, j);
+            const TinyValue* e = TinyGetArrayElement(arr, j);
             EXPECT_EQ_INT(TINY_NUMBER, TinyGetType(e));
             EXPECT_EQ_DOUBLE((double)j, TinyGetNumber(e));
         }
@@ -303,16 +313,16 @@ static void TestParseObject() {
     EXPECT_EQ_INT(TINY_ARRAY, TinyGetType(TinyGetObjectValue(&value, 5)));
     EXPECT_EQ_SIZE_T(3, TinyGetArraySize(TinyGetObjectValue(&value, 5)));
     for (size_t i = 0; i < 3; i++) {
-        TinyValue* e = TinyGetArrayElement(TinyGetObjectValue(&value, 5), i);
+        const TinyValue* e = TinyGetArrayElement(TinyGetObjectValue(&value, 5), i);
         EXPECT_EQ_INT(TINY_NUMBER, TinyGetType(e));
         EXPECT_EQ_DOUBLE(i + 1.0, TinyGetNumber(e));
     }
     EXPECT_EQ_STRING("o", TinyGetObjectKey(&value, 6), TinyGetObjectKeyLength(&value, 6));
     {
-        TinyValue* o = TinyGetObjectValue(&value, 6);
+        const TinyValue* o = TinyGetObjectValue(&value, 6);
         EXPECT_EQ_INT(TINY_OBJECT, TinyGetType(o));
         for (size_t i = 0; i < 3; i++) {
-            TinyValue* ov = TinyGetObjectValue(o, i);
+            const TinyValue* ov = TinyGetObjectValue(o, i);
             EXPECT_TRUE(('1' + (int)i) == TinyGetObjectKey(o, i)[0]);
             EXPECT_EQ_SIZE_T(1, TinyGetObjectKeyLength(o, i));
             EXPECT_EQ_INT(TINY_NUMBER, TinyGetType(ov));
@@ -353,6 +363,217 @@ static void TestParseMissCommaOrCurlyBracket() {
     TEST_PARSE_ERROR(TINY_PARSE_MISS_COMMA_OR_CURLY_BRACKET, "{\"a\": {}");
 }
 
+#define TEST_PARSE_FLAGS(expectReact, expectValType, flags, json)\
+    do {\
+        TinyValue value;\
+        TinyInitValue(&value);\
+        EXPECT_EQ_INT(expectReact, TinyParseWithFlags(&value, json, flags));\
+        EXPECT_EQ_INT(expectValType, TinyGetType(&value));\
+        TinyFree(&value);\
+    } while(0)
+
+static void TestParseFlags() {
+    const unsigned both = TINY_PARSE_FLAG_DEPTH_LIMIT | TINY_PARSE_FLAG_NAN_INF;
+    TinyValue value;
+    TinyInitValue(&value);
+
+    /* 默认与 TinyParse 一致 */
+    TEST_PARSE_FLAGS(TINY_PARSE_OK, TINY_OBJECT, TINY_PARSE_FLAG_DEFAULT, "{\"a\":[1,2]}");
+    TEST_PARSE_FLAGS(TINY_PARSE_INVALID_VALUE, TINY_NULL, TINY_PARSE_FLAG_DEFAULT, "NaN");
+    TEST_PARSE_FLAGS(TINY_PARSE_INVALID_VALUE, TINY_NULL, TINY_PARSE_FLAG_DEFAULT, "-Infinity");
+
+    /* NaN / Infinity */
+    EXPECT_EQ_INT(TINY_PARSE_OK, TinyParseWithFlags(&value, "[NaN, Infinity, -Infinity, -1]", TINY_PARSE_FLAG_NAN_INF));
+    EXPECT_EQ_SIZE_T(4, TinyGetArraySize(&value));
+    EXPECT_TRUE(isnan(TinyGetNumber(TinyGetArrayElement(&value, 0))));
+    EXPECT_TRUE(TinyGetNumber(TinyGetArrayElement(&value, 1)) > 1e308);
+    EXPECT_TRUE(TinyGetNumber(TinyGetArrayElement(&value, 2)) < -1e308);
+    EXPECT_EQ_DOUBLE(-1.0, TinyGetNumber(TinyGetArrayElement(&value, 3)));
+    /* 输出原来的写法, 各种输出方式相同, 可以再读回 */
+    {
+        const char expect[] = "[NaN,Infinity,-Infinity,-1]";
+        size_t len;
+        char* json = TinyStringify(&value, &len);
+        EXPECT_EQ_STRING(expect, json, len);
+        free(json);
+        json = TinyStringifyCached(&value, &len);
+        EXPECT_EQ_STRING(expect, json, len);
+        free(json);
+        json = TinyStringifyParallel(&value, &len, 2);
+        EXPECT_EQ_STRING(expect, json, len);
+        free(json);
+        TinyWriter w;
+        TinyWriterInit(&w);
+        EXPECT_TRUE(TinyWriterValue(&w, &value));
+        const char* written = TinyWriterGetString(&w, &len);
+        EXPECT_EQ_STRING(expect, written, len);
+        TinyWriterFree(&w);
+        TinyValue copy;
+        TinyInitValue(&copy);
+        EXPECT_EQ_INT(TINY_PARSE_OK, TinyParseWithFlags(&copy, expect, TINY_PARSE_FLAG_NAN_INF));
+        EXPECT_TRUE(isnan(TinyGetNumber(TinyGetArrayElement(&copy, 0))));
+        EXPECT_TRUE(TinyGetNumber(TinyGetArrayElement(&copy, 1)) == HUGE_VAL);
+        EXPECT_TRUE(TinyGetNumber(TinyGetArrayElement(&copy, 2)) == -HUGE_VAL);
+        TinyFree(&copy);
+    }
+    TinyFree(&value);
+    TEST_PARSE_FLAGS(TINY_PARSE_INVALID_VALUE, TINY_NULL, TINY_PARSE_FLAG_NAN_INF, "nan");
+    TEST_PARSE_FLAGS(TINY_PARSE_INVALID_VALUE, TINY_NULL, TINY_PARSE_FLAG_NAN_INF, "-NaN");
+    TEST_PARSE_FLAGS(TINY_PARSE_INVALID_VALUE, TINY_NULL, TINY_PARSE_FLAG_NAN_INF, "Inf");
+    TEST_PARSE_FLAGS(TINY_PARSE_ROOT_NOT_SINGULAR, TINY_NULL, TINY_PARSE_FLAG_NAN_INF, "Infinityx");
+
+    /* 嵌套层数 */
+    char* deep = (char*)malloc(2 * TINY_PARSE_MAX_DEPTH + 8);
+    for(size_t depth = TINY_PARSE_MAX_DEPTH; depth <= TINY_PARSE_MAX_DEPTH + 1; depth++) {
+        int expect = depth <= TINY_PARSE_MAX_DEPTH ? TINY_PARSE_OK : TINY_PARSE_DEPTH_EXCEEDED;
+        int type = depth <= TINY_PARSE_MAX_DEPTH ? TINY_ARRAY : TINY_NULL;
+        memset(deep, '[', depth);
+        memset(deep + depth, ']', depth);
+        deep[2 * depth] = '\0';
+        TEST_PARSE_FLAGS(expect, type, TINY_PARSE_FLAG_DEPTH_LIMIT, deep);
+        TEST_PARSE_FLAGS(expect, type, both, deep);
+        TEST_PARSE(TINY_PARSE_OK, TINY_ARRAY, deep);
+        /* 对象和数组都算一层 */
+        deep[depth - 1] = '{';
+        deep[depth] = '}';
+        TEST_PARSE_FLAGS(expect, type, TINY_PARSE_FLAG_DEPTH_LIMIT, deep);
+    }
+    free(deep);
+}
+
+#define TEST_UTF8(expectReact, json)\
+    do {\
+        TinyValue value;\
+        TinyInitValue(&value);\
+        EXPECT_EQ_INT(expectReact, TinyParseWithFlags(&value, json, TINY_PARSE_FLAG_VALIDATE_UTF8));\
+        TinyFree(&value);\
+        EXPECT_EQ_INT(TINY_PARSE_OK, TinyParse(&value, json));\
+        TinyFree(&value);\
+    } while(0)
+
+static void TestParseValidateUtf8() {
+    TEST_UTF8(TINY_PARSE_OK, "\"\xC2\xA9 \xE2\x82\xAC \xF0\x9F\x98\x80\"");
+    TEST_UTF8(TINY_PARSE_OK, "\"\xED\x9F\xBF\xEE\x80\x80\xF4\x8F\xBF\xBF\"");    /* U+D7FF U+E000 U+10FFFF */
+    TEST_UTF8(TINY_PARSE_OK, "{\"caf\xC3\xA9\":[\"\xE6\x97\xA5\xE6\x9C\xAC\\n\xE8\xAA\x9E\"]}");
+    TEST_UTF8(TINY_PARSE_INVALID_UTF8, "\"\x80\"");                 /* 单独的后续字节 */
+    TEST_UTF8(TINY_PARSE_INVALID_UTF8, "\"\xC0\xAF\"");             /* 超长编码 */
+    TEST_UTF8(TINY_PARSE_INVALID_UTF8, "\"\xC1\xBF\"");
+    TEST_UTF8(TINY_PARSE_INVALID_UTF8, "\"\xE0\x80\xAF\"");
+    TEST_UTF8(TINY_PARSE_INVALID_UTF8, "\"\xF0\x80\x80\xAF\"");
+    TEST_UTF8(TINY_PARSE_INVALID_UTF8, "\"\xED\xA0\x80\"");         /* U+D800 */
+    TEST_UTF8(TINY_PARSE_INVALID_UTF8, "\"\xF4\x90\x80\x80\"");     /* > U+10FFFF */
+    TEST_UTF8(TINY_PARSE_INVALID_UTF8, "\"\xF5\x80\x80\x80\"");
+    TEST_UTF8(TINY_PARSE_INVALID_UTF8, "\"\xFF\"");
+    TEST_UTF8(TINY_PARSE_INVALID_UTF8, "\"\xE2\x82\"");             /* 不完整 */
+    TEST_UTF8(TINY_PARSE_INVALID_UTF8, "\"\xE2\x82\\n\xAC\"");
+    TEST_UTF8(TINY_PARSE_INVALID_UTF8, "\"\xC3\x28\"");
+    TEST_UTF8(TINY_PARSE_INVALID_UTF8, "{\"\xC3\":1}");
+    TEST_UTF8(TINY_PARSE_INVALID_UNICODE_SURROGATE, "\"\\uDC00\"");
+    TEST_UTF8(TINY_PARSE_OK, "\"\\uD83D\\uDE00\\u00E9\"");
+
+    /* 各种对齐和长度下整段扫描与校验的结果一致 */
+    char* buf = (char*)malloc(128);
+    for(size_t off = 0; off < 16; off++) {
+        for(size_t n = 0; n < 48; n++) {
+            TinyValue value;
+            char* json = buf + off;
+            json[0] = '"';
+            memset(json + 1, 'a', n);
+            memcpy(json + 1 + n, "\xC3\xA9\"", 4);
+            TinyInitValue(&value);
+            EXPECT_EQ_INT(TINY_PARSE_OK, TinyParseWithFlags(&value, json, TINY_PARSE_FLAG_VALIDATE_UTF8));
+            EXPECT_EQ_SIZE_T(n + 2, TinyGetStringLength(&value));
+            TinyFree(&value);
+            json[1 + n + 1] = '"';
+            json[1 + n + 2] = '\0';
+            EXPECT_EQ_INT(TINY_PARSE_INVALID_UTF8, TinyParseWithFlags(&value, json, TINY_PARSE_FLAG_VALIDATE_UTF8));
+        }
+    }
+    free(buf);
+}
+
+/* 原文原样输出, 取值与 TinyParse 相同 */
+#define TEST_LAZY_NUMBER(expectNum, json)\
+    do {\
+        TinyValue value;\
+        size_t len;\
+        TinyInitValue(&value);\
+        EXPECT_EQ_INT(TINY_PARSE_OK, TinyParseWithFlags(&value, json, TINY_PARSE_FLAG_LAZY_NUMBER));\
+        EXPECT_EQ_INT(TINY_NUMBER, TinyGetType(&value));\
+        EXPECT_EQ_DOUBLE(expectNum, TinyGetNumber(&value));\
+        EXPECT_TRUE(TinyGetNumberText(&value, &len) != NULL);\
+        char* out = TinyStringify(&value, &len);\
+        EXPECT_EQ_STRING(json, out, len);\
+        free(out);\
+        TinyFree(&value);\
+    } while(0)
+
+static void TestParseLazyNumber() {
+    TEST_LAZY_NUMBER(0.0, "0");
+    TEST_LAZY_NUMBER(0.0, "-0");
+    TEST_LAZY_NUMBER(1.0, "1.0");
+    TEST_LAZY_NUMBER(-1.5, "-1.50");
+    TEST_LAZY_NUMBER(1e10, "1E+10");
+    TEST_LAZY_NUMBER(123456789012345.0, "123456789012345");
+    TEST_LAZY_NUMBER(-123456789012345.0, "-123456789012345");
+    TEST_LAZY_NUMBER(1.0000000000000002, "1.0000000000000002");
+    TEST_LAZY_NUMBER(1.7976931348623157e+308, "1.7976931348623157e+308");
+    /* 放不下 numText 的原文单独存放 */
+    TEST_LAZY_NUMBER(12345678901234567890.0, "12345678901234567890");
+    TEST_LAZY_NUMBER(3.14159265358979323846, "3.141592653589793238462643383279502884197");
+    TEST_LAZY_NUMBER(-0.1, "-0.100000000000000000000000000000000000000000000000000");
+    TEST_LAZY_NUMBER(1e308, "0.0001e312");
+    TEST_LAZY_NUMBER(0.0, "0.000e99999");
+    /* 接受的输入与 TinyParse 相同: 超出范围同样报错 */
+    const char* ranges[] = { "1e309", "-1e309", "1.8e308", "-1.8e308", "17976931348623159e292", "1e99999999999999999999",
+                             "1.7976931348623157e308", "17976931348623157e292", "0.1e309", "1e-400", "123e306" };
+    for(size_t i = 0; i < sizeof(ranges) / sizeof(ranges[0]); i++) {
+        TinyValue v;
+        TinyInitValue(&v);
+        int expect = TinyParse(&v, ranges[i]);
+        TinyFree(&v);
+        EXPECT_EQ_INT(expect, TinyParseWithFlags(&v, ranges[i], TINY_PARSE_FLAG_LAZY_NUMBER));
+        TinyFree(&v);
+    }
+    TEST_PARSE_FLAGS(TINY_PARSE_NUMBER_TOO_BIG, TINY_NULL, TINY_PARSE_FLAG_LAZY_NUMBER, "1e309");
+    TEST_PARSE_FLAGS(TINY_PARSE_NUMBER_TOO_BIG, TINY_NULL, TINY_PARSE_FLAG_LAZY_NUMBER, "-1e309");
+    TEST_PARSE_FLAGS(TINY_PARSE_NUMBER_TOO_BIG, TINY_NULL, TINY_PARSE_FLAG_LAZY_NUMBER, "[1,1e309]");
+    TEST_PARSE_FLAGS(TINY_PARSE_INVALID_VALUE, TINY_NULL, TINY_PARSE_FLAG_LAZY_NUMBER, "01");
+    TEST_PARSE_FLAGS(TINY_PARSE_INVALID_VALUE, TINY_NULL, TINY_PARSE_FLAG_LAZY_NUMBER, "1.");
+    TEST_PARSE_FLAGS(TINY_PARSE_INVALID_VALUE, TINY_NULL, TINY_PARSE_FLAG_LAZY_NUMBER, "-");
+    TEST_PARSE_FLAGS(TINY_PARSE_INVALID_VALUE, TINY_NULL, TINY_PARSE_FLAG_LAZY_NUMBER, "1e");
+    TEST_PARSE_FLAGS(TINY_PARSE_OK, TINY_ARRAY, TINY_PARSE_FLAG_LAZY_NUMBER | TINY_PARSE_FLAG_NAN_INF, "[NaN,1.0]");
+
+    /* 只有修改过的数字重新格式化; 数组不转为紧凑存储 */
+    const char json[] = "{\"id\":12345678901234567890,\"price\":9.90,\"list\":[1.0,2.50,1e2],\"n\":7}";
+    TinyValue value, copy, plain;
+    size_t len;
+    TinyInitValue(&value);
+    TinyInitValue(&copy);
+    TinyInitValue(&plain);
+    EXPECT_EQ_INT(TINY_PARSE_OK, TinyParseWithFlags(&value, json, TINY_PARSE_FLAG_LAZY_NUMBER));
+    EXPECT_TRUE(TinyGetArrayDoubles(TinyFindObjectValue(&value, "list", 4), NULL) == NULL);
+    TinyCopy(&copy, &value);
+    TinySetNumber(TinySetObjectValue(&value, "n", 1), 8);
+    char* out = TinyStringify(&value, &len);
+    EXPECT_EQ_STRING("{\"id\":12345678901234567890,\"price\":9.90,\"list\":[1.0,2.50,1e2],\"n\":8}", out, len);
+    free(out);
+    out = TinyStringify(&copy, &len);
+    EXPECT_EQ_STRING(json, out, len);
+    free(out);
+    EXPECT_TRUE(TinyGetNumberText(TinyFindObjectValue(&value, "n", 1), NULL) == NULL);
+
+    /* 比较和哈希按数值 */
+    EXPECT_EQ_INT(TINY_PARSE_OK, TinyParse(&plain, json));
+    EXPECT_TRUE(TinyIsEqual(&copy, &plain));
+    EXPECT_TRUE(TinyHash(&copy) == TinyHash(&plain));
+    EXPECT_TRUE(TinyPackArray(TinySetObjectValue(&copy, "list", 4)));
+    EXPECT_EQ_DOUBLE(2.5, TinyGetArrayDoubles(TinyFindObjectValue(&copy, "list", 4), NULL)[1]);
+    TinyFree(&value);
+    TinyFree(&copy);
+    TinyFree(&plain);
+}
+
 static void TestAccessBool() {
     TinyValue value;
     TinyInitValue(&value);
@@ -467,7 +688,8 @@ static void TestAccessArray() {
 }
 
 static void TestAccessObject() {
-    TinyValue o, v, *pv;
+    TinyValue o, v;
+    const TinyValue* pv;
     size_t i, j, index;
 
     TinyInitValue(&o);
@@ -546,15 +768,66 @@ static void TestStringifyNumber() {
     TEST_ROUNDTRIP("1.234e+20");
     TEST_ROUNDTRIP("1.234e-20");
 
+    TEST_ROUNDTRIP("0.1");
+    TEST_ROUNDTRIP("0.3");
+    TEST_ROUNDTRIP("0.0001");
+    TEST_ROUNDTRIP("1e-05");
+    TEST_ROUNDTRIP("12345678901234568");
+    TEST_ROUNDTRIP("1.2345678901234568e+17");
+    TEST_ROUNDTRIP("1e+17");
+    TEST_ROUNDTRIP("9007199254740991");
+    TEST_ROUNDTRIP("-9007199254740992");
+
     TEST_ROUNDTRIP("1.0000000000000002");       /* the smallest number > 1 */
-    TEST_ROUNDTRIP("4.9406564584124654e-324");   /* minimum denormal */
-    TEST_ROUNDTRIP("-4.9406564584124654e-324");
-    TEST_ROUNDTRIP("2.2250738585072009e-308");  /* Max subnormal double */
-    TEST_ROUNDTRIP("-2.2250738585072009e-308");
+    TEST_ROUNDTRIP("5e-324");                   /* minimum denormal */
+    TEST_ROUNDTRIP("-5e-324");
+    TEST_ROUNDTRIP("2.225073858507201e-308");   /* Max subnormal double */
+    TEST_ROUNDTRIP("-2.225073858507201e-308");
     TEST_ROUNDTRIP("2.2250738585072014e-308"); /* Min normal positive double */
     TEST_ROUNDTRIP("-2.2250738585072014e-308");
     TEST_ROUNDTRIP("1.7976931348623157e+308"); /* Max double */
     TEST_ROUNDTRIP("-1.7976931348623157e+308");
+
+    /* NaN and infinities must not reach the finite formatting path */
+    const double special[] = { NAN, HUGE_VAL, -HUGE_VAL };
+    const char* texts[] = { "NaN", "Infinity", "-Infinity" };
+    for(int i = 0; i < 3; i++) {
+        TinyValue v;
+        size_t len;
+        TinyInitValue(&v);
+        TinySetNumber(&v, special[i]);
+        char* json = TinyStringify(&v, &len);
+        EXPECT_EQ_SIZE_T(strlen(texts[i]), len);
+        EXPECT_TRUE(memcmp(texts[i], json, len) == 0);
+        free(json);
+    }
+}
+
+static void TestStringifyNumberRandom() {
+    /* every finite double must re-parse to the same bits, never longer than %.17g */
+    unsigned long long seed = 0x853C49E6748FEA9BULL;
+    for(int i = 0; i < 100000; i++) {
+        TinyValue value, back;
+        unsigned long long bits;
+        double d;
+        char ref[32];
+        size_t len;
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        bits = seed ^ (seed >> 29);
+        memcpy(&d, &bits, sizeof(d));
+        if(d != d || d - d != 0) continue;    /* NaN, Inf */
+
+        TinyInitValue(&value);
+        TinySetNumber(&value, d);
+        char* json = TinyStringify(&value, &len);
+        EXPECT_EQ_INT(TINY_PARSE_OK, TinyParse(&back, json));
+        d = TinyGetNumber(&back);
+        EXPECT_TRUE(memcmp(&d, &value.num, sizeof(d)) == 0);
+        EXPECT_TRUE(len <= (size_t)sprintf(ref, "%.17g", value.num));
+        free(json);
+        TinyFree(&value);
+        TinyFree(&back);
+    }
 }
 
 static void TestStringifyString() {
@@ -563,6 +836,50 @@ static void TestStringifyString() {
     TEST_ROUNDTRIP("\"Hello\\nWorld\"");
     TEST_ROUNDTRIP("\"\\\" \\\\ / \\b \\f \\n \\r \\t\"");
     TEST_ROUNDTRIP("\"Hello\\u0000World\"");
+
+    /* escapes that decode to bytes needing no escaping are written back raw */
+    TinyValue value;
+    size_t len;
+    TinyInitValue(&value);
+    EXPECT_EQ_INT(TINY_PARSE_OK, TinyParse(&value, "{\"\\/\":\"\\/\\u00E9\\u0041\"}"));
+    char* json = TinyStringify(&value, &len);
+    EXPECT_EQ_STRING("{\"/\":\"/\xC3\xA9" "A\"}", json, len);
+    free(json);
+    TinyFree(&value);
+}
+
+static void TestStringifyStringEscapes() {
+    /* a single special byte at every offset around the 16-byte scan blocks */
+    const char specials[] = { '"', '\\', '\n', '\x01', '\x1f', '\x7f', '\xc3' };
+    const size_t extra[] = { 1, 1, 1, 5, 5, 0, 0 };
+    for(size_t k = 0; k < sizeof(specials); k++) {
+        for(size_t pos = 0; pos < 40; pos++) {
+            char str[40];
+            size_t len;
+            TinyValue v1, v2;
+            memset(str, 'a', sizeof(str));
+            str[pos] = specials[k];
+            TinyInitValue(&v1);
+            TinySetString(&v1, str, sizeof(str));
+            char* json = TinyStringify(&v1, &len);
+            EXPECT_EQ_SIZE_T(sizeof(str) + 2 + extra[k], len);
+            EXPECT_EQ_INT(TINY_PARSE_OK, TinyParse(&v2, json));
+            EXPECT_TRUE(TinyIsEqual(&v1, &v2));
+            free(json);
+            /* the same bytes as an object key */
+            TinySetObject(&v1, 1);
+            TinySetNull(TinySetObjectValue(&v1, str, sizeof(str)));
+            TinyFree(&v2);
+            json = TinyStringify(&v1, &len);
+            EXPECT_EQ_SIZE_T(sizeof(str) + 9 + extra[k], len);
+            EXPECT_EQ_INT(TINY_PARSE_OK, TinyParse(&v2, json));
+            EXPECT_TRUE(TinyIsEqual(&v1, &v2));
+            free(json);
+            TinyFree(&v1);
+            TinyFree(&v2);
+        }
+    }
+    TEST_ROUNDTRIP("\"\\u001F\\u0001\\\"\\\\\\b\\f\\n\\r\\tabcdefghijklmnopqrstuvwxyz\\u0010\"");
 }
 
 static void TestStringifyArray() {
@@ -572,9 +889,315 @@ static void TestStringifyArray() {
 
 static void TestStringifyObject() {
     TEST_ROUNDTRIP("{}");
+    TEST_ROUNDTRIP("{\"a\\\"b\":\"\\u0001\",\"\\n\":\"\\t\",\"\\u001F\\\\\":[\"\\\"\"]}");
     TEST_ROUNDTRIP("{\"n\":null,\"f\":false,\"t\":true,\"i\":123,\"s\":\"abc\",\"a\":[1,2,3],\"o\":{\"1\":1,\"2\":2,\"3\":3}}");
 }
 
+/* a document with long strings that need escaping, long clean strings and nesting */
+static void MakeStreamDocument(TinyValue* value) {
+    char* big = (char*)malloc(20000);
+    TinyInitValue(value);
+    TinySetObject(value, 0);
+    for(size_t i = 0; i < 20000; i++) big[i] = "abc\"\\\n\x01xyz"[i % 10];
+    TinySetString(TinySetObjectValue(value, "escaped", 7), big, 20000);
+    memset(big, 'k', 20000);
+    TinySetString(TinySetObjectValue(value, "clean", 5), big, 10000);
+    TinyValue* a = TinySetObjectValue(value, big, 5000);
+    TinySetArray(a, 0);
+    for(size_t i = 0; i < 100; i++) {
+        TinyValue* e = TinyPushBackArrayElement(a);
+        TinySetObject(e, 0);
+        TinySetNumber(TinySetObjectValue(e, "i", 1), (double)i);
+        TinySetString(TinySetObjectValue(e, "s", 1), big, i * 10);
+        TinySetArray(TinySetObjectValue(e, "a", 1), 0);
+    }
+    free(big);
+}
+
+static void TestStringifyStream() {
+    TinyValue value;
+    size_t len;
+    MakeStreamDocument(&value);
+    char* expect = TinyStringify(&value, &len);
+    char* out = (char*)malloc(len + 1);
+
+    const size_t sizes[] = { 1, 7, 4096, 100000 };
+    for(size_t k = 0; k < sizeof(sizes) / sizeof(sizes[0]); k++) {
+        TinyStringifier s;
+        size_t n = 0, w;
+        TinyStringifierInit(&s, &value);
+        while((w = TinyStringifierWrite(&s, out + n, len - n < sizes[k] ? len - n : sizes[k])) > 0) {
+            n += w;
+        }
+        EXPECT_TRUE(TinyStringifierDone(&s));
+        EXPECT_EQ_SIZE_T(len, n);
+        EXPECT_TRUE(memcmp(expect, out, len) == 0);
+        TinyStringifierFree(&s);
+    }
+
+    TinyIovecList list;
+    TinyStringifyIovec(&value, &list);
+    size_t n = 0;
+    bool referenced = false;
+    for(size_t i = 0; i < list.count; i++) {
+        memcpy(out + n, list.iov[i].base, list.iov[i].len);
+        n += list.iov[i].len;
+        referenced |= list.iov[i].base == TinyGetString(TinyFindObjectValue(&value, "clean", 5));
+    }
+    EXPECT_EQ_SIZE_T(len, n);
+    EXPECT_TRUE(memcmp(expect, out, len) == 0);
+    EXPECT_TRUE(referenced);
+    EXPECT_EQ_SIZE_T(75, list.direct);
+    TinyFreeIovecList(&list);
+
+    FILE* fp = tmpfile();
+    EXPECT_EQ_INT(TINY_STRINGIFY_OK, TinyStringifyFile(&value, fp));
+#if TINY_HAS_POSIX
+    fflush(fp);
+    EXPECT_EQ_INT(TINY_STRINGIFY_OK, TinyStringifyFd(&value, fileno(fp)));
+    EXPECT_EQ_INT(TINY_STRINGIFY_OK, TinyStringifyWritev(&value, fileno(fp)));
+    const int copies = 3;
+#else
+    const int copies = 1;
+#endif
+    rewind(fp);
+    for(int c = 0; c < copies; c++) {
+        EXPECT_EQ_SIZE_T(len, fread(out, 1, len, fp));
+        EXPECT_TRUE(memcmp(expect, out, len) == 0);
+    }
+    EXPECT_EQ_SIZE_T(0, fread(out, 1, 1, fp));
+    fclose(fp);
+
+    free(out);
+    free(expect);
+    TinyFree(&value);
+}
+
+#define EXPECT_CACHED_OUTPUT(value) \
+    do {\
+        size_t len1, len2;\
+        char* json1 = TinyStringify(value, &len1);\
+        char* json2 = TinyStringifyCached(value, &len2);\
+        EXPECT_EQ_SIZE_T(len1, len2);\
+        EXPECT_TRUE(len1 == len2 && memcmp(json1, json2, len1) == 0);\
+        free(json1);\
+        free(json2);\
+    } while(0)
+
+static void TestStringifyCached() {
+    TinyValue value, copy;
+    TinyInitValue(&value);
+    TinyInitValue(&copy);
+    EXPECT_EQ_INT(TINY_PARSE_OK, TinyParse(&value,
+        "{\"users\":[{\"id\":1,\"name\":\"alice\",\"tags\":[\"a\",\"b\\n\"]},{\"id\":2,\"name\":\"bob\",\"tags\":[]}],"
+        "\"points\":[1.5,2.5,3.5,4.5,5.5,6.5,7.5,8.5,9.5,10.5,11.5,12.5,13.5,14.5],"
+        "\"meta\":{\"version\":3,\"description\":\"a document that is long enough to be cached\"}}"));
+    EXPECT_CACHED_OUTPUT(&value);
+    EXPECT_CACHED_OUTPUT(&value);
+
+    /* every change goes through the parents, each round compares against a full stringify */
+    for(int round = 0; round < 300; round++) {
+        int r = rand();
+        TinyValue* users = TinySetObjectValue(&value, "users", 5);
+        size_t n = TinyGetArraySize(users);
+        switch(r % 8) {
+            case 0: if(n > 0) TinySetNumber(TinySetObjectValue(TinySetArrayElement(users, r / 8 % n), "id", 2), r % 1000); break;
+            case 1: if(n > 0) TinySetString(TinySetObjectValue(TinySetArrayElement(users, r / 8 % n), "name", 4), "\"quoted\"", 8); break;
+            case 2: if(n > 0) TinySetString(TinyPushBackArrayElement(TinySetObjectValue(TinySetArrayElement(users, r / 8 % n), "tags", 4)), "t", 1); break;
+            case 3: if(n > 1) TinyEraseArrayElement(users, r / 8 % n, 1); break;
+            case 4:
+            {
+                TinyValue* u = TinyPushBackArrayElement(users);
+                TinySetObject(u, 0);
+                TinySetNumber(TinySetObjectValue(u, "id", 2), r % 1000);
+                TinySetArray(TinySetObjectValue(u, "tags", 4), 0);
+                break;
+            }
+            case 5:
+            {
+                double num = r % 100;
+                TinyAppendArrayNumbers(TinySetObjectValue(&value, "points", 6), &num, 1);
+                break;
+            }
+            case 6: TinySetNumber(TinySetArrayElement(TinySetObjectValue(&value, "points", 6), 0), r % 7); break;
+            default: TinySetNumber(TinySetObjectValue(TinySetObjectValue(&value, "meta", 4), "version", 7), round); break;
+        }
+        EXPECT_CACHED_OUTPUT(&value);
+        if(round % 50 == 0) TinyPackArray(TinySetObjectValue(&value, "points", 6));
+    }
+
+    /* child pointers kept across cached stringifies: the ancestors' output must not go stale */
+    {
+        TinyValue root;
+        char key[8];
+        TinyInitValue(&root);
+        TinySetObject(&root, 0);
+        TinyValue* c = TinySetObjectValue(&root, "child", 5);
+        TinySetObject(c, 0);
+        for(int i = 0; i < 20; i++) {
+            snprintf(key, sizeof(key), "k%02d", i);
+            TinySetNumber(TinySetObjectValue(c, key, 3), i);
+        }
+        TinyValue* deep = TinySetObjectValue(c, "deep", 4);
+        TinySetArray(deep, 0);
+        for(int i = 0; i < 20; i++) TinySetNumber(TinyPushBackArrayElement(deep), i);
+        EXPECT_CACHED_OUTPUT(&root);
+        TinySetNumber(TinySetObjectValue(c, "k00", 3), 999);
+        EXPECT_CACHED_OUTPUT(&root);
+        EXPECT_CACHED_OUTPUT(&root);
+        TinySetString(TinySetArrayElement(deep, 3), "three", 5);
+        EXPECT_CACHED_OUTPUT(&root);
+        TinyPopBackArrayElement(deep);
+        EXPECT_CACHED_OUTPUT(&root);
+        TinyFree(&root);
+    }
+
+    /* copies share storage and its cached output until one side is changed */
+    TinyCopy(&copy, &value);
+    EXPECT_CACHED_OUTPUT(&copy);
+    TinySetString(TinySetObjectValue(TinySetObjectValue(&copy, "meta", 4), "description", 11), "changed", 7);
+    EXPECT_CACHED_OUTPUT(&copy);
+    EXPECT_CACHED_OUTPUT(&value);
+    EXPECT_FALSE(TinyIsEqual(&value, &copy));
+    TinyRemoveObjectValue(&copy, TinyFindObjectIndex(&copy, "users", 5));
+    EXPECT_CACHED_OUTPUT(&copy);
+    TinyClearObject(&value);
+    EXPECT_CACHED_OUTPUT(&value);
+    TinyFree(&value);
+    TinyFree(&copy);
+}
+
+/* parallel output, concatenated or as segments, must match TinyStringify byte for byte */
+#define EXPECT_PARALLEL_OUTPUT(value, threads)\
+    do {\
+        size_t len1, len2, n = 0;\
+        char* json1 = TinyStringify(value, &len1);\
+        char* json2 = TinyStringifyParallel(value, &len2, threads);\
+        EXPECT_EQ_SIZE_T(len1, len2);\
+        EXPECT_TRUE(len1 == len2 && memcmp(json1, json2, len1 + 1) == 0);\
+        TinyIovecList list;\
+        TinyStringifyParallelIovec(value, &list, threads);\
+        for(size_t i = 0; i < list.count; i++) {\
+            EXPECT_TRUE(n + list.iov[i].len <= len1 && memcmp(json1 + n, list.iov[i].base, list.iov[i].len) == 0);\
+            n += list.iov[i].len;\
+        }\
+        EXPECT_EQ_SIZE_T(len1, n);\
+        TinyFreeIovecList(&list);\
+        free(json1);\
+        free(json2);\
+    } while(0)
+
+static void TestStringifyParallel() {
+    const char* docs[] = {
+        "null", "\"s\"", "[]", "{}", "[[]]", "[1]", "[1.5,2,3]", "{\"a\":{},\"b\":[]}",
+        "{\"k\\n\":[1,{\"x\\\"\":\"y\"}],\"e\":[[],{}],\"s\":\"\\u00e9\"}",
+        /* few members, one large child: the split goes deeper */
+        "{\"meta\":1,\"data\":[{\"id\":1},{\"id\":2},{\"id\":3},{\"id\":4},{\"id\":5},{\"id\":6},{\"id\":7},{\"id\":8},"
+        "{\"id\":9},{\"id\":10},{\"id\":11},{\"id\":12},{\"id\":13},{\"id\":14},{\"id\":15},{\"id\":16},{\"id\":17}]}",
+    };
+    const unsigned threads[] = { 0, 1, 2, 3, 8, 64 };
+    TinyValue value;
+    TinyInitValue(&value);
+    for(size_t d = 0; d < sizeof(docs) / sizeof(docs[0]); d++) {
+        EXPECT_EQ_INT(TINY_PARSE_OK, TinyParse(&value, docs[d]));
+        for(size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++) {
+            EXPECT_PARALLEL_OUTPUT(&value, threads[t]);
+        }
+        TinyFree(&value);
+    }
+
+    /* large flat, packed and nested containers */
+    TinySetArray(&value, 0);
+    for(int i = 0; i < 1000; i++) {
+        TinyValue* o = TinyPushBackArrayElement(&value);
+        TinySetObject(o, 0);
+        TinySetNumber(TinySetObjectValue(o, "id", 2), i);
+        TinySetString(TinySetObjectValue(o, "s", 1), "a\tb", 3);
+    }
+    double nums[5000];
+    for(int i = 0; i < 5000; i++) nums[i] = i * 0.25;
+    TinyValue* packed = TinyPushBackArrayElement(&value);
+    TinySetArray(packed, 0);
+    EXPECT_TRUE(TinyPackArray(packed));
+    TinyAppendArrayNumbers(packed, nums, 5000);
+    EXPECT_TRUE(TinyGetArrayDoubles(packed, NULL) != NULL);
+    for(size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++) {
+        EXPECT_PARALLEL_OUTPUT(&value, threads[t]);
+        EXPECT_PARALLEL_OUTPUT(packed, threads[t]);
+    }
+
+    /* callers on several threads share the worker pool; whoever finds it busy works alone */
+    size_t expectLen;
+    char* expect = TinyStringify(&value, &expectLen);
+    int mismatches[4] = { 0 };
+    std::thread callers[4];
+    for(int c = 0; c < 4; c++) {
+        callers[c] = std::thread([&value, expect, expectLen, &mismatches, c]() {
+            for(int r = 0; r < 20; r++) {
+                size_t len;
+                char* out = TinyStringifyParallel(&value, &len, 4);
+                if(len != expectLen || memcmp(out, expect, len) != 0) mismatches[c]++;
+                free(out);
+            }
+        });
+    }
+    for(int c = 0; c < 4; c++) {
+        callers[c].join();
+        EXPECT_EQ_INT(0, mismatches[c]);
+    }
+    free(expect);
+    TinyFree(&value);
+}
+
+static void TestWriter() {
+    TinyWriter w;
+    TinyValue v;
+    size_t len;
+    TinyInitValue(&v);
+    TinyParse(&v, "{\"x\":[1,{}]}");
+    TinyWriterInit(&w);
+    EXPECT_TRUE(TinyWriterGetString(&w, &len) == NULL);
+    EXPECT_FALSE(TinyWriterKey(&w, "a", 1));
+    EXPECT_TRUE(TinyWriterStartObject(&w));
+    EXPECT_FALSE(TinyWriterNull(&w));            /* value without key */
+    EXPECT_FALSE(TinyWriterEndArray(&w));
+    EXPECT_TRUE(TinyWriterKey(&w, "n", 1));
+    EXPECT_FALSE(TinyWriterKey(&w, "m", 1));     /* key after key */
+    EXPECT_FALSE(TinyWriterEndObject(&w));
+    EXPECT_TRUE(TinyWriterNull(&w));
+    EXPECT_TRUE(TinyWriterKey(&w, "b", 1));
+    EXPECT_TRUE(TinyWriterBool(&w, true));
+    EXPECT_TRUE(TinyWriterKey(&w, "s\n", 2));
+    EXPECT_TRUE(TinyWriterString(&w, "a\"b", 3));
+    EXPECT_TRUE(TinyWriterKey(&w, "a", 1));
+    EXPECT_TRUE(TinyWriterStartArray(&w));
+    EXPECT_FALSE(TinyWriterKey(&w, "a", 1));
+    EXPECT_FALSE(TinyWriterEndObject(&w));
+    EXPECT_TRUE(TinyWriterNumber(&w, 1.5));
+    EXPECT_TRUE(TinyWriterNumber(&w, 1.0 / 0.0));
+    EXPECT_TRUE(TinyWriterInt64(&w, -9223372036854775807LL - 1));
+    EXPECT_TRUE(TinyWriterInt64(&w, 0));
+    EXPECT_TRUE(TinyWriterStartArray(&w));
+    EXPECT_TRUE(TinyWriterEndArray(&w));
+    EXPECT_TRUE(TinyWriterValue(&w, &v));
+    EXPECT_TRUE(TinyWriterBool(&w, false));
+    EXPECT_TRUE(TinyWriterEndArray(&w));
+    EXPECT_FALSE(TinyWriterIsComplete(&w));
+    EXPECT_TRUE(TinyWriterEndObject(&w));
+    EXPECT_TRUE(TinyWriterIsComplete(&w));
+    EXPECT_FALSE(TinyWriterNull(&w));            /* second root */
+    const char* json = TinyWriterGetString(&w, &len);
+    EXPECT_EQ_STRING("{\"n\":null,\"b\":true,\"s\\n\":\"a\\\"b\",\"a\":[1.5,Infinity,-9223372036854775808,0,[],{\"x\":[1,{}]},false]}", json, len);
+
+    TinyWriterReset(&w);
+    EXPECT_TRUE(TinyWriterString(&w, "", 0));
+    json = TinyWriterGetString(&w, &len);
+    EXPECT_EQ_STRING("\"\"", json, len);
+    EXPECT_TRUE(json[len] == '\0');
+    TinyWriterFree(&w);
+    TinyFree(&v);
+}
+
 static void TestParse() {
     TestParseOk();
     TestParseNumber();
@@ -599,9 +1222,169 @@ static void TestParse() {
     TestParseMissKey();
     TestParseMissColon();
     TestParseMissCommaOrCurlyBracket();
+    TestParseFlags();
+    TestParseValidateUtf8();
+    TestParseLazyNumber();
     TestParseObject();
 }
 
+static void TestAccessBulk() {
+    TinyValue a, o, expect;
+    TinyInitValue(&a);
+    TinyInitValue(&o);
+    TinyInitValue(&expect);
+    const double nums[] = { 1.5, 2.5 };
+    const int64_t ints[] = { -3, 4 };
+    const char* strs[] = { "a", "bc\0d" };
+    const size_t lens[] = { 1, 4 };
+    TinySetArray(&a, 0);
+    TinyAppendArrayNumbers(&a, nums, 2);
+    TinyAppendArrayInt64s(&a, ints, 2);
+    TinyAppendArrayStrings(&a, strs, lens, 2);
+    TinyAppendArrayStrings(&a, strs, NULL, 2);
+    TinyAppendArrayNumbers(&a, NULL, 0);
+    TinyParse(&expect, "[1.5,2.5,-3,4,\"a\",\"bc\\u0000d\",\"a\",\"bc\"]");
+    EXPECT_TRUE(TinyIsEqual(&expect, &a));
+
+    TinyValue* e = TinyInsertArrayElements(&a, 1, 3);
+    EXPECT_EQ_INT(TINY_NULL, TinyGetType(&e[0]));
+    TinySetNumber(&e[2], 9);
+    TinyInsertArrayElements(&a, TinyGetArraySize(&a), 1);
+    TinyEraseArrayElement(&a, 4, 6);
+    TinyFree(&expect);
+    TinyParse(&expect, "[1.5,null,null,9,\"bc\",null]");
+    EXPECT_TRUE(TinyIsEqual(&expect, &a));
+    TinySetString(TinyInsertArrayElement(&a, 0), "first", 5);
+    EXPECT_EQ_STRING("first", TinyGetString(TinyGetArrayElement(&a, 0)), 5);
+    EXPECT_EQ_DOUBLE(1.5, TinyGetNumber(TinyGetArrayElement(&a, 1)));
+    EXPECT_EQ_SIZE_T(7, TinyGetArraySize(&a));
+
+    const char* keys[] = { "x", "y", "z" };
+    TinySetObjectFromArrays(&o, keys, NULL, TinyGetArrayElement(&a, 1), 3);
+    TinyFree(&expect);
+    TinyParse(&expect, "{\"x\":1.5,\"y\":null,\"z\":null}");
+    EXPECT_TRUE(TinyIsEqual(&expect, &o));
+    const size_t klens[] = { 1, 1 };
+    TinySetObjectFromArrays(&o, keys, klens, NULL, 2);
+    EXPECT_EQ_SIZE_T(2, TinyGetObjectSize(&o));
+    EXPECT_EQ_INT(TINY_NULL, TinyGetType(TinyFindObjectValue(&o, "y", 1)));
+    TinyFree(&a);
+    TinyFree(&o);
+    TinyFree(&expect);
+}
+
+static void TestAccessPacked() {
+    TinyValue a, b;
+    size_t size;
+    TinyInitValue(&a);
+    TinyInitValue(&b);
+    /* TinyParse 不做紧凑存储: 元素是数组里真实的值, 多次取得的指针不变 */
+    EXPECT_EQ_INT(TINY_PARSE_OK, TinyParse(&a, "[1.5, -2, 0, 1e300]"));
+    EXPECT_TRUE(TinyGetArrayDoubles(&a, NULL) == NULL);
+    const TinyValue* first = TinyGetArrayElement(&a, 0);
+    for(int i = 0; i < 20; i++) TinyGetArrayElement(&a, i % 4);
+    EXPECT_TRUE(first == TinyGetArrayElement(&a, 0));
+    TinySetNumber(TinySetArrayElement(&a, 0), 42);
+    EXPECT_EQ_DOUBLE(42.0, TinyGetNumber(first));
+    TinyFree(&a);
+
+    EXPECT_EQ_INT(TINY_PARSE_OK, TinyParseWithFlags(&a, "[1.5, -2, 0, 1e300]", TINY_PARSE_FLAG_PACK_NUMBERS));
+    const double* nums = TinyGetArrayDoubles(&a, &size);
+    EXPECT_TRUE(nums != NULL);
+    EXPECT_EQ_SIZE_T(4, size);
+    EXPECT_EQ_DOUBLE(-2.0, nums[1]);
+    EXPECT_EQ_DOUBLE(1e300, TinyGetNumber(TinyGetArrayElement(&a, 3)));
+    /* 按元素读取得到的指针和普通数组一样一直有效, 可以同时持有多个 */
+    first = TinyGetArrayElement(&a, 0);
+    const TinyValue* second = TinyGetArrayElement(&a, 1);
+    for(int i = 0; i < 20; i++) TinyGetArrayElement(&a, i % 4);
+    EXPECT_TRUE(first == TinyGetArrayElement(&a, 0));
+    EXPECT_EQ_DOUBLE(1.5, TinyGetNumber(first));
+    EXPECT_EQ_DOUBLE(-2.0, TinyGetNumber(second));
+    EXPECT_TRUE(TinyGetArrayDoubles(&a, NULL) == nums);
+    char* json = TinyStringify(&a, &size);
+    EXPECT_EQ_STRING("[1.5,-2,0,1e+300]", json, size);
+    free(json);
+
+    /* 与普通数组相等且哈希相同 */
+    TinySetArray(&b, 0);
+    for(int i = 0; i < 4; i++) TinySetNumber(TinyPushBackArrayElement(&b), nums[i]);
+    EXPECT_TRUE(TinyGetArrayDoubles(&b, NULL) == NULL);
+    EXPECT_TRUE(TinyIsEqual(&a, &b));
+    EXPECT_TRUE(TinyIsEqual(&b, &a));
+    EXPECT_TRUE(TinyHash(&a) == TinyHash(&b));
+    EXPECT_TRUE(TinyPackArray(&b));
+    EXPECT_TRUE(TinyGetArrayDoubles(&b, NULL) != NULL);
+
+    /* 追加数字保持紧凑, 其它修改展开 */
+    const double more[] = { 7, 8 };
+    TinyAppendArrayNumbers(&b, more, 2);
+    EXPECT_TRUE(TinyGetArrayDoubles(&b, &size) != NULL);
+    EXPECT_EQ_SIZE_T(6, size);
+    TinyValue c;
+    TinyCopy(&c, &b);
+    TinySetString(TinySetArrayElement(&c, 0), "x", 1);
+    EXPECT_TRUE(TinyGetArrayDoubles(&c, NULL) == NULL);
+    EXPECT_EQ_DOUBLE(1.5, TinyGetArrayDoubles(&b, NULL)[0]);
+    EXPECT_FALSE(TinyPackArray(&c));
+    TinyPopBackArrayElement(&b);
+    EXPECT_EQ_DOUBLE(7.0, TinyGetNumber(TinyGetArrayElement(&b, 4)));
+    EXPECT_TRUE(TinyGetArrayDoubles(&b, NULL) == NULL);
+    EXPECT_TRUE(TinyPackArray(&b));
+    TinyShrinkArray(&b);
+    EXPECT_EQ_SIZE_T(5, TinyGetArrayCapacity(&b));
+
+    /* 多个线程同时读取共享的紧凑存储, 得到同一份元素 */
+    {
+        const TinyValue* seen[4];
+        std::thread readers[4];
+        for(int t = 0; t < 4; t++) {
+            readers[t] = std::thread([&b, &seen, t]() {
+                TinyValue copy;
+                TinyCopy(&copy, &b);
+                seen[t] = TinyGetArrayElement(&copy, 2);
+                TinyFree(&copy);
+            });
+        }
+        for(int t = 0; t < 4; t++) {
+            readers[t].join();
+            EXPECT_TRUE(seen[t] == TinyGetArrayElement(&b, 2));
+        }
+    }
+
+    /* 空数组追加数字不会自动变成紧凑数组; 先 TinyPackArray 才保持紧凑 */
+    TinySetArray(&a, 0);
+    TinyAppendArrayNumbers(&a, more, 2);
+    EXPECT_TRUE(TinyGetArrayDoubles(&a, NULL) == NULL);
+    TinyFree(&a);
+
+    /* 流式输出与 TinyStringify 一致 */
+    TinySetArray(&a, 0);
+    EXPECT_TRUE(TinyPackArray(&a));
+    for(int i = 0; i < 1000; i++) {
+        double d = i * 0.1;
+        TinyAppendArrayNumbers(&a, &d, 1);
+    }
+    json = TinyStringify(&a, &size);
+    TinyStringifier st;
+    char buff[100];
+    size_t n, total = 0;
+    bool same = true;
+    TinyStringifierInit(&st, &a);
+    while((n = TinyStringifierWrite(&st, buff, sizeof(buff))) > 0) {
+        same = same && total + n <= size && memcmp(json + total, buff, n) == 0;
+        total += n;
+    }
+    TinyStringifierFree(&st);
+    EXPECT_TRUE(same);
+    EXPECT_EQ_SIZE_T(size, total);
+    EXPECT_TRUE(TinyGetArrayDoubles(&a, NULL) != NULL);
+    free(json);
+    TinyFree(&a);
+    TinyFree(&b);
+    TinyFree(&c);
+}
+
 static void TestAccess() {
     TestAccessString();
     TestAccessNumber();
@@ -609,6 +1392,8 @@ static void TestAccess() {
     TestAccessNull();
     TestAccessArray();
     TestAccessObject();
+    TestAccessBulk();
+    TestAccessPacked();
 }
 
 static void TestStringify() {
@@ -616,9 +1401,15 @@ static void TestStringify() {
     TEST_ROUNDTRIP("false");
     TEST_ROUNDTRIP("true");
     TestStringifyNumber();
+    TestStringifyNumberRandom();
     TestStringifyString();
+    TestStringifyStringEscapes();
     TestStringifyArray();
     TestStringifyObject();
+    TestStringifyStream();
+    TestStringifyCached();
+    TestStringifyParallel();
+    TestWriter();
 }
 
 static void TestEqual() {
@@ -648,6 +1439,97 @@ static void TestEqual() {
     TEST_EQUAL("{\"a\":{\"b\":{\"c\":{}}}}", "{\"a\":{\"b\":{\"c\":[]}}}", 0);
 }
 
+#define TEST_HASH(json1, json2, equality) \
+    do {\
+        TinyValue v1, v2;\
+        TinyInitValue(&v1);\
+        TinyInitValue(&v2);\
+        EXPECT_EQ_INT(TINY_PARSE_OK, TinyParse(&v1, json1));\
+        EXPECT_EQ_INT(TINY_PARSE_OK, TinyParse(&v2, json2));\
+        EXPECT_EQ_INT(equality, TinyHash(&v1) == TinyHash(&v2));\
+        TinyFree(&v1);\
+        TinyFree(&v2);\
+    } while(0)
+
+static void TestHash() {
+    TEST_HASH("null", "null", 1);
+    TEST_HASH("null", "false", 0);
+    TEST_HASH("0", "-0", 1);
+    TEST_HASH("1.5", "1.50", 1);
+    TEST_HASH("1", "2", 0);
+    TEST_HASH("\"abc\"", "\"abc\"", 1);
+    TEST_HASH("\"abcdefghijk\"", "\"abcdefghijx\"", 0);
+    TEST_HASH("[1,2]", "[2,1]", 0);
+    TEST_HASH("[[]]", "[{}]", 0);
+    TEST_HASH("{\"a\":1,\"b\":[true]}", "{\"b\":[true],\"a\":1}", 1);
+    TEST_HASH("{\"a\":1,\"b\":2}", "{\"a\":2,\"b\":1}", 0);
+
+    /* memoized hashes are dropped by mutators */
+    TinyValue v1, v2;
+    TinyInitValue(&v1);
+    TinyInitValue(&v2);
+    TinyParse(&v1, "{\"a\":[1,2,3],\"b\":{\"c\":null}}");
+    TinyCopy(&v2, &v1);
+    EXPECT_TRUE(TinyHashMemo(&v1) == TinyHash(&v2));
+    TinySetNumber(TinySetArrayElement(TinySetObjectValue(&v1, "a", 1), 1), 5);
+    EXPECT_TRUE(TinyHashMemo(&v1) != TinyHashMemo(&v2));
+    EXPECT_FALSE(TinyIsEqual(&v1, &v2));
+    TinySetNumber(TinySetArrayElement(TinySetObjectValue(&v2, "a", 1), 1), 5);
+    EXPECT_TRUE(TinyHash(&v1) == TinyHashMemo(&v2));
+    EXPECT_TRUE(TinyIsEqual(&v1, &v2));
+    TinyFree(&v1);
+    TinyFree(&v2);
+
+    /* copies share storage and its memo: threads may memoize and compare them at the same time */
+    TinyParse(&v1, "{\"a\":[1,2,3],\"b\":{\"c\":[null,{\"d\":\"e\"}]}}");
+    uint64_t expect = TinyHash(&v1), seen[4];
+    bool equal[4];
+    std::thread threads[4];
+    for(int t = 0; t < 4; t++) {
+        threads[t] = std::thread([&v1, &seen, &equal, t]() {
+            TinyValue copy, other;
+            TinyCopy(&copy, &v1);
+            TinyInitValue(&other);
+            TinyParse(&other, "{\"b\":{\"c\":[null,{\"d\":\"e\"}]},\"a\":[1,2,3]}");
+            TinyHashMemo(&other);
+            seen[t] = TinyHashMemo(&copy);
+            equal[t] = TinyIsEqual(&copy, &other);
+            TinyFree(&copy);
+            TinyFree(&other);
+        });
+    }
+    for(int t = 0; t < 4; t++) {
+        threads[t].join();
+        EXPECT_TRUE(seen[t] == expect);
+        EXPECT_TRUE(equal[t]);
+    }
+    TinyFree(&v1);
+}
+
+static void TestEqualLargeObject() {
+    TinyValue v1, v2;
+    char key[16];
+    TinyInitValue(&v1);
+    TinyInitValue(&v2);
+    TinySetObject(&v1, 0);
+    TinySetObject(&v2, 0);
+    for(int i = 0; i < 100; i++) {
+        snprintf(key, sizeof(key), "k%d", i);
+        TinySetNumber(TinySetObjectValue(&v1, key, strlen(key)), i);
+        snprintf(key, sizeof(key), "k%d", 99 - i);
+        TinySetNumber(TinySetObjectValue(&v2, key, strlen(key)), 99 - i);
+    }
+    EXPECT_TRUE(TinyIsEqual(&v1, &v2));
+    EXPECT_TRUE(TinyHash(&v1) == TinyHash(&v2));
+    TinySetNumber(TinySetObjectValue(&v2, "k50", 3), -1);
+    EXPECT_FALSE(TinyIsEqual(&v1, &v2));
+    TinyRemoveObjectValue(&v2, TinyFindObjectIndex(&v2, "k50", 3));
+    TinySetNumber(TinySetObjectValue(&v2, "k100", 4), 50);
+    EXPECT_FALSE(TinyIsEqual(&v1, &v2));
+    TinyFree(&v1);
+    TinyFree(&v2);
+}
+
 static void TestCopy() {
     TinyValue v1, v2;
     TinyInitValue(&v1);
@@ -659,6 +1541,48 @@ static void TestCopy() {
     TinyFree(&v2);
 }
 
+static void TestCopyOnWrite() {
+    TinyValue v1, v2, v3;
+    TinyInitValue(&v1);
+    TinyInitValue(&v2);
+    TinyInitValue(&v3);
+    TinyParse(&v1, "{\"name\":\"template\",\"a\":[1,[2,3],{\"x\":\"y\"}],\"o\":{\"k\":\"v\"}}");
+    TinyCopy(&v2, &v1);
+    TinyCopy(&v3, &v2);
+    /* 只复制被修改的路径 */
+    TinySetNumber(TinySetArrayElement(TinySetArrayElement(TinySetObjectValue(&v2, "a", 1), 1), 0), 20);
+    TinySetString(TinySetObjectValue(&v2, "name", 4), "copy", 4);
+    TinyPushBackArrayElement(TinySetObjectValue(&v3, "a", 1));
+    TinyValue expect;
+    TinyInitValue(&expect);
+    TinyParse(&expect, "{\"name\":\"template\",\"a\":[1,[2,3],{\"x\":\"y\"}],\"o\":{\"k\":\"v\"}}");
+    EXPECT_TRUE(TinyIsEqual(&expect, &v1));
+    TinyFree(&expect);
+    TinyParse(&expect, "{\"name\":\"copy\",\"a\":[1,[20,3],{\"x\":\"y\"}],\"o\":{\"k\":\"v\"}}");
+    EXPECT_TRUE(TinyIsEqual(&expect, &v2));
+    TinyFree(&expect);
+    TinyParse(&expect, "{\"name\":\"template\",\"a\":[1,[2,3],{\"x\":\"y\"}, null],\"o\":{\"k\":\"v\"}}");
+    EXPECT_TRUE(TinyIsEqual(&expect, &v3));
+    /* 未修改的部分仍然共享 */
+    const TinyValue* o1 = TinyFindObjectValue(&v1, "o", 1);
+    const TinyValue* o2 = TinyFindObjectValue(&v2, "o", 1);
+    EXPECT_TRUE(o1 != o2);
+    EXPECT_TRUE(TinyGetObjectValue(o1, 0) == TinyGetObjectValue(o2, 0));
+    EXPECT_TRUE(TinyGetObjectKey(&v1, 0) == TinyGetObjectKey(&v2, 0));
+    const TinyValue* x1 = TinyGetArrayElement(TinyFindObjectValue(&v1, "a", 1), 2);
+    const TinyValue* x3 = TinyGetArrayElement(TinyFindObjectValue(&v3, "a", 1), 2);
+    EXPECT_TRUE(TinyGetObjectValue(x1, 0) == TinyGetObjectValue(x3, 0));
+    /* 释放顺序任意 */
+    TinyFree(&v1);
+    TinyRemoveObjectValue(&v3, 0);
+    TinyClearObject(&v2);
+    EXPECT_EQ_SIZE_T(0, TinyGetObjectSize(&v2));
+    EXPECT_EQ_SIZE_T(2, TinyGetObjectSize(&v3));
+    TinyFree(&v2);
+    TinyFree(&v3);
+    TinyFree(&expect);
+}
+
 static void TestMove() {
     TinyValue v1, v2, v3;
     TinyInitValue(&v1);
@@ -687,14 +1611,1094 @@ static void TestSwap() {
     TinyFree(&v2);
 }
 
+#define TEST_BINARY_ROUNDTRIP(json, encode, decode, expectLen)\
+    do {\
+        TinyValue v1, v2;\
+        size_t blen;\
+        TinyInitValue(&v1);\
+        EXPECT_EQ_INT(TINY_PARSE_OK, TinyParse(&v1, json));\
+        char* data = encode(&v1, &blen);\
+        EXPECT_EQ_SIZE_T(expectLen, blen);\
+        EXPECT_EQ_INT(TINY_PARSE_OK, decode(&v2, data, blen));\
+        EXPECT_TRUE(TinyIsEqual(&v1, &v2));\
+        free(data);\
+        TinyFree(&v1);\
+        TinyFree(&v2);\
+    } while(0)
+
+#define TEST_BINARY_ERROR(expectReact, decode, data)\
+    do {\
+        TinyValue v;\
+        EXPECT_EQ_INT(expectReact, decode(&v, data, sizeof(data) - 1));\
+        EXPECT_EQ_INT(TINY_NULL, TinyGetType(&v));\
+        TinyFree(&v);\
+    } while(0)
+
+static void TestMsgPack() {
+    TEST_BINARY_ROUNDTRIP("null", TinyEncodeMsgPack, TinyDecodeMsgPack, 1);
+    TEST_BINARY_ROUNDTRIP("127", TinyEncodeMsgPack, TinyDecodeMsgPack, 1);
+    TEST_BINARY_ROUNDTRIP("-32", TinyEncodeMsgPack, TinyDecodeMsgPack, 1);
+    TEST_BINARY_ROUNDTRIP("-33", TinyEncodeMsgPack, TinyDecodeMsgPack, 2);
+    TEST_BINARY_ROUNDTRIP("65536", TinyEncodeMsgPack, TinyDecodeMsgPack, 5);
+    TEST_BINARY_ROUNDTRIP("-9223372036854775808", TinyEncodeMsgPack, TinyDecodeMsgPack, 9);
+    TEST_BINARY_ROUNDTRIP("18446744073709549568", TinyEncodeMsgPack, TinyDecodeMsgPack, 9);
+    TEST_BINARY_ROUNDTRIP("1.5", TinyEncodeMsgPack, TinyDecodeMsgPack, 5);
+    TEST_BINARY_ROUNDTRIP("0.1", TinyEncodeMsgPack, TinyDecodeMsgPack, 9);
+    TEST_BINARY_ROUNDTRIP("-0.0", TinyEncodeMsgPack, TinyDecodeMsgPack, 5);
+    TEST_BINARY_ROUNDTRIP("\"Hello\\u0000World\"", TinyEncodeMsgPack, TinyDecodeMsgPack, 12);
+    TEST_BINARY_ROUNDTRIP("[1,[2,[3]],{\"a\":true,\"b\":false,\"\":\"x\"}]", TinyEncodeMsgPack, TinyDecodeMsgPack, 16);
+
+    TinyValue v;
+    EXPECT_EQ_INT(TINY_PARSE_OK, TinyDecodeMsgPack(&v, "\xc4\x02" "ab", 4));
+    EXPECT_EQ_STRING("ab", TinyGetString(&v), TinyGetStringLength(&v));
+    TinyFree(&v);
+    EXPECT_EQ_INT(TINY_PARSE_OK, TinyDecodeMsgPack(&v, "\xcb\xbf\xf0\x00\x00\x00\x00\x00\x00", 9));
+    EXPECT_EQ_DOUBLE(-1.0, TinyGetNumber(&v));
+    TinyFree(&v);
+
+    TEST_BINARY_ERROR(TINY_PARSE_EXPECT_VALUE, TinyDecodeMsgPack, "");
+    TEST_BINARY_ERROR(TINY_PARSE_EXPECT_VALUE, TinyDecodeMsgPack, "\xa3" "ab");
+    TEST_BINARY_ERROR(TINY_PARSE_EXPECT_VALUE, TinyDecodeMsgPack, "\x93\x01\x02");
+    TEST_BINARY_ERROR(TINY_PARSE_EXPECT_VALUE, TinyDecodeMsgPack, "\xdd\xff\xff\xff\xff\x01");
+    TEST_BINARY_ERROR(TINY_PARSE_INVALID_VALUE, TinyDecodeMsgPack, "\xc1");
+    TEST_BINARY_ERROR(TINY_PARSE_INVALID_VALUE, TinyDecodeMsgPack, "\x92\x01\xd4\x01\x02");
+    TEST_BINARY_ERROR(TINY_PARSE_NUMBER_TOO_BIG, TinyDecodeMsgPack, "\xca\x7f\x80\x00\x00");
+    TEST_BINARY_ERROR(TINY_PARSE_NUMBER_TOO_BIG, TinyDecodeMsgPack, "\xca\x7f\xc0\x00\x00");
+    TEST_BINARY_ERROR(TINY_PARSE_MISS_KEY, TinyDecodeMsgPack, "\x81\x01\x02");
+    TEST_BINARY_ERROR(TINY_PARSE_ROOT_NOT_SINGULAR, TinyDecodeMsgPack, "\xc0\xc0");
+}
+
+static void TestCbor() {
+    TEST_BINARY_ROUNDTRIP("null", TinyEncodeCbor, TinyDecodeCbor, 1);
+    TEST_BINARY_ROUNDTRIP("23", TinyEncodeCbor, TinyDecodeCbor, 1);
+    TEST_BINARY_ROUNDTRIP("24", TinyEncodeCbor, TinyDecodeCbor, 2);
+    TEST_BINARY_ROUNDTRIP("-24", TinyEncodeCbor, TinyDecodeCbor, 1);
+    TEST_BINARY_ROUNDTRIP("-1000", TinyEncodeCbor, TinyDecodeCbor, 3);
+    TEST_BINARY_ROUNDTRIP("-9223372036854775808", TinyEncodeCbor, TinyDecodeCbor, 9);
+    TEST_BINARY_ROUNDTRIP("1.5", TinyEncodeCbor, TinyDecodeCbor, 5);
+    TEST_BINARY_ROUNDTRIP("1e300", TinyEncodeCbor, TinyDecodeCbor, 9);
+    TEST_BINARY_ROUNDTRIP("\"\"", TinyEncodeCbor, TinyDecodeCbor, 1);
+    TEST_BINARY_ROUNDTRIP("[1,[2,[3]],{\"a\":true,\"b\":false,\"\":\"x\"}]", TinyEncodeCbor, TinyDecodeCbor, 16);
+
+    TinyValue v;
+    /* 半精度浮点数 */
+    EXPECT_EQ_INT(TINY_PARSE_OK, TinyDecodeCbor(&v, "\xf9\x3c\x00", 3));
+    EXPECT_EQ_DOUBLE(1.0, TinyGetNumber(&v));
+    TinyFree(&v);
+    EXPECT_EQ_INT(TINY_PARSE_OK, TinyDecodeCbor(&v, "\xf9\x00\x01", 3));
+    EXPECT_EQ_DOUBLE(5.960464477539063e-8, TinyGetNumber(&v));
+    TinyFree(&v);
+    /* 负整数的最小值 -2^64 */
+    EXPECT_EQ_INT(TINY_PARSE_OK, TinyDecodeCbor(&v, "\x3b\xff\xff\xff\xff\xff\xff\xff\xff", 9));
+    EXPECT_EQ_DOUBLE(-18446744073709551616.0, TinyGetNumber(&v));
+    TinyFree(&v);
+    /* 标签被忽略, undefined 视为 null */
+    EXPECT_EQ_INT(TINY_PARSE_OK, TinyDecodeCbor(&v, "\xc1\x1a\x00\x00\x00\x01", 6));
+    EXPECT_EQ_DOUBLE(1.0, TinyGetNumber(&v));
+    TinyFree(&v);
+    EXPECT_EQ_INT(TINY_PARSE_OK, TinyDecodeCbor(&v, "\xf7", 1));
+    EXPECT_EQ_INT(TINY_NULL, TinyGetType(&v));
+    /* 不定长字符串、数组和 map */
+    EXPECT_EQ_INT(TINY_PARSE_OK, TinyDecodeCbor(&v, "\x7f\x62" "ab" "\x61" "c" "\xff", 7));
+    EXPECT_EQ_STRING("abc", TinyGetString(&v), TinyGetStringLength(&v));
+    TinyFree(&v);
+    const char indefinite[] = "\xbf\x7f\x61" "k" "\x61" "e" "\xff\x9f\x01\x9f\xff\x82\x02\x03\xff\x61" "a" "\xf5\xff";
+    EXPECT_EQ_INT(TINY_PARSE_OK, TinyDecodeCbor(&v, indefinite, sizeof(indefinite) - 1));
+    TinyValue expect;
+    TinyInitValue(&expect);
+    TinyParse(&expect, "{\"ke\":[1,[],[2,3]],\"a\":true}");
+    EXPECT_TRUE(TinyIsEqual(&expect, &v));
+    TinyFree(&expect);
+    TinyFree(&v);
+
+    TEST_BINARY_ERROR(TINY_PARSE_EXPECT_VALUE, TinyDecodeCbor, "");
+    TEST_BINARY_ERROR(TINY_PARSE_EXPECT_VALUE, TinyDecodeCbor, "\x19\x01");
+    TEST_BINARY_ERROR(TINY_PARSE_EXPECT_VALUE, TinyDecodeCbor, "\x9f\x01\x61");
+    TEST_BINARY_ERROR(TINY_PARSE_EXPECT_VALUE, TinyDecodeCbor, "\x9f\x82\x01\x9f\x62" "ab");
+    TEST_BINARY_ERROR(TINY_PARSE_EXPECT_VALUE, TinyDecodeCbor, "\x9b\xff\xff\xff\xff\xff\xff\xff\xff");
+    /* 定长 2^64-1 不是不定长, 其后的 0xFF 不能当作结束 */
+    TEST_BINARY_ERROR(TINY_PARSE_EXPECT_VALUE, TinyDecodeCbor, "\x7b\xff\xff\xff\xff\xff\xff\xff\xff\xff");
+    TEST_BINARY_ERROR(TINY_PARSE_EXPECT_VALUE, TinyDecodeCbor, "\x9b\xff\xff\xff\xff\xff\xff\xff\xff\xff");
+    TEST_BINARY_ERROR(TINY_PARSE_EXPECT_VALUE, TinyDecodeCbor, "\xbb\xff\xff\xff\xff\xff\xff\xff\xff\xff");
+    TEST_BINARY_ERROR(TINY_PARSE_INVALID_VALUE, TinyDecodeCbor, "\xff");
+    TEST_BINARY_ERROR(TINY_PARSE_INVALID_VALUE, TinyDecodeCbor, "\x1c");
+    TEST_BINARY_ERROR(TINY_PARSE_INVALID_VALUE, TinyDecodeCbor, "\x7f\x41" "a" "\xff");
+    TEST_BINARY_ERROR(TINY_PARSE_NUMBER_TOO_BIG, TinyDecodeCbor, "\xf9\x7c\x00");
+    TEST_BINARY_ERROR(TINY_PARSE_MISS_KEY, TinyDecodeCbor, "\xa1\x01\x02");
+    TEST_BINARY_ERROR(TINY_PARSE_ROOT_NOT_SINGULAR, TinyDecodeCbor, "\x01\x02");
+}
+
+static void TestSnapshot() {
+    const char* path = "snapshot.tmp";
+    TinyValue v, copy;
+    TinySnapshot snap;
+    TinyInitValue(&v);
+    TinyInitValue(&copy);
+    EXPECT_EQ_INT(TINY_PARSE_OK, TinyParse(&v, "{\"n\":null,\"f\":false,\"t\":true,\"d\":-1.5,"
+        "\"s\":\"Hello\\u0000\",\"a\":[1,\"\",[],{}],\"\":0,\"dup\":1,\"b\":{\"x\":[true]},\"dup\":2}"));
+    EXPECT_EQ_INT(TINY_SNAPSHOT_OK, TinySaveSnapshot(&v, path));
+    EXPECT_EQ_INT(TINY_SNAPSHOT_OK, TinyLoadSnapshot(&snap, path));
+
+    const TinySnapValue* root = TinySnapshotRoot(&snap);
+    EXPECT_EQ_INT(TINY_OBJECT, TinySnapGetType(root));
+    EXPECT_EQ_SIZE_T(10, TinySnapGetObjectSize(root));
+    EXPECT_EQ_STRING("n", TinySnapGetObjectKey(root, 0), TinySnapGetObjectKeyLength(root, 0));
+    EXPECT_EQ_INT(TINY_NULL, TinySnapGetType(TinySnapGetObjectValue(root, 0)));
+    EXPECT_FALSE(TinySnapGetBoolean(TinySnapFindObjectValue(root, "f", 1)));
+    EXPECT_TRUE(TinySnapGetBoolean(TinySnapFindObjectValue(root, "t", 1)));
+    EXPECT_EQ_DOUBLE(-1.5, TinySnapGetNumber(TinySnapFindObjectValue(root, "d", 1)));
+    const TinySnapValue* s = TinySnapFindObjectValue(root, "s", 1);
+    EXPECT_EQ_STRING("Hello\0", TinySnapGetString(s), TinySnapGetStringLength(s));
+    const TinySnapValue* a = TinySnapFindObjectValue(root, "a", 1);
+    EXPECT_EQ_SIZE_T(4, TinySnapGetArraySize(a));
+    EXPECT_EQ_DOUBLE(1.0, TinySnapGetNumber(TinySnapGetArrayElement(a, 0)));
+    EXPECT_EQ_SIZE_T(0, TinySnapGetStringLength(TinySnapGetArrayElement(a, 1)));
+    EXPECT_EQ_SIZE_T(0, TinySnapGetArraySize(TinySnapGetArrayElement(a, 2)));
+    EXPECT_EQ_SIZE_T(0, TinySnapGetObjectSize(TinySnapGetArrayElement(a, 3)));
+    EXPECT_EQ_SIZE_T(6, TinySnapFindObjectIndex(root, "", 0));
+    EXPECT_EQ_SIZE_T(7, TinySnapFindObjectIndex(root, "dup", 3));
+    EXPECT_EQ_SIZE_T(TINY_KEY_NOT_EXIST, TinySnapFindObjectIndex(root, "du", 2));
+    EXPECT_EQ_SIZE_T(TINY_KEY_NOT_EXIST, TinySnapFindObjectIndex(root, "z", 1));
+    EXPECT_TRUE(TinySnapFindObjectValue(root, "dupe", 4) == NULL);
+    const TinySnapValue* x = TinySnapFindObjectValue(TinySnapFindObjectValue(root, "b", 1), "x", 1);
+    EXPECT_TRUE(TinySnapGetBoolean(TinySnapGetArrayElement(x, 0)));
+
+    TinySnapCopy(&copy, root);
+    EXPECT_TRUE(TinyIsEqual(&v, &copy));
+    size_t size = snap.size;
+    TinyFreeSnapshot(&snap);
+
+    /* 损坏与截断 */
+    FILE* fp = fopen(path, "r+b");
+    fseek(fp, (long)size - 9, SEEK_SET);
+    fputc('#', fp);
+    fclose(fp);
+    EXPECT_EQ_INT(TINY_SNAPSHOT_CHECKSUM_MISMATCH, TinyLoadSnapshot(&snap, path));
+    EXPECT_TRUE(snap.base == NULL);
+    fp = fopen(path, "wb");
+    fwrite("TINYSNAP", 1, 8, fp);
+    fclose(fp);
+    EXPECT_EQ_INT(TINY_SNAPSHOT_INVALID_FORMAT, TinyLoadSnapshot(&snap, path));
+    remove(path);
+    EXPECT_EQ_INT(TINY_SNAPSHOT_IO_ERROR, TinyLoadSnapshot(&snap, path));
+
+    /* 标量作为根值 */
+    TinySetString(&v, "root", 4);
+    EXPECT_EQ_INT(TINY_SNAPSHOT_OK, TinySaveSnapshot(&v, path));
+    EXPECT_EQ_INT(TINY_SNAPSHOT_OK, TinyLoadSnapshot(&snap, path));
+    EXPECT_EQ_STRING("root", TinySnapGetString(TinySnapshotRoot(&snap)), TinySnapGetStringLength(TinySnapshotRoot(&snap)));
+    TinyFreeSnapshot(&snap);
+    remove(path);
+    TinyFree(&v);
+    TinyFree(&copy);
+}
+
+static TinySharedDoc* MakeSharedVersion(int version) {
+    TinyValue v;
+    TinyInitValue(&v);
+    TinySetObject(&v, 0);
+    TinySetNumber(TinySetObjectValue(&v, "version", 7), version);
+    TinySetString(TinySetObjectValue(&v, "name", 4), "config", 6);
+    TinySharedDoc* doc = TinySharedCreate(&v);
+    EXPECT_EQ_INT(TINY_NULL, TinyGetType(&v));
+    return doc;
+}
+
+static double SharedVersion(const TinyValue* v) {
+    return TinyGetNumber(TinyFindObjectValue(v, "version", 7));
+}
+
+static void TestShared() {
+    TinySharedSlot slot;
+    TinySharedReader reader;
+    TinySharedSlotInit(&slot, MakeSharedVersion(1));
+    TinySharedReaderInit(&reader, &slot);
+    const TinyValue* v = TinySharedRead(&reader);
+    EXPECT_EQ_DOUBLE(1.0, SharedVersion(v));
+
+    TinySharedDoc* held = TinySharedAcquire(&slot);
+    EXPECT_EQ_SIZE_T(3, held->refs.load());
+    TinySharedPublish(&slot, MakeSharedVersion(2));
+    /* 旧文档仍被 reader 和 held 引用 */
+    EXPECT_EQ_SIZE_T(2, held->refs.load());
+    EXPECT_TRUE(v == TinySharedGetValue(held));
+    EXPECT_EQ_DOUBLE(2.0, SharedVersion(TinySharedRead(&reader)));
+    EXPECT_EQ_SIZE_T(1, held->refs.load());
+    EXPECT_EQ_DOUBLE(1.0, SharedVersion(TinySharedGetValue(held)));
+    TinySharedRelease(held);
+
+    TinySharedPublish(&slot, NULL);
+    EXPECT_TRUE(TinySharedRead(&reader) == NULL);
+    TinySharedReaderFree(&reader);
+    TinySharedSlotFree(&slot);
+}
+
+/* 写者不断发布新版本, 读者看到的版本只增不减 */
+static void TestSharedThreads() {
+    const int threads = 4, versions = 200;
+    TinySharedSlot slot;
+    int failures[threads] = { 0 };
+    TinySharedSlotInit(&slot, MakeSharedVersion(0));
+    std::thread readers[threads];
+    for(int t = 0; t < threads; t++) {
+        readers[t] = std::thread([&slot, &failures, t]() {
+            TinySharedReader reader;
+            TinySharedReaderInit(&reader, &slot);
+            double last = 0;
+            for(int i = 0; i < 20000 && last < versions; i++) {
+                const TinyValue* v = TinySharedRead(&reader);
+                double version = SharedVersion(v);
+                if(version < last || TinyGetStringLength(TinyFindObjectValue(v, "name", 4)) != 6) failures[t]++;
+                last = version;
+                /* 共享文档上的 TinyCopy 只增加引用计数 */
+                TinyValue copy;
+                TinyCopy(&copy, v);
+                TinySetNumber(TinySetObjectValue(&copy, "version", 7), -1);
+                TinyFree(&copy);
+                /* 与发布交错的取引用: 写者替换时未归还的登记转入引用计数 */
+                TinySharedDoc* doc = TinySharedAcquire(&slot);
+                if(SharedVersion(TinySharedGetValue(doc)) < version) failures[t]++;
+                TinySharedRelease(doc);
+            }
+            TinySharedReaderFree(&reader);
+        });
+    }
+    for(int i = 1; i <= versions; i++) {
+        TinySharedPublish(&slot, MakeSharedVersion(i));
+    }
+    for(int t = 0; t < threads; t++) {
+        readers[t].join();
+        EXPECT_EQ_INT(0, failures[t]);
+    }
+    TinySharedSlotFree(&slot);
+}
+
+/* 预算为 1 时逐个元素释放; 与副本共享的存储只减少引用计数 */
+static void TestReclaim() {
+    TinyValue v, copy, packed;
+    TinyReclaimer r;
+    TinyInitValue(&v);
+    TinyInitValue(&copy);
+    TinyInitValue(&packed);
+    TinyReclaimerInit(&r);
+    EXPECT_TRUE(TinyReclaimerIsEmpty(&r));
+    EXPECT_TRUE(TinyReclaimerStep(&r, 1));
+
+    EXPECT_EQ_INT(TINY_PARSE_OK, TinyParse(&v, "{\"a\":[1,2,3],\"b\":{\"c\":\"hello\"},\"d\":[\"x\",[]]}"));
+    EXPECT_EQ_INT(TINY_PARSE_OK, TinyParse(&packed, "[1,2,3]"));
+    TinyCopy(&copy, TinyFindObjectValue(&v, "b", 1));
+    TinyReclaimerPush(&r, &v);
+    EXPECT_EQ_INT(TINY_NULL, TinyGetType(&v));
+    TinyReclaimerPush(&r, &packed);
+    size_t steps = 0;
+    while(!TinyReclaimerStep(&r, 1)) steps++;
+    EXPECT_TRUE(steps > 5);
+    EXPECT_TRUE(TinyReclaimerIsEmpty(&r));
+    /* 已释放: 1 个对象存储、3 个数组存储("d" 中的 [] 没有存储)、3 个键、1 个字符串; "b" 的存储仍被 copy 引用 */
+    EXPECT_EQ_SIZE_T(8, (size_t)r.nodes);
+    EXPECT_TRUE(r.bytes > 0);
+    EXPECT_EQ_STRING("hello", TinyGetString(TinyFindObjectValue(&copy, "c", 1)), 5);
+    TinyFree(&copy);
+
+    /* 保留原文的长数字 */
+    EXPECT_EQ_INT(TINY_PARSE_OK, TinyParseWithFlags(&v, "[123456789012345678901234567890,1.0]", TINY_PARSE_FLAG_LAZY_NUMBER));
+    TinyReclaimerPush(&r, &v);
+    EXPECT_TRUE(TinyReclaimerStep(&r, 10));
+
+    /* 很深的嵌套也不会递归 */
+    TinyValue deep;
+    TinyInitValue(&deep);
+    for(int i = 0; i < 100000; i++) {
+        TinyValue outer;
+        TinyInitValue(&outer);
+        TinySetArray(&outer, 1);
+        TinyMove(TinyPushBackArrayElement(&outer), &deep);
+        TinyMove(&deep, &outer);
+    }
+    TinyReclaimerPush(&r, &deep);
+    EXPECT_FALSE(TinyReclaimerStep(&r, 1000));
+    TinyReclaimerFree(&r);
+    EXPECT_TRUE(TinyReclaimerIsEmpty(&r));
+}
+
+/* 后台线程: Drain 之后统计完整; Stop 前交来的值也会释放 */
+static void TestReclaimThread() {
+    TinyReclaimThread* t = TinyReclaimThreadStart(16);
+    TinyReclaimStats stats;
+    TinyValue v, copy;
+    TinyInitValue(&v);
+    TinyInitValue(&copy);
+    for(int i = 0; i < 10; i++) {
+        EXPECT_EQ_INT(TINY_PARSE_OK, TinyParse(&v, "[{\"k\":\"value\"},[1,2],\"s\",true]"));
+        if(i == 0) TinyCopy(&copy, &v);
+        TinyReclaimThreadPush(t, &v);
+        EXPECT_EQ_INT(TINY_NULL, TinyGetType(&v));
+    }
+    TinySetNumber(&v, 1.0);
+    TinyReclaimThreadPush(t, &v);
+    TinyReclaimThreadDrain(t);
+    TinyReclaimThreadGetStats(t, &stats);
+    EXPECT_EQ_SIZE_T(0, (size_t)stats.pending);
+    /* 每个文档 3 个容器存储, 1 个键, 2 个字符串; 第一个文档的存储由 copy 共享 */
+    EXPECT_EQ_SIZE_T(9 * 6, (size_t)stats.nodes);
+    EXPECT_EQ_STRING("s", TinyGetString(TinyGetArrayElement(&copy, 2)), 1);
+    TinyReclaimThreadPush(t, &copy);
+    TinyReclaimThreadDrain(t);
+    TinyReclaimThreadGetStats(t, &stats);
+    EXPECT_EQ_SIZE_T(10 * 6, (size_t)stats.nodes);
+
+    for(int i = 0; i < 100; i++) {
+        EXPECT_EQ_INT(TINY_PARSE_OK, TinyParse(&v, "{\"a\":[\"b\",{\"c\":[]}]}"));
+        TinyReclaimThreadPush(t, &v);
+    }
+    TinyReclaimThreadStop(t);
+}
+
+#define TEST_MERGE_PATCH(expect, target, patch)\
+    do {\
+        TinyValue t, p, e;\
+        TinyInitValue(&t);\
+        TinyInitValue(&p);\
+        TinyInitValue(&e);\
+        EXPECT_EQ_INT(TINY_PARSE_OK, TinyParse(&t, target));\
+        EXPECT_EQ_INT(TINY_PARSE_OK, TinyParse(&p, patch));\
+        EXPECT_EQ_INT(TINY_PARSE_OK, TinyParse(&e, expect));\
+        TinyApplyMergePatch(&t, &p);\
+        EXPECT_TRUE(TinyIsEqual(&e, &t));\
+        TinyFree(&t);\
+        TinyFree(&p);\
+        TinyFree(&e);\
+    } while(0)
+
+static void TestMergePatch() {
+    /* RFC 7386 附录 A */
+    TEST_MERGE_PATCH("{\"a\":\"c\"}", "{\"a\":\"b\"}", "{\"a\":\"c\"}");
+    TEST_MERGE_PATCH("{\"a\":\"b\",\"b\":\"c\"}", "{\"a\":\"b\"}", "{\"b\":\"c\"}");
+    TEST_MERGE_PATCH("{}", "{\"a\":\"b\"}", "{\"a\":null}");
+    TEST_MERGE_PATCH("{\"b\":\"c\"}", "{\"a\":\"b\",\"b\":\"c\"}", "{\"a\":null}");
+    TEST_MERGE_PATCH("{\"a\":\"c\"}", "{\"a\":[\"b\"]}", "{\"a\":\"c\"}");
+    TEST_MERGE_PATCH("{\"a\":[\"b\"]}", "{\"a\":\"c\"}", "{\"a\":[\"b\"]}");
+    TEST_MERGE_PATCH("{\"a\":{\"b\":\"d\"}}", "{\"a\":{\"b\":\"c\"}}", "{\"a\":{\"b\":\"d\",\"c\":null}}");
+    TEST_MERGE_PATCH("{\"a\":[1]}", "{\"a\":[{\"b\":\"c\"}]}", "{\"a\":[1]}");
+    TEST_MERGE_PATCH("[\"c\",\"d\"]", "[\"a\",\"b\"]", "[\"c\",\"d\"]");
+    TEST_MERGE_PATCH("[\"c\"]", "{\"a\":\"b\"}", "[\"c\"]");
+    TEST_MERGE_PATCH("null", "{\"a\":\"foo\"}", "null");
+    TEST_MERGE_PATCH("\"bar\"", "{\"a\":\"foo\"}", "\"bar\"");
+    TEST_MERGE_PATCH("{\"e\":null,\"a\":1}", "{\"e\":null}", "{\"a\":1}");
+    TEST_MERGE_PATCH("{\"a\":\"b\"}", "[1,2]", "{\"a\":\"b\",\"c\":null}");
+    TEST_MERGE_PATCH("{\"a\":{\"bb\":{}}}", "{}", "{\"a\":{\"bb\":{\"ccc\":null}}}");
+    TEST_MERGE_PATCH("{\"\":1}", "{}", "{\"\":1}");
+
+    /* 只复制被修改的路径, 原文档不受影响 */
+    TinyValue doc, copy, patch;
+    TinyInitValue(&doc);
+    TinyInitValue(&patch);
+    TinyParse(&doc, "{\"a\":{\"x\":1},\"b\":{\"y\":2}}");
+    TinyParse(&patch, "{\"a\":{\"x\":null,\"z\":[3]}}");
+    TinyCopy(&copy, &doc);
+    TinyApplyMergePatch(&copy, &patch);
+    EXPECT_EQ_INT(TINY_NUMBER, TinyGetType(TinyFindObjectValue(TinyFindObjectValue(&doc, "a", 1), "x", 1)));
+    EXPECT_TRUE(TinyFindObjectValue(&doc, "b", 1) != TinyFindObjectValue(&copy, "b", 1));
+    EXPECT_TRUE(TinyGetObjectValue(TinyFindObjectValue(&doc, "b", 1), 0) == TinyGetObjectValue(TinyFindObjectValue(&copy, "b", 1), 0));
+    EXPECT_EQ_SIZE_T(1, TinyGetObjectSize(TinyFindObjectValue(&copy, "a", 1)));
+    TinyFree(&doc);
+    TinyFree(&copy);
+    TinyFree(&patch);
+}
+
+#define TEST_PATCH(expectReact, expect, target, ops)\
+    do {\
+        TinyValue t, p, e;\
+        TinyInitValue(&t);\
+        TinyInitValue(&p);\
+        TinyInitValue(&e);\
+        EXPECT_EQ_INT(TINY_PARSE_OK, TinyParse(&t, target));\
+        EXPECT_EQ_INT(TINY_PARSE_OK, TinyParse(&p, ops));\
+        EXPECT_EQ_INT(TINY_PARSE_OK, TinyParse(&e, expect));\
+        EXPECT_EQ_INT(expectReact, TinyApplyPatch(&t, &p));\
+        EXPECT_TRUE(TinyIsEqual(&e, &t));\
+        TinyFree(&t);\
+        TinyFree(&p);\
+        TinyFree(&e);\
+    } while(0)
+
+static void TestPatch() {
+    /* RFC 6902 附录 A */
+    TEST_PATCH(TINY_PATCH_OK, "{\"baz\":\"qux\",\"foo\":\"bar\"}", "{\"foo\":\"bar\"}",
+        "[{\"op\":\"add\",\"path\":\"/baz\",\"value\":\"qux\"}]");
+    TEST_PATCH(TINY_PATCH_OK, "{\"foo\":[\"bar\",\"qux\",\"baz\"]}", "{\"foo\":[\"bar\",\"baz\"]}",
+        "[{\"op\":\"add\",\"path\":\"/foo/1\",\"value\":\"qux\"}]");
+    TEST_PATCH(TINY_PATCH_OK, "{\"foo\":\"bar\"}", "{\"baz\":\"qux\",\"foo\":\"bar\"}",
+        "[{\"op\":\"remove\",\"path\":\"/baz\"}]");
+    TEST_PATCH(TINY_PATCH_OK, "{\"foo\":[\"bar\",\"baz\"]}", "{\"foo\":[\"bar\",\"qux\",\"baz\"]}",
+        "[{\"op\":\"remove\",\"path\":\"/foo/1\"}]");
+    TEST_PATCH(TINY_PATCH_OK, "{\"baz\":\"boo\",\"foo\":\"bar\"}", "{\"baz\":\"qux\",\"foo\":\"bar\"}",
+        "[{\"op\":\"replace\",\"path\":\"/baz\",\"value\":\"boo\"}]");
+    TEST_PATCH(TINY_PATCH_OK, "{\"foo\":{\"bar\":\"baz\"},\"qux\":{\"corge\":\"grault\",\"thud\":\"fred\"}}",
+        "{\"foo\":{\"bar\":\"baz\",\"waldo\":\"fred\"},\"qux\":{\"corge\":\"grault\"}}",
+        "[{\"op\":\"move\",\"from\":\"/foo/waldo\",\"path\":\"/qux/thud\"}]");
+    TEST_PATCH(TINY_PATCH_OK, "{\"foo\":[\"all\",\"cows\",\"eat\",\"grass\"]}", "{\"foo\":[\"all\",\"grass\",\"cows\",\"eat\"]}",
+        "[{\"op\":\"move\",\"from\":\"/foo/1\",\"path\":\"/foo/3\"}]");
+    TEST_PATCH(TINY_PATCH_OK, "{\"baz\":\"qux\",\"foo\":[\"a\",2,\"c\"]}", "{\"baz\":\"qux\",\"foo\":[\"a\",2,\"c\"]}",
+        "[{\"op\":\"test\",\"path\":\"/baz\",\"value\":\"qux\"},{\"op\":\"test\",\"path\":\"/foo/1\",\"value\":2}]");
+    TEST_PATCH(TINY_PATCH_TEST_FAILED, "{\"baz\":\"qux\"}", "{\"baz\":\"qux\"}",
+        "[{\"op\":\"test\",\"path\":\"/baz\",\"value\":\"bar\"}]");
+    TEST_PATCH(TINY_PATCH_OK, "{\"foo\":\"bar\",\"child\":{\"grandchild\":{}}}", "{\"foo\":\"bar\"}",
+        "[{\"op\":\"add\",\"path\":\"/child\",\"value\":{\"grandchild\":{}}}]");
+    TEST_PATCH(TINY_PATCH_OK, "{\"foo\":\"bar\"}", "{\"foo\":\"bar\"}",
+        "[{\"op\":\"add\",\"path\":\"/baz\",\"value\":\"qux\",\"xyz\":123},{\"op\":\"remove\",\"path\":\"/baz\"}]");
+    TEST_PATCH(TINY_PATCH_PATH_NOT_FOUND, "{\"foo\":\"bar\"}", "{\"foo\":\"bar\"}",
+        "[{\"op\":\"add\",\"path\":\"/baz/bat\",\"value\":\"qux\"}]");
+    TEST_PATCH(TINY_PATCH_OK, "{\"/\":9,\"~1\":10}", "{\"/\":9,\"~1\":10}",
+        "[{\"op\":\"test\",\"path\":\"/~01\",\"value\":10},{\"op\":\"test\",\"path\":\"/~1\",\"value\":9}]");
+    TEST_PATCH(TINY_PATCH_OK, "{\"foo\":[\"bar\",[\"abc\",\"def\"]]}", "{\"foo\":[\"bar\"]}",
+        "[{\"op\":\"add\",\"path\":\"/foo/-\",\"value\":[\"abc\",\"def\"]}]");
+
+    /* 其它 */
+    TEST_PATCH(TINY_PATCH_OK, "{\"a\":[1,2],\"b\":[1,2]}", "{\"a\":[1,2]}",
+        "[{\"op\":\"copy\",\"from\":\"/a\",\"path\":\"/b\"}]");
+    TEST_PATCH(TINY_PATCH_OK, "[1,2]", "{\"a\":1}",
+        "[{\"op\":\"replace\",\"path\":\"\",\"value\":[1,2]}]");
+    TEST_PATCH(TINY_PATCH_OK, "{\"\":[0,9]}", "{\"\":[0,1]}",
+        "[{\"op\":\"replace\",\"path\":\"/\",\"value\":[0,9]},{\"op\":\"test\",\"path\":\"//1\",\"value\":9}]");
+    TEST_PATCH(TINY_PATCH_OK, "{\"a\":[1,2,3]}", "{\"a\":[1,3]}",
+        "[{\"op\":\"add\",\"path\":\"/a/1\",\"value\":2},{\"op\":\"move\",\"from\":\"/a\",\"path\":\"/a\"}]");
+    TEST_PATCH(TINY_PATCH_INVALID_OPERATION, "{\"a\":{\"b\":1}}", "{\"a\":{\"b\":1}}",
+        "[{\"op\":\"move\",\"from\":\"/a\",\"path\":\"/a/b\"}]");
+    TEST_PATCH(TINY_PATCH_INVALID_OPERATION, "{}", "{}", "[{\"op\":\"frobnicate\",\"path\":\"/a\"}]");
+    TEST_PATCH(TINY_PATCH_INVALID_OPERATION, "{}", "{}", "[{\"op\":\"add\",\"path\":\"/a\"}]");
+    TEST_PATCH(TINY_PATCH_INVALID_OPERATION, "{}", "{}", "[1]");
+    TEST_PATCH(TINY_PATCH_INVALID_OPERATION, "{}", "{}", "{}");
+    TEST_PATCH(TINY_PATCH_INVALID_POINTER, "{}", "{}", "[{\"op\":\"add\",\"path\":\"a\",\"value\":1}]");
+    TEST_PATCH(TINY_PATCH_INVALID_POINTER, "{}", "{}", "[{\"op\":\"add\",\"path\":\"/~2\",\"value\":1}]");
+    TEST_PATCH(TINY_PATCH_PATH_NOT_FOUND, "[1]", "[1]", "[{\"op\":\"add\",\"path\":\"/2\",\"value\":1}]");
+    TEST_PATCH(TINY_PATCH_PATH_NOT_FOUND, "[1]", "[1]", "[{\"op\":\"remove\",\"path\":\"/01\"}]");
+    TEST_PATCH(TINY_PATCH_PATH_NOT_FOUND, "[1]", "[1]", "[{\"op\":\"replace\",\"path\":\"/-\",\"value\":1}]");
+    /* 失败时已执行的操作保留 */
+    TEST_PATCH(TINY_PATCH_PATH_NOT_FOUND, "{\"a\":1}", "{}",
+        "[{\"op\":\"add\",\"path\":\"/a\",\"value\":1},{\"op\":\"remove\",\"path\":\"/b\"}]");
+}
+
+#define TEST_DIFF(expectPatch, from, to)\
+    do {\
+        TinyValue f, t, d, e;\
+        TinyInitValue(&f);\
+        TinyInitValue(&t);\
+        TinyInitValue(&d);\
+        TinyInitValue(&e);\
+        EXPECT_EQ_INT(TINY_PARSE_OK, TinyParse(&f, from));\
+        EXPECT_EQ_INT(TINY_PARSE_OK, TinyParse(&t, to));\
+        EXPECT_EQ_INT(TINY_PARSE_OK, TinyParse(&e, expectPatch));\
+        TinyDiff(&d, &f, &t);\
+        EXPECT_TRUE(TinyIsEqual(&e, &d));\
+        EXPECT_EQ_INT(TINY_PATCH_OK, TinyApplyPatch(&f, &d));\
+        EXPECT_TRUE(TinyIsEqual(&t, &f));\
+        TinyFree(&f);\
+        TinyFree(&t);\
+        TinyFree(&d);\
+        TinyFree(&e);\
+    } while(0)
+
+static void TestDiff() {
+    TEST_DIFF("[]", "{\"a\":[1,{\"b\":null}]}", "{\"a\":[1,{\"b\":null}]}");
+    TEST_DIFF("[{\"op\":\"replace\",\"path\":\"\",\"value\":[1]}]", "{}", "[1]");
+    TEST_DIFF("[{\"op\":\"replace\",\"path\":\"\",\"value\":false}]", "true", "false");
+    TEST_DIFF("[{\"op\":\"replace\",\"path\":\"/a\",\"value\":2},{\"op\":\"remove\",\"path\":\"/b\"},{\"op\":\"add\",\"path\":\"/c\",\"value\":3}]",
+        "{\"a\":1,\"b\":2}", "{\"c\":3,\"a\":2}");
+    TEST_DIFF("[{\"op\":\"replace\",\"path\":\"/~0~1/x\",\"value\":\"y\"}]", "{\"~/\":{\"x\":\"x\"}}", "{\"~/\":{\"x\":\"y\"}}");
+    TEST_DIFF("[{\"op\":\"add\",\"path\":\"/1\",\"value\":\"b\"}]", "[\"a\",\"c\"]", "[\"a\",\"b\",\"c\"]");
+    TEST_DIFF("[{\"op\":\"remove\",\"path\":\"/0\"},{\"op\":\"remove\",\"path\":\"/1\"}]", "[1,2,3,4]", "[2,4]");
+    TEST_DIFF("[{\"op\":\"replace\",\"path\":\"/1/k\",\"value\":0}]", "[1,{\"k\":1},3]", "[1,{\"k\":0},3]");
+    /* 中间部分走 LCS: 相同的元素保留, 其间按位置配对 */
+    TEST_DIFF("[{\"op\":\"replace\",\"path\":\"/0\",\"value\":9},{\"op\":\"add\",\"path\":\"/2\",\"value\":7},{\"op\":\"remove\",\"path\":\"/5\"}]",
+        "[0,\"x\",[1],5,\"y\"]", "[9,\"x\",7,[1],5]");
+    TEST_DIFF("[{\"op\":\"add\",\"path\":\"/0\",\"value\":0},{\"op\":\"add\",\"path\":\"/1\",\"value\":1}]", "[]", "[0,1]");
+
+    /* 随机修改后的往返: 结果应用到 from 上得到 to */
+    TinyValue from, to, patch;
+    TinyInitValue(&from);
+    TinyInitValue(&patch);
+    TinyParse(&from, "{\"list\":[{\"id\":0},{\"id\":1},{\"id\":2},{\"id\":3},{\"id\":4},{\"id\":5}],"
+                     "\"nums\":[1,2,3,4,5,6,7,8],\"meta\":{\"a\":\"x\",\"b\":[true,false]}}");
+    for(int round = 0; round < 200; round++) {
+        TinyValue* list;
+        TinyValue* nums;
+        TinyCopy(&to, &from);
+        list = TinySetObjectValue(&to, "list", 4);
+        nums = TinySetObjectValue(&to, "nums", 4);
+        for(int k = 0; k < 3; k++) {
+            int r = rand();
+            size_t n = TinyGetArraySize(list);
+            switch(r % 5) {
+                case 0: if(n > 0) TinyEraseArrayElement(list, r / 5 % n, 1); break;
+                case 1:
+                {
+                    TinyValue* e = TinyInsertArrayElements(list, r / 5 % (n + 1), 1);
+                    TinySetObject(e, 1);
+                    TinySetNumber(TinySetObjectValue(e, "id", 2), r % 100);
+                    break;
+                }
+                case 2: if(n > 0) TinySetNumber(TinySetObjectValue(TinySetArrayElement(list, r / 5 % n), "id", 2), -1); break;
+                case 3: TinySetNumber(TinyPushBackArrayElement(nums), r % 10); break;
+                default: TinySetString(TinySetObjectValue(TinySetObjectValue(&to, "meta", 4), "c", 1), "z", 1); break;
+            }
+        }
+        TinyDiff(&patch, &from, &to);
+        TinyValue applied;
+        TinyCopy(&applied, &from);
+        EXPECT_EQ_INT(TINY_PATCH_OK, TinyApplyPatch(&applied, &patch));
+        EXPECT_TRUE(TinyIsEqual(&to, &applied));
+        TinyFree(&applied);
+        TinyMove(&from, &to);
+    }
+    TinyFree(&from);
+    TinyFree(&patch);
+}
+
+struct BindAddress {
+    std::string city;
+    int zip;
+};
+
+struct BindUser {
+    int64_t id;
+    std::string name;
+    bool active;
+    double score;
+    std::vector<std::string> tags;
+    std::vector<int> counts;
+    BindAddress address;
+    std::vector<BindAddress> history;
+    TinyOptional<std::string> nickname;
+    TinyOptional<std::vector<double> > weights;
+};
+
+TINY_BIND_BEGIN(BindAddress)
+    TINY_BIND_FIELD(city)
+    TINY_BIND_FIELD(zip)
+TINY_BIND_END()
+
+TINY_BIND_BEGIN(BindUser)
+    TINY_BIND_FIELD(id)
+    TINY_BIND_FIELD(name)
+    TINY_BIND_FIELD(active)
+    TINY_BIND_FIELD(score)
+    TINY_BIND_FIELD_AS(tags, "labels")
+    TINY_BIND_FIELD(counts)
+    TINY_BIND_FIELD(address)
+    TINY_BIND_FIELD(history)
+    TINY_BIND_FIELD(nickname)
+    TINY_BIND_FIELD(weights)
+TINY_BIND_END()
+
+#define TEST_BIND_ERROR(error, json)\
+    do {\
+        BindUser u;\
+        EXPECT_EQ_INT(error, TinyBindParse(&u, json));\
+    } while(0)
+
+static void TestBind() {
+    BindUser u;
+    size_t len;
+    u.nickname.has = true;
+    /* keys out of order, escapes, and unknown members of every kind */
+    EXPECT_EQ_INT(TINY_PARSE_OK, TinyBindParse(&u,
+        " { \"name\" : \"a\\\"b\\u00e9\\uD83D\\uDE00\", \"id\":-9007199254740993, \"extra\":{\"x\":[1,\"]}\",{\"y\":null}],\"z\":\"\\\\\"},"
+        "\"active\":true,\"score\":1.5e2,\"labels\":[\"x\",\"y\"],\"counts\":[],\"skip\":[true,false,-0.5e-3],"
+        "\"address\":{\"zip\":100080,\"city\":\"Beijing\"},\"history\":[{\"city\":\"\",\"zip\":-1}],\"weights\":[0.5,2],\"\\u0069d2\":7} "));
+    EXPECT_TRUE(u.id == -9007199254740993LL);    /* exact, not rounded through double */
+    EXPECT_EQ_STRING("a\"b\xC3\xA9\xF0\x9F\x98\x80", u.name.data(), u.name.size());
+    EXPECT_TRUE(u.active);
+    EXPECT_EQ_DOUBLE(150.0, u.score);
+    EXPECT_EQ_SIZE_T(2, u.tags.size());
+    EXPECT_EQ_STRING("y", u.tags[1].data(), u.tags[1].size());
+    EXPECT_EQ_SIZE_T(0, u.counts.size());
+    EXPECT_EQ_STRING("Beijing", u.address.city.data(), u.address.city.size());
+    EXPECT_EQ_INT(100080, u.address.zip);
+    EXPECT_EQ_SIZE_T(1, u.history.size());
+    EXPECT_EQ_INT(-1, u.history[0].zip);
+    EXPECT_FALSE(u.nickname.has);
+    EXPECT_TRUE(u.weights.has);
+    EXPECT_EQ_DOUBLE(2.0, u.weights.value[1]);
+
+    /* members are written in declaration order, absent optionals are omitted */
+    char* json = TinyBindStringify(u, &len);
+    const char expect[] = "{\"id\":-9007199254740993,\"name\":\"a\\\"b\xC3\xA9\xF0\x9F\x98\x80\",\"active\":true,\"score\":150,"
+        "\"labels\":[\"x\",\"y\"],\"counts\":[],\"address\":{\"city\":\"Beijing\",\"zip\":100080},"
+        "\"history\":[{\"city\":\"\",\"zip\":-1}],\"weights\":[0.5,2]}";
+    EXPECT_EQ_STRING(expect, json, len);
+    BindUser v;
+    EXPECT_EQ_INT(TINY_PARSE_OK, TinyBindParse(&v, json));
+    free(json);
+    v.nickname.has = true;
+    v.nickname.value = "n";
+    v.counts.push_back(3);
+    json = TinyBindStringify(v, &len);
+    TinyValue value;
+    TinyInitValue(&value);
+    EXPECT_EQ_INT(TINY_PARSE_OK, TinyParse(&value, json));
+    EXPECT_EQ_STRING("n", TinyGetString(TinyFindObjectValue(&value, "nickname", 8)), 1);
+    EXPECT_EQ_SIZE_T(1, TinyGetArraySize(TinyFindObjectValue(&value, "counts", 6)));
+    TinyFree(&value);
+    free(json);
+
+    /* the writer can hold bound values next to hand-written ones */
+    TinyWriter w;
+    TinyWriterInit(&w);
+    TinyWriterStartArray(&w);
+    TinyBindWrite(&w, u.address);
+    TinyWriterNull(&w);
+    TinyWriterEndArray(&w);
+    const char* out = TinyWriterGetString(&w, &len);
+    EXPECT_EQ_STRING("[{\"city\":\"Beijing\",\"zip\":100080},null]", out, len);
+    TinyWriterFree(&w);
+
+    std::vector<int> nums;
+    EXPECT_EQ_INT(TINY_PARSE_OK, TinyBindParse(&nums, "[1, 2.0, -3e0, 2147483647]"));
+    EXPECT_EQ_SIZE_T(4, nums.size());
+    EXPECT_EQ_INT(-3, nums[2]);
+    EXPECT_EQ_INT(TINY_BIND_TYPE_MISMATCH, TinyBindParse(&nums, "[2147483648]"));
+    EXPECT_EQ_INT(TINY_BIND_TYPE_MISMATCH, TinyBindParse(&nums, "[1.5]"));
+    EXPECT_EQ_INT(TINY_BIND_TYPE_MISMATCH, TinyBindParse(&nums, "[\"1\"]"));
+    EXPECT_EQ_INT(TINY_PARSE_INVALID_VALUE, TinyBindParse(&nums, "[01]"));
+    EXPECT_EQ_INT(TINY_PARSE_INVALID_VALUE, TinyBindParse(&nums, "[-]"));
+    EXPECT_EQ_INT(TINY_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, TinyBindParse(&nums, "[1 2]"));
+    EXPECT_EQ_INT(TINY_PARSE_ROOT_NOT_SINGULAR, TinyBindParse(&nums, "[1] x"));
+
+    /* 64-bit integers are exact over the whole range and never silently rounded */
+    std::vector<int64_t> longs;
+    EXPECT_EQ_INT(TINY_PARSE_OK, TinyBindParse(&longs, "[9223372036854775807,-9223372036854775808,1234567890123456789,-0]"));
+    EXPECT_EQ_SIZE_T(4, longs.size());
+    EXPECT_TRUE(longs[0] == INT64_MAX);
+    EXPECT_TRUE(longs[1] == INT64_MIN);
+    EXPECT_TRUE(longs[2] == 1234567890123456789LL);
+    EXPECT_TRUE(longs[3] == 0);
+    EXPECT_EQ_INT(TINY_BIND_TYPE_MISMATCH, TinyBindParse(&longs, "[9223372036854775808]"));
+    EXPECT_EQ_INT(TINY_BIND_TYPE_MISMATCH, TinyBindParse(&longs, "[-9223372036854775809]"));
+    EXPECT_EQ_INT(TINY_BIND_TYPE_MISMATCH, TinyBindParse(&longs, "[123456789012345678901234567890]"));
+    EXPECT_EQ_INT(TINY_PARSE_OK, TinyBindParse(&longs, "[1.5e3]"));
+    EXPECT_TRUE(longs[0] == 1500);
+
+    /* underflow is not an error: subnormals and values that round to zero parse as in TinyParse */
+    std::vector<double> doubles;
+    EXPECT_EQ_INT(TINY_PARSE_OK, TinyBindParse(&doubles, "[1e-320, 4.9406564584124654e-324, 1e-400, -1e-320]"));
+    EXPECT_EQ_SIZE_T(4, doubles.size());
+    EXPECT_EQ_DOUBLE(1e-320, doubles[0]);
+    EXPECT_EQ_DOUBLE(4.9406564584124654e-324, doubles[1]);
+    EXPECT_EQ_DOUBLE(0.0, doubles[2]);
+    EXPECT_EQ_DOUBLE(-1e-320, doubles[3]);
+    EXPECT_EQ_INT(TINY_PARSE_NUMBER_TOO_BIG, TinyBindParse(&doubles, "[1e309]"));
+    EXPECT_EQ_INT(TINY_PARSE_NUMBER_TOO_BIG, TinyBindParse(&doubles, "[-1e309]"));
+
+    const char* base = "\"id\":1,\"name\":\"n\",\"active\":false,\"score\":0,\"labels\":[],\"counts\":[],"
+                       "\"address\":{\"city\":\"c\",\"zip\":1},\"history\":[]";
+    char buf[512];
+    sprintf(buf, "{%s}", base);
+    TEST_BIND_ERROR(TINY_PARSE_OK, buf);
+    sprintf(buf, "{%s,\"nickname\":null}", base);
+    TEST_BIND_ERROR(TINY_PARSE_OK, buf);
+    sprintf(buf, "{%s,\"unknown\":[}]}", base);
+    TEST_BIND_ERROR(TINY_PARSE_INVALID_VALUE, buf);
+    sprintf(buf, "{%s,\"unknown\":[1,\"a}", base);
+    TEST_BIND_ERROR(TINY_PARSE_MISS_QUOTATION_MARK, buf);
+    sprintf(buf, "{%s,\"unknown\":[1 2]}", base);
+    TEST_BIND_ERROR(TINY_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, buf);
+    sprintf(buf, "{%s,\"unknown\":{\"a\":1,}}", base);
+    TEST_BIND_ERROR(TINY_PARSE_MISS_KEY, buf);
+    sprintf(buf, "{%s,\"nickname\":5}", base);
+    TEST_BIND_ERROR(TINY_BIND_TYPE_MISMATCH, buf);
+    sprintf(buf, "{%s,\"address\":[]}", base);
+    TEST_BIND_ERROR(TINY_BIND_TYPE_MISMATCH, buf);
+    sprintf(buf, "{%s,\"history\":[{\"city\":\"c\"}]}", base);
+    TEST_BIND_ERROR(TINY_BIND_MISSING_FIELD, buf);
+    sprintf(buf, "{%s,\"active\":nul}", base);
+    TEST_BIND_ERROR(TINY_PARSE_INVALID_VALUE, buf);
+    sprintf(buf, "{%s \"x\":1}", base);
+    TEST_BIND_ERROR(TINY_PARSE_MISS_COMMA_OR_CURLY_BRACKET, buf);
+    sprintf(buf, "{%s,\"x\" 1}", base);
+    TEST_BIND_ERROR(TINY_PARSE_MISS_COLON, buf);
+    TEST_BIND_ERROR(TINY_BIND_MISSING_FIELD, "{\"id\":1}");
+    TEST_BIND_ERROR(TINY_BIND_TYPE_MISMATCH, "[]");
+    TEST_BIND_ERROR(TINY_PARSE_EXPECT_VALUE, "");
+    TEST_BIND_ERROR(TINY_PARSE_MISS_KEY, "{1:2}");
+}
+
+/* the DOM and text validators must agree on every well-formed input */
+#define TEST_SCHEMA(expect, schemaJson, json)\
+    do {\
+        TinyValue sv, v;\
+        TinySchema schema;\
+        TinyInitValue(&sv);\
+        TinyInitValue(&v);\
+        EXPECT_EQ_INT(TINY_PARSE_OK, TinyParse(&sv, schemaJson));\
+        EXPECT_EQ_INT(TINY_SCHEMA_OK, TinySchemaCompile(&schema, &sv));\
+        TinyFree(&sv);\
+        EXPECT_EQ_INT(TINY_PARSE_OK, TinyParse(&v, json));\
+        EXPECT_EQ_INT(expect, TinySchemaValidate(&schema, &v));\
+        EXPECT_EQ_INT(expect, TinySchemaValidateJson(&schema, json));\
+        TinyFree(&v);\
+        TinySchemaFree(&schema);\
+    } while(0)
+
+#define TEST_SCHEMA_INVALID(schemaJson)\
+    do {\
+        TinyValue sv;\
+        TinySchema schema;\
+        TinyInitValue(&sv);\
+        EXPECT_EQ_INT(TINY_PARSE_OK, TinyParse(&sv, schemaJson));\
+        EXPECT_EQ_INT(TINY_SCHEMA_INVALID, TinySchemaCompile(&schema, &sv));\
+        TinySchemaFree(&schema);\
+        TinyFree(&sv);\
+    } while(0)
+
+static void TestSchema() {
+    TEST_SCHEMA(TINY_SCHEMA_OK, "{}", "[1,{\"a\":null}]");
+    TEST_SCHEMA(TINY_SCHEMA_OK, "true", "\"x\"");
+    TEST_SCHEMA(TINY_SCHEMA_TYPE_MISMATCH, "false", "null");
+    TEST_SCHEMA(TINY_SCHEMA_OK, "{\"title\":\"t\",\"format\":\"email\",\"x-custom\":1}", "3");
+
+    /* type, integer is a subset of number */
+    TEST_SCHEMA(TINY_SCHEMA_OK, "{\"type\":\"integer\"}", "-3e2");
+    TEST_SCHEMA(TINY_SCHEMA_TYPE_MISMATCH, "{\"type\":\"integer\"}", "1.5");
+    TEST_SCHEMA(TINY_SCHEMA_OK, "{\"type\":\"number\"}", "1.5");
+    TEST_SCHEMA(TINY_SCHEMA_OK, "{\"type\":[\"string\",\"null\"]}", "null");
+    TEST_SCHEMA(TINY_SCHEMA_TYPE_MISMATCH, "{\"type\":[\"string\",\"null\"]}", "false");
+    TEST_SCHEMA(TINY_SCHEMA_OK, "{\"type\":\"boolean\"}", "true");
+    TEST_SCHEMA(TINY_SCHEMA_TYPE_MISMATCH, "{\"type\":\"object\"}", "[{}]");
+    TEST_SCHEMA(TINY_SCHEMA_TYPE_MISMATCH, "{\"type\":\"array\"}", "{\"a\":[]}");
+
+    /* numeric bounds, both exclusive forms; the tighter bound wins */
+    TEST_SCHEMA(TINY_SCHEMA_OK, "{\"minimum\":1,\"maximum\":3}", "3");
+    TEST_SCHEMA(TINY_SCHEMA_OUT_OF_RANGE, "{\"minimum\":1,\"maximum\":3}", "0.5");
+    TEST_SCHEMA(TINY_SCHEMA_OUT_OF_RANGE, "{\"exclusiveMaximum\":3}", "3");
+    TEST_SCHEMA(TINY_SCHEMA_OUT_OF_RANGE, "{\"minimum\":1,\"exclusiveMinimum\":true}", "1");
+    TEST_SCHEMA(TINY_SCHEMA_OK, "{\"minimum\":1,\"exclusiveMinimum\":false}", "1");
+    TEST_SCHEMA(TINY_SCHEMA_OUT_OF_RANGE, "{\"exclusiveMinimum\":2,\"minimum\":1}", "2");
+    TEST_SCHEMA(TINY_SCHEMA_OUT_OF_RANGE, "{\"minimum\":5,\"exclusiveMinimum\":1}", "4");
+    TEST_SCHEMA(TINY_SCHEMA_OK, "{\"minimum\":5}", "\"string\"");
+
+    /* lengths count code points, not bytes or escapes */
+    TEST_SCHEMA(TINY_SCHEMA_OK, "{\"maxLength\":2}", "\"\xE4\xB8\xAD\xF0\x9D\x84\x9E\"");
+    TEST_SCHEMA(TINY_SCHEMA_OUT_OF_RANGE, "{\"maxLength\":1}", "\"\xE4\xB8\xAD\xF0\x9D\x84\x9E\"");
+    TEST_SCHEMA(TINY_SCHEMA_OK, "{\"minLength\":2,\"maxLength\":2}", "\"\\n\\u00E9\"");
+    TEST_SCHEMA(TINY_SCHEMA_OUT_OF_RANGE, "{\"minLength\":1}", "\"\"");
+
+    /* enum and const compare whole values, key order ignored */
+    TEST_SCHEMA(TINY_SCHEMA_OK, "{\"enum\":[1,\"a\",{\"x\":1,\"y\":[2]}]}", "{\"y\":[2],\"x\":1}");
+    TEST_SCHEMA(TINY_SCHEMA_ENUM_MISMATCH, "{\"enum\":[1,\"a\",{\"x\":1,\"y\":[2]}]}", "{\"y\":[3],\"x\":1}");
+    TEST_SCHEMA(TINY_SCHEMA_ENUM_MISMATCH, "{\"enum\":[1,2,3]}", "4");
+    TEST_SCHEMA(TINY_SCHEMA_OK, "{\"const\":null}", "null");
+    TEST_SCHEMA(TINY_SCHEMA_ENUM_MISMATCH, "{\"enum\":[true,null,\"false\"]}", "false");
+    TEST_SCHEMA(TINY_SCHEMA_OK, "{\"enum\":[true,null,\"false\"]}", "true");
+    TEST_SCHEMA(TINY_SCHEMA_TYPE_MISMATCH, "{\"type\":\"string\",\"enum\":[1]}", "1");
+
+    /* arrays */
+    TEST_SCHEMA(TINY_SCHEMA_OK, "{\"items\":{\"type\":\"integer\"},\"minItems\":1}", "[1,2,3]");
+    TEST_SCHEMA(TINY_SCHEMA_TYPE_MISMATCH, "{\"items\":{\"type\":\"integer\"}}", "[1,2.5,3]");
+    TEST_SCHEMA(TINY_SCHEMA_OUT_OF_RANGE, "{\"items\":{\"type\":\"integer\"},\"minItems\":1}", "[]");
+    TEST_SCHEMA(TINY_SCHEMA_OUT_OF_RANGE, "{\"maxItems\":2}", "[1,[2],3]");
+    TEST_SCHEMA(TINY_SCHEMA_TYPE_MISMATCH, "{\"items\":false}", "[null]");
+    TEST_SCHEMA(TINY_SCHEMA_OK, "{\"items\":false}", "[]");
+
+    /* objects */
+    const char* user = "{\"type\":\"object\",\"required\":[\"id\",\"name\",\"id\"],\"additionalProperties\":false,"
+                       "\"properties\":{\"id\":{\"type\":\"integer\",\"minimum\":1},\"name\":{\"type\":\"string\"},"
+                       "\"tags\":{\"items\":{\"enum\":[\"a\",\"b\"]},\"maxItems\":2}}}";
+    TEST_SCHEMA(TINY_SCHEMA_OK, user, "{\"name\":\"n\",\"id\":7,\"tags\":[\"b\"]}");
+    TEST_SCHEMA(TINY_SCHEMA_MISSING_PROPERTY, user, "{\"name\":\"n\"}");
+    TEST_SCHEMA(TINY_SCHEMA_MISSING_PROPERTY, user, "{\"id\":1,\"tags\":[]}");
+    TEST_SCHEMA(TINY_SCHEMA_ADDITIONAL_PROPERTY, user, "{\"id\":1,\"name\":\"n\",\"x\":1}");
+    TEST_SCHEMA(TINY_SCHEMA_OUT_OF_RANGE, user, "{\"id\":0,\"name\":\"n\"}");
+    TEST_SCHEMA(TINY_SCHEMA_ENUM_MISMATCH, user, "{\"id\":1,\"name\":\"n\",\"tags\":[\"c\"]}");
+    TEST_SCHEMA(TINY_SCHEMA_OK, "{\"additionalProperties\":{\"type\":\"number\"},\"properties\":{\"a\":true}}",
+                "{\"a\":\"s\",\"b\":1}");
+    TEST_SCHEMA(TINY_SCHEMA_TYPE_MISMATCH, "{\"additionalProperties\":{\"type\":\"number\"},\"properties\":{\"a\":true}}",
+                "{\"a\":\"s\",\"b\":\"t\"}");
+    /* a name only listed in required is still an additional property */
+    TEST_SCHEMA(TINY_SCHEMA_ADDITIONAL_PROPERTY, "{\"required\":[\"a\"],\"additionalProperties\":false}", "{\"a\":1}");
+    TEST_SCHEMA(TINY_SCHEMA_OK, "{\"minProperties\":1,\"maxProperties\":2}", "{\"a\":1,\"b\":2}");
+    TEST_SCHEMA(TINY_SCHEMA_OUT_OF_RANGE, "{\"minProperties\":1,\"maxProperties\":2}", "{\"a\":1,\"b\":2,\"c\":3}");
+    TEST_SCHEMA(TINY_SCHEMA_OUT_OF_RANGE, "{\"minProperties\":1}", "{}");
+    TEST_SCHEMA(TINY_SCHEMA_OK, "{\"properties\":{\"a\\\"b\":{\"type\":\"null\"}}}", "{\"a\\u0022b\":null}");
+    TEST_SCHEMA(TINY_SCHEMA_TYPE_MISMATCH, "{\"properties\":{\"a\\\"b\":{\"type\":\"null\"}}}", "{\"a\\\"b\":1}");
+
+    /* more than 64 required members, checked with several bitmap words */
+    char schemaBuf[4096], jsonBuf[4096];
+    size_t sl = sprintf(schemaBuf, "{\"required\":["), jl = sprintf(jsonBuf, "{");
+    for(int i = 0; i < 100; i++) {
+        sl += sprintf(schemaBuf + sl, "%s\"k%d\"", i ? "," : "", i);
+        if(i != 77) jl += sprintf(jsonBuf + jl, "%s\"k%d\":%d", i ? "," : "", i, i);
+    }
+    sprintf(schemaBuf + sl, "]}");
+    jl += sprintf(jsonBuf + jl, "}");
+    TEST_SCHEMA(TINY_SCHEMA_MISSING_PROPERTY, schemaBuf, jsonBuf);
+    sprintf(jsonBuf + jl - 1, ",\"k77\":0}");
+    TEST_SCHEMA(TINY_SCHEMA_OK, schemaBuf, jsonBuf);
+
+    TEST_SCHEMA_INVALID("1");
+    TEST_SCHEMA_INVALID("{\"type\":\"float\"}");
+    TEST_SCHEMA_INVALID("{\"type\":[\"string\",1]}");
+    TEST_SCHEMA_INVALID("{\"pattern\":\"^a\"}");
+    TEST_SCHEMA_INVALID("{\"properties\":{\"a\":{\"$ref\":\"#\"}}}");
+    TEST_SCHEMA_INVALID("{\"items\":[{}]}");
+    TEST_SCHEMA_INVALID("{\"minLength\":-1}");
+    TEST_SCHEMA_INVALID("{\"maxItems\":1.5}");
+    TEST_SCHEMA_INVALID("{\"required\":[1]}");
+    TEST_SCHEMA_INVALID("{\"enum\":1}");
+
+    /* text validation reports syntax errors and rejects before building a value */
+    TinyValue sv, v;
+    TinySchema schema;
+    TinyInitValue(&sv);
+    TinyInitValue(&v);
+    EXPECT_EQ_INT(TINY_PARSE_OK, TinyParse(&sv, user));
+    EXPECT_EQ_INT(TINY_SCHEMA_OK, TinySchemaCompile(&schema, &sv));
+    TinyFree(&sv);
+    EXPECT_EQ_INT(TINY_PARSE_EXPECT_VALUE, TinySchemaValidateJson(&schema, " "));
+    EXPECT_EQ_INT(TINY_PARSE_ROOT_NOT_SINGULAR, TinySchemaValidateJson(&schema, "{\"id\":1,\"name\":\"n\"} x"));
+    EXPECT_EQ_INT(TINY_PARSE_MISS_COLON, TinySchemaValidateJson(&schema, "{\"id\" 1}"));
+    EXPECT_EQ_INT(TINY_PARSE_MISS_KEY, TinySchemaValidateJson(&schema, "{1:1}"));
+    EXPECT_EQ_INT(TINY_PARSE_MISS_COMMA_OR_CURLY_BRACKET, TinySchemaValidateJson(&schema, "{\"id\":1 \"name\":\"n\"}"));
+    EXPECT_EQ_INT(TINY_PARSE_INVALID_VALUE, TinySchemaValidateJson(&schema, "{\"id\":1,\"name\":nul}"));
+    EXPECT_EQ_INT(TINY_PARSE_MISS_QUOTATION_MARK, TinySchemaValidateJson(&schema, "{\"id\":1,\"name\":\"n"));
+    EXPECT_EQ_INT(TINY_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, TinySchemaValidateJson(&schema, "{\"tags\":[\"a\" \"b\"]}"));
+    /* members the schema leaves unconstrained are still checked for syntax */
+    TinySchema loose;
+    EXPECT_EQ_INT(TINY_PARSE_OK, TinyParse(&sv, "{\"properties\":{\"id\":{\"type\":\"integer\"}}}"));
+    EXPECT_EQ_INT(TINY_SCHEMA_OK, TinySchemaCompile(&loose, &sv));
+    TinyFree(&sv);
+    EXPECT_EQ_INT(TINY_SCHEMA_OK, TinySchemaValidateJson(&loose, "{\"id\":1,\"note\":[1,{\"a\":2}]}"));
+    EXPECT_EQ_INT(TINY_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, TinySchemaValidateJson(&loose, "{\"id\":1,\"note\":[1 2]}"));
+    EXPECT_EQ_INT(TINY_PARSE_MISS_COLON, TinySchemaValidateJson(&loose, "{\"id\":1,\"note\":{\"a\" 1}}"));
+    EXPECT_EQ_INT(TINY_PARSE_INVALID_VALUE, TinySchemaValidateJson(&loose, "{\"id\":1,\"note\":[1,]}"));
+    EXPECT_EQ_INT(TINY_SCHEMA_OK, TinySchemaValidateJson(&loose, "{\"id\":1,\"note\":[1e-320]}"));
+    TinySchemaFree(&loose);
+    /* the first violation stops the scan, so later syntax errors go unseen */
+    EXPECT_EQ_INT(TINY_SCHEMA_TYPE_MISMATCH, TinySchemaValidateJson(&schema, "[1,2,"));
+    EXPECT_EQ_INT(TINY_SCHEMA_OUT_OF_RANGE, TinySchemaValidateJson(&schema, "{\"id\":-1,\"name\":"));
+    EXPECT_EQ_INT(TINY_SCHEMA_ADDITIONAL_PROPERTY, TinySchemaValidateJson(&schema, "{\"id\":1,\"x\":[[[["));
+
+    TinySetNumber(&v, 5);
+    EXPECT_EQ_INT(TINY_SCHEMA_MISSING_PROPERTY, TinySchemaParse(&schema, &v, "{\"name\":\"n\"}"));
+    EXPECT_EQ_INT(TINY_NUMBER, TinyGetType(&v));
+    EXPECT_EQ_INT(TINY_SCHEMA_OK, TinySchemaParse(&schema, &v, " {\"id\":2,\"name\":\"n\"} "));
+    EXPECT_EQ_INT(TINY_OBJECT, TinyGetType(&v));
+    EXPECT_EQ_SIZE_T(2, TinyGetObjectSize(&v));
+    TinyFree(&v);
+    TinySchemaFree(&schema);
+}
+
+/* matches joined with '|', stop after 'limit' of them */
+struct PathMatches {
+    std::string out;
+    int count, limit;
+};
+
+static bool PathCollect(void* user, const char* json, size_t len) {
+    PathMatches* m = (PathMatches*)user;
+    if(m->count++ > 0) m->out += '|';
+    m->out.append(json, len);
+    return m->count != m->limit;
+}
+
+#define TEST_PATH_LIMIT(expectReact, expect, expr, json, maxMatches)\
+    do {\
+        TinyPath path;\
+        PathMatches m;\
+        m.count = 0;\
+        m.limit = maxMatches;\
+        EXPECT_EQ_INT(TINY_PATH_OK, TinyPathCompile(&path, expr));\
+        EXPECT_EQ_INT(expectReact, TinyPathQuery(&path, json, PathCollect, &m));\
+        EXPECT_EQ_STRING(expect, m.out.c_str(), m.out.size());\
+        TinyPathFree(&path);\
+    } while(0)
+
+#define TEST_PATH(expect, expr, json) TEST_PATH_LIMIT(TINY_PATH_OK, expect, expr, json, -1)
+
+#define TEST_PATH_INVALID(expr)\
+    do {\
+        TinyPath path;\
+        EXPECT_EQ_INT(TINY_PATH_INVALID, TinyPathCompile(&path, expr));\
+        TinyPathFree(&path);\
+    } while(0)
+
+static void TestPath() {
+    const char* doc = "{\"events\":[{\"user\":{\"id\":1,\"name\":\"a\"},\"tags\":[\"x\"]},"
+                      " {\"user\":{\"id\":2}}, {\"type\":\"ping\"}, {\"user\":{\"id\":[3, {\"id\":4}]}}],"
+                      " \"id\":\"root\", \"a b\":{\"it's\":true}}";
+    TEST_PATH("1|2|[3, {\"id\":4}]", "$.events[*].user.id", doc);
+    TEST_PATH("1|2|4|[3, {\"id\":4}]|\"root\"", "$..id", doc);
+    TEST_PATH("{\"user\":{\"id\":2}}", "$.events[1]", doc);
+    TEST_PATH("{\"user\":{\"id\":2}}|{\"user\":{\"id\":[3, {\"id\":4}]}}", "$['events'][1:4:2]", doc);
+    TEST_PATH("\"ping\"", "$.events[2:].type", doc);
+    TEST_PATH("{\"id\":1,\"name\":\"a\"}|{\"id\":2}", "$.events[:2].user", doc);
+    TEST_PATH("true", "$[\"a b\"]['it\\'s']", doc);
+    TEST_PATH("\"x\"", "$..tags[0]", doc);
+    TEST_PATH("4", "$..id[1].id", doc);
+    TEST_PATH("", "$.events[9]", doc);
+    TEST_PATH("", "$.missing..id", doc);
+    TEST_PATH("", "$.events.user", doc);
+    TEST_PATH("[1, 2]", "$", " [1, 2] ");
+    TEST_PATH("1|2", "$.*", "{\"a\":1,\"b\":2}");
+    TEST_PATH("1|[1]|[[1]]", "$..*", "[[[1]]]");
+    TEST_PATH("\"v\"", "$.k", "{\"k\\u0022\":1,\"k\":\"v\"}");
+    TEST_PATH("1|2", "$.k", "{\"k\":1,\"k\":2}");
+
+    /* subnormals are valid numbers, in matches and in skipped subtrees alike */
+    TEST_PATH("1e-320", "$.x", "{\"x\":1e-320}");
+    TEST_PATH("1", "$.a", "{\"s\":[4.9406564584124654e-324],\"a\":1}");
+    TEST_PATH_LIMIT(TINY_PARSE_NUMBER_TOO_BIG, "", "$.a", "{\"s\":[1e309],\"a\":1}", -1);
+
+    /* the callback can stop early, leaving the rest unread */
+    TEST_PATH_LIMIT(TINY_PATH_OK, "1", "$..id", doc, 1);
+    TEST_PATH_LIMIT(TINY_PATH_OK, "1", "$[*]", "[1, {oops", 1);
+
+    /* syntax errors are still reported, after the matches before them */
+    TEST_PATH_LIMIT(TINY_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, "1", "$[*]", "[1 2]", -1);
+    TEST_PATH_LIMIT(TINY_PARSE_MISS_COMMA_OR_CURLY_BRACKET, "1", "$.a", "{\"a\":1 \"b\":2}", -1);
+    TEST_PATH_LIMIT(TINY_PARSE_MISS_COLON, "", "$.a", "{\"a\" 1}", -1);
+    TEST_PATH_LIMIT(TINY_PARSE_MISS_KEY, "", "$.a", "{\"b\":1,}", -1);
+    TEST_PATH_LIMIT(TINY_PARSE_INVALID_VALUE, "1", "$.b[*]", "{\"b\":[1,]}", -1);
+    TEST_PATH_LIMIT(TINY_PARSE_INVALID_VALUE, "", "$.a", "{\"b\":[}]}", -1);
+    TEST_PATH_LIMIT(TINY_PARSE_EXPECT_VALUE, "", "$.a", " ", -1);
+    TEST_PATH_LIMIT(TINY_PARSE_MISS_KEY, "", "$.a", "{", -1);
+    TEST_PATH_LIMIT(TINY_PARSE_ROOT_NOT_SINGULAR, "1", "$.a", "{\"a\":1} 2", -1);
+    /* skipped subtrees get the same separator checks as traversed ones */
+    TEST_PATH_LIMIT(TINY_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, "1", "$.a", "{\"a\":1,\"b\":[1 2]}", -1);
+    TEST_PATH_LIMIT(TINY_PARSE_INVALID_VALUE, "1", "$.a", "{\"a\":1,\"b\":[1,]}", -1);
+    TEST_PATH_LIMIT(TINY_PARSE_MISS_COLON, "", "$.a", "{\"b\":{\"c\" 1},\"a\":1}", -1);
+    TEST_PATH_LIMIT(TINY_PARSE_MISS_KEY, "", "$.a", "{\"b\":{,},\"a\":1}", -1);
+    TEST_PATH_LIMIT(TINY_PARSE_MISS_COMMA_OR_CURLY_BRACKET, "", "$.a", "{\"b\":{\"c\":1:2},\"a\":1}", -1);
+    TEST_PATH_LIMIT(TINY_PARSE_INVALID_VALUE, "", "$.a", "{\"b\":[:],\"a\":1}", -1);
+
+    /* depth is limited by memory only */
+    std::string deep(100000, '[');
+    deep += "{\"v\":7}";
+    deep += std::string(100000, ']');
+    TEST_PATH("7", "$..v", deep.c_str());
+
+    TEST_PATH_INVALID("");
+    TEST_PATH_INVALID("a.b");
+    TEST_PATH_INVALID("$.");
+    TEST_PATH_INVALID("$..");
+    TEST_PATH_INVALID("$[-1]");
+    TEST_PATH_INVALID("$[1,2]");
+    TEST_PATH_INVALID("$[?(@.a)]");
+    TEST_PATH_INVALID("$['a]");
+    TEST_PATH_INVALID("$[0:5:0]");
+    TEST_PATH_INVALID("$[99999999999999999999999]");
+
+    /* matches can be turned into values */
+    TinyPath path;
+    PathMatches m;
+    TinyValue v;
+    m.count = 0;
+    m.limit = -1;
+    TinyInitValue(&v);
+    EXPECT_EQ_INT(TINY_PATH_OK, TinyPathCompile(&path, "$.events[3].user"));
+    EXPECT_EQ_INT(TINY_PATH_OK, TinyPathQuery(&path, doc, PathCollect, &m));
+    EXPECT_EQ_INT(TINY_PARSE_OK, TinyPathParseMatch(&v, m.out.data(), m.out.size()));
+    EXPECT_EQ_INT(TINY_OBJECT, TinyGetType(&v));
+    EXPECT_EQ_SIZE_T(2, TinyGetArraySize(TinyFindObjectValue(&v, "id", 2)));
+    TinyFree(&v);
+    TinyPathFree(&path);
+}
+
+static void TestStats() {
+    TinyStats st;
+    TinyValue v;
+    size_t len;
+    const char* json = " [1,\"a\",{\"k\":[null,true,false]}] ";
+    EXPECT_EQ_STRING("parse_bytes", TinyGetStatName(TINY_STAT_PARSE_BYTES), 11);
+    EXPECT_EQ_STRING("max_depth", TinyGetStatName(TINY_STAT_MAX_DEPTH), 9);
+    TinyInitValue(&v);
+    TinyResetStats();
+    TinyResetGlobalStats();
+    EXPECT_EQ_INT(TINY_PARSE_OK, TinyParse(&v, json));
+    free(TinyStringify(&v, &len));
+    TinyGetStats(&st);
+#if TINY_ENABLE_STATS
+    EXPECT_EQ_SIZE_T(1, st.counts[TINY_STAT_PARSES]);
+    EXPECT_EQ_SIZE_T(0, st.counts[TINY_STAT_PARSE_ERRORS]);
+    EXPECT_EQ_SIZE_T(strlen(json), st.counts[TINY_STAT_PARSE_BYTES]);
+    EXPECT_EQ_SIZE_T(1, st.counts[TINY_STAT_NULLS]);
+    EXPECT_EQ_SIZE_T(1, st.counts[TINY_STAT_FALSES]);
+    EXPECT_EQ_SIZE_T(1, st.counts[TINY_STAT_TRUES]);
+    EXPECT_EQ_SIZE_T(1, st.counts[TINY_STAT_NUMBERS]);
+    EXPECT_EQ_SIZE_T(1, st.counts[TINY_STAT_STRINGS]);
+    EXPECT_EQ_SIZE_T(2, st.counts[TINY_STAT_ARRAYS]);
+    EXPECT_EQ_SIZE_T(1, st.counts[TINY_STAT_OBJECTS]);
+    EXPECT_EQ_SIZE_T(3, st.counts[TINY_STAT_MAX_DEPTH]);
+    EXPECT_EQ_SIZE_T(1, st.counts[TINY_STAT_STRINGIFIES]);
+    EXPECT_EQ_SIZE_T(len, st.counts[TINY_STAT_STRINGIFY_BYTES]);
+    EXPECT_TRUE(st.counts[TINY_STAT_ALLOCS] > 0 && st.counts[TINY_STAT_ALLOC_BYTES] > 0);
+    EXPECT_TRUE(st.counts[TINY_STAT_STACK_GROWS] > 0 && st.counts[TINY_STAT_STACK_PEAK] >= TINY_STACK_SIZE);
+
+    /* 出错的解析也计入, 只计到出错的位置 */
+    TinyFree(&v);
+    EXPECT_EQ_INT(TINY_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, TinyParse(&v, "[1 2]"));
+    TinyGetStats(&st);
+    EXPECT_EQ_SIZE_T(2, st.counts[TINY_STAT_PARSES]);
+    EXPECT_EQ_SIZE_T(1, st.counts[TINY_STAT_PARSE_ERRORS]);
+    EXPECT_EQ_SIZE_T(strlen(json) + 3, st.counts[TINY_STAT_PARSE_BYTES]);
+
+    /* 汇总包括已经退出的线程, 峰值取最大 */
+    std::thread worker([]() {
+        TinyValue w;
+        TinyInitValue(&w);
+        for(int i = 0; i < 10; i++) {
+            TinyParse(&w, "[[[[[0]]]]]");
+            TinyFree(&w);
+        }
+    });
+    worker.join();
+    TinyGetGlobalStats(&st);
+    EXPECT_EQ_SIZE_T(12, st.counts[TINY_STAT_PARSES]);
+    EXPECT_EQ_SIZE_T(5, st.counts[TINY_STAT_MAX_DEPTH]);
+    TinyGetStats(&st);
+    EXPECT_EQ_SIZE_T(2, st.counts[TINY_STAT_PARSES]);
+    EXPECT_EQ_SIZE_T(3, st.counts[TINY_STAT_MAX_DEPTH]);
+
+    TinyResetStats();
+    TinyGetStats(&st);
+    EXPECT_EQ_SIZE_T(0, st.counts[TINY_STAT_PARSES]);
+    EXPECT_EQ_SIZE_T(0, st.counts[TINY_STAT_MAX_DEPTH]);
+    TinyResetGlobalStats();
+    TinyGetGlobalStats(&st);
+    EXPECT_EQ_SIZE_T(0, st.counts[TINY_STAT_PARSES]);
+    EXPECT_EQ_SIZE_T(0, st.counts[TINY_STAT_MAX_DEPTH]);
+#else
+    /* 未打开统计时全部为 0 */
+    for(int i = 0; i < TINY_STAT_COUNT; i++) EXPECT_EQ_SIZE_T(0, st.counts[i]);
+#endif
+    TinyFree(&v);
+}
+
 int main() {
     TestParse();
     TestAccess();
     TestStringify();
     TestEqual();
+    TestEqualLargeObject();
+    TestHash();
     TestCopy();
+    TestCopyOnWrite();
     TestMove();
     TestSwap();
+    TestMsgPack();
+    TestCbor();
+    TestSnapshot();
+    TestShared();
+    TestSharedThreads();
+    TestReclaim();
+    TestReclaimThread();
+    TestMergePatch();
+    TestPatch();
+    TestDiff();
+    TestBind();
+    TestSchema();
+    TestPath();
+    TestStats();
     printf("%d/%d (%3.2f%%) passed!\n", testPass, testCount, 100.0 * testPass / testCount);
     return mainRet;
 }
\ No newline at end of file